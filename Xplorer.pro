@@ -1,8 +1,11 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
+# QFuture::then(), QList::removeIf() and the other Qt 6 APIs used throughout the code need Qt 6.
+lessThan(QT_MAJOR_VERSION, 6): error("Xplorer requires Qt 6.2 or newer.")
+
+CONFIG += c++17
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -11,27 +14,100 @@ CONFIG += c++11
 SOURCES += \
     src/main.cpp \
     src/types/actionmanager.cpp \
+    src/types/directorycache.cpp \
+    src/types/directorycompare.cpp \
+    src/types/directoryentries.cpp \
+    src/types/directorylisting.cpp \
+    src/types/directorymodel.cpp \
+    src/types/directoryprefetcher.cpp \
+    src/types/directoryreader.cpp \
+    src/types/directorytreemodel.cpp \
+    src/types/directorywatcher.cpp \
+    src/types/duplicatefinder.cpp \
     src/types/explorermanager.cpp \
     src/types/explorersplitter.cpp \
     src/types/explorersplitterhandle.cpp \
+    src/types/fileindex.cpp \
+    src/types/fileindexer.cpp \
+    src/types/fileoperation.cpp \
+    src/types/filesearch.cpp \
+    src/types/filesystemaccess.cpp \
+    src/types/foldersizeservice.cpp \
+    src/types/historycache.cpp \
+    src/types/iconservice.cpp \
+    src/types/mimesniffer.cpp \
+    src/types/mimetypetable.cpp \
+    src/types/mountmonitor.cpp \
+    src/types/namematcher.cpp \
     src/types/opendircommand.cpp \
+    src/types/previewdocument.cpp \
+    src/types/previewview.cpp \
+    src/types/searchresultsmodel.cpp \
+    src/types/sessionsnapshot.cpp \
+    src/types/thumbnailservice.cpp \
+    src/types/trashcommand.cpp \
+    src/types/trashservice.cpp \
     src/types/treeviewmanager.cpp \
     src/ui/aboutdialog.cpp \
-    src/ui/mainwindow.cpp
+    src/ui/analyzedialog.cpp \
+    src/ui/duplicatesdialog.cpp \
+    src/ui/mainwindow.cpp \
+    src/ui/operationdialog.cpp \
+    src/ui/searchdialog.cpp \
+    src/ui/trashdialog.cpp
 
 HEADERS += \
     src/types/actionmanager.h \
+    src/types/directorycache.h \
+    src/types/directorycompare.h \
+    src/types/directoryentries.h \
+    src/types/directorylisting.h \
+    src/types/directorymodel.h \
+    src/types/directoryprefetcher.h \
+    src/types/directoryreader.h \
+    src/types/directorytreemodel.h \
+    src/types/directorywatcher.h \
+    src/types/duplicatefinder.h \
     src/types/explorermanager.h \
     src/types/explorersplitter.h \
     src/types/explorersplitterhandle.h \
+    src/types/fileindex.h \
+    src/types/fileindexer.h \
+    src/types/fileoperation.h \
+    src/types/filesearch.h \
+    src/types/filesystemaccess.h \
+    src/types/foldersizeservice.h \
+    src/types/historycache.h \
+    src/types/iconservice.h \
+    src/types/mimesniffer.h \
+    src/types/mimetypetable.h \
+    src/types/mountmonitor.h \
+    src/types/namematcher.h \
     src/types/opendircommand.h \
+    src/types/previewdocument.h \
+    src/types/previewview.h \
+    src/types/searchresultsmodel.h \
+    src/types/sessionsnapshot.h \
+    src/types/thumbnailservice.h \
+    src/types/trashcommand.h \
+    src/types/trashservice.h \
     src/types/treeviewmanager.h \
     src/ui/aboutdialog.h \
-    src/ui/mainwindow.h
+    src/ui/analyzedialog.h \
+    src/ui/duplicatesdialog.h \
+    src/ui/mainwindow.h \
+    src/ui/operationdialog.h \
+    src/ui/searchdialog.h \
+    src/ui/trashdialog.h
 
 FORMS += \
     src/ui/aboutdialog.ui \
-    src/ui/mainwindow.ui
+    src/ui/analyzedialog.ui \
+    src/ui/duplicatesdialog.ui \
+    src/ui/mainwindow.ui \
+    src/ui/operationdialog.ui \
+    src/ui/searchdialog.ui \
+    src/ui/trashdialog.ui
 
 TRANSLATIONS += \
     lang/Xplorer_af_ZA.ts
@@ -1,52 +1,644 @@
 #include "actionmanager.h"
+#include "mimesniffer.h"
 
 #include <QProcess>
 #include <QUrl>
 #include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMimeDatabase>
+#include <QPair>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
 
 /*!
  * \brief The constructor
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note On Linux the associations start being read on a worker right away.
  */
-ActionManager::ActionManager()
+ActionManager::ActionManager() :
+    loading(false),
+    reloadPending(false),
+    configWatcher(QSharedPointer<QFileSystemWatcher>::create())
 {
+#if defined (Q_OS_LINUX)
+    QObject::connect(configWatcher.data(), &QFileSystemWatcher::directoryChanged, [this]() {
+        loadAssociations();
+    });
+    QObject::connect(configWatcher.data(), &QFileSystemWatcher::fileChanged, [this]() {
+        loadAssociations();
+    });
+
+    loadAssociations();
+#endif
 }
 
 /*!
  * \brief Opens a given file.
- * \param file = A QFileInfo variable with the path to the file
+ * \param file = The PathInfo of the file, with its MIME type detected
  * \return A boolean value stating if the function was successful or not.
  * \note This function will try to open the file with the correct application, but if there is no assigned default application, then this function will still return true and the file will not be opened.
+ * \note Only executable files whose contents are a program are started, so an executable text file or image is opened.
  */
-bool ActionManager::openFile(const QFileInfo &file)
+bool ActionManager::openFile(const PathInfo &file)
 {
-    if (file.isExecutable()) {
+    if (isProgram(file)) {
         return openExecutableFile(file);
     } else
         return openReadableFile(file);
 }
 
+/*!
+ * \brief Opens several files, and passes the files that are opened by the same application to it at once.
+ * \param files = The PathInfo of the files, with their MIME types detected
+ * \return A boolean value that is true if every file could be opened
+ * \note Programs are started on their own, and an application whose Exec key takes only one file is started
+ * once per file.
+ */
+bool ActionManager::openFiles(const QVector<PathInfo> &files)
+{
+    QList<QPair<QSharedPointer<DesktopHandler>, QStringList>> groups;
+    QHash<QString, int> groupIndexes;
+    bool opened(true);
+
+    for (const PathInfo &file : files) {
+        const QSharedPointer<DesktopHandler> handler(isProgram(file) ? QSharedPointer<DesktopHandler>() : handlerFor(file));
+
+        if (handler.isNull()) {
+            opened = openFile(file) && opened;
+            continue;
+        }
+
+        if (!groupIndexes.contains(handler->desktopId)) {
+            groupIndexes.insert(handler->desktopId, groups.count());
+            groups.append(qMakePair(handler, QStringList()));
+        }
+
+        groups[groupIndexes.value(handler->desktopId)].second.append(file.path);
+    }
+
+    for (const QPair<QSharedPointer<DesktopHandler>, QStringList> &group : qAsConst(groups)) {
+        QList<QStringList> invocations;
+
+        if (group.first->acceptsMultiple) {
+            invocations.append(group.second);
+        } else {
+            for (const QString &path : group.second) {
+                invocations.append(QStringList({path}));
+            }
+        }
+
+        for (const QStringList &paths : qAsConst(invocations)) {
+            if (launch(*group.first, paths)) {
+                continue;
+            }
+
+            for (const QString &path : paths) {
+                opened = QDesktopServices::openUrl(QUrl::fromLocalFile(path)) && opened;
+            }
+        }
+    }
+
+    return opened;
+}
+
 /*!
  * \brief Opens a readable file (aka a non-executable file like jpg, png, txt etc.).
- * \param file = A QFileInfo variable with the path to the file
+ * \param file = The PathInfo of the file
  * \return A boolean value stating if the function was successful or not.
  * \note If there is no assosiated application for opening this specific file, then the function will still return true but the file will not be opened.
  */
-bool ActionManager::openReadableFile(const QFileInfo &file)
+bool ActionManager::openReadableFile(const PathInfo &file)
 {
-    return QDesktopServices::openUrl(QUrl::fromLocalFile(file.path() + "/" + file.fileName()));
+    const QSharedPointer<DesktopHandler> handler(handlerFor(file));
+
+    if (!handler.isNull() && launch(*handler, QStringList({file.path}))) {
+        return true;
+    }
+
+    return QDesktopServices::openUrl(QUrl::fromLocalFile(file.path));
 }
 
 /*!
  * \brief Opens an executable file (such as exe, run etc.).
- * \param file = A QFileInfo variable with the path to the file
+ * \param file = The PathInfo of the file
  * \return A boolean value stating if the function was successful or not.
  * \note If the executable cannot be started, then this function will try and open it as a non-executable.
  */
-bool ActionManager::openExecutableFile(const QFileInfo &file)
+bool ActionManager::openExecutableFile(const PathInfo &file)
 {
-    if (!QProcess::startDetached(file.path() + "/" + file.fileName())) {
+    if (!QProcess::startDetached(file.path)) {
         return openReadableFile(file);
     }
 
     return true;
 }
+
+/*!
+ * \brief Checks if a file is a program that is started instead of opened.
+ * \param file = The PathInfo of the file
+ * \return A boolean value that is true if the file is executable and its contents are a binary or a script
+ * \note Both are taken from the PathInfo, so the file is not looked at again.
+ */
+bool ActionManager::isProgram(const PathInfo &file) const
+{
+    return file.isExecutable && MimeSniffer::isProgram(file.mimeName);
+}
+
+/*!
+ * \brief Resolves the application that opens a file.
+ * \param file = The file
+ * \return A QSharedPointer to the DesktopHandler, which is null if no handler can be started directly
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note The MIME type in the PathInfo, which the MimeSniffer detected on a worker, is tried first, and then the types
+ * it is derived from, such as text/plain for source code. A file without a detected type falls back to the type of its
+ * name, so the file itself is never read here. The handler of every MIME type is cached once it has been resolved.
+ * \note Only the associations read by the worker are used, and there is no handler until they have been read.
+ */
+QSharedPointer<ActionManager::DesktopHandler> ActionManager::handlerFor(const PathInfo &file)
+{
+#if defined (Q_OS_LINUX)
+    if (associations.isNull()) {
+        return QSharedPointer<DesktopHandler>();
+    }
+
+    QMimeDatabase mimeDatabase;
+    QMimeType mimeType(mimeDatabase.mimeTypeForName(file.mimeName));
+
+    if (!mimeType.isValid()) {
+        mimeType = mimeDatabase.mimeTypeForFile(file.path, QMimeDatabase::MatchExtension);
+    }
+
+    const QStringList mimeNames(QStringList({mimeType.name()}) + mimeType.allAncestors());
+
+    for (const QString &mimeName : mimeNames) {
+        const auto cachedHandler(handlers.constFind(mimeName));
+
+        if (cachedHandler != handlers.constEnd()) {
+            if (!cachedHandler->isNull()) {
+                return *cachedHandler;
+            }
+
+            continue;
+        }
+
+        // The defaults come first, followed by the other associations that have not been removed.
+        const QStringList removedIds(associations->removedApps.value(mimeName));
+        QStringList desktopIds(associations->defaultApps.value(mimeName));
+        QSharedPointer<DesktopHandler> handler;
+
+        for (const QString &desktopId : associations->addedApps.value(mimeName) + associations->cachedApps.value(mimeName)) {
+            if (!removedIds.contains(desktopId)) {
+                desktopIds.append(desktopId);
+            }
+        }
+
+        for (int i(0); i < desktopIds.count() && handler.isNull(); ++i) {
+            handler = associations->desktopEntries.value(desktopIds.at(i));
+        }
+
+        handlers.insert(mimeName, handler);
+
+        if (!handler.isNull()) {
+            return handler;
+        }
+    }
+#else
+    Q_UNUSED(file)
+#endif
+
+    return QSharedPointer<DesktopHandler>();
+}
+
+/*!
+ * \brief Starts reading the associations on a worker, or reads them again once the running worker has finished.
+ * \note The associations that were read before are used until the new ones are in.
+ */
+void ActionManager::loadAssociations()
+{
+    if (loading) {
+        reloadPending = true;
+        return;
+    }
+
+    loading = true;
+    QtConcurrent::run(&ActionManager::readAssociations).then(configWatcher.data(), [this](const Associations &newAssociations) {
+        associationsRead(newAssociations);
+    });
+}
+
+/*!
+ * \brief Replaces the associations by the ones a worker has read and watches the files and directories they came from.
+ * \param newAssociations = The associations
+ * \note The handlers resolved from the old associations are dropped. A file that was replaced atomically is no longer
+ * watched, so it is watched again here.
+ */
+void ActionManager::associationsRead(const Associations &newAssociations)
+{
+    const QStringList watchedDirs(configWatcher->directories()), watchedFiles(configWatcher->files());
+    QStringList newPaths;
+
+    loading = false;
+    associations = QSharedPointer<const Associations>::create(newAssociations);
+    handlers.clear();
+
+    for (const QString &path : newAssociations.watchedPaths) {
+        if (!watchedDirs.contains(path) && !watchedFiles.contains(path)) {
+            newPaths.append(path);
+        }
+    }
+
+    if (!newPaths.isEmpty()) {
+        configWatcher->addPaths(newPaths);
+    }
+
+    if (reloadPending) {
+        reloadPending = false;
+        loadAssociations();
+    }
+}
+
+/*!
+ * \brief Starts an application with files.
+ * \param handler = The application
+ * \param paths = The paths of the files, of which there is only one unless the application accepts several
+ * \return A Boolean value that is true if the application could be started
+ * \note The field codes of the Exec key are expanded as the specification describes, and the deprecated ones are
+ * removed. If the Exec key has no field code for files, the files are appended to the arguments.
+ */
+bool ActionManager::launch(const DesktopHandler &handler, const QStringList &paths) const
+{
+    QStringList arguments;
+    bool filesPassed(false);
+
+    for (const QString &argument : handler.exec) {
+        if (argument == "%F" || argument == "%U") {
+            for (const QString &path : paths) {
+                arguments.append((argument == "%F") ? path : QUrl::fromLocalFile(path).toString());
+            }
+
+            filesPassed = true;
+            continue;
+        }
+
+        if (argument == "%i") {
+            if (!handler.icon.isEmpty()) {
+                arguments << "--icon" << handler.icon;
+            }
+
+            continue;
+        }
+
+        QString expanded;
+
+        for (int i(0); i < argument.length(); ++i) {
+            if (argument.at(i) != '%' || i + 1 == argument.length()) {
+                expanded += argument.at(i);
+                continue;
+            }
+
+            switch (argument.at(++i).unicode()) {
+            case 'f':
+                expanded += paths.first();
+                filesPassed = true;
+                break;
+
+            case 'u':
+                expanded += QUrl::fromLocalFile(paths.first()).toString();
+                filesPassed = true;
+                break;
+
+            case 'c':
+                expanded += handler.name;
+                break;
+
+            case 'k':
+                expanded += handler.filePath;
+                break;
+
+            case '%':
+                expanded += '%';
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (!expanded.isEmpty()) {
+            arguments.append(expanded);
+        }
+    }
+
+    if (!filesPassed) {
+        arguments += paths;
+    }
+
+    if (arguments.isEmpty()) {
+        return false;
+    }
+
+    const QString program(arguments.takeFirst());
+    return QProcess::startDetached(program, arguments, handler.workingDir);
+}
+
+/*!
+ * \brief Provides the configuration directories, which hold the mimeapps.list files of the user and of the system.
+ * \return A QStringList, ordered from the highest to the lowest precedence
+ */
+QStringList ActionManager::configDirs()
+{
+    return QStandardPaths::standardLocations(QStandardPaths::GenericConfigLocation);
+}
+
+/*!
+ * \brief Provides the application directories, which hold the .desktop files and the mimeinfo.cache files.
+ * \return A QStringList, ordered from the highest to the lowest precedence
+ */
+QStringList ActionManager::applicationDirs()
+{
+    return QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+}
+
+/*!
+ * \brief Provides a directory, or the nearest directory above it if it does not exist.
+ * \param dirPath = The path of the directory
+ * \return A QString with the path of the directory that exists, which is empty if none does
+ */
+QString ActionManager::nearestExistingDir(const QString &dirPath)
+{
+    QString path(QDir::cleanPath(dirPath));
+
+    while (!QFileInfo(path).isDir()) {
+        const QString parentPath(QFileInfo(path).path());
+
+        if (parentPath == path) {
+            return QString();
+        }
+
+        path = parentPath;
+    }
+
+    return path;
+}
+
+/*!
+ * \brief Reads the associations of MIME types and applications, and the .desktop files of the associated applications.
+ * \return The Associations
+ * \note This function is meant to be run with QtConcurrent::run().
+ * \note The mimeapps.list files are read in the order of precedence of the specification, including the lists of the
+ * current desktop. The configuration and application directories are watched for files that appear or disappear,
+ * and the list and cache files themselves for changes that are written in place. A directory that does not exist yet
+ * is covered by watching the nearest folder above it that does.
+ */
+ActionManager::Associations ActionManager::readAssociations()
+{
+    const QStringList desktops(QString::fromLocal8Bit(qgetenv("XDG_CURRENT_DESKTOP")).toLower().split(':', Qt::SkipEmptyParts));
+    const QStringList appDirs(applicationDirs()), watchedDirs(configDirs() + appDirs);
+    QStringList watchedFiles;
+    Associations newAssociations;
+
+    for (const QString &dir : watchedDirs) {
+        QStringList listPaths;
+
+        for (const QString &desktop : desktops) {
+            listPaths.append(dir + '/' + desktop + "-mimeapps.list");
+        }
+
+        listPaths.append(dir + "/mimeapps.list");
+        watchedFiles.append(listPaths);
+
+        for (const QString &listPath : qAsConst(listPaths)) {
+            const QHash<QString, QHash<QString, QString>> groups(readKeyFile(listPath));
+
+            addAssociations(newAssociations.defaultApps, groups.value("Default Applications"));
+            addAssociations(newAssociations.addedApps, groups.value("Added Associations"));
+            addAssociations(newAssociations.removedApps, groups.value("Removed Associations"));
+        }
+    }
+
+    for (const QString &dir : appDirs) {
+        addAssociations(newAssociations.cachedApps, readKeyFile(dir + "/mimeinfo.cache").value("MIME Cache"));
+        watchedFiles.append(dir + "/mimeinfo.cache");
+    }
+
+    // Every associated application is read here, so resolving a handler on the GUI thread never reads a file.
+    for (const QHash<QString, QStringList> *apps : {&newAssociations.defaultApps, &newAssociations.addedApps, &newAssociations.cachedApps}) {
+        for (const QStringList &desktopIds : *apps) {
+            for (const QString &desktopId : desktopIds) {
+                if (!newAssociations.desktopEntries.contains(desktopId)) {
+                    newAssociations.desktopEntries.insert(desktopId, readDesktopEntry(desktopId, appDirs));
+                }
+            }
+        }
+    }
+
+    for (const QString &dir : watchedDirs) {
+        const QString existingDir(nearestExistingDir(dir));
+
+        if (!existingDir.isEmpty() && !newAssociations.watchedPaths.contains(existingDir)) {
+            newAssociations.watchedPaths.append(existingDir);
+        }
+    }
+
+    for (const QString &file : qAsConst(watchedFiles)) {
+        if (QFileInfo::exists(file) && !newAssociations.watchedPaths.contains(file)) {
+            newAssociations.watchedPaths.append(file);
+        }
+    }
+
+    return newAssociations;
+}
+
+/*!
+ * \brief Reads a .desktop file from the application directories.
+ * \param desktopId = The ID of the .desktop file
+ * \param appDirs = The application directories, ordered from the highest to the lowest precedence
+ * \return A QSharedPointer to the DesktopHandler, which is null if the file does not exist, is hidden, has no Exec key
+ * or runs in a terminal
+ * \note Applications that run in a terminal are left to QDesktopServices, which knows the terminal of the desktop.
+ */
+QSharedPointer<ActionManager::DesktopHandler> ActionManager::readDesktopEntry(const QString &desktopId, const QStringList &appDirs)
+{
+    QSharedPointer<DesktopHandler> handler;
+    QString filePath;
+
+    // The ID of a file in a subdirectory joins the subdirectory and the name with a dash.
+    for (int i(0); i < appDirs.count() && filePath.isEmpty(); ++i) {
+        QString candidatePath(appDirs.at(i) + '/' + desktopId);
+
+        if (!QFileInfo::exists(candidatePath) && desktopId.contains('-')) {
+            candidatePath = appDirs.at(i) + '/' + QString(desktopId).replace(desktopId.indexOf('-'), 1, '/');
+        }
+
+        if (QFileInfo::exists(candidatePath)) {
+            filePath = candidatePath;
+        }
+    }
+
+    if (filePath.isEmpty()) {
+        return handler;
+    }
+
+    const QHash<QString, QString> entry(readKeyFile(filePath).value("Desktop Entry"));
+    const QStringList exec(splitExec(entry.value("Exec")));
+
+    if (entry.value("Type", "Application") == "Application" && entry.value("Hidden") != "true"
+            && entry.value("Terminal") != "true" && !exec.isEmpty()) {
+        handler = QSharedPointer<DesktopHandler>::create();
+        handler->desktopId = desktopId;
+        handler->filePath = filePath;
+        handler->name = entry.value("Name");
+        handler->icon = entry.value("Icon");
+        handler->exec = exec;
+        handler->workingDir = entry.value("Path");
+        handler->acceptsMultiple = exec.contains("%F") || exec.contains("%U");
+    }
+
+    return handler;
+}
+
+/*!
+ * \brief Reads a file in the key file format of the freedesktop.org specifications, such as a .desktop file.
+ * \param path = The path of the file
+ * \return A QHash with the keys and values of every group, keyed by the name of the group
+ * \note A key that appears more than once in a group keeps its first value.
+ */
+QHash<QString, QHash<QString, QString>> ActionManager::readKeyFile(const QString &path)
+{
+    QHash<QString, QHash<QString, QString>> groups;
+    QFile keyFile(path);
+    QString group;
+
+    if (!keyFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return groups;
+    }
+
+    while (!keyFile.atEnd()) {
+        const QString line(QString::fromUtf8(keyFile.readLine()).trimmed());
+        const int separator(line.indexOf('='));
+
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        if (line.startsWith('[') && line.endsWith(']')) {
+            group = line.mid(1, line.length() - 2);
+            continue;
+        }
+
+        if (separator > 0 && !groups[group].contains(line.left(separator).trimmed())) {
+            groups[group].insert(line.left(separator).trimmed(), line.mid(separator + 1).trimmed());
+        }
+    }
+
+    return groups;
+}
+
+/*!
+ * \brief Adds the associations of a group of a mimeapps.list or mimeinfo.cache file.
+ * \param associations = The associations, to which the new desktop IDs of every MIME type are appended
+ * \param group = The keys and values of the group, with the MIME types as keys and lists of desktop IDs as values
+ */
+void ActionManager::addAssociations(QHash<QString, QStringList> &associations, const QHash<QString, QString> &group)
+{
+    for (auto association(group.constBegin()); association != group.constEnd(); ++association) {
+        const QStringList desktopIds(association.value().split(';', Qt::SkipEmptyParts));
+        QStringList &knownIds(associations[association.key()]);
+
+        for (const QString &desktopId : desktopIds) {
+            if (!knownIds.contains(desktopId)) {
+                knownIds.append(desktopId);
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Splits the value of an Exec key into its arguments.
+ * \param exec = The value as it appears in the .desktop file
+ * \return A QStringList with the unquoted arguments, which still contain their field codes
+ * \note The escape sequences of the key file are resolved first, and then the quoting rules of the Exec key.
+ */
+QStringList ActionManager::splitExec(const QString &exec)
+{
+    QString unescaped;
+    QStringList arguments;
+    QString argument;
+    bool inQuotes(false), hasArgument(false);
+
+    for (int i(0); i < exec.length(); ++i) {
+        if (exec.at(i) != '\\' || i + 1 == exec.length()) {
+            unescaped += exec.at(i);
+            continue;
+        }
+
+        switch (exec.at(++i).unicode()) {
+        case 's':
+            unescaped += ' ';
+            break;
+
+        case 'n':
+            unescaped += '\n';
+            break;
+
+        case 't':
+            unescaped += '\t';
+            break;
+
+        case 'r':
+            unescaped += '\r';
+            break;
+
+        case '\\':
+            unescaped += '\\';
+            break;
+
+        default:
+            unescaped += '\\';
+            unescaped += exec.at(i);
+            break;
+        }
+    }
+
+    for (int i(0); i < unescaped.length(); ++i) {
+        const QChar character(unescaped.at(i));
+
+        if (inQuotes) {
+            if (character == '\\' && i + 1 < unescaped.length()) {
+                argument += unescaped.at(++i);
+            } else {
+                if (character == '"') {
+                    inQuotes = false;
+                } else {
+                    argument += character;
+                }
+            }
+            continue;
+        }
+
+        if (character == '"') {
+            inQuotes = true;
+            hasArgument = true;
+        } else {
+            if (character == ' ' || character == '\t') {
+                if (hasArgument) {
+                    arguments.append(argument);
+                    argument.clear();
+                    hasArgument = false;
+                }
+            } else {
+                argument += character;
+                hasArgument = true;
+            }
+        }
+    }
+
+    if (hasArgument) {
+        arguments.append(argument);
+    }
+
+    return arguments;
+}
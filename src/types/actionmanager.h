@@ -1,21 +1,91 @@
 #ifndef ACTIONMANAGER_H
 #define ACTIONMANAGER_H
 
+#include "filesystemaccess.h"
+
 #include <QString>
-#include <QFileInfo>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+
+class QFileSystemWatcher;
 
 /*!
  * \brief The class responsible for all actions applied to files.
+ *
+ * On Linux the application that opens a file is resolved in-process from the mimeapps.list files and the mimeinfo.cache
+ * of the application directories, following the freedesktop.org specifications, and started directly instead of going
+ * through xdg-open. The associations and the .desktop files they refer to are read on a worker thread when the manager
+ * is created, and read again whenever one of the configuration or application directories, or one of their
+ * mimeapps.list or mimeinfo.cache files, changes. The new associations replace the old ones once they have been read,
+ * so the GUI thread never reads them itself. The resolved handler of every MIME type is cached until then. Files opened
+ * together are passed to their application in one invocation if its Exec line accepts several files.
+ * \note This contains preprocessor directives for detecting the OS at compile time. Other platforms, files without a
+ * handler that can be started directly and files opened before the associations have been read for the first time are
+ * opened with QDesktopServices.
+ * \note The files are described by the PathInfo of the FileSystemAccess, with their MIME types detected, so opening a
+ * file does not look at the file system from the GUI thread.
  */
 class ActionManager
 {
 public:
     ActionManager();
-    bool openFile(const QFileInfo &file);
+    bool openFile(const PathInfo &file);
+    bool openFiles(const QVector<PathInfo> &files);
+
+    static QStringList splitExec(const QString &exec);
 
 private:
-    bool openReadableFile(const QFileInfo &file);
-    bool openExecutableFile(const QFileInfo &file);
+    /*!
+     * \brief An application that opens files, as described by its .desktop file.
+     */
+    struct DesktopHandler
+    {
+        QString desktopId;          ///< The ID of the .desktop file, such as org.gnome.gedit.desktop.
+        QString filePath;           ///< The path of the .desktop file.
+        QString name;               ///< The name of the application.
+        QString icon;               ///< The icon of the application.
+        QStringList exec;           ///< The unquoted arguments of the Exec key, with their field codes.
+        QString workingDir;         ///< The directory in which the application is started, which may be empty.
+        bool acceptsMultiple;       ///< Whether the Exec key takes several files at once with %F or %U.
+    };
+
+    /*!
+     * \brief The associations of MIME types and applications, as read by a worker.
+     */
+    struct Associations
+    {
+        QHash<QString, QStringList> defaultApps;    ///< The default applications of every MIME type, in order of precedence.
+        QHash<QString, QStringList> addedApps;      ///< The associations added by the mimeapps.list files.
+        QHash<QString, QStringList> removedApps;    ///< The associations removed by the mimeapps.list files.
+        QHash<QString, QStringList> cachedApps;     ///< The associations of the installed applications, from the mimeinfo.cache files.
+        QHash<QString, QSharedPointer<DesktopHandler>> desktopEntries;  ///< The parsed .desktop files by ID, which are null if they can not be used.
+        QStringList watchedPaths;                   ///< The existing directories and files that are watched for changes.
+    };
+
+    QSharedPointer<const Associations> associations;    ///< The associations that were read last, which are null until the first read has finished.
+    QHash<QString, QSharedPointer<DesktopHandler>> handlers;    ///< The resolved handler of every MIME type, which is null if there is none.
+    bool loading;                               ///< Whether a worker is reading the associations.
+    bool reloadPending;                         ///< Whether the associations have changed while they were being read.
+    QSharedPointer<QFileSystemWatcher> configWatcher;   ///< Watches the configuration and application directories, and the list and cache files in them.
+
+    bool openReadableFile(const PathInfo &file);
+    bool openExecutableFile(const PathInfo &file);
+    bool isProgram(const PathInfo &file) const;
+    QSharedPointer<DesktopHandler> handlerFor(const PathInfo &file);
+    void loadAssociations();
+    void associationsRead(const Associations &newAssociations);
+    bool launch(const DesktopHandler &handler, const QStringList &paths) const;
+
+    static QStringList configDirs();
+    static QStringList applicationDirs();
+    static QString nearestExistingDir(const QString &dirPath);
+    static Associations readAssociations();
+    static QSharedPointer<DesktopHandler> readDesktopEntry(const QString &desktopId, const QStringList &appDirs);
+    static QHash<QString, QHash<QString, QString>> readKeyFile(const QString &path);
+    static void addAssociations(QHash<QString, QStringList> &associations, const QHash<QString, QString> &group);
 };
 
 #endif // ACTIONMANAGER_H
@@ -0,0 +1,112 @@
+#include "directorycache.h"
+
+#include <QDir>
+
+/*!
+ * \brief The constructor
+ */
+DirectoryCache::DirectoryCache()
+{
+}
+
+/*!
+ * \brief Provides the cache shared by the whole application.
+ * \return A pointer to the DirectoryCache
+ */
+DirectoryCache *DirectoryCache::instance()
+{
+    static DirectoryCache cache;
+    return &cache;
+}
+
+/*!
+ * \brief Provides the listing of a directory and starts reading it if it is not cached yet.
+ * \param path = The path of the directory
+ * \param background = Whether the directory is only read speculatively, at idle priority
+ * \return A QSharedPointer of the DirectoryListing
+ * \note The listing is removed from the cache once the last QSharedPointer to it is released.
+ * \note A speculative read of a listing that is acquired for a view is restarted at normal priority.
+ */
+QSharedPointer<DirectoryListing> DirectoryCache::acquire(const QString &path, bool background)
+{
+    const QString dirPath(cleanPath(path));
+    QSharedPointer<DirectoryListing> listing(listings.value(dirPath).toStrongRef());
+
+    if (!listing.isNull()) {
+        if (!background) {
+            listing->prioritize();
+        }
+        return listing;
+    }
+
+    listing = insert(dirPath);
+    listing->load(background);
+
+    return listing;
+}
+
+/*!
+ * \brief Provides the listing of a directory if it is cached.
+ * \param path = The path of the directory
+ * \return A QSharedPointer of the DirectoryListing that is null if the directory is not cached
+ */
+QSharedPointer<DirectoryListing> DirectoryCache::find(const QString &path) const
+{
+    return listings.value(cleanPath(path)).toStrongRef();
+}
+
+/*!
+ * \brief Provides the listing of a directory with entries that were saved earlier, unless it has been read already.
+ * \param path = The path of the directory
+ * \param entries = The saved entries
+ * \return A QSharedPointer of the DirectoryListing
+ * \note The listing shows the saved entries right away and reads the directory again in the background.
+ * \see DirectoryListing::restore()
+ */
+QSharedPointer<DirectoryListing> DirectoryCache::restore(const QString &path, const DirectoryEntries &entries)
+{
+    const QString dirPath(cleanPath(path));
+    QSharedPointer<DirectoryListing> listing(listings.value(dirPath).toStrongRef());
+
+    if (listing.isNull()) {
+        listing = insert(dirPath);
+    }
+
+    listing->restore(entries);
+
+    return listing;
+}
+
+/*!
+ * \brief Adds a listing to the cache without reading its directory.
+ * \param dirPath = The clean path of the directory
+ * \return A QSharedPointer of the new DirectoryListing
+ * \note The listing is removed from the cache once the last QSharedPointer to it is released.
+ */
+QSharedPointer<DirectoryListing> DirectoryCache::insert(const QString &dirPath)
+{
+    const QSharedPointer<DirectoryListing> listing(new DirectoryListing(dirPath), [this, dirPath](DirectoryListing *oldListing) {
+        // Only forget the path if it has not been acquired again in the meantime.
+        if (listings.value(dirPath).isNull()) {
+            listings.remove(dirPath);
+        }
+
+        // The last reference may be released from one of the listing's own signals.
+        oldListing->cancel();
+        oldListing->deleteLater();
+    });
+
+    listings.insert(dirPath, listing);
+
+    return listing;
+}
+
+/*!
+ * \brief Cleans a path so that every directory has exactly one key in the cache.
+ * \param path = The path
+ * \return A QString with the clean path
+ */
+QString DirectoryCache::cleanPath(const QString &path)
+{
+    return QDir::cleanPath(QDir::fromNativeSeparators(path));
+}
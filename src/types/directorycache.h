@@ -0,0 +1,34 @@
+#ifndef DIRECTORYCACHE_H
+#define DIRECTORYCACHE_H
+
+#include "directorylisting.h"
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+/*!
+ * \brief The process-wide cache of directory listings shared by the explorers and the tree view.
+ *
+ * Every directory is read and held only once, no matter how many views show it. A listing stays alive for as long as
+ * one of the views holds a reference to it and is dropped from the cache with its last reference.
+ * \note The cache and its listings may only be used from the GUI thread.
+ */
+class DirectoryCache
+{
+public:
+    static DirectoryCache *instance();
+    QSharedPointer<DirectoryListing> acquire(const QString &path, bool background = false);
+    QSharedPointer<DirectoryListing> find(const QString &path) const;
+    QSharedPointer<DirectoryListing> restore(const QString &path, const DirectoryEntries &entries);
+
+private:
+    DirectoryCache();
+    QHash<QString, QWeakPointer<DirectoryListing>> listings;   ///< The live listings, keyed by their clean path.
+
+    QSharedPointer<DirectoryListing> insert(const QString &dirPath);
+
+    static QString cleanPath(const QString &path);
+};
+
+#endif // DIRECTORYCACHE_H
@@ -0,0 +1,412 @@
+#include "directorycompare.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cstring>
+
+#if defined (Q_OS_LINUX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+DirectoryCompare::DirectoryCompare(QObject *parent) :
+    QObject(parent)
+{
+    connect(&watcher, &QFutureWatcher<Result>::finished, this, [this]() {
+        if (!watcher.isCanceled() && watcher.future().resultCount() > 0) {
+            result = watcher.result();
+        }
+
+        emit finished();
+    });
+}
+
+/*!
+ * \brief The destructor
+ * \note A running comparison is canceled and waited for.
+ */
+DirectoryCompare::~DirectoryCompare()
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+/*!
+ * \brief Starts comparing two directory trees.
+ * \param leftRoot = The root of the left tree
+ * \param rightRoot = The root of the right tree
+ * \note The results of the previous comparison are dropped, and a comparison that is still running is canceled.
+ */
+void DirectoryCompare::start(const QString &leftRoot, const QString &rightRoot)
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+
+    left = QDir::cleanPath(leftRoot);
+    right = QDir::cleanPath(rightRoot);
+    result = Result();
+    watcher.setFuture(QtConcurrent::run(&DirectoryCompare::compare, left, right));
+}
+
+/*!
+ * \brief Cancels the running comparison.
+ */
+void DirectoryCompare::cancel()
+{
+    watcher.cancel();
+}
+
+/*!
+ * \brief Checks if the comparison is running.
+ * \return A Boolean value
+ */
+bool DirectoryCompare::isRunning() const
+{
+    return watcher.isRunning();
+}
+
+/*!
+ * \brief Checks if a comparison has finished.
+ * \return A Boolean value that is false while comparing and after a comparison has been canceled
+ */
+bool DirectoryCompare::hasResults() const
+{
+    return !result.counts.isEmpty();
+}
+
+/*!
+ * \brief Provides the root of the left tree.
+ * \return A QString with the clean path
+ */
+QString DirectoryCompare::leftRoot() const
+{
+    return left;
+}
+
+/*!
+ * \brief Provides the root of the right tree.
+ * \return A QString with the clean path
+ */
+QString DirectoryCompare::rightRoot() const
+{
+    return right;
+}
+
+/*!
+ * \brief Checks if a path lies in the left tree.
+ * \param path = The clean path
+ * \return A Boolean value
+ * \note A path that lies in both trees, because one root contains the other, is considered to lie in the deeper one.
+ */
+bool DirectoryCompare::isLeftPath(const QString &path) const
+{
+    const bool inLeft(path == left || path.startsWith(left.endsWith('/') ? left : left + '/'));
+    const bool inRight(path == right || path.startsWith(right.endsWith('/') ? right : right + '/'));
+
+    return inLeft && (!inRight || left.length() > right.length());
+}
+
+/*!
+ * \brief Provides the status of an entry in either tree.
+ * \param path = The clean path of the entry
+ * \return The Status, which is Same for entries outside both trees and while no results are known
+ */
+DirectoryCompare::Status DirectoryCompare::status(const QString &path) const
+{
+    const QString relative(relativePath(path));
+
+    if (relative.isEmpty()) {
+        return Same;
+    }
+
+    return result.statuses.value(relative, Same);
+}
+
+/*!
+ * \brief Provides the amount of entries with a certain status.
+ * \param status = The status
+ * \return An integer that is 0 while no results are known
+ */
+int DirectoryCompare::count(Status status) const
+{
+    return result.counts.value(status, 0);
+}
+
+/*!
+ * \brief Provides what a one-way synchronization from the left to the right tree has to copy.
+ * \param sourcePaths = Receives the entries that are only on the left or newer on the left
+ * \param targetPaths = Receives the path in the right tree of every source
+ * \note Entries that are newer on the right are left alone, and so are entries that are a file on one side and a
+ * directory on the other.
+ */
+void DirectoryCompare::syncPaths(QStringList &sourcePaths, QStringList &targetPaths) const
+{
+    for (auto entryStatus(result.statuses.constBegin()); entryStatus != result.statuses.constEnd(); ++entryStatus) {
+        if (entryStatus.value() != OnlyLeft && entryStatus.value() != NewerLeft) {
+            continue;
+        }
+
+        const QString sourcePath(left + '/' + entryStatus.key());
+        const QString targetPath(right + '/' + entryStatus.key());
+
+        if (entryStatus.value() == NewerLeft && QFileInfo(sourcePath).isDir() != QFileInfo(targetPath).isDir()) {
+            continue;
+        }
+
+        sourcePaths.append(sourcePath);
+        targetPaths.append(targetPath);
+    }
+}
+
+/*!
+ * \brief Converts a path in either tree to a path relative to its root.
+ * \param path = The clean path
+ * \return A QString that is empty for the roots themselves and for paths outside both trees
+ */
+QString DirectoryCompare::relativePath(const QString &path) const
+{
+    const QString &root(isLeftPath(path) ? left : right);
+    const QString rootPrefix(root.endsWith('/') ? root : root + '/');
+
+    if (!path.startsWith(rootPrefix)) {
+        return QString();
+    }
+
+    return path.mid(rootPrefix.length());
+}
+
+/*!
+ * \brief Compares two directory trees.
+ * \param promise = The promise to which the result is reported
+ * \param leftRoot = The clean path of the left root
+ * \param rightRoot = The clean path of the right root
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ */
+void DirectoryCompare::compare(QPromise<Result> &promise, const QString &leftRoot, const QString &rightRoot)
+{
+    QThreadPool comparePool;
+    QStringList level({QString()});
+    QVector<QPair<QString, Status>> candidates;
+    Result compareResult;
+
+    comparePool.setMaxThreadCount(CompareThreads);
+    compareResult.counts.fill(0, StatusCount);
+
+    // Every level of both trees is read on several threads at once.
+    while (!level.isEmpty()) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const QVector<DirResult> dirResults(QtConcurrent::blockingMapped<QVector<DirResult>>(&comparePool, level, [&leftRoot, &rightRoot](const QString &relativeDir) {
+            return compareDir(leftRoot, rightRoot, relativeDir);
+        }));
+
+        level.clear();
+
+        for (const DirResult &dirResult : dirResults) {
+            for (const QPair<QString, Status> &difference : dirResult.differences) {
+                compareResult.statuses.insert(difference.first, difference.second);
+                ++compareResult.counts[difference.second];
+            }
+
+            compareResult.counts[Same] += dirResult.sameCount;
+            candidates += dirResult.candidates;
+            level += dirResult.subdirs;
+        }
+    }
+
+    // The contents are only read for the files whose metadata leaves the question open.
+    const QVector<bool> sameFlags(QtConcurrent::blockingMapped<QVector<bool>>(&comparePool, candidates, [&promise, &leftRoot, &rightRoot](const QPair<QString, Status> &candidate) {
+        return !promise.isCanceled() && sameContents(leftRoot + '/' + candidate.first, rightRoot + '/' + candidate.first);
+    }));
+
+    if (promise.isCanceled()) {
+        return;
+    }
+
+    for (int i(0); i < candidates.count(); ++i) {
+        if (sameFlags.at(i)) {
+            ++compareResult.counts[Same];
+        } else {
+            compareResult.statuses.insert(candidates.at(i).first, candidates.at(i).second);
+            ++compareResult.counts[candidates.at(i).second];
+        }
+    }
+
+    // The directories on both sides above a difference are marked, so the way to it can be highlighted.
+    const QStringList differingPaths(compareResult.statuses.keys());
+
+    for (const QString &differingPath : differingPaths) {
+        for (int slash(differingPath.lastIndexOf('/')); slash > 0; slash = differingPath.lastIndexOf('/', slash - 1)) {
+            const QString parentPath(differingPath.left(slash));
+
+            if (compareResult.statuses.contains(parentPath)) {
+                break;
+            }
+
+            compareResult.statuses.insert(parentPath, ContainsDifferences);
+            ++compareResult.counts[ContainsDifferences];
+            --compareResult.counts[Same];
+        }
+    }
+
+    promise.addResult(compareResult);
+}
+
+/*!
+ * \brief Compares the entries of a pair of directories by their metadata.
+ * \param leftRoot = The clean path of the left root
+ * \param rightRoot = The clean path of the right root
+ * \param relativeDir = The path of the directories relative to the roots, which is empty for the roots themselves
+ * \return A DirResult
+ */
+DirectoryCompare::DirResult DirectoryCompare::compareDir(const QString &leftRoot, const QString &rightRoot, const QString &relativeDir)
+{
+    const QString dirSuffix(relativeDir.isEmpty() ? QString() : '/' + relativeDir);
+    const QHash<QString, EntryInfo> leftEntries(readDir(leftRoot + dirSuffix));
+    const QHash<QString, EntryInfo> rightEntries(readDir(rightRoot + dirSuffix));
+    DirResult dirResult;
+
+    for (auto leftEntry(leftEntries.constBegin()); leftEntry != leftEntries.constEnd(); ++leftEntry) {
+        const QString entryPath(relativeDir.isEmpty() ? leftEntry.key() : relativeDir + '/' + leftEntry.key());
+        const auto rightEntry(rightEntries.constFind(leftEntry.key()));
+
+        if (rightEntry == rightEntries.constEnd()) {
+            dirResult.differences.append(qMakePair(entryPath, OnlyLeft));
+            continue;
+        }
+
+        if (leftEntry->isDir && rightEntry->isDir) {
+            dirResult.subdirs.append(entryPath);
+            ++dirResult.sameCount;
+            continue;
+        }
+
+        const qint64 mtimeDifference(leftEntry->mtime - rightEntry->mtime);
+        const Status newerStatus((mtimeDifference >= 0) ? NewerLeft : NewerRight);
+
+        if (leftEntry->isDir != rightEntry->isDir || leftEntry->size != rightEntry->size) {
+            dirResult.differences.append(qMakePair(entryPath, newerStatus));
+        } else {
+            if (qAbs(mtimeDifference) <= MtimeTolerance) {
+                ++dirResult.sameCount;
+            } else {
+                dirResult.candidates.append(qMakePair(entryPath, newerStatus));
+            }
+        }
+    }
+
+    for (auto rightEntry(rightEntries.constBegin()); rightEntry != rightEntries.constEnd(); ++rightEntry) {
+        if (!leftEntries.contains(rightEntry.key())) {
+            dirResult.differences.append(qMakePair(relativeDir.isEmpty() ? rightEntry.key() : relativeDir + '/' + rightEntry.key(), OnlyRight));
+        }
+    }
+
+    return dirResult;
+}
+
+/*!
+ * \brief Reads the entries of a directory with their metadata.
+ * \param dirPath = The path of the directory
+ * \return A QHash with the metadata of every entry, keyed by name
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note Symbolic links are compared as links, and never followed into other trees.
+ */
+QHash<QString, DirectoryCompare::EntryInfo> DirectoryCompare::readDir(const QString &dirPath)
+{
+    QHash<QString, EntryInfo> entries;
+
+#if defined (Q_OS_LINUX)
+    const int dirFd(::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+    if (dirFd < 0) {
+        return entries;
+    }
+
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+
+    forever {
+        const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (long pos(0); pos < bytesRead;) {
+            const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+            pos += dirEntry->d_reclen;
+
+            const char *name(dirEntry->d_name);
+            struct statx entryStat;
+
+            if ((name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                    || statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE | STATX_MTIME, &entryStat) != 0) {
+                continue;
+            }
+
+            entries.insert(QFile::decodeName(name), EntryInfo{S_ISDIR(entryStat.stx_mode),
+                                                               static_cast<qint64>(entryStat.stx_size),
+                                                               static_cast<qint64>(entryStat.stx_mtime.tv_sec) * 1000 + entryStat.stx_mtime.tv_nsec / 1000000});
+        }
+    }
+
+    ::close(dirFd);
+#else
+    const QFileInfoList infos(QDir(dirPath).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System));
+
+    for (const QFileInfo &info : infos) {
+        entries.insert(info.fileName(), EntryInfo{info.isDir() && !info.isSymLink(), info.size(), info.lastModified().toMSecsSinceEpoch()});
+    }
+#endif
+
+    return entries;
+}
+
+/*!
+ * \brief Compares the contents of two files of the same size.
+ * \param leftPath = The path of the left file
+ * \param rightPath = The path of the right file
+ * \return A Boolean value that is true if the contents are equal
+ * \note Comparing the bytes directly reads no more than hashing both files would, and stops at the first difference.
+ */
+bool DirectoryCompare::sameContents(const QString &leftPath, const QString &rightPath)
+{
+    QFile leftFile(leftPath), rightFile(rightPath);
+
+    if (!leftFile.open(QIODevice::ReadOnly) || !rightFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray leftBuffer(ContentBufferSize, Qt::Uninitialized), rightBuffer(ContentBufferSize, Qt::Uninitialized);
+
+    forever {
+        const qint64 leftRead(leftFile.read(leftBuffer.data(), leftBuffer.size()));
+        const qint64 rightRead(rightFile.read(rightBuffer.data(), rightBuffer.size()));
+
+        if (leftRead != rightRead || leftRead < 0) {
+            return false;
+        }
+
+        if (leftRead == 0) {
+            return true;
+        }
+
+        if (memcmp(leftBuffer.constData(), rightBuffer.constData(), static_cast<size_t>(leftRead)) != 0) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef DIRECTORYCOMPARE_H
+#define DIRECTORYCOMPARE_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QPromise>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief A comparison of two directory trees, performed on worker threads.
+ *
+ * The trees are walked level by level, and the directories of a level are read on several threads at once, each on
+ * both sides. Entries are first compared by their metadata: an entry on one side only is reported as such, and files
+ * whose size differs are reported as newer on the side with the later modification time. Files of the same size and
+ * modification time are considered the same. Only files of the same size whose modification times differ have their
+ * contents compared, also in parallel, and stop being read at the first difference.
+ *
+ * Only the entries that differ are kept, keyed by their path relative to the roots, so comparing large mirrors costs
+ * little memory. Directories on both sides that contain differences are reported as well, so they can be highlighted.
+ * \note Modification times that differ by less than MtimeTolerance are considered equal, since file systems such as FAT
+ * only store them with a precision of two seconds.
+ */
+class DirectoryCompare : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status : quint8 {
+        Same,                   ///< 0
+        OnlyLeft,               ///< 1
+        OnlyRight,              ///< 2
+        NewerLeft,              ///< 3
+        NewerRight,             ///< 4
+        ContainsDifferences,    ///< 5 (directories on both sides)
+        StatusCount             ///< 6
+    };
+
+    explicit DirectoryCompare(QObject *parent = nullptr);
+    ~DirectoryCompare();
+    void start(const QString &leftRoot, const QString &rightRoot);
+    void cancel();
+    bool isRunning() const;
+    bool hasResults() const;
+    QString leftRoot() const;
+    QString rightRoot() const;
+    bool isLeftPath(const QString &path) const;
+    Status status(const QString &path) const;
+    int count(Status status) const;
+    void syncPaths(QStringList &sourcePaths, QStringList &targetPaths) const;
+
+signals:
+    void finished();    ///< Emitted when the comparison has finished or has been canceled.
+
+private:
+    static const int CompareThreads = 4;        ///< The amount of directories or files compared at once.
+    static const qint64 MtimeTolerance = 2000;  ///< The difference in milliseconds below which modification times are equal.
+    static const int ContentBufferSize = 1024 * 1024;   ///< The size of the chunks in which contents are compared.
+
+    /*!
+     * \brief The metadata of an entry.
+     */
+    struct EntryInfo
+    {
+        bool isDir;     ///< Whether the entry is a directory.
+        qint64 size;    ///< The size in bytes.
+        qint64 mtime;   ///< The modification time in milliseconds since the epoch.
+    };
+
+    /*!
+     * \brief The outcome of comparing a pair of directories.
+     */
+    struct DirResult
+    {
+        QVector<QPair<QString, Status>> differences;    ///< The entries that differ, by relative path.
+        QStringList subdirs;                            ///< The relative paths of the directories on both sides.
+        QVector<QPair<QString, Status>> candidates;     ///< The files whose contents are compared, with their status if they differ.
+        int sameCount = 0;                              ///< The amount of entries that are the same.
+    };
+
+    /*!
+     * \brief The outcome of the whole comparison.
+     */
+    struct Result
+    {
+        QHash<QString, Status> statuses;    ///< The status of every entry that differs, by relative path.
+        QVector<int> counts;                ///< The amount of entries of every status.
+    };
+
+    QString left;                       ///< The clean path of the left root.
+    QString right;                      ///< The clean path of the right root.
+    Result result;                      ///< The outcome of the last comparison that has finished.
+    QFutureWatcher<Result> watcher;     ///< Watches the running comparison.
+
+    QString relativePath(const QString &path) const;
+
+    static void compare(QPromise<Result> &promise, const QString &leftRoot, const QString &rightRoot);
+    static DirResult compareDir(const QString &leftRoot, const QString &rightRoot, const QString &relativeDir);
+    static QHash<QString, EntryInfo> readDir(const QString &dirPath);
+    static bool sameContents(const QString &leftPath, const QString &rightPath);
+};
+
+#endif // DIRECTORYCOMPARE_H
@@ -0,0 +1,507 @@
+#include "directoryentries.h"
+
+#include <cstring>
+
+/*!
+ * \brief Provides the amount of entries.
+ * \return An integer
+ */
+int DirectoryEntries::count() const
+{
+    return types.count();
+}
+
+/*!
+ * \brief Reserves memory for the given amount of entries.
+ * \param entryCount = The expected amount of entries
+ * \param nameBytes = The expected total size of all the names in bytes
+ */
+void DirectoryEntries::reserve(int entryCount, int nameBytes)
+{
+    nameArena.reserve(nameBytes);
+    nameOffsets.reserve(entryCount);
+    nameLengths.reserve(entryCount);
+    keyArena.reserve(nameBytes);
+    keyOffsets.reserve(entryCount);
+    keyLengths.reserve(entryCount);
+    types.reserve(entryCount);
+    flags.reserve(entryCount);
+}
+
+/*!
+ * \brief Removes all the entries.
+ */
+void DirectoryEntries::clear()
+{
+    nameArena.clear();
+    nameOffsets.clear();
+    nameLengths.clear();
+    keyArena.clear();
+    keyOffsets.clear();
+    keyLengths.clear();
+    types.clear();
+    flags.clear();
+    metadataPages.clear();
+    dirMtime = 0;
+}
+
+/*!
+ * \brief Estimates the memory held by the entries.
+ * \return The size of the arenas, the columns and the allocated metadata pages in bytes
+ */
+qint64 DirectoryEntries::memoryUsage() const
+{
+    qint64 bytes(nameArena.capacity() + keyArena.capacity());
+    bytes += (nameOffsets.capacity() + keyOffsets.capacity()) * static_cast<qint64>(sizeof(quint32));
+    bytes += (nameLengths.capacity() + keyLengths.capacity()) * static_cast<qint64>(sizeof(quint16));
+    bytes += types.capacity() + flags.capacity();
+
+    for (const MetadataPage &page : metadataPages) {
+        bytes += page.sizes.capacity() * static_cast<qint64>(sizeof(qint64) * 2 + sizeof(quint32) + sizeof(quint16));
+    }
+
+    return bytes;
+}
+
+/*!
+ * \brief Adds an entry without any metadata and computes its sort key.
+ * \param name = The UTF-8 name of the entry (does not need to be null terminated)
+ * \param length = The length of the name in bytes
+ * \param type = The type of the entry
+ * \param entryFlags = The EntryFlag values of the entry
+ * \return The position of the new entry
+ */
+int DirectoryEntries::append(const char *name, int length, EntryType type, quint8 entryFlags)
+{
+    nameOffsets.append(static_cast<quint32>(nameArena.size()));
+    nameLengths.append(static_cast<quint16>(length));
+    nameArena.append(name, length);
+    appendSortKey(name, length);
+    types.append(type);
+    flags.append(entryFlags);
+
+    return types.count() - 1;
+}
+
+/*!
+ * \brief Assigns the metadata of an entry and marks it as stat'ed.
+ * \param entry = The position of the entry
+ * \param size = The size in bytes
+ * \param mtime = The last modification time in milliseconds since the epoch
+ * \param mode = The mode bits
+ */
+void DirectoryEntries::setMetadata(int entry, qint64 size, qint64 mtime, quint32 mode)
+{
+    MetadataPage &page(metadataPage(entry));
+    const int slot(entry & (PageSize - 1));
+
+    page.sizes[slot] = size;
+    page.mtimes[slot] = mtime;
+    page.modes[slot] = mode;
+    flags[entry] |= StatFlag;
+}
+
+/*!
+ * \brief Assigns the MIME type of an entry.
+ * \param entry = The position of the entry
+ * \param mimeType = The MimeTypeTable ID of the MIME type
+ */
+void DirectoryEntries::setMimeType(int entry, quint16 mimeType)
+{
+    metadataPage(entry).mimeTypes[entry & (PageSize - 1)] = mimeType;
+    flags[entry] |= MimeFlag;
+}
+
+/*!
+ * \brief Forgets the metadata and MIME type of an entry, so they are fetched again.
+ * \param entry = The position of the entry
+ */
+void DirectoryEntries::clearMetadata(int entry)
+{
+    flags[entry] &= ~(StatFlag | MimeFlag);
+}
+
+/*!
+ * \brief Marks an entry as removed from the directory.
+ * \param entry = The position of the entry
+ * \note The entry keeps its position, so the positions of the other entries do not change.
+ */
+void DirectoryEntries::remove(int entry)
+{
+    flags[entry] |= RemovedFlag;
+}
+
+/*!
+ * \brief Drops the entries that have been removed, which moves the following entries to lower positions.
+ * \note The names and sort keys are copied as they are, so the sort keys are not computed again.
+ */
+void DirectoryEntries::compact()
+{
+    DirectoryEntries kept;
+    kept.reserve(count(), nameArena.size());
+    kept.keyArena.reserve(keyArena.size());
+    kept.dirMtime = dirMtime;
+
+    for (int entry(0); entry < count(); ++entry) {
+        if (isRemoved(entry)) {
+            continue;
+        }
+
+        kept.nameOffsets.append(static_cast<quint32>(kept.nameArena.size()));
+        kept.nameLengths.append(nameLengths.at(entry));
+        kept.nameArena.append(nameArena.constData() + nameOffsets.at(entry), nameLengths.at(entry));
+        kept.keyOffsets.append(static_cast<quint32>(kept.keyArena.size()));
+        kept.keyLengths.append(keyLengths.at(entry));
+        kept.keyArena.append(keyArena.constData() + keyOffsets.at(entry), keyLengths.at(entry));
+        kept.types.append(types.at(entry));
+        kept.flags.append(flags.at(entry) & (SymlinkFlag | HiddenFlag));
+
+        const int keptEntry(kept.count() - 1);
+
+        if (hasMetadata(entry)) {
+            kept.setMetadata(keptEntry, size(entry), mtime(entry), mode(entry));
+        }
+
+        if (hasMimeType(entry)) {
+            kept.setMimeType(keptEntry, mimeType(entry));
+        }
+    }
+
+    *this = std::move(kept);
+}
+
+/*!
+ * \brief Checks if an entry has been removed from the directory.
+ * \param entry = The position of the entry
+ * \return A Boolean value
+ */
+bool DirectoryEntries::isRemoved(int entry) const
+{
+    return flags.at(entry) & RemovedFlag;
+}
+
+/*!
+ * \brief Checks if the size, modification time and mode of an entry are known.
+ * \param entry = The position of the entry
+ * \return A Boolean value
+ */
+bool DirectoryEntries::hasMetadata(int entry) const
+{
+    return flags.at(entry) & StatFlag;
+}
+
+/*!
+ * \brief Checks if the MIME type of an entry is known.
+ * \param entry = The position of the entry
+ * \return A Boolean value
+ */
+bool DirectoryEntries::hasMimeType(int entry) const
+{
+    return flags.at(entry) & MimeFlag;
+}
+
+/*!
+ * \brief Provides the size of an entry.
+ * \param entry = The position of the entry
+ * \return The size in bytes, or 0 if the entry has no metadata yet
+ */
+qint64 DirectoryEntries::size(int entry) const
+{
+    return hasMetadata(entry) ? metadataPages.at(entry >> PageShift).sizes.at(entry & (PageSize - 1)) : 0;
+}
+
+/*!
+ * \brief Provides the last modification time of an entry.
+ * \param entry = The position of the entry
+ * \return The time in milliseconds since the epoch, or 0 if the entry has no metadata yet
+ */
+qint64 DirectoryEntries::mtime(int entry) const
+{
+    return hasMetadata(entry) ? metadataPages.at(entry >> PageShift).mtimes.at(entry & (PageSize - 1)) : 0;
+}
+
+/*!
+ * \brief Provides the mode bits of an entry.
+ * \param entry = The position of the entry
+ * \return The mode bits, or 0 if the entry has no metadata yet
+ */
+quint32 DirectoryEntries::mode(int entry) const
+{
+    return hasMetadata(entry) ? metadataPages.at(entry >> PageShift).modes.at(entry & (PageSize - 1)) : 0;
+}
+
+/*!
+ * \brief Provides the MIME type of an entry.
+ * \param entry = The position of the entry
+ * \return The MimeTypeTable ID of the MIME type, or 0 if it is not known yet
+ */
+quint16 DirectoryEntries::mimeType(int entry) const
+{
+    return hasMimeType(entry) ? metadataPages.at(entry >> PageShift).mimeTypes.at(entry & (PageSize - 1)) : 0;
+}
+
+/*!
+ * \brief Adds all the entries of another block to the end of this one.
+ * \param other = The block to copy from
+ */
+void DirectoryEntries::append(const DirectoryEntries &other)
+{
+    const quint32 arenaOffset(static_cast<quint32>(nameArena.size()));
+
+    nameArena.append(other.nameArena);
+    nameOffsets.reserve(nameOffsets.count() + other.count());
+
+    for (quint32 offset : other.nameOffsets) {
+        nameOffsets.append(offset + arenaOffset);
+    }
+
+    const quint32 keyArenaOffset(static_cast<quint32>(keyArena.size()));
+
+    keyArena.append(other.keyArena);
+    keyOffsets.reserve(keyOffsets.count() + other.count());
+
+    for (quint32 offset : other.keyOffsets) {
+        keyOffsets.append(offset + keyArenaOffset);
+    }
+
+    const int firstEntry(count());
+
+    nameLengths.append(other.nameLengths);
+    keyLengths.append(other.keyLengths);
+    types.append(other.types);
+    flags.append(other.flags);
+
+    // The pages of the other block are not aligned with ours, so only the entries that have metadata are copied.
+    for (int entry(0); entry < other.count(); ++entry) {
+        if (other.hasMetadata(entry)) {
+            setMetadata(firstEntry + entry, other.size(entry), other.mtime(entry), other.mode(entry));
+        }
+
+        if (other.hasMimeType(entry)) {
+            setMimeType(firstEntry + entry, other.mimeType(entry));
+        }
+    }
+}
+
+/*!
+ * \brief Provides a view of the raw UTF-8 name of an entry.
+ * \param entry = The position of the entry
+ * \return A QByteArrayView into the name arena
+ */
+QByteArrayView DirectoryEntries::nameView(int entry) const
+{
+    return QByteArrayView(nameArena.constData() + nameOffsets.at(entry), nameLengths.at(entry));
+}
+
+/*!
+ * \brief Provides the name of an entry.
+ * \param entry = The position of the entry
+ * \return A QString with the decoded name
+ */
+QString DirectoryEntries::name(int entry) const
+{
+    return QString::fromUtf8(nameArena.constData() + nameOffsets.at(entry), nameLengths.at(entry));
+}
+
+/*!
+ * \brief Looks up an entry by its name.
+ * \param name = The UTF-8 name
+ * \return The position of the entry, or -1 if there is no entry with that name
+ * \note Removed entries are skipped.
+ */
+int DirectoryEntries::indexOf(const QByteArray &name) const
+{
+    for (int entry(0); entry < count(); ++entry) {
+        if (nameLengths.at(entry) == name.size() && !isRemoved(entry)
+                && std::memcmp(nameArena.constData() + nameOffsets.at(entry), name.constData(), name.size()) == 0) {
+            return entry;
+        }
+    }
+
+    return -1;
+}
+
+/*!
+ * \brief Checks if an entry is a directory (or a link to one).
+ * \param entry = The position of the entry
+ * \return A Boolean value
+ */
+bool DirectoryEntries::isDir(int entry) const
+{
+    return types.at(entry) == DirEntry;
+}
+
+/*!
+ * \brief Checks if an entry is the "." or ".." entry.
+ * \param entry = The position of the entry
+ * \return A Boolean value
+ */
+bool DirectoryEntries::isDotOrDotDot(int entry) const
+{
+    const char *entryName(nameArena.constData() + nameOffsets.at(entry));
+    const int length(nameLengths.at(entry));
+
+    return (length == 1 && entryName[0] == '.') || (length == 2 && entryName[0] == '.' && entryName[1] == '.');
+}
+
+/*!
+ * \brief Compares the names of two entries in natural order.
+ * \param entry = The position of the first entry
+ * \param otherEntry = The position of the second entry
+ * \return An integer that is negative if the first entry comes first, positive if it comes last and 0 if both names
+ * are the same
+ * \note Names with the same sort key, like "a" and "A", are ordered by their raw bytes.
+ */
+int DirectoryEntries::compareNames(int entry, int otherEntry) const
+{
+    const int keyLength(keyLengths.at(entry)), otherKeyLength(keyLengths.at(otherEntry));
+    int result(std::memcmp(keyArena.constData() + keyOffsets.at(entry), keyArena.constData() + keyOffsets.at(otherEntry),
+                           qMin(keyLength, otherKeyLength)));
+
+    if (result == 0) {
+        result = keyLength - otherKeyLength;
+    }
+
+    if (result == 0) {
+        const int nameLength(nameLengths.at(entry)), otherNameLength(nameLengths.at(otherEntry));
+        result = std::memcmp(nameArena.constData() + nameOffsets.at(entry), nameArena.constData() + nameOffsets.at(otherEntry),
+                             qMin(nameLength, otherNameLength));
+
+        if (result == 0) {
+            result = nameLength - otherNameLength;
+        }
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Checks if an entry passes the given filters.
+ * \param entry = The position of the entry
+ * \param filters = The QDir::Filters
+ * \return A Boolean value
+ * \note Only the Dirs, AllDirs, Files, System, Hidden, NoDot and NoDotDot flags are taken into account. Removed
+ * entries never pass.
+ */
+bool DirectoryEntries::passesFilter(int entry, QDir::Filters filters) const
+{
+    if (isRemoved(entry)) {
+        return false;
+    }
+
+    if (isDotOrDotDot(entry)) {
+        if (nameLengths.at(entry) == 1) {
+            return !filters.testFlag(QDir::NoDot);
+        }
+
+        return !filters.testFlag(QDir::NoDotDot);
+    }
+
+    if ((flags.at(entry) & HiddenFlag) && !filters.testFlag(QDir::Hidden)) {
+        return false;
+    }
+
+    switch (types.at(entry)) {
+    case DirEntry:
+        return filters.testFlag(QDir::Dirs) || filters.testFlag(QDir::AllDirs);
+
+    case FileEntry:
+    case UnknownEntry:
+        return filters.testFlag(QDir::Files);
+
+    default:
+        return filters.testFlag(QDir::System);
+    }
+}
+
+/*!
+ * \brief Provides the metadata page of an entry and allocates it if needed.
+ * \param entry = The position of the entry
+ * \return A reference to the MetadataPage
+ */
+DirectoryEntries::MetadataPage &DirectoryEntries::metadataPage(int entry)
+{
+    const int pageIndex(entry >> PageShift);
+
+    if (metadataPages.count() <= pageIndex) {
+        metadataPages.resize(pageIndex + 1);
+    }
+
+    MetadataPage &page(metadataPages[pageIndex]);
+
+    if (page.sizes.isEmpty()) {
+        page.sizes.fill(0, PageSize);
+        page.mtimes.fill(0, PageSize);
+        page.modes.fill(0, PageSize);
+        page.mimeTypes.fill(0, PageSize);
+    }
+
+    return page;
+}
+
+/*!
+ * \brief Computes the natural sort key of a name and appends it to the key arena.
+ * \param name = The UTF-8 name
+ * \param length = The length of the name in bytes
+ *
+ * Letters are folded to lower case and, for names that are not plain ASCII, accents are stripped by decomposing the
+ * name and dropping the combining marks. Every run of digits becomes a '0' byte, followed by the amount of significant
+ * digits and the digits themselves, so longer numbers sort after shorter ones and numbers still sort before letters.
+ */
+void DirectoryEntries::appendSortKey(const char *name, int length)
+{
+    bool ascii(true);
+
+    for (int i(0); i < length && ascii; ++i) {
+        ascii = static_cast<uchar>(name[i]) < 0x80;
+    }
+
+    QByteArray foldedName;
+    const char *text(name);
+    int textLength(length);
+
+    if (!ascii) {
+        const QString decomposedName(QString::fromUtf8(name, length).normalized(QString::NormalizationForm_KD));
+        QString strippedName;
+        strippedName.reserve(decomposedName.size());
+
+        for (const QChar character : decomposedName) {
+            if (character.category() != QChar::Mark_NonSpacing) {
+                strippedName.append(character);
+            }
+        }
+
+        foldedName = strippedName.toCaseFolded().toUtf8();
+        text = foldedName.constData();
+        textLength = foldedName.size();
+    }
+
+    const int keyStart(keyArena.size());
+    keyOffsets.append(static_cast<quint32>(keyStart));
+
+    for (int i(0); i < textLength;) {
+        const char character(text[i]);
+
+        if (character < '0' || character > '9') {
+            keyArena.append((character >= 'A' && character <= 'Z') ? static_cast<char>(character - 'A' + 'a') : character);
+            ++i;
+            continue;
+        }
+
+        while (i < textLength && text[i] == '0') {
+            ++i;
+        }
+
+        const int digitsStart(i);
+
+        while (i < textLength && text[i] >= '0' && text[i] <= '9') {
+            ++i;
+        }
+
+        keyArena.append('0');
+        keyArena.append(static_cast<char>(qMin(i - digitsStart, 255)));
+        keyArena.append(text + digitsStart, i - digitsStart);
+    }
+
+    keyLengths.append(static_cast<quint16>(keyArena.size() - keyStart));
+}
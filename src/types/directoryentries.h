@@ -0,0 +1,121 @@
+#ifndef DIRECTORYENTRIES_H
+#define DIRECTORYENTRIES_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QDir>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief A block of directory entries stored as a struct of arrays.
+ *
+ * Every entry is identified by its position in the arrays, which stays stable for as long as the block exists. Entries
+ * that disappear from the directory are therefore only marked as removed instead of being erased.
+ * The names are stored back to back in a single UTF-8 arena, so an entry costs its name plus a couple of bytes instead
+ * of a heap node with its own strings. The metadata (size, modification time, mode and MIME type) is only fetched for
+ * the entries that are actually looked at, so it is kept in packed columns that are split into pages of PageSize
+ * entries and a page is only allocated once one of its entries gets metadata.
+ *
+ * Every entry also gets a natural sort key when it is appended, which is stored in a second arena. Comparing two keys
+ * byte by byte orders the names case-insensitively, ignoring accents, with runs of digits compared by their value, so
+ * "file2" comes before "file10". Sorting therefore never has to decode or collate the names themselves.
+ */
+struct DirectoryEntries
+{
+    /*!
+     * \brief The type of file system object an entry refers to (after following symbolic links).
+     */
+    enum EntryType : quint8 {
+        UnknownEntry,   ///< 0
+        FileEntry,      ///< 1
+        DirEntry,       ///< 2
+        OtherEntry      ///< 3 (devices, pipes, sockets and broken links)
+    };
+
+    /*!
+     * \brief Flags describing an entry.
+     */
+    enum EntryFlag : quint8 {
+        SymlinkFlag = 0x01,     ///< The entry is a symbolic link.
+        HiddenFlag = 0x02,      ///< The entry is hidden.
+        StatFlag = 0x04,        ///< The size, modification time and mode of the entry are known.
+        MimeFlag = 0x08,        ///< The MIME type of the entry is known.
+        RemovedFlag = 0x10      ///< The entry has been removed from the directory and only keeps its position.
+    };
+
+    static const int PageShift = 8;                 ///< The log2 of the amount of entries per metadata page.
+    static const int PageSize = 1 << PageShift;     ///< The amount of entries per metadata page.
+
+    /*!
+     * \brief The metadata columns of PageSize consecutive entries.
+     */
+    struct MetadataPage
+    {
+        QVector<qint64> sizes;          ///< The size of each entry in bytes.
+        QVector<qint64> mtimes;         ///< The last modification time of each entry in milliseconds since the epoch.
+        QVector<quint32> modes;         ///< The mode bits of each entry.
+        QVector<quint16> mimeTypes;     ///< The MimeTypeTable ID of each entry.
+    };
+
+    QByteArray nameArena;           ///< All the entry names, stored back to back in UTF-8.
+    QVector<quint32> nameOffsets;   ///< The offset of each name in the name arena.
+    QVector<quint16> nameLengths;   ///< The length in bytes of each name.
+    QByteArray keyArena;            ///< All the natural sort keys, stored back to back.
+    QVector<quint32> keyOffsets;    ///< The offset of each sort key in the key arena.
+    QVector<quint16> keyLengths;    ///< The length in bytes of each sort key.
+    QVector<quint8> types;          ///< The EntryType of each entry.
+    QVector<quint8> flags;          ///< The EntryFlag values of each entry.
+    QVector<MetadataPage> metadataPages;    ///< The metadata pages, which are empty until one of their entries gets metadata.
+    qint64 dirMtime = 0;            ///< The modification time of the directory when the entries were read, in milliseconds since the epoch, or 0 if it is not known.
+
+    int count() const;
+    void reserve(int entryCount, int nameBytes);
+    void clear();
+    qint64 memoryUsage() const;
+    int append(const char *name, int length, EntryType type, quint8 entryFlags);
+    void setMetadata(int entry, qint64 size, qint64 mtime, quint32 mode);
+    void setMimeType(int entry, quint16 mimeType);
+    void clearMetadata(int entry);
+    void remove(int entry);
+    void compact();
+    bool isRemoved(int entry) const;
+    bool hasMetadata(int entry) const;
+    bool hasMimeType(int entry) const;
+    qint64 size(int entry) const;
+    qint64 mtime(int entry) const;
+    quint32 mode(int entry) const;
+    quint16 mimeType(int entry) const;
+    void append(const DirectoryEntries &other);
+    QByteArrayView nameView(int entry) const;
+    QString name(int entry) const;
+    int indexOf(const QByteArray &name) const;
+    bool isDir(int entry) const;
+    bool isDotOrDotDot(int entry) const;
+    int compareNames(int entry, int otherEntry) const;
+    bool passesFilter(int entry, QDir::Filters filters) const;
+
+private:
+    MetadataPage &metadataPage(int entry);
+    void appendSortKey(const char *name, int length);
+};
+
+/*!
+ * \brief The metadata of a single entry, as fetched by a worker thread.
+ */
+struct EntryMetadata
+{
+    int id;             ///< The position of the entry.
+    quint8 type;        ///< The DirectoryEntries::EntryType of the entry.
+    bool stated;        ///< Whether the entry could be stat'ed.
+    qint64 size;        ///< The size in bytes.
+    qint64 mtime;       ///< The last modification time in milliseconds since the epoch.
+    quint32 mode;       ///< The mode bits.
+    QString mimeName;   ///< The name of the MIME type.
+};
+
+Q_DECLARE_METATYPE(DirectoryEntries)
+Q_DECLARE_METATYPE(EntryMetadata)
+
+#endif // DIRECTORYENTRIES_H
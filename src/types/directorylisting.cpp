@@ -0,0 +1,791 @@
+#include "directorylisting.h"
+#include "directoryreader.h"
+#include "directorywatcher.h"
+#include "filesystemaccess.h"
+#include "mimetypetable.h"
+
+#include <QCoreApplication>
+#include <QtConcurrent/QtConcurrentRun>
+
+static int foregroundLoads(0);  ///< The amount of listings that are being read for a view.
+
+/*!
+ * \brief The constructor
+ * \param dirPath = The path of the directory
+ * \param parent = The QObject to which this object is bound
+ * \note The directory is not read until load() is called.
+ */
+DirectoryListing::DirectoryListing(const QString &dirPath, QObject *parent) :
+    QObject(parent),
+    dirPath(dirPath),
+    removedCount(0),
+    nameIndexBuilt(false),
+    rescanPending(false),
+    watching(false),
+    loaded(false),
+    loading(false),
+    backgroundLoad(false),
+    readerDone(false),
+    entriesGeneration(0),
+    metadataGeneration(0),
+    allMetadataRequested(false),
+    metadataCursor(0),
+    readMtime(0)
+{
+    batchTimer.setSingleShot(true);
+    batchTimer.setInterval(0);
+    requestTimer.setSingleShot(true);
+    requestTimer.setInterval(0);
+
+    connect(&readWatcher, &QFutureWatcher<DirectoryEntries>::resultsReadyAt, this, &DirectoryListing::readerResultsReady);
+    connect(&readWatcher, &QFutureWatcher<DirectoryEntries>::finished, this, &DirectoryListing::readerFinished);
+    connect(&batchTimer, &QTimer::timeout, this, &DirectoryListing::appendPendingBatches);
+    connect(&requestTimer, &QTimer::timeout, this, &DirectoryListing::queuePaintRequests);
+    connect(&metadataWatcher, &QFutureWatcher<QVector<EntryMetadata>>::finished, this, &DirectoryListing::metadataBatchFinished);
+    connect(&changeWatcher, &QFutureWatcher<DirectoryEntries>::finished, this, &DirectoryListing::changeReadFinished);
+    connect(DirectoryWatcher::instance(), &DirectoryWatcher::directoryChanged, this, &DirectoryListing::directoryChanged);
+    connect(DirectoryWatcher::instance(), &DirectoryWatcher::rescanNeeded, this, &DirectoryListing::rescanNeeded);
+}
+
+/*!
+ * \brief The destructor
+ * \note This will cancel the worker if it is still reading the directory and stop watching it.
+ */
+DirectoryListing::~DirectoryListing()
+{
+    cancel();
+
+    // The watcher is deleted with the application object.
+    if (watching && QCoreApplication::instance() != nullptr) {
+        DirectoryWatcher::instance()->removePath(dirPath);
+    }
+}
+
+/*!
+ * \brief Provides the path of the directory.
+ * \return A QString value of the path
+ */
+QString DirectoryListing::path() const
+{
+    return dirPath;
+}
+
+/*!
+ * \brief Provides the modification time of the directory when it was last read.
+ * \return A qint64 in milliseconds since the epoch, which is 0 if it is not known
+ */
+qint64 DirectoryListing::modificationTime() const
+{
+    return readMtime;
+}
+
+/*!
+ * \brief Provides the entries of the directory.
+ * \return A reference to the DirectoryEntries
+ */
+const DirectoryEntries &DirectoryListing::entries() const
+{
+    return dirEntries;
+}
+
+/*!
+ * \brief Checks if the directory is currently being read.
+ * \return A Boolean value
+ */
+bool DirectoryListing::isLoading() const
+{
+    return loading;
+}
+
+/*!
+ * \brief Checks if the directory has been read at least once.
+ * \return A Boolean value
+ */
+bool DirectoryListing::isLoaded() const
+{
+    return loaded;
+}
+
+/*!
+ * \brief Starts reading the directory on a worker thread.
+ * \param background = Whether the directory is read speculatively, at idle CPU and I/O priority
+ * \note A read that is still running will be canceled first. loadFinished() is emitted once all the entries are available.
+ * \note The directory is watched before it is read, so no change can slip in between. A directory whose watch has been
+ * lost, because it was deleted or moved away, is watched again.
+ */
+void DirectoryListing::load(bool background)
+{
+    cancel();
+
+    // A first read that was interrupted starts over from scratch.
+    if (!loaded && dirEntries.count() > 0) {
+        resetEntries();
+        emit entriesReset();
+    }
+
+    if (!watching || !DirectoryWatcher::instance()->isWatching(dirPath)) {
+        DirectoryWatcher::instance()->addPath(dirPath);
+        watching = true;
+    }
+
+    backgroundLoad = background;
+    setLoading(true);
+    readerDone = false;
+    readMtime = 0;
+
+    if (background) {
+        readWatcher.setFuture(QtConcurrent::run(FileSystemAccess::instance()->backgroundPool(dirPath), &DirectoryReader::readDirectoryInBackground, dirPath));
+    } else {
+        readWatcher.setFuture(QtConcurrent::run(FileSystemAccess::instance()->readerPool(dirPath), &DirectoryReader::readDirectory, dirPath));
+    }
+
+    emit loadStarted();
+}
+
+/*!
+ * \brief Restarts a speculative read at normal priority, once a view is waiting for the directory.
+ */
+void DirectoryListing::prioritize()
+{
+    if (loading && backgroundLoad) {
+        load();
+    }
+}
+
+/*!
+ * \brief Provides the amount of listings that are being read for a view rather than speculatively.
+ * \return An integer
+ * \note Speculative reads are only started while this is zero.
+ */
+int DirectoryListing::foregroundLoadCount()
+{
+    return foregroundLoads;
+}
+
+/*!
+ * \brief Cancels the worker reading the directory and drops the batches it has reported so far.
+ * \note The entries that have already been streamed in are kept.
+ */
+void DirectoryListing::cancel()
+{
+    if (readWatcher.isRunning()) {
+        readWatcher.cancel();
+    }
+
+    batchTimer.stop();
+    pendingBatches.clear();
+    reloadEntries.clear();
+    setLoading(false);
+}
+
+/*!
+ * \brief Sets whether the directory is being read and keeps count of the reads that are not speculative.
+ * \param isLoading = Whether the directory is being read
+ */
+void DirectoryListing::setLoading(bool isLoading)
+{
+    if (isLoading != loading && !backgroundLoad) {
+        foregroundLoads += isLoading ? 1 : -1;
+    }
+
+    loading = isLoading;
+}
+
+/*!
+ * \brief Queues the batches reported by the worker.
+ * \param begin = The position of the first new batch
+ * \param end = The position after the last new batch
+ * \note The first batch carries the modification time of the directory, as stat'ed by the worker before reading it.
+ */
+void DirectoryListing::readerResultsReady(int begin, int end)
+{
+    if (readWatcher.isCanceled()) {
+        return;
+    }
+
+    for (int i(begin); i < end; ++i) {
+        pendingBatches.enqueue(readWatcher.resultAt(i));
+
+        if (i == 0) {
+            readMtime = pendingBatches.last().dirMtime;
+        }
+    }
+
+    if (!batchTimer.isActive()) {
+        batchTimer.start();
+    }
+}
+
+/*!
+ * \brief Marks the worker as done once it has reported all of its batches.
+ */
+void DirectoryListing::readerFinished()
+{
+    if (readWatcher.isCanceled() || !loading) {
+        return;
+    }
+
+    readerDone = true;
+
+    if (!batchTimer.isActive()) {
+        batchTimer.start();
+    }
+}
+
+/*!
+ * \brief Appends a bounded chunk of the pending batches and finishes the load once everything has been appended.
+ */
+void DirectoryListing::appendPendingBatches()
+{
+    int appendedCount(0);
+
+    while (!pendingBatches.isEmpty() && appendedCount < MaxEntriesPerTurn) {
+        const DirectoryEntries batch(pendingBatches.dequeue());
+        appendedCount += batch.count();
+
+        if (loaded) {
+            reloadEntries.append(batch);
+        } else {
+            if (batch.count() == 0) {
+                continue;
+            }
+
+            const int first(dirEntries.count());
+            dirEntries.append(batch);
+
+            if (nameIndexBuilt) {
+                for (int id(first); id < dirEntries.count(); ++id) {
+                    nameIndex.insert(dirEntries.nameView(id).toByteArray(), id);
+                }
+            }
+
+            emit entriesAppended(first, dirEntries.count() - 1);
+        }
+    }
+
+    if (!pendingBatches.isEmpty()) {
+        batchTimer.start();
+        return;
+    }
+
+    if (!readerDone) {
+        return;
+    }
+
+    // A rescan is compared with the current entries instead of replacing them.
+    if (loaded) {
+        const DirectoryEntries rescanEntries(reloadEntries);
+        reloadEntries.clear();
+        buildNameIndex();
+        applyChanges(rescanEntries, nameIndex.keys());
+    }
+
+    loaded = true;
+    setLoading(false);
+
+    // Release the batches held by the finished future.
+    readWatcher.setFuture(QFuture<DirectoryEntries>());
+    emit loadFinished();
+
+    processPendingChanges();
+}
+
+/*!
+ * \brief Requests the metadata of an entry that is being painted.
+ * \param id = The position of the entry
+ * \note The requests made while painting are queued together, in front of all the other requests.
+ */
+void DirectoryListing::requestMetadata(int id)
+{
+    if (id < 0 || id >= dirEntries.count() || dirEntries.hasMimeType(id)) {
+        return;
+    }
+
+    paintRequests.append(id);
+
+    if (!requestTimer.isActive()) {
+        requestTimer.start();
+    }
+}
+
+/*!
+ * \brief Requests the metadata of a set of entries.
+ * \param ids = The positions of the entries, in order of priority
+ * \param urgent = Whether the entries should be fetched before the ones that are already queued
+ * \note Once the queue is full, the entries that were requested the longest ago are dropped.
+ */
+void DirectoryListing::requestMetadata(const QVector<int> &ids, bool urgent)
+{
+    QVector<int> newIds;
+    newIds.reserve(ids.count());
+
+    for (int id : ids) {
+        if (id < 0 || id >= dirEntries.count() || dirEntries.hasMimeType(id)) {
+            continue;
+        }
+
+        if (queuedMetadata.contains(id)) {
+            if (!urgent) {
+                continue;
+            }
+
+            metadataQueue.removeOne(id);
+        } else {
+            queuedMetadata.insert(id);
+        }
+
+        newIds.append(id);
+    }
+
+    if (urgent) {
+        metadataQueue = newIds + metadataQueue;
+    } else {
+        metadataQueue.append(newIds);
+    }
+
+    while (metadataQueue.count() > MaxQueuedMetadata) {
+        queuedMetadata.remove(metadataQueue.takeLast());
+    }
+
+    startMetadataBatch();
+}
+
+/*!
+ * \brief Requests the metadata of every entry, for example to sort by size.
+ * \note The entries are fetched after the queued requests. allMetadataFetched() is emitted once they are all done.
+ */
+void DirectoryListing::requestAllMetadata()
+{
+    if (allMetadataRequested) {
+        return;
+    }
+
+    allMetadataRequested = true;
+    metadataCursor = 0;
+    startMetadataBatch();
+}
+
+/*!
+ * \brief Reads the directory again in the background if it has changed since it was last read.
+ * \note This is meant for listings that are shown again after a while. Changes reported by the DirectoryWatcher are
+ * already applied, so this only catches the ones that were missed, such as changes on file systems without inotify.
+ * \note The directory is stat'ed by a worker, and the rescan is only scheduled once its answer has come back. Modifying
+ * a file does not change the time of its directory, so if the watcher can not report such modifications, the metadata
+ * of an unchanged directory is fetched again instead.
+ */
+void DirectoryListing::revalidate()
+{
+    if (!loaded || loading) {
+        return;
+    }
+
+    QtConcurrent::run(FileSystemAccess::instance()->readerPool(dirPath), &DirectoryReader::directoryMtime, dirPath).then(this, [this](qint64 mtime) {
+        if (!loaded || loading) {
+            return;
+        }
+
+        if (mtime != readMtime) {
+            rescanPending = true;
+            processPendingChanges();
+            return;
+        }
+
+        if (!DirectoryWatcher::instance()->reportsModifications(dirPath)) {
+            invalidateMetadata();
+        }
+    });
+}
+
+/*!
+ * \brief Shows entries that were saved earlier right away and reads the directory again in the background.
+ * \param savedEntries = The saved entries, such as the ones of the last session
+ * \note Nothing happens if the directory has already been read, and a first read that is still running is replaced.
+ * The directory is only read again if its modification time differs from the one saved with the entries, and the rescan
+ * is compared with the saved entries like any other rescan. The saved metadata is painted until the rows are fetched
+ * again, which happens either way, since modifying a file does not change the time of its directory.
+ */
+void DirectoryListing::restore(const DirectoryEntries &savedEntries)
+{
+    if (loaded) {
+        return;
+    }
+
+    cancel();
+    resetEntries();
+    dirEntries = savedEntries;
+    readMtime = savedEntries.dirMtime;
+    loaded = true;
+
+    for (int id(0); id < dirEntries.count(); ++id) {
+        if (dirEntries.isRemoved(id)) {
+            ++removedCount;
+        }
+    }
+
+    if (!watching) {
+        DirectoryWatcher::instance()->addPath(dirPath);
+        watching = true;
+    }
+
+    emit entriesReset();
+    emit loadFinished();
+
+    // The saved entries are painted first, so the rescan only starts once a worker has stat'ed the directory.
+    QtConcurrent::run(FileSystemAccess::instance()->readerPool(dirPath), &DirectoryReader::directoryMtime, dirPath).then(this, [this](qint64 mtime) {
+        if (loading) {
+            return;
+        }
+
+        if (mtime == 0 || mtime != readMtime) {
+            load(true);
+        } else {
+            invalidateMetadata();
+        }
+    });
+}
+
+/*!
+ * \brief Looks up an entry by its name.
+ * \param name = The UTF-8 name of the entry
+ * \return The position of the entry, or -1 if there is no entry with that name or it has been removed
+ * \note The first lookup builds the name index, which is kept up to date from then on.
+ */
+int DirectoryListing::indexOf(const QByteArray &name)
+{
+    buildNameIndex();
+    return nameIndex.value(name, -1);
+}
+
+/*!
+ * \brief Drops everything that refers to the current entries, before they are replaced.
+ */
+void DirectoryListing::resetEntries()
+{
+    dirEntries.clear();
+    metadataQueue.clear();
+    queuedMetadata.clear();
+    paintRequests.clear();
+    nameIndex.clear();
+    nameIndexBuilt = false;
+    removedCount = 0;
+    metadataCursor = 0;
+    ++entriesGeneration;
+}
+
+/*!
+ * \brief Drops the metadata of every entry, so it is fetched again for the entries that are painted.
+ * \note This is meant for metadata that may have gone stale without the DirectoryWatcher noticing.
+ */
+void DirectoryListing::invalidateMetadata()
+{
+    QVector<int> ids;
+
+    for (int id(0); id < dirEntries.count(); ++id) {
+        if (dirEntries.hasMetadata(id) || dirEntries.hasMimeType(id)) {
+            dirEntries.clearMetadata(id);
+            ids.append(id);
+        }
+    }
+
+    metadataCursor = 0;
+
+    if (!ids.isEmpty()) {
+        emit metadataChanged(ids);
+    }
+}
+
+/*!
+ * \brief Queues the metadata requests made while painting.
+ */
+void DirectoryListing::queuePaintRequests()
+{
+    const QVector<int> ids(paintRequests);
+    paintRequests.clear();
+    requestMetadata(ids, true);
+}
+
+/*!
+ * \brief Starts a worker for the next batch of queued entries, unless one is already running.
+ */
+void DirectoryListing::startMetadataBatch()
+{
+    if (metadataWatcher.isRunning()) {
+        return;
+    }
+
+    QVector<int> ids;
+    QVector<QByteArray> names;
+
+    while (!metadataQueue.isEmpty() && ids.count() < MetadataBatchSize) {
+        const int id(metadataQueue.takeFirst());
+        queuedMetadata.remove(id);
+        ids.append(id);
+        names.append(dirEntries.nameView(id).toByteArray());
+    }
+
+    if (allMetadataRequested) {
+        while (metadataCursor < dirEntries.count() && ids.count() < MetadataBatchSize) {
+            if (!dirEntries.hasMimeType(metadataCursor) && !queuedMetadata.contains(metadataCursor)) {
+                ids.append(metadataCursor);
+                names.append(dirEntries.nameView(metadataCursor).toByteArray());
+            }
+
+            ++metadataCursor;
+        }
+    }
+
+    if (ids.isEmpty()) {
+        if (allMetadataRequested && !loading) {
+            allMetadataRequested = false;
+            emit allMetadataFetched();
+        }
+
+        return;
+    }
+
+    metadataGeneration = entriesGeneration;
+    metadataWatcher.setFuture(QtConcurrent::run(FileSystemAccess::instance()->readerPool(dirPath), &DirectoryReader::readMetadata, dirPath, ids, names));
+}
+
+/*!
+ * \brief Stores the metadata fetched by the worker and starts the next batch.
+ * \note The metadata is dropped if the entries have been replaced in the meantime.
+ */
+void DirectoryListing::metadataBatchFinished()
+{
+    if (metadataWatcher.isCanceled() || metadataWatcher.future().resultCount() == 0) {
+        return;
+    }
+
+    const QVector<EntryMetadata> results(metadataWatcher.result());
+    metadataWatcher.setFuture(QFuture<QVector<EntryMetadata>>());
+
+    if (metadataGeneration == entriesGeneration) {
+        QVector<int> ids;
+        ids.reserve(results.count());
+
+        for (const EntryMetadata &metadata : results) {
+            if (metadata.stated) {
+                dirEntries.setMetadata(metadata.id, metadata.size, metadata.mtime, metadata.mode);
+
+                if (dirEntries.types.at(metadata.id) == DirectoryEntries::UnknownEntry) {
+                    dirEntries.types[metadata.id] = metadata.type;
+                }
+            }
+
+            dirEntries.setMimeType(metadata.id, MimeTypeTable::instance()->intern(metadata.mimeName));
+            ids.append(metadata.id);
+        }
+
+        emit metadataChanged(ids);
+    }
+
+    startMetadataBatch();
+}
+
+/*!
+ * \brief Queues the entries that have changed in the directory.
+ * \param changedPath = The path of the directory that changed
+ * \param names = The UTF-8 names of the entries that changed
+ */
+void DirectoryListing::directoryChanged(const QString &changedPath, const QSet<QByteArray> &names)
+{
+    if (changedPath != dirPath) {
+        return;
+    }
+
+    pendingChanges.unite(names);
+    processPendingChanges();
+}
+
+/*!
+ * \brief Schedules a rescan of the whole directory.
+ * \param changedPath = The path of the directory whose changes are not known
+ */
+void DirectoryListing::rescanNeeded(const QString &changedPath)
+{
+    if (changedPath != dirPath) {
+        return;
+    }
+
+    rescanPending = true;
+    processPendingChanges();
+}
+
+/*!
+ * \brief Starts a rescan or a read of the changed entries, unless the directory is already being read.
+ * \note A rescan covers all the changes that were queued before it.
+ */
+void DirectoryListing::processPendingChanges()
+{
+    if (loading || changeWatcher.isRunning()) {
+        return;
+    }
+
+    if (rescanPending) {
+        rescanPending = false;
+        pendingChanges.clear();
+        load();
+        return;
+    }
+
+    if (!loaded || pendingChanges.isEmpty()) {
+        return;
+    }
+
+    changingNames = QVector<QByteArray>(pendingChanges.cbegin(), pendingChanges.cend());
+    pendingChanges.clear();
+    changeWatcher.setFuture(QtConcurrent::run(FileSystemAccess::instance()->readerPool(dirPath), &DirectoryReader::readEntries, dirPath, changingNames));
+}
+
+/*!
+ * \brief Applies the changed entries read by the worker and handles the changes that came in meanwhile.
+ */
+void DirectoryListing::changeReadFinished()
+{
+    if (changeWatcher.future().resultCount() == 0) {
+        return;
+    }
+
+    const DirectoryEntries found(changeWatcher.result());
+    changeWatcher.setFuture(QFuture<DirectoryEntries>());
+    readMtime = found.dirMtime;
+
+    applyChanges(found, changingNames);
+    changingNames.clear();
+    processPendingChanges();
+}
+
+/*!
+ * \brief Builds the index of the entries by name, unless it has been built already.
+ * \note The index is only needed once the directory changes or an entry is looked up by name, so other directories
+ * never pay for it. Entries that are streamed in afterwards are added to it as they are appended.
+ */
+void DirectoryListing::buildNameIndex()
+{
+    if (nameIndexBuilt) {
+        return;
+    }
+
+    nameIndex.reserve(dirEntries.count());
+
+    for (int id(0); id < dirEntries.count(); ++id) {
+        if (!dirEntries.isRemoved(id)) {
+            nameIndex.insert(dirEntries.nameView(id).toByteArray(), id);
+        }
+    }
+
+    nameIndexBuilt = true;
+}
+
+/*!
+ * \brief Applies the current state of a set of entries to the listing.
+ * \param found = The entries that exist, as read by a worker
+ * \param checkedNames = The names of all the entries that were read, including the ones that no longer exist
+ *
+ * New entries are appended, entries that no longer exist are marked as removed and the metadata of the other entries
+ * is updated in place. An entry that has turned from a file into a folder or the other way around, or into a link or
+ * back, is replaced. The MIME type of an entry is only fetched again if its metadata has actually changed. Entries read
+ * without metadata, as a rescan reads them, lose the metadata they have: a rescan is only needed when changes have been
+ * missed, so the files may have been modified as well. Their metadata is fetched again once they are painted. The
+ * changes are reported with entriesRemoved(), entriesAppended() and metadataChanged(), in that order.
+ * \note Once more than a fraction of the entries are marked as removed, the removed entries are dropped and the change
+ * is reported with entriesReset() instead, since the positions of the other entries move.
+ */
+void DirectoryListing::applyChanges(const DirectoryEntries &found, const QVector<QByteArray> &checkedNames)
+{
+    buildNameIndex();
+
+    QVector<int> removedIds, changedIds;
+    QSet<QByteArray> foundNames;
+    const int firstAdded(dirEntries.count());
+    foundNames.reserve(found.count());
+
+    for (int entry(0); entry < found.count(); ++entry) {
+        const QByteArray name(found.nameView(entry).toByteArray());
+        const int id(nameIndex.value(name, -1));
+        const quint8 flags(found.flags.at(entry) & (DirectoryEntries::SymlinkFlag | DirectoryEntries::HiddenFlag));
+        foundNames.insert(name);
+
+        if (id >= 0 && dirEntries.types.at(id) == found.types.at(entry)
+                && (dirEntries.flags.at(id) & DirectoryEntries::SymlinkFlag) == (flags & DirectoryEntries::SymlinkFlag)) {
+            if (!found.hasMetadata(entry)) {
+                if (dirEntries.hasMetadata(id) || dirEntries.hasMimeType(id)) {
+                    dirEntries.clearMetadata(id);
+                    changedIds.append(id);
+                }
+            } else {
+                if (!dirEntries.hasMetadata(id) || dirEntries.size(id) != found.size(entry)
+                        || dirEntries.mtime(id) != found.mtime(entry) || dirEntries.mode(id) != found.mode(entry)) {
+                    dirEntries.clearMetadata(id);
+                    dirEntries.setMetadata(id, found.size(entry), found.mtime(entry), found.mode(entry));
+                    changedIds.append(id);
+                }
+            }
+            continue;
+        }
+
+        if (id >= 0) {
+            dirEntries.remove(id);
+            removedIds.append(id);
+        }
+
+        const int newId(dirEntries.append(name.constData(), name.size(), static_cast<DirectoryEntries::EntryType>(found.types.at(entry)), flags));
+
+        if (found.hasMetadata(entry)) {
+            dirEntries.setMetadata(newId, found.size(entry), found.mtime(entry), found.mode(entry));
+        }
+
+        nameIndex.insert(name, newId);
+    }
+
+    for (const QByteArray &name : checkedNames) {
+        if (foundNames.contains(name)) {
+            continue;
+        }
+
+        const auto removedEntry(nameIndex.constFind(name));
+
+        if (removedEntry != nameIndex.constEnd()) {
+            dirEntries.remove(removedEntry.value());
+            removedIds.append(removedEntry.value());
+            nameIndex.erase(removedEntry);
+        }
+    }
+
+    removedCount += removedIds.count();
+
+    if (removedCount >= MinCompactedEntries && removedCount > dirEntries.count() / CompactionDivisor) {
+        compactEntries();
+        return;
+    }
+
+    if (!removedIds.isEmpty()) {
+        emit entriesRemoved(removedIds);
+    }
+
+    if (dirEntries.count() > firstAdded) {
+        emit entriesAppended(firstAdded, dirEntries.count() - 1);
+    }
+
+    if (!changedIds.isEmpty()) {
+        // Entries whose metadata has been dropped are fetched again when every entry has been requested.
+        metadataCursor = 0;
+        emit metadataChanged(changedIds);
+    }
+}
+
+/*!
+ * \brief Drops the entries that are marked as removed and reports the remaining ones as new entries.
+ * \note The metadata of the remaining entries is kept, but the requests that refer to the old positions are dropped.
+ */
+void DirectoryListing::compactEntries()
+{
+    DirectoryEntries keptEntries(std::move(dirEntries));
+    keptEntries.compact();
+
+    resetEntries();
+    dirEntries = std::move(keptEntries);
+
+    emit entriesReset();
+}
@@ -0,0 +1,115 @@
+#ifndef DIRECTORYLISTING_H
+#define DIRECTORYLISTING_H
+
+#include "directoryentries.h"
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+
+/*!
+ * \brief The class responsible for loading and holding the entries of a single directory.
+ *
+ * The first time a directory is read, its entries are streamed in: the batches reported by the worker are appended in
+ * bounded chunks, one chunk per turn of the event loop, so the views can paint while the rest is still being read.
+ * The directory is then kept up to date through the DirectoryWatcher: only the entries that changed are read again,
+ * and the differences are applied in place. Entries that disappear keep their position and are marked as removed.
+ * A full rescan, which is only needed when change notifications have been lost, is collected in the background and
+ * compared with the current entries in the same way, so the entries are never replaced as a whole once loaded.
+ *
+ * Reading the directory only records the names and types of the entries. The rest of the metadata is fetched by a
+ * worker thread for the entries the views ask for, in order of priority: the rows that are painted come first, followed
+ * by the rows near the viewport. Older requests are dropped once the queue is full, so rows that have scrolled away
+ * are never stat'ed.
+ */
+class DirectoryListing : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryListing(const QString &dirPath, QObject *parent = nullptr);
+    ~DirectoryListing();
+    QString path() const;
+    qint64 modificationTime() const;
+    const DirectoryEntries &entries() const;
+    bool isLoading() const;
+    bool isLoaded() const;
+    void load(bool background = false);
+    void prioritize();
+    void cancel();
+    void requestMetadata(int id);
+    void requestMetadata(const QVector<int> &ids, bool urgent);
+    void requestAllMetadata();
+    void revalidate();
+    void restore(const DirectoryEntries &savedEntries);
+    int indexOf(const QByteArray &name);
+
+    static int foregroundLoadCount();
+
+signals:
+    void loadStarted();     ///< Emitted when the directory starts being read.
+    void entriesAppended(int first, int last);  ///< Emitted when the entries from first to last (inclusive) have been streamed in.
+    void entriesRemoved(const QVector<int> &ids);   ///< Emitted when the given entries have been removed from the directory.
+    void entriesReset();    ///< Emitted when all the entries have been dropped because the first read was restarted.
+    void loadFinished();    ///< Emitted when the directory has been read completely.
+    void metadataChanged(const QVector<int> &ids);  ///< Emitted when the metadata of the given entries has been fetched.
+    void allMetadataFetched();  ///< Emitted when the metadata of every entry has been fetched after requestAllMetadata().
+
+private:
+    static const int MaxEntriesPerTurn = 4096;  ///< The maximum amount of entries appended per turn of the event loop.
+    static const int MetadataBatchSize = 64;    ///< The maximum amount of entries stat'ed by a single worker run.
+    static const int MaxQueuedMetadata = 2048;  ///< The maximum amount of entries waiting for their metadata.
+    static const int MinCompactedEntries = 256; ///< The minimum amount of removed entries before they are dropped.
+    static const int CompactionDivisor = 4;     ///< The removed entries are dropped once they exceed this fraction of all entries.
+
+    QString dirPath;            ///< The path of the directory.
+    DirectoryEntries dirEntries;    ///< The entries of the directory.
+    DirectoryEntries reloadEntries; ///< The entries collected by a rescan that has not finished yet.
+    QQueue<DirectoryEntries> pendingBatches;    ///< The batches reported by the worker that have not been appended yet.
+    QFutureWatcher<DirectoryEntries> readWatcher;   ///< Watches the worker reading the directory.
+    QFutureWatcher<DirectoryEntries> changeWatcher; ///< Watches the worker reading the entries that changed.
+    QVector<QByteArray> changingNames;  ///< The names of the entries being read by the change worker.
+    QSet<QByteArray> pendingChanges;    ///< The names of the entries that changed and have not been read yet.
+    QHash<QByteArray, int> nameIndex;   ///< The position of every entry that has not been removed, keyed by name.
+    int removedCount;           ///< The amount of entries that are marked as removed.
+    bool nameIndexBuilt;        ///< Whether the name index has been built, which happens on the first change or lookup.
+    bool rescanPending;         ///< Whether the whole directory needs to be read again.
+    bool watching;              ///< Whether the directory has been added to the DirectoryWatcher.
+    QTimer batchTimer;          ///< Appends the pending batches on the next turn of the event loop.
+    bool loaded;                ///< Whether the directory has been read at least once.
+    bool loading;               ///< Whether the directory is currently being read.
+    bool backgroundLoad;        ///< Whether the current read is a speculative one at idle priority.
+    bool readerDone;            ///< Whether the worker has reported all of its batches.
+    QList<int> metadataQueue;   ///< The entries waiting for their metadata, in order of priority.
+    QSet<int> queuedMetadata;   ///< The entries in the metadata queue.
+    QVector<int> paintRequests; ///< The entries requested while painting, which are queued on the next turn of the event loop.
+    QTimer requestTimer;        ///< Queues the paint requests on the next turn of the event loop.
+    QFutureWatcher<QVector<EntryMetadata>> metadataWatcher; ///< Watches the worker fetching metadata.
+    int entriesGeneration;      ///< Incremented whenever the entries are replaced, so stale metadata can be dropped.
+    int metadataGeneration;     ///< The entries generation of the metadata being fetched.
+    bool allMetadataRequested;  ///< Whether the metadata of every entry has been requested.
+    int metadataCursor;         ///< The next entry to check when fetching the metadata of every entry.
+    qint64 readMtime;           ///< The modification time of the directory when it was last read, in milliseconds since the epoch.
+
+    void setLoading(bool isLoading);
+    void readerResultsReady(int begin, int end);
+    void readerFinished();
+    void appendPendingBatches();
+    void resetEntries();
+    void invalidateMetadata();
+    void queuePaintRequests();
+    void startMetadataBatch();
+    void metadataBatchFinished();
+    void directoryChanged(const QString &changedPath, const QSet<QByteArray> &names);
+    void rescanNeeded(const QString &changedPath);
+    void processPendingChanges();
+    void changeReadFinished();
+    void buildNameIndex();
+    void applyChanges(const DirectoryEntries &found, const QVector<QByteArray> &checkedNames);
+    void compactEntries();
+};
+
+#endif // DIRECTORYLISTING_H
@@ -0,0 +1,1269 @@
+#include "directorymodel.h"
+#include "directorycache.h"
+#include "foldersizeservice.h"
+#include "iconservice.h"
+#include "mimetypetable.h"
+#include "thumbnailservice.h"
+
+#include <QColor>
+#include <QDateTime>
+#include <QLocale>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <functional>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this model is bound
+ * \note The model is empty until setRootPath() is called.
+ */
+DirectoryModel::DirectoryModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    filters(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::AllDirs),
+    sortColumn(NameColumn),
+    sortOrder(Qt::AscendingOrder),
+    thumbnails(false)
+{
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    sizeSortTimer.setSingleShot(true);
+    sizeSortTimer.setInterval(SizeSortDelay);
+
+    connect(IconService::instance(), &IconService::iconsResolved, this, &DirectoryModel::iconsResolved);
+    connect(ThumbnailService::instance(), &ThumbnailService::thumbnailReady, this, &DirectoryModel::thumbnailReady);
+    connect(FolderSizeService::instance(), &FolderSizeService::sizeChanged, this, &DirectoryModel::folderSizeChanged);
+    connect(&sizeSortTimer, &QTimer::timeout, this, [this]() {
+        sort(sortColumn, sortOrder);
+    });
+}
+
+/*!
+ * \brief The destructor
+ * \note This function will call clear() on the listing.
+ * \see QSharedPointer::clear()
+ */
+DirectoryModel::~DirectoryModel()
+{
+    ThumbnailService::instance()->cancelRequests(this);
+    FolderSizeService::instance()->cancelRequests(this);
+    listing.clear();
+}
+
+/*!
+ * \brief Provides the index of the given row and column.
+ * \param row = The row
+ * \param column = The column
+ * \param parent = The parent index, which must be the invalid root index
+ * \return A QModelIndex that is invalid if there is no such item
+ */
+QModelIndex DirectoryModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || row < 0 || row >= visibleRows.count() || column < 0 || column >= ColumnCount) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column);
+}
+
+/*!
+ * \brief Provides the index of the given path.
+ * \param path = The path of the root directory or of an entry in it
+ * \param column = The column
+ * \return A QModelIndex that is invalid for the root path itself and for paths that are not shown
+ */
+QModelIndex DirectoryModel::index(const QString &path, int column) const
+{
+    if (listing.isNull()) {
+        return QModelIndex();
+    }
+
+    const QFileInfo info(QDir::cleanPath(QDir::fromNativeSeparators(path)));
+
+    if (info.path() != listing->path()) {
+        return QModelIndex();
+    }
+
+    return indexForRowId(listing->indexOf(info.fileName().toUtf8()), column);
+}
+
+/*!
+ * \brief Provides the parent of an index.
+ * \param child = The index
+ * \return This always returns an invalid index, since the model is flat.
+ */
+QModelIndex DirectoryModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+/*!
+ * \brief Provides the amount of rows under the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int DirectoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : visibleRows.count();
+}
+
+/*!
+ * \brief Provides the amount of columns under the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int DirectoryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+/*!
+ * \brief Checks if the given parent has any rows.
+ * \param parent = The parent index
+ * \return A Boolean value
+ */
+bool DirectoryModel::hasChildren(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !visibleRows.isEmpty();
+}
+
+/*!
+ * \brief Provides the data of an index.
+ * \param index = The index
+ * \param role = The role of the data
+ * \return A QVariant that is invalid if there is no data for the role
+ */
+QVariant DirectoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= visibleRows.count()) {
+        return QVariant();
+    }
+
+    const int id(visibleRows.at(index.row()));
+    const DirectoryEntries &entries(listing->entries());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        switch (index.column()) {
+        case NameColumn:
+            return entries.name(id);
+
+        case SizeColumn:
+            if (entries.isDir(id)) {
+                if (entries.isDotOrDotDot(id)) {
+                    return QVariant();
+                }
+
+                // Painting only shows the sizes that are known. The folders are only counted while the rows are sorted by size.
+                const FolderSize folderSize(FolderSizeService::instance()->folderSize(entryPath(id)));
+
+                if (folderSize.bytes < 0) {
+                    return QVariant();
+                }
+
+                // A folder that is still being counted shows its partial total.
+                const QString sizeText(QLocale::system().formattedDataSize(folderSize.bytes));
+                return folderSize.complete ? sizeText : sizeText + "...";
+            }
+            if (!entries.hasMetadata(id)) {
+                listing->requestMetadata(id);
+                return QVariant();
+            }
+            return QLocale::system().formattedDataSize(entries.size(id));
+
+        case TypeColumn:
+            return entryType(id);
+
+        case DateColumn:
+            if (!entries.hasMetadata(id)) {
+                listing->requestMetadata(id);
+                return QVariant();
+            }
+            return QLocale::system().toString(QDateTime::fromMSecsSinceEpoch(entries.mtime(id)), QLocale::ShortFormat);
+
+        default:
+            return QVariant();
+        }
+
+    case Qt::DecorationRole:
+        if (index.column() == NameColumn) {
+            return entryIcon(id);
+        }
+        return QVariant();
+
+    case Qt::BackgroundRole:
+        return entryHighlight(id);
+
+    case Qt::TextAlignmentRole:
+        if (index.column() == SizeColumn) {
+            return QVariant(Qt::AlignTrailing | Qt::AlignVCenter);
+        }
+        return QVariant();
+
+    case FilePathRole:
+        return filePath(index);
+
+    case FileNameRole:
+        return entries.name(id);
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Provides the column titles.
+ * \param section = The column
+ * \param orientation = The orientation of the header
+ * \param role = The role of the data
+ * \return A QVariant containing the title of the column
+ */
+QVariant DirectoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractItemModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case NameColumn:
+        return QString("Name");
+
+    case SizeColumn:
+        return QString("Size");
+
+    case TypeColumn:
+        return QString("Type");
+
+    case DateColumn:
+        return QString("Date Modified");
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Provides the item flags of an index.
+ * \param index = The index
+ * \return The Qt::ItemFlags of the index
+ */
+Qt::ItemFlags DirectoryModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemNeverHasChildren;
+}
+
+/*!
+ * \brief Sorts the rows by the given column.
+ * \param column = The column
+ * \param order = The sort order
+ * \note Folders are always listed before files and ".." is always the first row.
+ * \note Sorting by anything other than the name fetches the metadata of every entry and sorts again once it is in.
+ * \note Sorting by size counts every folder, and the counts are canceled once the rows are sorted by something else.
+ */
+void DirectoryModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= ColumnCount) {
+        return;
+    }
+
+    if (sortColumn == SizeColumn && column != SizeColumn) {
+        FolderSizeService::instance()->cancelRequests(this);
+    }
+
+    sortColumn = column;
+    sortOrder = order;
+
+    if (sortColumn != NameColumn && !listing.isNull()) {
+        listing->requestAllMetadata();
+    }
+
+    if (visibleRows.isEmpty() && unfilteredRows.isEmpty()) {
+        return;
+    }
+
+    emit layoutAboutToBeChanged();
+
+    const QModelIndexList oldIndexes(persistentIndexList());
+    QVector<int> oldIds;
+    oldIds.reserve(oldIndexes.count());
+
+    for (const QModelIndex &oldIndex : oldIndexes) {
+        oldIds.append(visibleRows.at(oldIndex.row()));
+    }
+
+    if (sortColumn == TypeColumn) {
+        rankTypes();
+    }
+
+    if (sortColumn == SizeColumn) {
+        collectFolderSizes();
+    }
+
+    // While the name filter is set, the matching rows are taken from the sorted unfiltered rows.
+    if (nameMatcher.isEmpty()) {
+        sortRows(visibleRows);
+    } else {
+        sortRows(unfilteredRows);
+        visibleRows = matchingRows(unfilteredRows);
+    }
+
+    for (int row(0); row < visibleRows.count(); ++row) {
+        rowOfId[visibleRows.at(row)] = row;
+    }
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.count());
+
+    for (int i(0); i < oldIndexes.count(); ++i) {
+        newIndexes.append(index(rowOfId.at(oldIds.at(i)), oldIndexes.at(i).column()));
+    }
+
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged();
+}
+
+/*!
+ * \brief Sets a new root path and starts loading its entries.
+ * \param newPath = The path of the directory
+ * \return The index of the root path, which is always the invalid index
+ * \note The listing is shared through the DirectoryCache. Rows are added as the entries are streamed in, unless
+ * another view already holds the listing, in which case they are shown right away. The name filter is cleared.
+ */
+QModelIndex DirectoryModel::setRootPath(const QString &newPath)
+{
+    const QString cleanPath(QDir::cleanPath(QDir::fromNativeSeparators(newPath)));
+
+    if (!listing.isNull() && listing->path() == cleanPath) {
+        return QModelIndex();
+    }
+
+    if (!listing.isNull()) {
+        disconnect(listing.data(), nullptr, this, nullptr);
+    }
+
+    // A directory that is already shown elsewhere is taken from the cache as is, without reading it again.
+    FolderSizeService::instance()->cancelRequests(this);
+    sizeSortTimer.stop();
+
+    beginResetModel();
+    nameMatcher = NameMatcher();
+    listing = DirectoryCache::instance()->acquire(cleanPath);
+    rebuildRows();
+    endResetModel();
+
+    connect(listing.data(), &DirectoryListing::loadStarted, this, &DirectoryModel::listingLoadStarted);
+    connect(listing.data(), &DirectoryListing::entriesAppended, this, &DirectoryModel::listingEntriesAppended);
+    connect(listing.data(), &DirectoryListing::entriesRemoved, this, &DirectoryModel::listingEntriesRemoved);
+    connect(listing.data(), &DirectoryListing::entriesReset, this, &DirectoryModel::listingEntriesReset);
+    connect(listing.data(), &DirectoryListing::loadFinished, this, &DirectoryModel::listingLoadFinished);
+    connect(listing.data(), &DirectoryListing::metadataChanged, this, &DirectoryModel::listingMetadataChanged);
+    connect(listing.data(), &DirectoryListing::allMetadataFetched, this, &DirectoryModel::listingAllMetadataFetched);
+
+    emit rootPathChanged(cleanPath);
+
+    if (listing->isLoaded() && !listing->isLoading()) {
+        emit directoryLoaded(cleanPath);
+    } else {
+        emit loadProgress(visibleRows.count());
+    }
+    return QModelIndex();
+}
+
+/*!
+ * \brief Provides the root path of the model.
+ * \return A QString value of the root path
+ */
+QString DirectoryModel::rootPath() const
+{
+    return listing.isNull() ? QString() : listing->path();
+}
+
+/*!
+ * \brief Checks if the entries of the root path are still being read.
+ * \return A Boolean value
+ */
+bool DirectoryModel::isLoading() const
+{
+    return !listing.isNull() && listing->isLoading();
+}
+
+/*!
+ * \brief Sets the filters applied to the entries.
+ * \param newFilters = The QDir::Filters
+ * \note Only the Dirs, AllDirs, Files, System, Hidden, NoDot and NoDotDot flags are taken into account.
+ */
+void DirectoryModel::setFilter(QDir::Filters newFilters)
+{
+    if (filters == newFilters) {
+        return;
+    }
+
+    filters = newFilters;
+
+    beginResetModel();
+    rebuildRows();
+    endResetModel();
+}
+
+/*!
+ * \brief Provides the filters applied to the entries.
+ * \return The QDir::Filters
+ */
+QDir::Filters DirectoryModel::filter() const
+{
+    return filters;
+}
+
+/*!
+ * \brief Only shows the entries whose name matches a query.
+ * \param query = The query, which is empty to show all the entries
+ * \note The rows are neither read nor sorted again. When the query is extended, only the rows that matched the previous
+ * query are matched again.
+ * \see NameMatcher
+ */
+void DirectoryModel::setNameFilter(const QString &query)
+{
+    const NameMatcher matcher(query);
+
+    if (matcher.query() == nameMatcher.query()) {
+        return;
+    }
+
+    if (listing.isNull()) {
+        nameMatcher = matcher;
+        return;
+    }
+
+    const DirectoryEntries &entries(listing->entries());
+
+    beginResetModel();
+
+    if (matcher.isEmpty()) {
+        if (!nameMatcher.isEmpty()) {
+            visibleRows = unfilteredRows;
+        }
+
+        unfilteredRows.clear();
+        nameMatches.clear();
+    } else {
+        if (nameMatcher.isEmpty()) {
+            unfilteredRows = visibleRows;
+        }
+
+        if (matcher.refines(nameMatcher)) {
+            nameMatches.fill(false, entries.count());
+            matcher.matchEntries(entries, visibleRows, nameMatches);
+            visibleRows = matchingRows(visibleRows);
+        } else {
+            matcher.matchAll(entries, nameMatches);
+            visibleRows = matchingRows(unfilteredRows);
+        }
+    }
+
+    nameMatcher = matcher;
+    rowOfId.fill(-1, entries.count());
+
+    for (int row(0); row < visibleRows.count(); ++row) {
+        rowOfId[visibleRows.at(row)] = row;
+    }
+
+    endResetModel();
+}
+
+/*!
+ * \brief Provides the query of the name filter.
+ * \return A QString that is empty if all the entries are shown
+ */
+QString DirectoryModel::nameFilter() const
+{
+    return nameMatcher.query();
+}
+
+/*!
+ * \brief Provides the name of the entry at the given index.
+ * \param index = The index
+ * \return A QString with the name
+ */
+QString DirectoryModel::fileName(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return QString();
+    }
+
+    return listing->entries().name(visibleRows.at(index.row()));
+}
+
+/*!
+ * \brief Provides the full path of the entry at the given index.
+ * \param index = The index
+ * \return A QString with the path, which is the root path for the invalid index
+ */
+QString DirectoryModel::filePath(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return rootPath();
+    }
+
+    return entryPath(visibleRows.at(index.row()));
+}
+
+/*!
+ * \brief Provides a QFileInfo of the entry at the given index.
+ * \param index = The index
+ * \return A QFileInfo
+ */
+QFileInfo DirectoryModel::fileInfo(const QModelIndex &index) const
+{
+    return QFileInfo(filePath(index));
+}
+
+/*!
+ * \brief Checks if the entry at the given index is a directory.
+ * \param index = The index
+ * \return A Boolean value that is true for the root path
+ */
+bool DirectoryModel::isDir(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return true;
+    }
+
+    return listing->entries().isDir(visibleRows.at(index.row()));
+}
+
+/*!
+ * \brief Provides the stable row ID of the entry at the given index.
+ * \param index = The index
+ * \return An integer that is -1 for the invalid index
+ * \note The row ID of an entry does not change when the rows are sorted or filtered.
+ */
+int DirectoryModel::rowId(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return -1;
+    }
+
+    return visibleRows.at(index.row());
+}
+
+/*!
+ * \brief Provides the index of the entry with the given row ID.
+ * \param id = The row ID
+ * \param column = The column
+ * \return A QModelIndex that is invalid if the entry is not shown
+ */
+QModelIndex DirectoryModel::indexForRowId(int id, int column) const
+{
+    if (id < 0 || id >= rowOfId.count()) {
+        return QModelIndex();
+    }
+
+    return index(rowOfId.at(id), column);
+}
+
+/*!
+ * \brief Fetches the metadata of a range of rows ahead of time.
+ * \param firstRow = The first row
+ * \param lastRow = The last row
+ * \note This is meant for the rows around the viewport, which are likely to be shown next.
+ */
+void DirectoryModel::prefetchMetadata(int firstRow, int lastRow)
+{
+    if (listing.isNull()) {
+        return;
+    }
+
+    firstRow = qMax(firstRow, 0);
+    lastRow = qMin(lastRow, visibleRows.count() - 1);
+
+    if (firstRow > lastRow) {
+        return;
+    }
+
+    listing->requestMetadata(visibleRows.mid(firstRow, lastRow - firstRow + 1), false);
+}
+
+/*!
+ * \brief Shows image files with a thumbnail instead of their icon.
+ * \param enabled = Whether thumbnails are shown
+ */
+void DirectoryModel::setThumbnailsEnabled(bool enabled)
+{
+    if (thumbnails == enabled) {
+        return;
+    }
+
+    thumbnails = enabled;
+
+    if (!thumbnails) {
+        ThumbnailService::instance()->cancelRequests(this);
+    }
+
+    iconsResolved();
+}
+
+/*!
+ * \brief Highlights the entries that differ in a comparison of two directory trees.
+ * \param compare = The comparison, or null to stop highlighting
+ * \note The entries are highlighted whenever the root path lies in one of the compared trees.
+ */
+void DirectoryModel::setComparison(DirectoryCompare *compare)
+{
+    if (comparison) {
+        disconnect(comparison, nullptr, this, nullptr);
+    }
+
+    comparison = compare;
+
+    if (comparison) {
+        connect(comparison, &DirectoryCompare::finished, this, &DirectoryModel::comparisonChanged);
+    }
+
+    comparisonChanged();
+}
+
+/*!
+ * \brief Checks if image files are shown with a thumbnail.
+ * \return A Boolean value
+ */
+bool DirectoryModel::thumbnailsEnabled() const
+{
+    return thumbnails;
+}
+
+/*!
+ * \brief Cancels the thumbnail requests of all the rows outside a range.
+ * \param firstRow = The first row of the range
+ * \param lastRow = The last row of the range
+ * \note This is meant to be called with the rows on screen whenever the view is scrolled.
+ */
+void DirectoryModel::retainThumbnails(int firstRow, int lastRow)
+{
+    if (!thumbnails || listing.isNull()) {
+        return;
+    }
+
+    QSet<QString> keptPaths;
+
+    for (int row(qMax(firstRow, 0)); row <= qMin(lastRow, visibleRows.count() - 1); ++row) {
+        keptPaths.insert(entryPath(visibleRows.at(row)));
+    }
+
+    ThumbnailService::instance()->cancelRequests(this, keptPaths);
+}
+
+/*!
+ * \brief Rebuilds the visible rows from the listing.
+ * \note This must be called between beginResetModel() and endResetModel().
+ */
+void DirectoryModel::rebuildRows()
+{
+    visibleRows.clear();
+    rowOfId.clear();
+    typeRanks.clear();
+    nameMatches.clear();
+    unfilteredRows.clear();
+    folderSizes.clear();
+
+    if (listing.isNull()) {
+        return;
+    }
+
+    const int entryCount(listing->entries().count());
+    visibleRows.reserve(entryCount);
+    rowOfId.fill(-1, entryCount);
+
+    const DirectoryEntries &entries(listing->entries());
+
+    for (int id(0); id < entryCount; ++id) {
+        if (entries.passesFilter(id, filters)) {
+            visibleRows.append(id);
+        }
+    }
+
+    if (sortColumn == TypeColumn) {
+        rankTypes();
+    }
+
+    if (sortColumn == SizeColumn) {
+        collectFolderSizes();
+    }
+
+    sortRows(visibleRows);
+
+    if (!nameMatcher.isEmpty()) {
+        nameMatcher.matchAll(entries, nameMatches);
+        unfilteredRows = visibleRows;
+        visibleRows = matchingRows(unfilteredRows);
+    }
+
+    for (int row(0); row < visibleRows.count(); ++row) {
+        rowOfId[visibleRows.at(row)] = row;
+    }
+}
+
+/*!
+ * \brief Sorts a list of row IDs by the current sort column and order.
+ * \param rows = The row IDs
+ *
+ * Names are compared through the sort keys the reader has computed, so no name is decoded while sorting. Large lists
+ * are split into one chunk per core, the chunks are sorted in parallel and then merged pairwise in parallel rounds.
+ */
+void DirectoryModel::sortRows(QVector<int> &rows)
+{
+    const auto lessThan([this](int left, int right) {
+        return rowLessThan(left, right);
+    });
+    const int threadCount(QThread::idealThreadCount());
+
+    // Unranked types are compared through the collator, which may only be used by one thread.
+    const bool ranked(sortColumn != TypeColumn || typeRanks.count() >= listing->entries().count());
+
+    if (rows.count() < ParallelSortThreshold || threadCount < 2 || !ranked) {
+        std::stable_sort(rows.begin(), rows.end(), lessThan);
+        return;
+    }
+
+    int *data(rows.data());
+    const int rowCount(rows.count());
+    const int chunkSize((rowCount + threadCount - 1) / threadCount);
+    QVector<int> chunkStarts;
+
+    for (int start(0); start < rowCount; start += chunkSize) {
+        chunkStarts.append(start);
+    }
+
+    QtConcurrent::blockingMap(chunkStarts, [data, rowCount, chunkSize, &lessThan](int start) {
+        std::stable_sort(data + start, data + qMin(start + chunkSize, rowCount), lessThan);
+    });
+
+    for (int width(chunkSize); width < rowCount; width *= 2) {
+        QVector<int> mergeStarts;
+
+        for (int start(0); start + width < rowCount; start += 2 * width) {
+            mergeStarts.append(start);
+        }
+
+        QtConcurrent::blockingMap(mergeStarts, [data, rowCount, width, &lessThan](int start) {
+            std::inplace_merge(data + start, data + start + width, data + qMin(start + 2 * width, rowCount), lessThan);
+        });
+    }
+}
+
+/*!
+ * \brief Ranks the types of all the entries, so they can be sorted by type without comparing strings.
+ * \note This is done before all the rows are sorted by type. Entries that are added later on have no rank and are
+ * compared by their type name instead.
+ */
+void DirectoryModel::rankTypes()
+{
+    const DirectoryEntries &entries(listing->entries());
+    QHash<QString, int> typeIds;
+    QStringList typeNames;
+    QVector<int> entryTypeIds(entries.count());
+
+    for (int id(0); id < entries.count(); ++id) {
+        const QString type(entryType(id));
+        auto typeId(typeIds.constFind(type));
+
+        if (typeId == typeIds.constEnd()) {
+            typeId = typeIds.insert(type, typeNames.count());
+            typeNames.append(type);
+        }
+
+        entryTypeIds[id] = typeId.value();
+    }
+
+    QVector<int> order(typeNames.count());
+    QVector<int> rankOfType(typeNames.count());
+
+    for (int i(0); i < order.count(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [this, &typeNames](int left, int right) {
+        return collator.compare(typeNames.at(left), typeNames.at(right)) < 0;
+    });
+
+    // Types that the collator considers equal share their rank.
+    for (int i(0); i < order.count(); ++i) {
+        const bool sameType(i > 0 && collator.compare(typeNames.at(order.at(i - 1)), typeNames.at(order.at(i))) == 0);
+        rankOfType[order.at(i)] = sameType ? rankOfType.at(order.at(i - 1)) : i;
+    }
+
+    typeRanks.resize(entries.count());
+
+    for (int id(0); id < entries.count(); ++id) {
+        typeRanks[id] = rankOfType.at(entryTypeIds.at(id));
+    }
+}
+
+/*!
+ * \brief Takes the known sizes of all the folders, so the rows can be sorted by them without asking the service.
+ * \note The folders whose size is not known or is outdated are requested, and the rows are sorted again as their
+ * sizes come in.
+ */
+void DirectoryModel::collectFolderSizes()
+{
+    const DirectoryEntries &entries(listing->entries());
+    folderSizes.fill(-1, entries.count());
+
+    for (int id(0); id < entries.count(); ++id) {
+        if (entries.isDir(id) && !entries.isRemoved(id) && !entries.isDotOrDotDot(id)) {
+            const QString dirPath(entryPath(id));
+
+            folderSizes[id] = FolderSizeService::instance()->folderSize(dirPath).bytes;
+            FolderSizeService::instance()->requestSize(dirPath, this);
+        }
+    }
+}
+
+/*!
+ * \brief Compares two rows by the current sort column and order.
+ * \param left = The row ID of the first entry
+ * \param right = The row ID of the second entry
+ * \return A Boolean value that is true if the first entry is shown before the second one
+ * \note Folders are always listed before files and "." and ".." always come first.
+ * \note This is called from several threads at once by sortRows(), so it must not modify the model.
+ */
+bool DirectoryModel::rowLessThan(int left, int right) const
+{
+    const DirectoryEntries &entries(listing->entries());
+    const bool leftDotDot(entries.isDotOrDotDot(left)), rightDotDot(entries.isDotOrDotDot(right));
+
+    if (leftDotDot != rightDotDot) {
+        return leftDotDot;
+    }
+
+    const bool leftDir(entries.isDir(left)), rightDir(entries.isDir(right));
+
+    if (leftDir != rightDir) {
+        return leftDir;
+    }
+
+    int result(0);
+
+    switch (sortColumn) {
+    case SizeColumn:
+        if (leftDir && left < folderSizes.count() && right < folderSizes.count()) {
+            result = (folderSizes.at(left) < folderSizes.at(right)) ? -1 : (folderSizes.at(left) > folderSizes.at(right)) ? 1 : 0;
+        } else {
+            result = (entries.size(left) < entries.size(right)) ? -1 : (entries.size(left) > entries.size(right)) ? 1 : 0;
+        }
+        break;
+
+    case TypeColumn:
+        if (left < typeRanks.count() && right < typeRanks.count()) {
+            result = typeRanks.at(left) - typeRanks.at(right);
+        } else {
+            result = collator.compare(entryType(left), entryType(right));
+        }
+        break;
+
+    case DateColumn:
+        result = (entries.mtime(left) < entries.mtime(right)) ? -1 : (entries.mtime(left) > entries.mtime(right)) ? 1 : 0;
+        break;
+
+    default:
+        break;
+    }
+
+    if (result == 0) {
+        result = entries.compareNames(left, right);
+    }
+
+    return (sortOrder == Qt::AscendingOrder) ? result < 0 : result > 0;
+}
+
+/*!
+ * \brief Inserts new rows at their sorted positions.
+ * \param newRows = The row IDs of the new entries, sorted like the rows
+ * \note This is used for the entries that are added to a directory after it has been loaded. New rows that end up next
+ * to each other are inserted together, and every search starts after the rows inserted before.
+ */
+void DirectoryModel::insertSortedRows(const QVector<int> &newRows)
+{
+    int firstChangedRow(visibleRows.count()), searchStart(0);
+
+    for (int first(0); first < newRows.count();) {
+        const auto position(std::upper_bound(visibleRows.constBegin() + searchStart, visibleRows.constEnd(), newRows.at(first), [this](int newId, int rowId) {
+            return rowLessThan(newId, rowId);
+        }));
+        const int row(static_cast<int>(position - visibleRows.constBegin()));
+        int last(first);
+
+        // The following new rows belong to the same place as long as they still come before the row found.
+        while (last + 1 < newRows.count() && (row == visibleRows.count() || rowLessThan(newRows.at(last + 1), visibleRows.at(row)))) {
+            ++last;
+        }
+
+        beginInsertRows(QModelIndex(), row, row + last - first);
+        visibleRows.insert(row, last - first + 1, 0);
+        std::copy(newRows.constBegin() + first, newRows.constBegin() + last + 1, visibleRows.begin() + row);
+        endInsertRows();
+
+        firstChangedRow = qMin(firstChangedRow, row);
+        searchStart = row + last - first + 1;
+        first = last + 1;
+    }
+
+    for (int row(firstChangedRow); row < visibleRows.count(); ++row) {
+        rowOfId[visibleRows.at(row)] = row;
+    }
+}
+
+/*!
+ * \brief Provides the rows that match the name filter.
+ * \param rows = The row IDs
+ * \return A QVector with the matching row IDs, in the same order
+ */
+QVector<int> DirectoryModel::matchingRows(const QVector<int> &rows) const
+{
+    QVector<int> matching;
+    matching.reserve(rows.count());
+
+    for (int id : rows) {
+        if (nameMatches.at(id)) {
+            matching.append(id);
+        }
+    }
+
+    return matching;
+}
+
+/*!
+ * \brief Reports that the listing has started reading the directory.
+ */
+void DirectoryModel::listingLoadStarted()
+{
+    emit loadProgress(visibleRows.count());
+}
+
+/*!
+ * \brief Adds the rows of the entries that have been appended to the listing.
+ * \param first = The row ID of the first new entry
+ * \param last = The row ID of the last new entry
+ * \note While the directory is streamed in, the new rows are only sorted among themselves and all the rows are sorted
+ * once the listing is done. Entries added later on are inserted at their sorted positions right away.
+ */
+void DirectoryModel::listingEntriesAppended(int first, int last)
+{
+    const DirectoryEntries &entries(listing->entries());
+    QVector<int> newRows;
+    newRows.reserve(last - first + 1);
+
+    for (int id(first); id <= last; ++id) {
+        rowOfId.append(-1);
+
+        if (entries.passesFilter(id, filters)) {
+            newRows.append(id);
+        }
+    }
+
+    sortRows(newRows);
+
+    // The rows that do not match the name filter are kept in order for when the filter is changed.
+    if (!nameMatcher.isEmpty()) {
+        nameMatches.resize(entries.count());
+        nameMatcher.matchEntries(entries, newRows, nameMatches);
+
+        for (int id : qAsConst(newRows)) {
+            const auto position(listing->isLoaded() ? std::upper_bound(unfilteredRows.begin(), unfilteredRows.end(), id, [this](int newId, int rowId) {
+                return rowLessThan(newId, rowId);
+            }) : unfilteredRows.end());
+            unfilteredRows.insert(position, id);
+        }
+
+        newRows = matchingRows(newRows);
+    }
+
+    if (newRows.isEmpty()) {
+        if (!listing->isLoaded()) {
+            emit loadProgress(visibleRows.count());
+        }
+        return;
+    }
+
+    if (listing->isLoaded()) {
+        insertSortedRows(newRows);
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), visibleRows.count(), visibleRows.count() + newRows.count() - 1);
+    for (int id : qAsConst(newRows)) {
+        rowOfId[id] = visibleRows.count();
+        visibleRows.append(id);
+    }
+    endInsertRows();
+
+    emit loadProgress(visibleRows.count());
+}
+
+/*!
+ * \brief Removes the rows of the entries that have been removed from the listing.
+ * \param ids = The row IDs of the removed entries
+ */
+void DirectoryModel::listingEntriesRemoved(const QVector<int> &ids)
+{
+    if (!nameMatcher.isEmpty()) {
+        const DirectoryEntries &entries(listing->entries());
+        unfilteredRows.removeIf([&entries](int id) {
+            return entries.isRemoved(id);
+        });
+    }
+
+    QVector<int> rows;
+    rows.reserve(ids.count());
+
+    for (int id : ids) {
+        if (id < rowOfId.count() && rowOfId.at(id) >= 0) {
+            rows.append(rowOfId.at(id));
+            rowOfId[id] = -1;
+        }
+    }
+
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    // Remove contiguous ranges from the bottom up, so the rows above them keep their positions.
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+
+    for (int i(0); i < rows.count();) {
+        const int lastRow(rows.at(i));
+        int firstRow(lastRow);
+
+        while (++i < rows.count() && rows.at(i) == firstRow - 1) {
+            firstRow = rows.at(i);
+        }
+
+        beginRemoveRows(QModelIndex(), firstRow, lastRow);
+        visibleRows.remove(firstRow, lastRow - firstRow + 1);
+        endRemoveRows();
+    }
+
+    for (int row(rows.last()); row < visibleRows.count(); ++row) {
+        rowOfId[visibleRows.at(row)] = row;
+    }
+}
+
+/*!
+ * \brief Replaces all the rows once the listing has dropped its entries.
+ */
+void DirectoryModel::listingEntriesReset()
+{
+    beginResetModel();
+    rebuildRows();
+    endResetModel();
+}
+
+/*!
+ * \brief Sorts the streamed rows once the listing has read the whole directory.
+ */
+void DirectoryModel::listingLoadFinished()
+{
+    sort(sortColumn, sortOrder);
+    emit directoryLoaded(listing->path());
+}
+
+/*!
+ * \brief Refreshes the rows whose metadata has been fetched.
+ * \param ids = The row IDs of the entries
+ */
+void DirectoryModel::listingMetadataChanged(const QVector<int> &ids)
+{
+    int firstRow(visibleRows.count()), lastRow(-1);
+
+    for (int id : ids) {
+        const int row((id < rowOfId.count()) ? rowOfId.at(id) : -1);
+
+        if (row >= 0) {
+            firstRow = qMin(firstRow, row);
+            lastRow = qMax(lastRow, row);
+        }
+    }
+
+    if (firstRow <= lastRow) {
+        emit dataChanged(index(firstRow, NameColumn), index(lastRow, ColumnCount - 1));
+    }
+}
+
+/*!
+ * \brief Refreshes the icons of all the rows once the IconService has resolved new icons.
+ * \note Only the rows that are painted actually ask for their icon again.
+ */
+void DirectoryModel::iconsResolved()
+{
+    if (!visibleRows.isEmpty()) {
+        emit dataChanged(index(0, NameColumn), index(visibleRows.count() - 1, NameColumn), {Qt::DecorationRole});
+    }
+}
+
+/*!
+ * \brief Refreshes the highlights of all rows once a comparison has finished or has been replaced.
+ */
+void DirectoryModel::comparisonChanged()
+{
+    if (!visibleRows.isEmpty()) {
+        emit dataChanged(index(0, 0), index(visibleRows.count() - 1, ColumnCount - 1), {Qt::BackgroundRole});
+    }
+}
+
+/*!
+ * \brief Refreshes the icon of a row once its thumbnail has been created.
+ * \param filePath = The path of the image file
+ */
+void DirectoryModel::thumbnailReady(const QString &filePath)
+{
+    if (!thumbnails) {
+        return;
+    }
+
+    const QModelIndex thumbnailIndex(index(filePath));
+
+    if (thumbnailIndex.isValid()) {
+        emit dataChanged(thumbnailIndex, thumbnailIndex, {Qt::DecorationRole});
+    }
+}
+
+/*!
+ * \brief Refreshes the size of a folder once a partial or final total is known.
+ * \param dirPath = The path of the folder
+ * \note While the rows are sorted by size, they are sorted again at most every SizeSortDelay milliseconds, so the
+ * partial totals streaming in do not sort the rows on every report.
+ */
+void DirectoryModel::folderSizeChanged(const QString &dirPath)
+{
+    const QModelIndex sizeIndex(index(dirPath, SizeColumn));
+
+    if (!sizeIndex.isValid()) {
+        return;
+    }
+
+    emit dataChanged(sizeIndex, sizeIndex, {Qt::DisplayRole});
+
+    if (sortColumn == SizeColumn && !sizeSortTimer.isActive()) {
+        sizeSortTimer.start();
+    }
+}
+
+/*!
+ * \brief Sorts the rows again once the metadata needed by the sort column has been fetched.
+ */
+void DirectoryModel::listingAllMetadataFetched()
+{
+    if (sortColumn != NameColumn) {
+        sort(sortColumn, sortOrder);
+    }
+}
+
+/*!
+ * \brief Provides the full path of an entry.
+ * \param id = The row ID of the entry
+ * \return A QString with the path
+ */
+QString DirectoryModel::entryPath(int id) const
+{
+    const QString root(rootPath());
+    return (root.endsWith('/') ? root : root + "/") + listing->entries().name(id);
+}
+
+/*!
+ * \brief Provides the icon of an entry.
+ * \param id = The row ID of the entry
+ * \return A QIcon that is empty if there is no icon provider
+ * \note The icons are shared through the IconService. A placeholder is shown until the icon of a file is resolved.
+ * Image files show their icon until their thumbnail is available, if thumbnails are enabled.
+ */
+QIcon DirectoryModel::entryIcon(int id) const
+{
+    const DirectoryEntries &entries(listing->entries());
+
+    if (entries.isDir(id)) {
+        return IconService::instance()->folderIcon();
+    }
+
+    if (thumbnails && ThumbnailService::instance()->canThumbnail(entries.name(id))) {
+        if (!entries.hasMetadata(id)) {
+            listing->requestMetadata(id);
+        } else {
+            const QIcon thumbnail(ThumbnailService::instance()->thumbnail(entryPath(id), entries.mtime(id), this));
+
+            if (!thumbnail.isNull()) {
+                return thumbnail;
+            }
+        }
+    }
+
+    // Without a suffix, the icon can only be found through the MIME type of the file.
+    if (!entries.hasMimeType(id) && QFileInfo(entries.name(id)).suffix().isEmpty()) {
+        listing->requestMetadata(id);
+    }
+
+    return IconService::instance()->fileIcon(entryPath(id), entries.hasMimeType(id) ? entries.mimeType(id) : 0);
+}
+
+/*!
+ * \brief Provides the type description of an entry.
+ * \param id = The row ID of the entry
+ * \return A QString like "Folder" or "Plain text document"
+ * \note The suffix of the file is used until its MIME type is known.
+ */
+QString DirectoryModel::entryType(int id) const
+{
+    const DirectoryEntries &entries(listing->entries());
+
+    if (entries.isDir(id)) {
+        return QString("Folder");
+    }
+
+    if (entries.hasMimeType(id) && entries.mimeType(id) != 0) {
+        return MimeTypeTable::instance()->comment(entries.mimeType(id));
+    }
+
+    const QString suffix(QFileInfo(entries.name(id)).suffix());
+    return suffix.isEmpty() ? QString("File") : suffix + " File";
+}
+
+/*!
+ * \brief Provides the background of an entry that differs in the comparison.
+ * \param id = The row ID of the entry
+ * \return A QVariant containing a QColor, or an invalid QVariant if the entry is not highlighted
+ *
+ * Entries only on this side are green, entries that are newer on this side blue and older on this side red, and
+ * directories containing differences are yellow.
+ */
+QVariant DirectoryModel::entryHighlight(int id) const
+{
+    if (!comparison || !comparison->hasResults() || listing->entries().isDotOrDotDot(id)) {
+        return QVariant();
+    }
+
+    const QString path(entryPath(id));
+    const bool leftSide(comparison->isLeftPath(path));
+
+    switch (comparison->status(path)) {
+    case DirectoryCompare::OnlyLeft:
+    case DirectoryCompare::OnlyRight:
+        return QColor(200, 240, 200);
+
+    case DirectoryCompare::NewerLeft:
+        return leftSide ? QColor(200, 220, 250) : QColor(250, 210, 210);
+
+    case DirectoryCompare::NewerRight:
+        return leftSide ? QColor(250, 210, 210) : QColor(200, 220, 250);
+
+    case DirectoryCompare::ContainsDifferences:
+        return QColor(250, 240, 190);
+
+    default:
+        return QVariant();
+    }
+}
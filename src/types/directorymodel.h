@@ -0,0 +1,123 @@
+#ifndef DIRECTORYMODEL_H
+#define DIRECTORYMODEL_H
+
+#include "directorycompare.h"
+#include "directorylisting.h"
+#include "namematcher.h"
+
+#include <QAbstractItemModel>
+#include <QCollator>
+#include <QDir>
+#include <QFileInfo>
+#include <QIcon>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTimer>
+
+/*!
+ * \brief The item model of a single directory shown in an explorer.
+ *
+ * The model is flat: its rows are the entries of the root path and the root path itself is the invalid index.
+ * Every row maps to a stable row ID, which is the position of the entry in the underlying DirectoryEntries.
+ */
+class DirectoryModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1,    ///< The full path of the entry.
+        FileNameRole                        ///< The name of the entry.
+    };
+
+    enum Columns {
+        NameColumn,     ///< 0
+        SizeColumn,     ///< 1
+        TypeColumn,     ///< 2
+        DateColumn,     ///< 3
+        ColumnCount     ///< 4
+    };
+
+    explicit DirectoryModel(QObject *parent = nullptr);
+    ~DirectoryModel();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex index(const QString &path, int column = 0) const;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    QModelIndex setRootPath(const QString &newPath);
+    QString rootPath() const;
+    bool isLoading() const;
+    void setFilter(QDir::Filters newFilters);
+    QDir::Filters filter() const;
+    void setNameFilter(const QString &query);
+    QString nameFilter() const;
+    QString fileName(const QModelIndex &index) const;
+    QString filePath(const QModelIndex &index) const;
+    QFileInfo fileInfo(const QModelIndex &index) const;
+    bool isDir(const QModelIndex &index) const;
+    int rowId(const QModelIndex &index) const;
+    QModelIndex indexForRowId(int id, int column = 0) const;
+    void prefetchMetadata(int firstRow, int lastRow);
+    void setThumbnailsEnabled(bool enabled);
+    bool thumbnailsEnabled() const;
+    void retainThumbnails(int firstRow, int lastRow);
+    void setComparison(DirectoryCompare *compare);
+
+signals:
+    void rootPathChanged(const QString &newPath);   ///< Emitted when the root path is changed.
+    void loadProgress(int rowCount);                ///< Emitted while the entries of the root path are streamed in.
+    void directoryLoaded(const QString &path);      ///< Emitted when the entries of the root path have been loaded.
+
+private:
+    static const int ParallelSortThreshold = 50000; ///< The minimum amount of rows that are sorted on several threads.
+    static const int SizeSortDelay = 500;           ///< The minimum time in milliseconds between two sorts caused by new folder sizes.
+
+    QSharedPointer<DirectoryListing> listing;   ///< The listing of the root path, shared through the DirectoryCache.
+    QVector<int> visibleRows;       ///< The row IDs of the entries that pass the filter, in display order.
+    QVector<int> rowOfId;           ///< The display row of each row ID, or -1 if it is filtered out.
+    QDir::Filters filters;          ///< The filters applied to the entries.
+    int sortColumn;                 ///< The column by which the rows are sorted.
+    Qt::SortOrder sortOrder;        ///< The order in which the rows are sorted.
+    bool thumbnails;                ///< Whether image files are shown with a thumbnail instead of their icon.
+    QCollator collator;             ///< Used to rank the types of the entries.
+    QVector<int> typeRanks;         ///< The position of each entry's type in the sorted list of types, by row ID.
+    NameMatcher nameMatcher;        ///< Matches the names against the query of the filter box.
+    QVector<bool> nameMatches;      ///< Whether each row ID matches the name filter, only while the name filter is set.
+    QVector<int> unfilteredRows;    ///< The row IDs that pass the filters but not necessarily the name filter, in display order, only while the name filter is set.
+    QVector<qint64> folderSizes;    ///< The size of the tree below each folder by row ID, or -1 if it is not known, only while sorting by size.
+    QTimer sizeSortTimer;           ///< Sorts the rows by size again once new folder sizes are known.
+    QPointer<DirectoryCompare> comparison;  ///< The comparison whose differences are highlighted, or null.
+
+    void rebuildRows();
+    void sortRows(QVector<int> &rows);
+    void rankTypes();
+    void collectFolderSizes();
+    bool rowLessThan(int left, int right) const;
+    void insertSortedRows(const QVector<int> &newRows);
+    QVector<int> matchingRows(const QVector<int> &rows) const;
+    void listingLoadStarted();
+    void listingEntriesAppended(int first, int last);
+    void listingEntriesRemoved(const QVector<int> &ids);
+    void listingEntriesReset();
+    void listingLoadFinished();
+    void listingMetadataChanged(const QVector<int> &ids);
+    void listingAllMetadataFetched();
+    void iconsResolved();
+    void thumbnailReady(const QString &filePath);
+    void folderSizeChanged(const QString &dirPath);
+    void comparisonChanged();
+    QString entryPath(int id) const;
+    QIcon entryIcon(int id) const;
+    QString entryType(int id) const;
+    QVariant entryHighlight(int id) const;
+};
+
+#endif // DIRECTORYMODEL_H
@@ -0,0 +1,167 @@
+#include "directoryprefetcher.h"
+#include "directorycache.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#include <algorithm>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+DirectoryPrefetcher::DirectoryPrefetcher(QObject *parent) :
+    QObject(parent),
+    retainedListings(MaxRetainedKiB)
+{
+    startTimer.setSingleShot(true);
+    startTimer.setInterval(SettleDelay);
+
+    connect(&startTimer, &QTimer::timeout, this, &DirectoryPrefetcher::startReads);
+}
+
+/*!
+ * \brief Provides the prefetcher shared by the whole application.
+ * \return A pointer to the DirectoryPrefetcher
+ * \note The prefetcher is bound to the application object and deleted with it.
+ */
+DirectoryPrefetcher *DirectoryPrefetcher::instance()
+{
+    static DirectoryPrefetcher *prefetcher(new DirectoryPrefetcher(QCoreApplication::instance()));
+    return prefetcher;
+}
+
+/*!
+ * \brief Suggests a directory that may be opened soon.
+ * \param dirPath = The clean path of the directory
+ * \note The newest suggestion is read first, and the oldest ones are dropped once there are more than MaxCandidates.
+ */
+void DirectoryPrefetcher::suggest(const QString &dirPath)
+{
+    if (dirPath.isEmpty() || runningReads.contains(dirPath)) {
+        return;
+    }
+
+    candidates.removeOne(dirPath);
+    candidates.prepend(dirPath);
+
+    while (candidates.count() > MaxCandidates) {
+        candidates.removeLast();
+    }
+
+    // Hovering or scrolling through folders produces a burst of suggestions, of which only the last ones matter.
+    startTimer.start();
+}
+
+/*!
+ * \brief Counts a visit to a directory and suggests the directories that are likely to be visited from there.
+ * \param dirPath = The clean path of the directory that was opened
+ * \note The parent of the directory and the most visited directories are suggested, the parent being read first.
+ */
+void DirectoryPrefetcher::recordVisit(const QString &dirPath)
+{
+    ++visitCounts[dirPath];
+
+    // Forget the least visited directories, so the counts do not grow forever.
+    if (visitCounts.count() > MaxVisitCounts) {
+        QVector<int> counts(visitCounts.cbegin(), visitCounts.cend());
+        std::nth_element(counts.begin(), counts.begin() + counts.count() / 2, counts.end());
+        const int median(counts.at(counts.count() / 2));
+
+        visitCounts.removeIf([median](const QHash<QString, int>::iterator visitCount) {
+            return visitCount.value() <= median;
+        });
+    }
+
+    QList<QPair<int, QString>> frequentDirs;
+
+    for (auto visitCount(visitCounts.cbegin()); visitCount != visitCounts.cend(); ++visitCount) {
+        if (visitCount.key() != dirPath && visitCount.value() > 1) {
+            frequentDirs.append(qMakePair(visitCount.value(), visitCount.key()));
+        }
+    }
+
+    std::sort(frequentDirs.begin(), frequentDirs.end(), [](const QPair<int, QString> &left, const QPair<int, QString> &right) {
+        return left.first < right.first;
+    });
+
+    for (int i(qMax(0, frequentDirs.count() - FrequentDirCount)); i < frequentDirs.count(); ++i) {
+        suggest(frequentDirs.at(i).second);
+    }
+
+    const QString parentPath(QFileInfo(dirPath).path());
+
+    if (parentPath != dirPath) {
+        suggest(parentPath);
+    }
+}
+
+/*!
+ * \brief Starts reading the newest suggestions, unless a view is waiting for a directory.
+ * \note Suggestions that are already cached are skipped, since they are either complete or being read for a view.
+ */
+void DirectoryPrefetcher::startReads()
+{
+    if (DirectoryListing::foregroundLoadCount() > 0) {
+        if (!candidates.isEmpty()) {
+            startTimer.start(BackoffDelay);
+        }
+        return;
+    }
+
+    while (runningReads.count() < MaxConcurrentReads && !candidates.isEmpty()) {
+        const QString dirPath(candidates.takeFirst());
+
+        if (!DirectoryCache::instance()->find(dirPath).isNull()) {
+            continue;
+        }
+
+        const QSharedPointer<DirectoryListing> listing(DirectoryCache::instance()->acquire(dirPath, true));
+        runningReads.insert(dirPath, listing);
+
+        connect(listing.data(), &DirectoryListing::entriesAppended, this, [this, dirPath]() {
+            readProgressed(dirPath);
+        });
+        connect(listing.data(), &DirectoryListing::loadFinished, this, [this, dirPath]() {
+            readFinished(dirPath);
+        });
+    }
+}
+
+/*!
+ * \brief Abandons a speculative read once its directory turns out to be too large.
+ * \param dirPath = The path of the directory
+ * \note The read is only canceled if no view has opened the directory in the meantime.
+ */
+void DirectoryPrefetcher::readProgressed(const QString &dirPath)
+{
+    const QSharedPointer<DirectoryListing> listing(runningReads.value(dirPath));
+
+    if (listing.isNull() || listing->entries().count() <= MaxPrefetchEntries) {
+        return;
+    }
+
+    disconnect(listing.data(), nullptr, this, nullptr);
+    runningReads.remove(dirPath);
+    startTimer.start();
+}
+
+/*!
+ * \brief Retains a listing that has been read completely and starts the next read.
+ * \param dirPath = The path of the directory
+ */
+void DirectoryPrefetcher::readFinished(const QString &dirPath)
+{
+    const QSharedPointer<DirectoryListing> listing(runningReads.take(dirPath));
+
+    if (listing.isNull()) {
+        return;
+    }
+
+    disconnect(listing.data(), nullptr, this, nullptr);
+
+    const int cost(qMax(1, static_cast<int>(listing->entries().memoryUsage() / 1024)));
+    retainedListings.insert(dirPath, new QSharedPointer<DirectoryListing>(listing), cost);
+
+    startTimer.start();
+}
@@ -0,0 +1,56 @@
+#ifndef DIRECTORYPREFETCHER_H
+#define DIRECTORYPREFETCHER_H
+
+#include "directorylisting.h"
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+
+/*!
+ * \brief The service that reads the directories the user is likely to open next before they are opened.
+ *
+ * The candidates are suggested by the views: the folder under the cursor or the keyboard focus, the parent of the
+ * current directory and the directories that are visited most often. The most recent suggestions are read first, at
+ * idle CPU and I/O priority, into the DirectoryCache, so opening one of them shows a listing that is already complete.
+ *
+ * At most MaxConcurrentReads directories are read at once, and nothing new is started while a view is waiting for a
+ * directory. Directories with more than MaxPrefetchEntries entries are abandoned. The finished listings are retained
+ * least recently used first, up to MaxRetainedKiB of memory.
+ * \note The service may only be used from the GUI thread.
+ */
+class DirectoryPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DirectoryPrefetcher *instance();
+    void suggest(const QString &dirPath);
+    void recordVisit(const QString &dirPath);
+
+private:
+    static const int MaxCandidates = 8;             ///< The maximum amount of suggestions waiting to be read.
+    static const int MaxConcurrentReads = 2;        ///< The maximum amount of directories read at once.
+    static const int MaxPrefetchEntries = 100000;   ///< The size at which a speculative read is abandoned.
+    static const int MaxRetainedKiB = 16 * 1024;    ///< The memory cap of the retained listings in KiB.
+    static const int MaxVisitCounts = 256;          ///< The maximum amount of directories whose visits are counted.
+    static const int FrequentDirCount = 3;          ///< The amount of most visited directories suggested on every visit.
+    static const int SettleDelay = 150;             ///< The time in milliseconds a suggestion has to stand before it is read.
+    static const int BackoffDelay = 500;            ///< The time in milliseconds to wait while a view is loading.
+
+    QStringList candidates;     ///< The directories waiting to be read, most recent first.
+    QHash<QString, QSharedPointer<DirectoryListing>> runningReads;  ///< The directories being read, keyed by path.
+    QCache<QString, QSharedPointer<DirectoryListing>> retainedListings;    ///< The finished listings, with their memory in KiB as cost.
+    QHash<QString, int> visitCounts;    ///< How often each directory has been visited.
+    QTimer startTimer;          ///< Starts the next reads once the suggestions have settled.
+
+    explicit DirectoryPrefetcher(QObject *parent = nullptr);
+    void startReads();
+    void readProgressed(const QString &dirPath);
+    void readFinished(const QString &dirPath);
+};
+
+#endif // DIRECTORYPREFETCHER_H
@@ -0,0 +1,423 @@
+#include "directoryreader.h"
+#include "mimesniffer.h"
+
+#include <QFile>
+#include <QMimeDatabase>
+
+#if defined (Q_OS_LINUX)
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const unsigned int StatMask(STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO);   ///< The fields requested from statx.
+static const int IoprioWhoProcess(1);       ///< Makes ioprio_set() apply to a single thread when its ID is 0.
+static const int IoprioIdleValue(3 << 13);  ///< The idle I/O scheduling class, which only gets disk time no one else wants.
+#else
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#endif
+
+/*!
+ * \brief Reads all the entries of a directory.
+ * \param promise = The promise to which the entries are reported
+ * \param dirPath = The path of the directory
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * The entries are reported in batches as they are read. The first batch is kept small so that the first screenful can
+ * be shown right away, and it carries the modification time of the directory from before it was read. It is reported
+ * even if the directory is empty. On Linux the directory is read with large getdents64 batches and only the name and d_type of an
+ * entry are recorded; the rest of the metadata is fetched later by readMetadata() for the entries that are looked at.
+ * Other platforms fall back to QDirIterator, which provides the metadata for free.
+ */
+void DirectoryReader::readDirectory(QPromise<DirectoryEntries> &promise, const QString &dirPath)
+{
+    DirectoryEntries entries;
+    int batchLimit(FirstBatchSize);
+
+#if defined (Q_OS_LINUX)
+    const int dirFd(::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+    if (dirFd < 0) {
+        return;
+    }
+
+    entries.dirMtime = mtimeOf(dirFd);
+    QByteArray buffer(ReadBufferSize, Qt::Uninitialized);
+    bool canceled(false);
+
+    while (!canceled) {
+        const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (long pos(0); pos < bytesRead && !canceled;) {
+            const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+            pos += dirEntry->d_reclen;
+
+            appendEntry(dirFd, dirEntry->d_name, dirEntry->d_type, entries);
+
+            if (entries.count() >= batchLimit) {
+                reportBatch(promise, entries, batchLimit);
+            }
+
+            canceled = promise.isCanceled();
+        }
+    }
+
+    ::close(dirFd);
+#else
+    entries.dirMtime = directoryMtime(dirPath);
+    QDirIterator dirIterator(dirPath, QDir::AllEntries | QDir::Hidden | QDir::System);
+
+    while (dirIterator.hasNext() && !promise.isCanceled()) {
+        dirIterator.next();
+
+        const QFileInfo info(dirIterator.fileInfo());
+        const QByteArray name(info.fileName().toUtf8());
+        quint8 flags(0);
+        DirectoryEntries::EntryType type(DirectoryEntries::OtherEntry);
+
+        if (info.isHidden() && name != "." && name != "..") {
+            flags |= DirectoryEntries::HiddenFlag;
+        }
+
+        if (info.isSymLink()) {
+            flags |= DirectoryEntries::SymlinkFlag;
+        }
+
+        if (info.isDir()) {
+            type = DirectoryEntries::DirEntry;
+        } else {
+            if (info.isFile()) {
+                type = DirectoryEntries::FileEntry;
+            }
+        }
+
+        const int entry(entries.append(name.constData(), name.size(), type, flags));
+        entries.setMetadata(entry, info.size(), info.lastModified().toMSecsSinceEpoch(), static_cast<quint32>(info.permissions()));
+
+        if (entries.count() >= batchLimit) {
+            reportBatch(promise, entries, batchLimit);
+        }
+    }
+#endif
+
+    // The batch limit is only raised once a batch has been reported, so an empty directory still reports its time.
+    if ((entries.count() > 0 || batchLimit == FirstBatchSize) && !promise.isCanceled()) {
+        promise.addResult(std::move(entries));
+    }
+}
+
+/*!
+ * \brief Reads all the entries of a directory without competing with the reads the user is waiting for.
+ * \param promise = The promise to which the entries are reported
+ * \param dirPath = The path of the directory
+ * \note This function is meant to be run with QtConcurrent::run() on FileSystemAccess::backgroundPool(), for
+ * directories that are read speculatively.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * The threads of the background pools are started at idle CPU priority. On Linux the worker also switches to the idle
+ * I/O scheduling class. Neither priority is restored, since the threads never run anything else, and lowering the
+ * priority of a shared pool thread could not be fully undone: Qt maps IdlePriority to SCHED_IDLE, which a later
+ * NormalPriority does not leave.
+ */
+void DirectoryReader::readDirectoryInBackground(QPromise<DirectoryEntries> &promise, const QString &dirPath)
+{
+#if defined (Q_OS_LINUX)
+    syscall(SYS_ioprio_set, IoprioWhoProcess, 0, IoprioIdleValue);
+#endif
+
+    readDirectory(promise, dirPath);
+}
+
+/*!
+ * \brief Reports a batch of entries and starts a new one.
+ * \param promise = The promise to which the batch is reported
+ * \param entries = The batch, which will be empty afterwards
+ * \param batchLimit = The size at which the batch was reported, which will be set to the size of the following batches
+ */
+void DirectoryReader::reportBatch(QPromise<DirectoryEntries> &promise, DirectoryEntries &entries, int &batchLimit)
+{
+    promise.addResult(std::move(entries));
+    entries.clear();
+    entries.reserve(BatchSize, BatchSize * 16);
+    batchLimit = BatchSize;
+}
+
+/*!
+ * \brief Reads a set of entries of a directory together with their metadata.
+ * \param dirPath = The path of the directory
+ * \param names = The UTF-8 names of the entries
+ * \return The DirectoryEntries of the names that exist, in no particular order, with the modification time of the
+ * directory from before they were read
+ * \note This function is meant to be run with QtConcurrent::run(), to find out how the given entries have changed.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+DirectoryEntries DirectoryReader::readEntries(const QString &dirPath, const QVector<QByteArray> &names)
+{
+    DirectoryEntries entries;
+
+#if defined (Q_OS_LINUX)
+    const int dirFd(::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+    if (dirFd < 0) {
+        return entries;
+    }
+
+    entries.dirMtime = mtimeOf(dirFd);
+
+    for (const QByteArray &name : names) {
+        // Entries of an unknown type are stat'ed, which also provides their metadata.
+        if (faccessat(dirFd, name.constData(), F_OK, AT_SYMLINK_NOFOLLOW) == 0) {
+            appendEntry(dirFd, name.constData(), DT_UNKNOWN, entries);
+        }
+    }
+
+    ::close(dirFd);
+#else
+    entries.dirMtime = directoryMtime(dirPath);
+
+    for (const QByteArray &name : names) {
+        const QFileInfo info(dirPath + "/" + QString::fromUtf8(name));
+
+        if (!info.exists() && !info.isSymLink()) {
+            continue;
+        }
+
+        quint8 flags(info.isHidden() ? DirectoryEntries::HiddenFlag : 0);
+        DirectoryEntries::EntryType type(DirectoryEntries::OtherEntry);
+
+        if (info.isSymLink()) {
+            flags |= DirectoryEntries::SymlinkFlag;
+        }
+
+        if (info.isDir()) {
+            type = DirectoryEntries::DirEntry;
+        } else {
+            if (info.isFile()) {
+                type = DirectoryEntries::FileEntry;
+            }
+        }
+
+        const int entry(entries.append(name.constData(), name.size(), type, flags));
+        entries.setMetadata(entry, info.size(), info.lastModified().toMSecsSinceEpoch(), static_cast<quint32>(info.permissions()));
+    }
+#endif
+
+    return entries;
+}
+
+/*!
+ * \brief Fetches the metadata and MIME type of a set of entries in a directory.
+ * \param dirPath = The path of the directory
+ * \param ids = The positions of the entries
+ * \param names = The UTF-8 names of the entries
+ * \return A QVector of EntryMetadata
+ * \note This function is meant to be run with QtConcurrent::run().
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * The MIME type is matched by name. The files whose name tells nothing and the executable files are handed to the
+ * MimeSniffer together once the batch has been stat'ed, which reads their headers in parallel.
+ */
+QVector<EntryMetadata> DirectoryReader::readMetadata(const QString &dirPath, const QVector<int> &ids, const QVector<QByteArray> &names)
+{
+    QVector<EntryMetadata> results;
+    QVector<MimeSniffer::Probe> probes;
+    QVector<int> probedResults;
+    QMimeDatabase mimeDatabase;
+    results.reserve(ids.count());
+
+#if defined (Q_OS_LINUX)
+    const int dirFd(::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+    if (dirFd < 0) {
+        return results;
+    }
+#endif
+
+    for (int i(0); i < ids.count(); ++i) {
+        EntryMetadata metadata;
+        metadata.id = ids.at(i);
+        metadata.type = DirectoryEntries::UnknownEntry;
+        metadata.stated = false;
+        metadata.size = 0;
+        metadata.mtime = 0;
+        metadata.mode = 0;
+
+        MimeSniffer::Probe probe;
+
+#if defined (Q_OS_LINUX)
+        struct statx stx;
+
+        if (statx(dirFd, names.at(i).constData(), AT_NO_AUTOMOUNT, StatMask, &stx) == 0) {
+            metadata.type = typeFromMode(stx.stx_mode);
+            metadata.stated = true;
+            metadata.size = static_cast<qint64>(stx.stx_size);
+            metadata.mtime = static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+            metadata.mode = stx.stx_mode;
+            probe.device = (static_cast<quint64>(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+            probe.inode = stx.stx_ino;
+        }
+#else
+        const QFileInfo info(dirPath + "/" + QString::fromUtf8(names.at(i)));
+
+        if (info.exists()) {
+            metadata.type = info.isDir() ? DirectoryEntries::DirEntry : (info.isFile() ? DirectoryEntries::FileEntry : DirectoryEntries::OtherEntry);
+            metadata.stated = true;
+            metadata.size = info.size();
+            metadata.mtime = info.lastModified().toMSecsSinceEpoch();
+            metadata.mode = static_cast<quint32>(info.permissions());
+        }
+#endif
+
+        if (metadata.type == DirectoryEntries::DirEntry) {
+            metadata.mimeName = QStringLiteral("inode/directory");
+        } else {
+            const QMimeType nameType(mimeDatabase.mimeTypeForFile(QString::fromUtf8(names.at(i)), QMimeDatabase::MatchExtension));
+            metadata.mimeName = nameType.name();
+            probe.nameType = nameType.isDefault() ? QString() : nameType.name();
+
+            if (metadata.type == DirectoryEntries::FileEntry && MimeSniffer::needsSniffing(probe.nameType, metadata.mode)) {
+                probe.path = dirPath + "/" + QString::fromUtf8(names.at(i));
+                probe.mtime = metadata.mtime;
+                probe.size = metadata.size;
+                probes.append(probe);
+                probedResults.append(results.count());
+            }
+        }
+
+        results.append(metadata);
+    }
+
+    MimeSniffer::instance()->detect(probes);
+
+    for (int i(0); i < probes.count(); ++i) {
+        results[probedResults.at(i)].mimeName = probes.at(i).mimeName;
+    }
+
+#if defined (Q_OS_LINUX)
+    ::close(dirFd);
+#endif
+
+    return results;
+}
+
+/*!
+ * \brief Provides the modification time of a directory.
+ * \param dirPath = The path of the directory
+ * \return The time in milliseconds since the epoch, or 0 if the directory can not be stat'ed
+ * \note This function is meant to be run with QtConcurrent::run(), to find out whether a directory has changed.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+qint64 DirectoryReader::directoryMtime(const QString &dirPath)
+{
+#if defined (Q_OS_LINUX)
+    struct statx stx;
+
+    if (statx(AT_FDCWD, QFile::encodeName(dirPath).constData(), AT_NO_AUTOMOUNT, STATX_MTIME, &stx) != 0) {
+        return 0;
+    }
+
+    return static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+#else
+    const QFileInfo info(dirPath);
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+#endif
+}
+
+#if defined (Q_OS_LINUX)
+/*!
+ * \brief Appends a directory entry to a batch.
+ * \param dirFd = The file descriptor of the directory
+ * \param name = The null terminated name of the entry
+ * \param dirType = The d_type reported by getdents64
+ * \param entries = The batch to which the entry is appended
+ *
+ * Only links and entries of an unknown d_type are stat'ed here, since their type can not be known otherwise.
+ */
+void DirectoryReader::appendEntry(int dirFd, const char *name, unsigned char dirType, DirectoryEntries &entries)
+{
+    const int length(static_cast<int>(std::strlen(name)));
+    const bool dotOrDotDot((length == 1 && name[0] == '.') || (length == 2 && name[0] == '.' && name[1] == '.'));
+    quint8 flags((name[0] == '.' && !dotOrDotDot) ? DirectoryEntries::HiddenFlag : 0);
+
+    switch (dirType) {
+    case DT_DIR:
+        entries.append(name, length, DirectoryEntries::DirEntry, flags);
+        return;
+
+    case DT_REG:
+        entries.append(name, length, DirectoryEntries::FileEntry, flags);
+        return;
+
+    case DT_LNK:
+    case DT_UNKNOWN:
+        break;
+
+    default:
+        entries.append(name, length, DirectoryEntries::OtherEntry, flags);
+        return;
+    }
+
+    struct statx stx;
+
+    if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, StatMask, &stx) != 0) {
+        entries.append(name, length, DirectoryEntries::UnknownEntry, flags);
+        return;
+    }
+
+    // Links are shown with the metadata of their target, the same way QFileInfo does it.
+    if (S_ISLNK(stx.stx_mode)) {
+        flags |= DirectoryEntries::SymlinkFlag;
+
+        if (statx(dirFd, name, AT_NO_AUTOMOUNT, StatMask, &stx) != 0) {
+            entries.append(name, length, DirectoryEntries::OtherEntry, flags);
+            return;
+        }
+    }
+
+    const int entry(entries.append(name, length, typeFromMode(stx.stx_mode), flags));
+    entries.setMetadata(entry,
+                        static_cast<qint64>(stx.stx_size),
+                        static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000,
+                        stx.stx_mode);
+}
+
+/*!
+ * \brief Provides the entry type of a mode.
+ * \param mode = The mode bits
+ * \return The DirectoryEntries::EntryType
+ */
+DirectoryEntries::EntryType DirectoryReader::typeFromMode(quint32 mode)
+{
+    if (S_ISDIR(mode)) {
+        return DirectoryEntries::DirEntry;
+    }
+
+    return S_ISREG(mode) ? DirectoryEntries::FileEntry : DirectoryEntries::OtherEntry;
+}
+
+/*!
+ * \brief Provides the modification time of an open directory.
+ * \param dirFd = The file descriptor of the directory
+ * \return The time in milliseconds since the epoch, or 0 if the directory can not be stat'ed
+ */
+qint64 DirectoryReader::mtimeOf(int dirFd)
+{
+    struct statx stx;
+
+    if (statx(dirFd, "", AT_EMPTY_PATH, STATX_MTIME, &stx) != 0) {
+        return 0;
+    }
+
+    return static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+}
+#endif
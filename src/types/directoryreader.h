@@ -0,0 +1,34 @@
+#ifndef DIRECTORYREADER_H
+#define DIRECTORYREADER_H
+
+#include "directoryentries.h"
+
+#include <QPromise>
+#include <QString>
+
+/*!
+ * \brief The class responsible for enumerating the entries of a directory on a worker thread.
+ */
+class DirectoryReader
+{
+public:
+    static void readDirectory(QPromise<DirectoryEntries> &promise, const QString &dirPath);
+    static void readDirectoryInBackground(QPromise<DirectoryEntries> &promise, const QString &dirPath);
+    static DirectoryEntries readEntries(const QString &dirPath, const QVector<QByteArray> &names);
+    static QVector<EntryMetadata> readMetadata(const QString &dirPath, const QVector<int> &ids, const QVector<QByteArray> &names);
+    static qint64 directoryMtime(const QString &dirPath);
+
+private:
+    static const int ReadBufferSize = 256 * 1024;   ///< The size of the buffer handed to each getdents64 call.
+    static const int FirstBatchSize = 256;          ///< The amount of entries in the first reported batch.
+    static const int BatchSize = 2048;              ///< The amount of entries in every following batch.
+
+    static void reportBatch(QPromise<DirectoryEntries> &promise, DirectoryEntries &entries, int &batchLimit);
+#if defined (Q_OS_LINUX)
+    static void appendEntry(int dirFd, const char *name, unsigned char dirType, DirectoryEntries &entries);
+    static DirectoryEntries::EntryType typeFromMode(quint32 mode);
+    static qint64 mtimeOf(int dirFd);
+#endif
+};
+
+#endif // DIRECTORYREADER_H
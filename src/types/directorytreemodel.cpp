@@ -0,0 +1,704 @@
+#include "directorytreemodel.h"
+#include "directorycache.h"
+#include "iconservice.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QLocale>
+#include <QSet>
+
+#include <algorithm>
+
+/*!
+ * \brief The constructor of a tree node.
+ * \param nodeName = The name of the folder
+ * \param parentNode = The parent folder
+ * \param id = The position of the folder in its parent's listing
+ */
+DirectoryTreeModel::Node::Node(const QString &nodeName, Node *parentNode, int id) :
+    name(nodeName),
+    parent(parentNode),
+    entryId(id),
+    fetched(false)
+{
+}
+
+/*!
+ * \brief The destructor of a tree node.
+ * \note This disconnects the node from its listing, which may outlive it, and deletes all of its children.
+ */
+DirectoryTreeModel::Node::~Node()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(listingConnections)) {
+        QObject::disconnect(connection);
+    }
+
+    qDeleteAll(children);
+}
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this model is bound
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+DirectoryTreeModel::DirectoryTreeModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    rootNode(new Node(QString(), nullptr, -1)),
+    filters(QDir::AllDirs | QDir::NoDotAndDotDot)
+{
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    rootNode->fetched = true;
+
+#if defined (Q_OS_WIN)
+    const QFileInfoList drives(QDir::drives());
+
+    for (int i(0); i < drives.length(); ++i) {
+        QString drive(drives.at(i).absolutePath());
+        drive.chop(1);
+        rootNode->children.append(new Node(drive, rootNode, -1));
+    }
+#endif
+
+#if defined (Q_OS_LINUX)
+    rootNode->children.append(new Node("/", rootNode, -1));
+#endif
+}
+
+/*!
+ * \brief The destructor
+ */
+DirectoryTreeModel::~DirectoryTreeModel()
+{
+    delete rootNode;
+}
+
+/*!
+ * \brief Provides the index of the given row and column.
+ * \param row = The row
+ * \param column = The column
+ * \param parent = The parent index
+ * \return A QModelIndex that is invalid if there is no such item
+ */
+QModelIndex DirectoryTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node *parentNode(nodeFromIndex(parent));
+
+    if (row < 0 || row >= parentNode->children.count() || column < 0 || column >= ColumnCount) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, parentNode->children.at(row));
+}
+
+/*!
+ * \brief Provides the index of the given folder path.
+ * \param path = The path of the folder
+ * \param column = The column
+ * \return A QModelIndex that is invalid for an empty path
+ * \note Nodes are created for the folders in the path that have not been fetched yet, like QFileSystemModel does.
+ */
+QModelIndex DirectoryTreeModel::index(const QString &path, int column) const
+{
+    DirectoryTreeModel *model(const_cast<DirectoryTreeModel *>(this));
+    return indexFromNode(model->nodeForPath(path), column);
+}
+
+/*!
+ * \brief Provides the parent of an index.
+ * \param child = The index
+ * \return The QModelIndex of the parent folder
+ */
+QModelIndex DirectoryTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+
+    return indexFromNode(nodeFromIndex(child)->parent);
+}
+
+/*!
+ * \brief Provides the amount of sub folders of the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int DirectoryTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    return nodeFromIndex(parent)->children.count();
+}
+
+/*!
+ * \brief Provides the amount of columns under the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int DirectoryTreeModel::columnCount(const QModelIndex &parent) const
+{
+    return (parent.column() > 0) ? 0 : ColumnCount;
+}
+
+/*!
+ * \brief Checks if the given parent has any sub folders.
+ * \param parent = The parent index
+ * \return A Boolean value that is always true for folders that have not been fetched yet
+ */
+bool DirectoryTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return false;
+    }
+
+    const Node *node(nodeFromIndex(parent));
+    return !node->fetched || !node->children.isEmpty();
+}
+
+/*!
+ * \brief Checks if the sub folders of the given parent still need to be fetched.
+ * \param parent = The parent index
+ * \return A Boolean value
+ */
+bool DirectoryTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !nodeFromIndex(parent)->fetched;
+}
+
+/*!
+ * \brief Fetches the sub folders of the given parent.
+ * \param parent = The parent index
+ */
+void DirectoryTreeModel::fetchMore(const QModelIndex &parent)
+{
+    fetchNode(nodeFromIndex(parent));
+}
+
+/*!
+ * \brief Provides the data of an index.
+ * \param index = The index
+ * \param role = The role of the data
+ * \return A QVariant that is invalid if there is no data for the role
+ */
+QVariant DirectoryTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const Node *node(nodeFromIndex(index));
+    const bool isDrive(node->parent == rootNode);
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        switch (index.column()) {
+        case NameColumn:
+            return node->name;
+
+        case TypeColumn:
+            return isDrive ? QString("Drive") : QString("Folder");
+
+        case DateColumn:
+            if (node->entryId >= 0 && !node->parent->listing.isNull() && node->entryId < node->parent->listing->entries().count()) {
+                const DirectoryEntries &entries(node->parent->listing->entries());
+
+                if (!entries.hasMetadata(node->entryId)) {
+                    node->parent->listing->requestMetadata(node->entryId);
+                    return QVariant();
+                }
+                return QLocale::system().toString(QDateTime::fromMSecsSinceEpoch(entries.mtime(node->entryId)), QLocale::ShortFormat);
+            }
+            return QVariant();
+
+        default:
+            return QVariant();
+        }
+
+    case Qt::DecorationRole:
+        if (index.column() == NameColumn) {
+            return isDrive ? IconService::instance()->driveIcon() : IconService::instance()->folderIcon();
+        }
+        return QVariant();
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Provides the column titles.
+ * \param section = The column
+ * \param orientation = The orientation of the header
+ * \param role = The role of the data
+ * \return A QVariant containing the title of the column
+ */
+QVariant DirectoryTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractItemModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case NameColumn:
+        return QString("Name");
+
+    case SizeColumn:
+        return QString("Size");
+
+    case TypeColumn:
+        return QString("Type");
+
+    case DateColumn:
+        return QString("Date Modified");
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Provides the item flags of an index.
+ * \param index = The index
+ * \return The Qt::ItemFlags of the index
+ */
+Qt::ItemFlags DirectoryTreeModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+/*!
+ * \brief Sets a new root path and fetches its sub folders.
+ * \param newPath = The path of the folder
+ * \return The QModelIndex of the folder
+ */
+QModelIndex DirectoryTreeModel::setRootPath(const QString &newPath)
+{
+    treeRootPath = QDir::cleanPath(QDir::fromNativeSeparators(newPath));
+
+    Node *node(nodeForPath(treeRootPath));
+
+    if (node != nullptr && !node->fetched) {
+        fetchNode(node);
+    }
+
+    return indexFromNode(node);
+}
+
+/*!
+ * \brief Provides the root path of the tree.
+ * \return A QString value of the root path
+ */
+QString DirectoryTreeModel::rootPath() const
+{
+    return treeRootPath;
+}
+
+/*!
+ * \brief Sets the filters applied to the listings.
+ * \param newFilters = The QDir::Filters
+ * \note Only folders are ever shown, so the Files and System flags have no effect.
+ */
+void DirectoryTreeModel::setFilter(QDir::Filters newFilters)
+{
+    if (filters == newFilters) {
+        return;
+    }
+
+    filters = newFilters;
+    syncFetchedNodes(rootNode);
+}
+
+/*!
+ * \brief Provides the filters applied to the listings.
+ * \return The QDir::Filters
+ */
+QDir::Filters DirectoryTreeModel::filter() const
+{
+    return filters;
+}
+
+/*!
+ * \brief Provides the full path of the folder at the given index.
+ * \param index = The index
+ * \return A QString with the path
+ */
+QString DirectoryTreeModel::filePath(const QModelIndex &index) const
+{
+    return nodePath(nodeFromIndex(index));
+}
+
+/*!
+ * \brief Provides the node of an index.
+ * \param index = The index
+ * \return A pointer to the Node, which is the invisible root node for the invalid index
+ */
+DirectoryTreeModel::Node *DirectoryTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return rootNode;
+    }
+
+    return static_cast<Node *>(index.internalPointer());
+}
+
+/*!
+ * \brief Provides the index of a node.
+ * \param node = The node
+ * \param column = The column
+ * \return A QModelIndex that is invalid for the invisible root node and null pointers
+ */
+QModelIndex DirectoryTreeModel::indexFromNode(Node *node, int column) const
+{
+    if (node == nullptr || node == rootNode) {
+        return QModelIndex();
+    }
+
+    return createIndex(node->parent->children.indexOf(node), column, node);
+}
+
+/*!
+ * \brief Finds the node of a folder path and creates the nodes that do not exist yet.
+ * \param path = The path of the folder
+ * \return A pointer to the Node, or a null pointer if the path does not start at one of the top level folders
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+DirectoryTreeModel::Node *DirectoryTreeModel::nodeForPath(const QString &path)
+{
+    const QString cleanPath(QDir::cleanPath(QDir::fromNativeSeparators(path)));
+
+    if (cleanPath.isEmpty()) {
+        return nullptr;
+    }
+
+#if defined (Q_OS_LINUX)
+    if (!cleanPath.startsWith('/')) {
+        return nullptr;
+    }
+
+    QStringList names(cleanPath.mid(1).split('/', Qt::SkipEmptyParts));
+    names.prepend("/");
+#else
+    QStringList names(cleanPath.split('/', Qt::SkipEmptyParts));
+#endif
+
+    Node *node(rootNode);
+
+    for (const QString &name : names) {
+        Node *child(nullptr);
+
+        for (Node *existingChild : qAsConst(node->children)) {
+            if (existingChild->name == name) {
+                child = existingChild;
+                break;
+            }
+        }
+
+        if (child == nullptr) {
+            if (node == rootNode) {
+                return nullptr;
+            }
+
+            const int row(insertPosition(node, name));
+
+            beginInsertRows(indexFromNode(node), row, row);
+            child = new Node(name, node, -1);
+            node->children.insert(row, child);
+            endInsertRows();
+        }
+
+        node = child;
+    }
+
+    return node;
+}
+
+/*!
+ * \brief Provides the full path of a node.
+ * \param node = The node
+ * \return A QString with the path
+ */
+QString DirectoryTreeModel::nodePath(const Node *node) const
+{
+    if (node == nullptr || node == rootNode) {
+        return QString();
+    }
+
+    QStringList names;
+
+    for (const Node *pathNode(node); pathNode != rootNode; pathNode = pathNode->parent) {
+        names.prepend(pathNode->name);
+    }
+
+    // Drives must end with a separator, otherwise "C:" refers to the current directory of the drive.
+    if (!names.first().endsWith('/')) {
+        names.first().append('/');
+    }
+
+    return QDir::cleanPath(names.join('/'));
+}
+
+/*!
+ * \brief Provides the row at which a sub folder should be inserted to keep the children sorted.
+ * \param parentNode = The parent folder
+ * \param name = The name of the sub folder
+ * \return An integer
+ */
+int DirectoryTreeModel::insertPosition(const Node *parentNode, const QString &name) const
+{
+    const auto position(std::lower_bound(parentNode->children.constBegin(), parentNode->children.constEnd(), name,
+                                         [this](const Node *child, const QString &childName) {
+        return collator.compare(child->name, childName) < 0;
+    }));
+
+    return static_cast<int>(position - parentNode->children.constBegin());
+}
+
+/*!
+ * \brief Requests the shared listing of a folder and shows its sub folders once it is loaded.
+ * \param node = The folder
+ * \note Once the listing is loaded, the entries it appends or removes are applied one by one, and the sub folders are
+ * only compared with the whole listing when it finishes a read or drops its entries.
+ */
+void DirectoryTreeModel::fetchNode(Node *node)
+{
+    if (node == nullptr || node->fetched) {
+        return;
+    }
+
+    node->fetched = true;
+    node->listing = DirectoryCache::instance()->acquire(nodePath(node));
+    const auto syncLoadedChildren([this, node]() {
+        if (node->listing->isLoaded()) {
+            syncChildren(node);
+        }
+    });
+
+    node->listingConnections.append(connect(node->listing.data(), &DirectoryListing::loadFinished, this, syncLoadedChildren));
+    node->listingConnections.append(connect(node->listing.data(), &DirectoryListing::entriesReset, this, syncLoadedChildren));
+    node->listingConnections.append(connect(node->listing.data(), &DirectoryListing::entriesAppended, this, [this, node](int first, int last) {
+        if (node->listing->isLoaded()) {
+            insertChildren(node, first, last);
+        }
+    }));
+    node->listingConnections.append(connect(node->listing.data(), &DirectoryListing::entriesRemoved, this, [this, node](const QVector<int> &ids) {
+        if (node->listing->isLoaded()) {
+            removeChildren(node, ids);
+        }
+    }));
+    node->listingConnections.append(connect(node->listing.data(), &DirectoryListing::metadataChanged, this, [this, node]() {
+        if (!node->children.isEmpty()) {
+            emit dataChanged(indexFromNode(node->children.first(), DateColumn), indexFromNode(node->children.last(), DateColumn));
+        }
+    }));
+
+    if (node->listing->isLoaded()) {
+        syncChildren(node);
+    }
+}
+
+/*!
+ * \brief Gives back the listings of a folder that has been collapsed and of the folders below it.
+ * \param index = The index of the folder
+ */
+void DirectoryTreeModel::releaseNode(const QModelIndex &index)
+{
+    Node *node(nodeFromIndex(index));
+
+    if (node != rootNode) {
+        releaseListing(node);
+    }
+}
+
+/*!
+ * \brief Gives back the listing of a folder and removes its sub folders, which are fetched again when it is expanded.
+ * \param node = The folder
+ * \note Folders on the way to the root path are kept, and only give back their own listings. A listing that no explorer
+ * holds either is dropped from the DirectoryCache and is no longer watched.
+ */
+void DirectoryTreeModel::releaseListing(Node *node)
+{
+    const QModelIndex parentIndex(indexFromNode(node));
+
+    for (const QMetaObject::Connection &connection : qAsConst(node->listingConnections)) {
+        disconnect(connection);
+    }
+
+    node->listingConnections.clear();
+    node->listing.clear();
+    node->fetched = false;
+
+    for (int row(node->children.count() - 1); row >= 0; --row) {
+        Node *child(node->children.at(row));
+
+        if (leadsToRoot(child)) {
+            releaseListing(child);
+            continue;
+        }
+
+        beginRemoveRows(parentIndex, row, row);
+        delete node->children.takeAt(row);
+        endRemoveRows();
+    }
+}
+
+/*!
+ * \brief Updates the sub folders of a node from its listing.
+ * \param node = The folder
+ *
+ * Sub folders that no longer pass the filters are removed and new ones are inserted in sorted order. Folders on the way
+ * to the root path are always kept, even if they are hidden.
+ */
+void DirectoryTreeModel::syncChildren(Node *node)
+{
+    const DirectoryEntries &entries(node->listing->entries());
+    const QModelIndex parentIndex(indexFromNode(node));
+    QHash<QString, int> folderIds;
+    QStringList folderNames;
+
+    for (int id(0); id < entries.count(); ++id) {
+        if (entries.isDir(id) && entries.passesFilter(id, filters)) {
+            const QString name(entries.name(id));
+            folderIds.insert(name, id);
+            folderNames.append(name);
+        }
+    }
+
+    std::sort(folderNames.begin(), folderNames.end(), [this](const QString &left, const QString &right) {
+        return collator.compare(left, right) < 0;
+    });
+
+    for (int row(node->children.count() - 1); row >= 0; --row) {
+        Node *child(node->children.at(row));
+        const auto folderId(folderIds.constFind(child->name));
+
+        if (folderId != folderIds.constEnd()) {
+            child->entryId = folderId.value();
+            continue;
+        }
+
+        if (leadsToRoot(child)) {
+            child->entryId = node->listing->indexOf(child->name.toUtf8());
+            continue;
+        }
+
+        beginRemoveRows(parentIndex, row, row);
+        delete node->children.takeAt(row);
+        endRemoveRows();
+    }
+
+    int row(0);
+
+    for (const QString &name : qAsConst(folderNames)) {
+        // Skip the folders that were only kept because they lead to the root path.
+        while (row < node->children.count() && !folderIds.contains(node->children.at(row)->name)) {
+            ++row;
+        }
+
+        if (row < node->children.count() && node->children.at(row)->name == name) {
+            ++row;
+            continue;
+        }
+
+        beginInsertRows(parentIndex, row, row);
+        node->children.insert(row, new Node(name, node, folderIds.value(name)));
+        endInsertRows();
+        ++row;
+    }
+
+    if (!node->children.isEmpty()) {
+        emit dataChanged(index(0, NameColumn, parentIndex), index(node->children.count() - 1, DateColumn, parentIndex));
+    }
+}
+
+/*!
+ * \brief Inserts the sub folders among a range of entries that have been added to a listing.
+ * \param node = The folder
+ * \param first = The position of the first added entry
+ * \param last = The position of the last added entry
+ * \note A folder that is already shown, because it leads to the root path, only takes over the new entry.
+ */
+void DirectoryTreeModel::insertChildren(Node *node, int first, int last)
+{
+    const DirectoryEntries &entries(node->listing->entries());
+    const QModelIndex parentIndex(indexFromNode(node));
+
+    for (int id(first); id <= last; ++id) {
+        if (!entries.isDir(id) || !entries.passesFilter(id, filters)) {
+            continue;
+        }
+
+        const QString name(entries.name(id));
+        const int row(insertPosition(node, name));
+
+        if (row < node->children.count() && node->children.at(row)->name == name) {
+            node->children.at(row)->entryId = id;
+            continue;
+        }
+
+        beginInsertRows(parentIndex, row, row);
+        node->children.insert(row, new Node(name, node, id));
+        endInsertRows();
+    }
+}
+
+/*!
+ * \brief Removes the sub folders whose entries have been removed from a listing.
+ * \param node = The folder
+ * \param ids = The positions of the removed entries
+ * \note Folders on the way to the root path are kept, without an entry.
+ */
+void DirectoryTreeModel::removeChildren(Node *node, const QVector<int> &ids)
+{
+    const QSet<int> removedIds(ids.cbegin(), ids.cend());
+    const QModelIndex parentIndex(indexFromNode(node));
+
+    for (int row(node->children.count() - 1); row >= 0; --row) {
+        Node *child(node->children.at(row));
+
+        if (!removedIds.contains(child->entryId)) {
+            continue;
+        }
+
+        if (leadsToRoot(child)) {
+            child->entryId = -1;
+            continue;
+        }
+
+        beginRemoveRows(parentIndex, row, row);
+        delete node->children.takeAt(row);
+        endRemoveRows();
+    }
+}
+
+/*!
+ * \brief Checks if a folder is the root path of the tree or one of the folders above it.
+ * \param node = The folder
+ * \return A boolean value that is true if the folder has to be kept even if it is hidden or gone
+ */
+bool DirectoryTreeModel::leadsToRoot(const Node *node) const
+{
+    const QString path(nodePath(node));
+    return treeRootPath == path || treeRootPath.startsWith(path.endsWith('/') ? path : path + "/");
+}
+
+/*!
+ * \brief Updates the sub folders of every fetched node below the given one.
+ * \param node = The folder to start from
+ */
+void DirectoryTreeModel::syncFetchedNodes(Node *node)
+{
+    if (!node->listing.isNull() && node->listing->isLoaded()) {
+        syncChildren(node);
+    }
+
+    for (int row(0); row < node->children.count(); ++row) {
+        syncFetchedNodes(node->children.at(row));
+    }
+}
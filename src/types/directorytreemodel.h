@@ -0,0 +1,90 @@
+#ifndef DIRECTORYTREEMODEL_H
+#define DIRECTORYTREEMODEL_H
+
+#include "directorylisting.h"
+
+#include <QAbstractItemModel>
+#include <QCollator>
+#include <QDir>
+#include <QSharedPointer>
+
+/*!
+ * \brief The item model of the folder tree shown in the tree view.
+ *
+ * The children of every expanded folder are a filtered view over the folder's DirectoryListing, which is taken from the
+ * DirectoryCache and therefore shared with the explorers. Only the names of the folders are kept in the tree itself.
+ * A collapsed folder gives its listing back, so the tree only holds and watches the folders that can be seen.
+ */
+class DirectoryTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Columns {
+        NameColumn,     ///< 0
+        SizeColumn,     ///< 1
+        TypeColumn,     ///< 2
+        DateColumn,     ///< 3
+        ColumnCount     ///< 4
+    };
+
+    explicit DirectoryTreeModel(QObject *parent = nullptr);
+    ~DirectoryTreeModel();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex index(const QString &path, int column = 0) const;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    QModelIndex setRootPath(const QString &newPath);
+    QString rootPath() const;
+    void setFilter(QDir::Filters newFilters);
+    QDir::Filters filter() const;
+    QString filePath(const QModelIndex &index) const;
+    void releaseNode(const QModelIndex &index);
+
+private:
+    /*!
+     * \brief A folder in the tree.
+     */
+    struct Node
+    {
+        Node(const QString &nodeName, Node *parentNode, int id);
+        ~Node();
+
+        QString name;           ///< The name of the folder.
+        Node *parent;           ///< The parent folder.
+        QVector<Node *> children;   ///< The sub folders, sorted by name.
+        QSharedPointer<DirectoryListing> listing;   ///< The shared listing of the folder, once it has been fetched.
+        QVector<QMetaObject::Connection> listingConnections;    ///< The connections to the signals of the listing.
+        int entryId;            ///< The position of the folder in its parent's listing, or -1 if it is not known yet.
+        bool fetched;           ///< Whether the folder's listing has been requested.
+    };
+
+    Node *rootNode;             ///< The invisible node above the top level folders.
+    QString treeRootPath;       ///< The root path of the tree.
+    QDir::Filters filters;      ///< The filters applied to the listings.
+    QCollator collator;         ///< Used to sort the folders by name.
+
+    Node *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexFromNode(Node *node, int column = 0) const;
+    Node *nodeForPath(const QString &path);
+    QString nodePath(const Node *node) const;
+    int insertPosition(const Node *parentNode, const QString &name) const;
+    void fetchNode(Node *node);
+    void releaseListing(Node *node);
+    void syncChildren(Node *node);
+    void insertChildren(Node *node, int first, int last);
+    void removeChildren(Node *node, const QVector<int> &ids);
+    bool leadsToRoot(const Node *node) const;
+    void syncFetchedNodes(Node *node);
+};
+
+#endif // DIRECTORYTREEMODEL_H
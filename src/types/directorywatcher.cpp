@@ -0,0 +1,351 @@
+#include "directorywatcher.h"
+#include "directoryreader.h"
+
+#include <QCoreApplication>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static const uint32_t WatchMask(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB
+                                | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK);   ///< The events that are watched.
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+DirectoryWatcher::DirectoryWatcher(QObject *parent) :
+    QObject(parent),
+    polling(false)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(CoalesceInterval);
+    pollTimer.setInterval(PollInterval);
+
+    connect(&flushTimer, &QTimer::timeout, this, &DirectoryWatcher::flushChanges);
+    connect(&pollTimer, &QTimer::timeout, this, &DirectoryWatcher::pollDirectories);
+
+#if defined (Q_OS_LINUX)
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    eventNotifier = nullptr;
+
+    if (inotifyFd >= 0) {
+        eventNotifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(eventNotifier, &QSocketNotifier::activated, this, &DirectoryWatcher::readEvents);
+    }
+#else
+    connect(&fallbackWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &path) {
+        pendingRescans.insert(path);
+        scheduleFlush();
+    });
+#endif
+}
+
+/*!
+ * \brief The destructor
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+DirectoryWatcher::~DirectoryWatcher()
+{
+#if defined (Q_OS_LINUX)
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+    }
+#endif
+}
+
+/*!
+ * \brief Provides the watcher shared by the whole application.
+ * \return A pointer to the DirectoryWatcher
+ * \note The watcher is bound to the application object and deleted with it.
+ */
+DirectoryWatcher *DirectoryWatcher::instance()
+{
+    static DirectoryWatcher *watcher(new DirectoryWatcher(QCoreApplication::instance()));
+    return watcher;
+}
+
+/*!
+ * \brief Starts watching a directory.
+ * \param path = The clean path of the directory
+ * \note A directory that is added several times is watched until it has been removed as many times.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+void DirectoryWatcher::addPath(const QString &path)
+{
+    if (watchCounts[path]++ > 0) {
+        return;
+    }
+
+#if defined (Q_OS_LINUX)
+    const int wd((inotifyFd >= 0) ? inotify_add_watch(inotifyFd, QFile::encodeName(path).constData(), WatchMask) : -1);
+
+    if (wd >= 0) {
+        watchPaths[wd].append(path);
+        watchDescriptors.insert(path, wd);
+        return;
+    }
+#else
+    if (fallbackWatcher.addPath(path)) {
+        return;
+    }
+#endif
+
+    // The watch limit has been reached, so the directory is checked periodically instead, from the time a worker finds.
+    polledPaths.insert(path, UnknownMtime);
+    QtConcurrent::run(&DirectoryWatcher::lastModified, QStringList({path})).then(this, [this](const QHash<QString, qint64> &mtimes) {
+        applyPolledTimes(mtimes);
+    });
+
+    if (!pollTimer.isActive()) {
+        pollTimer.start();
+    }
+}
+
+/*!
+ * \brief Stops watching a directory.
+ * \param path = The clean path of the directory
+ * \note Nothing happens if the watch of the directory has already been lost.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+void DirectoryWatcher::removePath(const QString &path)
+{
+    auto watchCount(watchCounts.find(path));
+
+    if (watchCount == watchCounts.end() || --watchCount.value() > 0) {
+        return;
+    }
+
+    watchCounts.erase(watchCount);
+    pendingChanges.remove(path);
+    pendingRescans.remove(path);
+
+    if (polledPaths.remove(path) > 0) {
+        if (polledPaths.isEmpty()) {
+            pollTimer.stop();
+        }
+        return;
+    }
+
+#if defined (Q_OS_LINUX)
+    const int wd(watchDescriptors.take(path));
+    QStringList &paths(watchPaths[wd]);
+    paths.removeOne(path);
+
+    // Links to the same directory share their watch descriptor.
+    if (paths.isEmpty()) {
+        watchPaths.remove(wd);
+        inotify_rm_watch(inotifyFd, wd);
+        droppedDescriptors.insert(wd);
+    }
+#else
+    fallbackWatcher.removePath(path);
+#endif
+}
+
+/*!
+ * \brief Checks if a directory is being watched.
+ * \param path = The clean path of the directory
+ * \return A boolean value that is false if the directory has not been added, or if its watch has been lost because it
+ * was deleted or moved away
+ */
+bool DirectoryWatcher::isWatching(const QString &path) const
+{
+    return watchCounts.contains(path);
+}
+
+/*!
+ * \brief Checks if the files in a directory are reported when they are modified, and not only when they are created,
+ * removed or renamed.
+ * \param path = The clean path of the directory
+ * \return A boolean value that is only true for a directory that is watched with inotify
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+bool DirectoryWatcher::reportsModifications(const QString &path) const
+{
+#if defined (Q_OS_LINUX)
+    return watchDescriptors.contains(path);
+#else
+    Q_UNUSED(path)
+    return false;
+#endif
+}
+
+#if defined (Q_OS_LINUX)
+/*!
+ * \brief Reads all the queued inotify events and collects the names of the changed entries.
+ */
+void DirectoryWatcher::readEvents()
+{
+    QByteArray buffer(EventBufferSize, Qt::Uninitialized);
+
+    forever {
+        const ssize_t bytesRead(::read(inotifyFd, buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (ssize_t pos(0); pos < bytesRead;) {
+            const struct inotify_event *event(reinterpret_cast<const struct inotify_event *>(buffer.constData() + pos));
+            pos += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            // Events have been lost, so nothing is known about any of the directories.
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (auto watchDescriptor(watchDescriptors.constBegin()); watchDescriptor != watchDescriptors.constEnd(); ++watchDescriptor) {
+                    pendingRescans.insert(watchDescriptor.key());
+                }
+                continue;
+            }
+
+            // The kernel reuses the descriptor of a dropped watch, so the watch is forgotten as soon as it is dropped.
+            if (event->mask & IN_IGNORED) {
+                if (droppedDescriptors.remove(event->wd) == 0) {
+                    forgetWatch(event->wd);
+                }
+                continue;
+            }
+
+            // A directory that has been moved away is still watched under its old path, so the watch is dropped.
+            if (event->mask & IN_MOVE_SELF) {
+                if (inotify_rm_watch(inotifyFd, event->wd) == 0) {
+                    droppedDescriptors.insert(event->wd);
+                }
+                forgetWatch(event->wd);
+                continue;
+            }
+
+            const QStringList paths(watchPaths.value(event->wd));
+
+            for (const QString &path : paths) {
+                if (event->mask & IN_DELETE_SELF) {
+                    pendingRescans.insert(path);
+                } else {
+                    if (event->len > 0) {
+                        pendingChanges[path].insert(QByteArray(event->name));
+                    }
+                }
+            }
+        }
+    }
+
+    scheduleFlush();
+}
+
+/*!
+ * \brief Forgets a watch that has been dropped, together with its directories, and requests a rescan of them.
+ * \param wd = The watch descriptor
+ * \note The directories are no longer counted as added, so the DirectoryListing adds them again on its rescan.
+ */
+void DirectoryWatcher::forgetWatch(int wd)
+{
+    const QStringList paths(watchPaths.take(wd));
+
+    for (const QString &path : paths) {
+        watchDescriptors.remove(path);
+        watchCounts.remove(path);
+        pendingChanges.remove(path);
+        pendingRescans.insert(path);
+    }
+}
+#endif
+
+/*!
+ * \brief Reports the pending changes once the coalescing interval has passed.
+ * \note The interval is not restarted by later changes, so a busy directory is still updated regularly.
+ */
+void DirectoryWatcher::scheduleFlush()
+{
+    if (!flushTimer.isActive() && (!pendingChanges.isEmpty() || !pendingRescans.isEmpty())) {
+        flushTimer.start();
+    }
+}
+
+/*!
+ * \brief Reports the changes collected since the last report.
+ * \note A directory that needs to be read again is not reported with its changed names.
+ */
+void DirectoryWatcher::flushChanges()
+{
+    const QSet<QString> rescans(pendingRescans);
+    const QHash<QString, QSet<QByteArray>> changes(pendingChanges);
+    pendingRescans.clear();
+    pendingChanges.clear();
+
+    for (const QString &path : rescans) {
+        emit rescanNeeded(path);
+    }
+
+    for (auto change(changes.constBegin()); change != changes.constEnd(); ++change) {
+        if (!rescans.contains(change.key())) {
+            emit directoryChanged(change.key(), change.value());
+        }
+    }
+}
+
+/*!
+ * \brief Starts a worker that checks the unwatched directories, unless one is still running.
+ * \note Only the creation, removal and renaming of entries change the modification time of a directory.
+ */
+void DirectoryWatcher::pollDirectories()
+{
+    if (polling) {
+        return;
+    }
+
+    polling = true;
+    QtConcurrent::run(&DirectoryWatcher::lastModified, polledPaths.keys()).then(this, [this](const QHash<QString, qint64> &mtimes) {
+        polling = false;
+        applyPolledTimes(mtimes);
+    });
+}
+
+/*!
+ * \brief Requests a rescan of the unwatched directories that have been modified since they were last checked.
+ * \param mtimes = The modification times found by a worker, keyed by directory
+ * \note Directories that have been removed in the meantime are skipped, and a directory that is checked for the first
+ * time only gets its time recorded.
+ */
+void DirectoryWatcher::applyPolledTimes(const QHash<QString, qint64> &mtimes)
+{
+    for (auto mtime(mtimes.constBegin()); mtime != mtimes.constEnd(); ++mtime) {
+        const auto polledPath(polledPaths.find(mtime.key()));
+
+        if (polledPath == polledPaths.end()) {
+            continue;
+        }
+
+        if (polledPath.value() != UnknownMtime && polledPath.value() != mtime.value()) {
+            pendingRescans.insert(polledPath.key());
+        }
+
+        polledPath.value() = mtime.value();
+    }
+
+    scheduleFlush();
+}
+
+/*!
+ * \brief Provides the modification times of a set of directories.
+ * \param paths = The paths of the directories
+ * \return A QHash with the modification time of every directory in milliseconds since the epoch, which is 0 for a
+ * directory that does not exist
+ * \note This function is meant to be run with QtConcurrent::run().
+ */
+QHash<QString, qint64> DirectoryWatcher::lastModified(const QStringList &paths)
+{
+    QHash<QString, qint64> mtimes;
+    mtimes.reserve(paths.count());
+
+    for (const QString &path : paths) {
+        mtimes.insert(path, DirectoryReader::directoryMtime(path));
+    }
+
+    return mtimes;
+}
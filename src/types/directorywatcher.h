@@ -0,0 +1,81 @@
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#if defined (Q_OS_LINUX)
+class QSocketNotifier;
+#else
+#include <QFileSystemWatcher>
+#endif
+
+/*!
+ * \brief The watcher that reports changes to the directories held by the DirectoryCache.
+ *
+ * On Linux the directories are watched with inotify directly. The names of the entries that change are collected per
+ * directory and reported together at most once every CoalesceInterval milliseconds, so a directory receiving thousands
+ * of changes per second is only updated a few times per second. When the inotify queue overflows, every watched
+ * directory is scanned again, and directories that can not be watched because the watch limit has been reached are
+ * scanned periodically instead. Other platforms fall back to QFileSystemWatcher and always scan the whole directory.
+ * A directory that is deleted or moved away loses its watch, and is watched again once it is added again.
+ * \note The watcher may only be used from the GUI thread. The unwatched directories are stat'ed by a worker.
+ */
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DirectoryWatcher *instance();
+    void addPath(const QString &path);
+    void removePath(const QString &path);
+    bool isWatching(const QString &path) const;
+    bool reportsModifications(const QString &path) const;
+
+signals:
+    void directoryChanged(const QString &path, const QSet<QByteArray> &names);  ///< Emitted with the names of the entries that changed in a directory.
+    void rescanNeeded(const QString &path); ///< Emitted when the changes to a directory are not known and it needs to be read again.
+
+private:
+    static const int CoalesceInterval = 250;    ///< The minimum time in milliseconds between two reports.
+    static const int PollInterval = 5000;       ///< The time in milliseconds between two checks of the unwatched directories.
+    static const qint64 UnknownMtime = -1;      ///< The modification time of an unwatched directory that has not been stat'ed yet.
+
+    QHash<QString, int> watchCounts;            ///< The amount of times each directory has been added.
+    QHash<QString, qint64> polledPaths;         ///< The directories that are checked periodically, with their last modification time.
+    QHash<QString, QSet<QByteArray>> pendingChanges;    ///< The names that have changed since the last report, keyed by directory.
+    QSet<QString> pendingRescans;               ///< The directories that need to be read again since the last report.
+    QTimer flushTimer;                          ///< Reports the pending changes.
+    QTimer pollTimer;                           ///< Checks the unwatched directories.
+    bool polling;                               ///< Whether a worker is checking the unwatched directories.
+#if defined (Q_OS_LINUX)
+    static const int EventBufferSize = 64 * 1024;   ///< The size of the buffer handed to each read of the inotify queue.
+
+    int inotifyFd;                              ///< The inotify instance.
+    QSocketNotifier *eventNotifier;             ///< Signals when inotify events are available.
+    QHash<int, QStringList> watchPaths;         ///< The directories of every watch descriptor.
+    QHash<QString, int> watchDescriptors;       ///< The watch descriptor of every watched directory.
+    QSet<int> droppedDescriptors;               ///< The watch descriptors removed by the watcher whose IN_IGNORED event is still due.
+
+    void readEvents();
+    void forgetWatch(int wd);
+#else
+    QFileSystemWatcher fallbackWatcher;         ///< Watches the directories on other platforms.
+#endif
+
+    explicit DirectoryWatcher(QObject *parent = nullptr);
+    ~DirectoryWatcher();
+    void scheduleFlush();
+    void flushChanges();
+    void pollDirectories();
+    void applyPolledTimes(const QHash<QString, qint64> &mtimes);
+
+    static QHash<QString, qint64> lastModified(const QStringList &paths);
+};
+
+#endif // DIRECTORYWATCHER_H
@@ -0,0 +1,495 @@
+#include "duplicatefinder.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <algorithm>
+
+#if defined (Q_OS_LINUX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+DuplicateFinder::DuplicateFinder(QObject *parent) :
+    QObject(parent),
+    statistics(QSharedPointer<Statistics>::create())
+{
+    statistics->stage.storeRelaxed(Done);
+
+    connect(&watcher, &QFutureWatcher<QVector<DuplicateGroup>>::finished, this, [this]() {
+        if (!watcher.isCanceled() && watcher.future().resultCount() > 0) {
+            foundGroups = watcher.result();
+        }
+
+        statistics->stage.storeRelaxed(Done);
+        emit finished();
+    });
+}
+
+/*!
+ * \brief The destructor
+ * \note A running search is canceled and waited for.
+ */
+DuplicateFinder::~DuplicateFinder()
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+/*!
+ * \brief Starts searching a directory tree for duplicates.
+ * \param rootPath = The root of the tree
+ * \param minSize = The size in bytes below which files are ignored
+ * \note The groups of the previous search are dropped, and a search that is still running is canceled.
+ */
+void DuplicateFinder::start(const QString &rootPath, qint64 minSize)
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+
+    foundGroups.clear();
+    statistics = QSharedPointer<Statistics>::create();
+    watcher.setFuture(QtConcurrent::run(&DuplicateFinder::find, QDir::cleanPath(rootPath), minSize, statistics));
+}
+
+/*!
+ * \brief Cancels the running search.
+ */
+void DuplicateFinder::cancel()
+{
+    watcher.cancel();
+}
+
+/*!
+ * \brief Checks if the search is running.
+ * \return A Boolean value
+ */
+bool DuplicateFinder::isRunning() const
+{
+    return watcher.isRunning();
+}
+
+/*!
+ * \brief Provides the stage of the running search.
+ * \return The Stage, which is Done when no search is running
+ */
+DuplicateFinder::Stage DuplicateFinder::stage() const
+{
+    return static_cast<Stage>(statistics->stage.loadRelaxed());
+}
+
+/*!
+ * \brief Provides the amount of files found in the tree.
+ * \return An integer
+ */
+int DuplicateFinder::scannedFileCount() const
+{
+    return statistics->scannedFiles.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of bytes hashed in the current stage.
+ * \return A qint64
+ */
+qint64 DuplicateFinder::hashedBytes() const
+{
+    return statistics->hashedBytes.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of bytes to hash in the current stage.
+ * \return A qint64
+ */
+qint64 DuplicateFinder::totalHashBytes() const
+{
+    return statistics->totalBytes.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the duplicates found by the last search that has finished.
+ * \return A QVector of DuplicateGroup, sorted by the space the duplicates use
+ */
+QVector<DuplicateGroup> DuplicateFinder::groups() const
+{
+    return foundGroups;
+}
+
+/*!
+ * \brief Searches a directory tree for duplicates.
+ * \param promise = The promise to which the groups are reported
+ * \param rootPath = The clean path of the root
+ * \param minSize = The size in bytes below which files are ignored
+ * \param stats = The counters of the search
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ */
+void DuplicateFinder::find(QPromise<QVector<DuplicateGroup>> &promise, const QString &rootPath, qint64 minSize,
+                           const QSharedPointer<Statistics> &stats)
+{
+    QThreadPool hashPool;
+    hashPool.setMaxThreadCount(HashThreads);
+
+    const QVector<Candidate> files(scanTree(promise, rootPath, minSize, stats));
+
+    if (promise.isCanceled()) {
+        return;
+    }
+
+    // Only the files that share their size with another file can have a duplicate.
+    QHash<qint64, QVector<Candidate>> sizeBuckets;
+    QVector<Candidate> candidates;
+    qint64 edgeBytes(0);
+
+    for (const Candidate &file : files) {
+        sizeBuckets[file.size].append(file);
+    }
+
+    for (const QVector<Candidate> &bucket : qAsConst(sizeBuckets)) {
+        if (bucket.count() > 1) {
+            candidates += bucket;
+        }
+    }
+
+    for (const Candidate &candidate : qAsConst(candidates)) {
+        edgeBytes += qMin(candidate.size, 2 * EdgeSize);
+    }
+
+    stats->totalBytes.storeRelaxed(edgeBytes);
+    stats->stage.storeRelaxed(HashingEdges);
+
+    QtConcurrent::blockingMap(&hashPool, candidates, [&promise, &stats](Candidate &candidate) {
+        if (!promise.isCanceled()) {
+            hashEdges(candidate, stats);
+        }
+    });
+
+    if (promise.isCanceled()) {
+        return;
+    }
+
+    // The edges of small files cover their whole contents, so only larger files are read completely.
+    QVector<QVector<Candidate>> duplicates;
+    QVector<Candidate> fileCandidates;
+    qint64 fileBytes(0);
+    const QVector<QVector<Candidate>> edgeGroups(groupByHash(candidates));
+
+    for (const QVector<Candidate> &edgeGroup : edgeGroups) {
+        if (edgeGroup.first().size <= 2 * EdgeSize) {
+            duplicates.append(edgeGroup);
+        } else {
+            fileCandidates += edgeGroup;
+            fileBytes += edgeGroup.first().size * edgeGroup.count();
+        }
+    }
+
+    stats->hashedBytes.storeRelaxed(0);
+    stats->totalBytes.storeRelaxed(fileBytes);
+    stats->stage.storeRelaxed(HashingFiles);
+
+    QtConcurrent::blockingMap(&hashPool, fileCandidates, [&promise, &stats](Candidate &candidate) {
+        if (!promise.isCanceled()) {
+            hashFile(promise, candidate, stats);
+        }
+    });
+
+    if (promise.isCanceled()) {
+        return;
+    }
+
+    duplicates += groupByHash(fileCandidates);
+
+    QVector<DuplicateGroup> duplicateGroups;
+    duplicateGroups.reserve(duplicates.count());
+
+    for (const QVector<Candidate> &duplicate : qAsConst(duplicates)) {
+        DuplicateGroup group{duplicate.first().size, QStringList()};
+
+        for (const Candidate &candidate : duplicate) {
+            group.paths.append(candidate.path);
+        }
+
+        group.paths.sort();
+        duplicateGroups.append(group);
+    }
+
+    std::sort(duplicateGroups.begin(), duplicateGroups.end(), [](const DuplicateGroup &first, const DuplicateGroup &second) {
+        return first.size * (first.paths.count() - 1) > second.size * (second.paths.count() - 1);
+    });
+
+    promise.addResult(duplicateGroups);
+}
+
+/*!
+ * \brief Finds the files in a directory tree that may have duplicates.
+ * \param promise = The promise of the search, which is checked for cancellation
+ * \param rootPath = The clean path of the root
+ * \param minSize = The size in bytes below which files are ignored
+ * \param stats = The counters of the search
+ * \return A QVector of Candidate with every regular file that is not empty, once per inode
+ * \note This contains preprocessor directives for detecting the OS at compile time. Other platforms can not tell hard
+ * links apart, and report them as duplicates.
+ */
+QVector<DuplicateFinder::Candidate> DuplicateFinder::scanTree(QPromise<QVector<DuplicateGroup>> &promise, const QString &rootPath,
+                                                              qint64 minSize, const QSharedPointer<Statistics> &stats)
+{
+    QVector<Candidate> files;
+    const qint64 sizeLimit(qMax<qint64>(minSize, 1));
+
+#if defined (Q_OS_LINUX)
+    QSet<QPair<quint64, quint64>> seenInodes;
+    QStringList dirStack({rootPath});
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+
+    while (!dirStack.isEmpty() && !promise.isCanceled()) {
+        const QString dirPath(dirStack.takeLast());
+        const QString pathPrefix(dirPath.endsWith('/') ? dirPath : dirPath + '/');
+        const int dirFd(::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+        if (dirFd < 0) {
+            continue;
+        }
+
+        forever {
+            const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+            if (bytesRead <= 0) {
+                break;
+            }
+
+            for (long pos(0); pos < bytesRead;) {
+                const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+                pos += dirEntry->d_reclen;
+
+                const char *name(dirEntry->d_name);
+                struct statx entryStat;
+
+                if ((name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                        || dirEntry->d_type == DT_LNK
+                        || statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE | STATX_INO | STATX_NLINK, &entryStat) != 0) {
+                    continue;
+                }
+
+                if (S_ISDIR(entryStat.stx_mode)) {
+                    dirStack.append(pathPrefix + QFile::decodeName(name));
+                    continue;
+                }
+
+                if (!S_ISREG(entryStat.stx_mode) || static_cast<qint64>(entryStat.stx_size) < sizeLimit) {
+                    continue;
+                }
+
+                // A hard link shares its contents with the first path found for its inode, and removing it frees nothing.
+                const quint64 device((static_cast<quint64>(entryStat.stx_dev_major) << 32) | entryStat.stx_dev_minor);
+
+                if (entryStat.stx_nlink > 1) {
+                    const QPair<quint64, quint64> inode(device, entryStat.stx_ino);
+
+                    if (seenInodes.contains(inode)) {
+                        continue;
+                    }
+
+                    seenInodes.insert(inode);
+                }
+
+                files.append(Candidate{pathPrefix + QFile::decodeName(name), static_cast<qint64>(entryStat.stx_size)});
+                stats->scannedFiles.fetchAndAddRelaxed(1);
+            }
+        }
+
+        ::close(dirFd);
+    }
+#else
+    QDirIterator it(rootPath, QDir::Files | QDir::Hidden | QDir::System | QDir::NoSymLinks, QDirIterator::Subdirectories);
+
+    while (it.hasNext() && !promise.isCanceled()) {
+        it.next();
+
+        const QFileInfo info(it.fileInfo());
+
+        if (info.size() >= sizeLimit) {
+            files.append(Candidate{info.filePath(), info.size()});
+            stats->scannedFiles.fetchAndAddRelaxed(1);
+        }
+    }
+#endif
+
+    return files;
+}
+
+/*!
+ * \brief Groups files by their size and their hash.
+ * \param candidates = The files, of which those that could not be read are left out
+ * \return A QVector with every group of at least two files
+ */
+QVector<QVector<DuplicateFinder::Candidate>> DuplicateFinder::groupByHash(const QVector<Candidate> &candidates)
+{
+    QHash<QPair<qint64, quint64>, QVector<Candidate>> hashBuckets;
+    QVector<QVector<Candidate>> hashGroups;
+
+    for (const Candidate &candidate : candidates) {
+        if (candidate.readable) {
+            hashBuckets[qMakePair(candidate.size, candidate.hash)].append(candidate);
+        }
+    }
+
+    for (const QVector<Candidate> &bucket : qAsConst(hashBuckets)) {
+        if (bucket.count() > 1) {
+            hashGroups.append(bucket);
+        }
+    }
+
+    return hashGroups;
+}
+
+/*!
+ * \brief Hashes the first and the last EdgeSize bytes of a file, or the whole file if it is not larger than both.
+ * \param candidate = The file, which receives the hash or is marked as unreadable
+ * \param stats = The counters of the search
+ */
+void DuplicateFinder::hashEdges(Candidate &candidate, const QSharedPointer<Statistics> &stats)
+{
+    QFile file(candidate.path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        candidate.readable = false;
+        return;
+    }
+
+    const qint64 edgeLength(qMin(candidate.size, 2 * EdgeSize));
+    QByteArray edges(edgeLength, Qt::Uninitialized);
+    qint64 bytesRead;
+
+    if (candidate.size <= 2 * EdgeSize) {
+        bytesRead = file.read(edges.data(), edgeLength);
+    } else {
+        bytesRead = file.read(edges.data(), EdgeSize);
+
+        if (bytesRead == EdgeSize && file.seek(candidate.size - EdgeSize)) {
+            bytesRead += file.read(edges.data() + EdgeSize, EdgeSize);
+        }
+    }
+
+    // A file whose size has changed since the tree was walked is left out.
+    candidate.readable = (bytesRead == edgeLength);
+    candidate.hash = hash64(edges.constData(), edgeLength, 0);
+    stats->hashedBytes.fetchAndAddRelaxed(edgeLength);
+}
+
+/*!
+ * \brief Hashes the whole contents of a file.
+ * \param promise = The promise of the search, which is checked for cancellation
+ * \param candidate = The file, which receives the hash or is marked as unreadable
+ * \param stats = The counters of the search
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note The file is read in sequential chunks of HashBufferSize instead of being mapped into memory, for the same reason
+ * as in PreviewDocument. Every chunk is hashed with the hash of the previous chunk as seed.
+ */
+void DuplicateFinder::hashFile(QPromise<QVector<DuplicateGroup>> &promise, Candidate &candidate, const QSharedPointer<Statistics> &stats)
+{
+    QFile file(candidate.path);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        candidate.readable = false;
+        return;
+    }
+
+#if defined (Q_OS_LINUX)
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    QByteArray buffer(HashBufferSize, Qt::Uninitialized);
+    quint64 hash(0);
+    qint64 totalRead(0);
+
+    forever {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const qint64 bytesRead(file.read(buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            candidate.readable = (bytesRead == 0 && totalRead == candidate.size);
+            break;
+        }
+
+        hash = hash64(buffer.constData(), bytesRead, hash);
+        totalRead += bytesRead;
+        stats->hashedBytes.fetchAndAddRelaxed(bytesRead);
+    }
+
+    candidate.hash = hash;
+}
+
+/*!
+ * \brief Computes the 64-bit xxHash of a block of data.
+ * \param data = The data
+ * \param length = The length of the data in bytes
+ * \param seed = The seed of the hash
+ * \return A quint64
+ */
+quint64 DuplicateFinder::hash64(const char *data, qint64 length, quint64 seed)
+{
+    const quint64 prime1(11400714785074694791ULL), prime2(14029467366897019727ULL), prime3(1609587929392839161ULL);
+    const quint64 prime4(9650029242287828579ULL), prime5(2870177450012600261ULL);
+    const auto rotate([](quint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); });
+    const auto round([&](quint64 accumulator, quint64 input) { return rotate(accumulator + input * prime2, 31) * prime1; });
+    const char *end(data + length);
+    quint64 hash;
+
+    if (length >= 32) {
+        quint64 lanes[4] = {seed + prime1 + prime2, seed + prime2, seed, seed - prime1};
+
+        for (; data + 32 <= end; data += 32) {
+            for (int lane(0); lane < 4; ++lane) {
+                lanes[lane] = round(lanes[lane], qFromLittleEndian<quint64>(data + lane * 8));
+            }
+        }
+
+        hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) + rotate(lanes[2], 12) + rotate(lanes[3], 18);
+
+        for (quint64 lane : lanes) {
+            hash = (hash ^ round(0, lane)) * prime1 + prime4;
+        }
+    } else {
+        hash = seed + prime5;
+    }
+
+    hash += static_cast<quint64>(length);
+
+    for (; data + 8 <= end; data += 8) {
+        hash = rotate(hash ^ round(0, qFromLittleEndian<quint64>(data)), 27) * prime1 + prime4;
+    }
+
+    if (data + 4 <= end) {
+        hash = rotate(hash ^ (qFromLittleEndian<quint32>(data) * prime1), 23) * prime2 + prime3;
+        data += 4;
+    }
+
+    for (; data < end; ++data) {
+        hash = rotate(hash ^ (static_cast<uchar>(*data) * prime5), 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
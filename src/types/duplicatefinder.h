@@ -0,0 +1,104 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief A set of files with the same contents.
+ */
+struct DuplicateGroup
+{
+    qint64 size;            ///< The size of every file in bytes.
+    QStringList paths;      ///< The paths of the files, sorted.
+};
+
+/*!
+ * \brief A search for files with the same contents in a directory tree, performed on worker threads.
+ *
+ * The search narrows the candidates down in stages, so most files are never read. The tree is walked first and the
+ * files are bucketed by size, since files of different sizes can not be the same. The files that share their size with
+ * another file then have their first and last EdgeSize bytes hashed, which tells most files of the same size apart with
+ * two small reads. Only the files whose edges match those of another file are hashed completely, in large sequential
+ * reads. Both hashing stages run on a pool of threads.
+ *
+ * Hard links to the same inode are only counted once, since removing them frees no space, and symbolic links and empty
+ * files are ignored. The groups are sorted by the space their duplicates use, largest first.
+ * \note The hashes are 64-bit xxHash values, which are fast but not cryptographic. Files with equal hashes are reported
+ * as duplicates without comparing their bytes.
+ */
+class DuplicateFinder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Stage {
+        Scanning,       ///< 0
+        HashingEdges,   ///< 1
+        HashingFiles,   ///< 2
+        Done            ///< 3
+    };
+
+    explicit DuplicateFinder(QObject *parent = nullptr);
+    ~DuplicateFinder();
+    void start(const QString &rootPath, qint64 minSize);
+    void cancel();
+    bool isRunning() const;
+    Stage stage() const;
+    int scannedFileCount() const;
+    qint64 hashedBytes() const;
+    qint64 totalHashBytes() const;
+    QVector<DuplicateGroup> groups() const;
+
+signals:
+    void finished();    ///< Emitted when the search has finished or has been canceled.
+
+private:
+    static const int HashThreads = 4;               ///< The amount of files hashed at once.
+    static const qint64 EdgeSize = 4096;            ///< The amount of bytes hashed at the start and at the end of a file.
+    static const int HashBufferSize = 1024 * 1024;  ///< The size of the reads with which files are hashed completely.
+
+    /*!
+     * \brief The counters of a running search, which are updated by its workers.
+     */
+    struct Statistics
+    {
+        QAtomicInt stage;                       ///< The Stage of the search.
+        QAtomicInt scannedFiles;                ///< The amount of files that have been found.
+        QAtomicInteger<qint64> hashedBytes;     ///< The amount of bytes hashed in the current stage.
+        QAtomicInteger<qint64> totalBytes;      ///< The amount of bytes to hash in the current stage.
+    };
+
+    /*!
+     * \brief A file that may have duplicates.
+     */
+    struct Candidate
+    {
+        QString path;           ///< The full path of the file.
+        qint64 size;            ///< The size in bytes.
+        quint64 hash = 0;       ///< The hash of the last stage.
+        bool readable = true;   ///< Whether the file could be read in every stage so far.
+    };
+
+    QFutureWatcher<QVector<DuplicateGroup>> watcher;    ///< Watches the running search.
+    QSharedPointer<Statistics> statistics;              ///< The counters of the current search.
+    QVector<DuplicateGroup> foundGroups;                ///< The groups found by the last search that has finished.
+
+    static void find(QPromise<QVector<DuplicateGroup>> &promise, const QString &rootPath, qint64 minSize,
+                     const QSharedPointer<Statistics> &stats);
+    static QVector<Candidate> scanTree(QPromise<QVector<DuplicateGroup>> &promise, const QString &rootPath, qint64 minSize,
+                                       const QSharedPointer<Statistics> &stats);
+    static QVector<QVector<Candidate>> groupByHash(const QVector<Candidate> &candidates);
+    static void hashEdges(Candidate &candidate, const QSharedPointer<Statistics> &stats);
+    static void hashFile(QPromise<QVector<DuplicateGroup>> &promise, Candidate &candidate, const QSharedPointer<Statistics> &stats);
+    static quint64 hash64(const char *data, qint64 length, quint64 seed);
+};
+
+#endif // DUPLICATEFINDER_H
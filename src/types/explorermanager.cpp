@@ -10,7 +10,7 @@
  */
 ExplorerManager::ExplorerManager(QObject *parent) :
     QObject(parent),
-    fileModel(new QFileSystemModel()),
+    fileModel(new DirectoryModel()),
     dirHistoryStack(new QUndoStack())
 {
     fileModel->setRootPath(QDir::homePath());
@@ -40,9 +40,9 @@ ExplorerManager::~ExplorerManager()
 
 /*!
  * \brief Provides a QSharedPointer of the explorer's file model.
- * \return A QSharedPointer of a QFileSystemModel
+ * \return A QSharedPointer of a DirectoryModel
  */
-QSharedPointer<QFileSystemModel> ExplorerManager::getFileSystemModel() const
+QSharedPointer<DirectoryModel> ExplorerManager::getFileSystemModel() const
 {
     return fileModel;
 }
@@ -71,10 +71,19 @@ QModelIndex ExplorerManager::currentPathIndex() const
  */
 void ExplorerManager::setCurrentPath(const QString &newPath)
 {
-    dirHistoryStack->push(new OpenDirCommand(newPath, currentPath(), fileModel));
+    dirHistoryStack->push(new OpenDirCommand(newPath, currentPath(), fileModel, fileView));
     emit pathChanged();
 }
 
+/*!
+ * \brief Sets the view showing the fileModel.
+ * \param view = The view, whose scroll position and selection are restored when going back and forward
+ */
+void ExplorerManager::setView(QAbstractItemView *view)
+{
+    fileView = view;
+}
+
 /*!
  * \brief This function will undo the last setCurrentPath() call.
  * \see setCurrentPath()
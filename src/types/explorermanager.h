@@ -1,7 +1,10 @@
 #ifndef EXPLORERMANAGER_H
 #define EXPLORERMANAGER_H
 
-#include <QFileSystemModel>
+#include "directorymodel.h"
+
+#include <QAbstractItemView>
+#include <QPointer>
 #include <QSharedPointer>
 #include <QObject>
 #include <QUndoStack>
@@ -16,10 +19,11 @@ class ExplorerManager : public QObject
 public:
     explicit ExplorerManager(QObject *parent = nullptr);
     ~ExplorerManager();
-    QSharedPointer<QFileSystemModel> getFileSystemModel() const;
+    QSharedPointer<DirectoryModel> getFileSystemModel() const;
     QString currentPath() const;
     QModelIndex currentPathIndex() const;
     void setCurrentPath(const QString &newPath);
+    void setView(QAbstractItemView *view);
     void undoPath() const;
     void redoPath() const;
     bool canUndoPath() const;
@@ -29,8 +33,9 @@ signals:
     void pathChanged(); ///< Emitted when the directory path is changed.
 
 private:
-    QSharedPointer<QFileSystemModel> fileModel;     ///< The explorer's file model.
+    QSharedPointer<DirectoryModel> fileModel;     ///< The explorer's file model.
     QSharedPointer<QUndoStack> dirHistoryStack;     ///< The explorer's directory access history.
+    QPointer<QAbstractItemView> fileView;   ///< The view showing the explorer's file model, whose state is kept in the history.
     QAction *undoPathAction;    ///< Triggers the explorer to undo its last path change.
     QAction *redoPathAction;    ///< Triggers the explorer to redo its previously undone path change.
 };
@@ -0,0 +1,571 @@
+#include "fileindex.h"
+#include "directoryentries.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined (Q_OS_LINUX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char IndexMagic[8] = {'X', 'P', 'L', 'R', 'I', 'D', 'X', '\0'};   ///< The magic bytes of an index file.
+
+/*!
+ * \brief An entry found while an index is built.
+ */
+struct BuildEntry
+{
+    QByteArray name;    ///< The encoded name.
+    quint8 type;        ///< The DirectoryEntries::EntryType.
+    bool descend;       ///< Whether the entry is a directory on the same file system that is indexed as well.
+    qint64 mtime;       ///< The modification time of a directory in nanoseconds since the epoch.
+};
+
+#if defined (Q_OS_LINUX)
+/*!
+ * \brief Provides the modification time of a statx result.
+ * \param stx = The statx result
+ * \return The modification time in nanoseconds since the epoch
+ */
+static qint64 statxMtime(const struct statx &stx)
+{
+    return static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+}
+
+/*!
+ * \brief Checks if a directory can be descended into while an index is built.
+ * \param dirFd = The file descriptor of the parent directory
+ * \param name = The name of the directory
+ * \param rootStat = The statx result of the root of the index
+ * \param mtime = Set to the modification time of the directory
+ * \return A Boolean value that is false for mount points, which belong to the index of their own drive
+ */
+static bool canDescend(int dirFd, const char *name, const struct statx &rootStat, qint64 &mtime)
+{
+    struct statx stx;
+
+    if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_MTIME, &stx) != 0 || !S_ISDIR(stx.stx_mode)) {
+        return false;
+    }
+
+    mtime = statxMtime(stx);
+    return stx.stx_dev_major == rootStat.stx_dev_major && stx.stx_dev_minor == rootStat.stx_dev_minor;
+}
+#endif
+
+/*!
+ * \brief Checks that a section of an index file lies within the file.
+ * \param offset = The offset of the section
+ * \param count = The amount of elements in the section
+ * \param elementSize = The size of an element
+ * \param fileSize = The size of the file
+ * \return A Boolean value that is true if the section ends within the file
+ * \note The check is written so it can not overflow, whatever values a damaged header holds.
+ */
+static bool fitsInFile(quint64 offset, quint64 count, quint64 elementSize, quint64 fileSize)
+{
+    return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+/*!
+ * \brief The constructor
+ * \param indexPath = The path of the index file
+ */
+FileIndex::FileIndex(const QString &indexPath) :
+    file(indexPath),
+    header(nullptr),
+    dirs(nullptr),
+    nameOffsets(nullptr),
+    nameLengths(nullptr),
+    entryDirs(nullptr),
+    types(nullptr),
+    names(nullptr)
+{
+}
+
+/*!
+ * \brief The destructor
+ */
+FileIndex::~FileIndex()
+{
+    file.close();
+}
+
+/*!
+ * \brief Maps an index file.
+ * \param indexPath = The path of the index file
+ * \return A QSharedPointer to the FileIndex, which is null if the file does not exist or is not a valid index
+ */
+QSharedPointer<FileIndex> FileIndex::open(const QString &indexPath)
+{
+    QSharedPointer<FileIndex> index(new FileIndex(indexPath));
+
+    if (!index->file.open(QIODevice::ReadOnly) || index->file.size() < static_cast<qint64>(sizeof(Header))) {
+        return QSharedPointer<FileIndex>();
+    }
+
+    const quint64 fileSize(static_cast<quint64>(index->file.size()));
+    const uchar *data(index->file.map(0, index->file.size()));
+
+    if (data == nullptr) {
+        return QSharedPointer<FileIndex>();
+    }
+
+    const Header *header(reinterpret_cast<const Header *>(data));
+
+    if (memcmp(header->magic, IndexMagic, sizeof(IndexMagic)) != 0 || header->version != Version || header->dirCount == 0
+            || !fitsInFile(header->rootOffset, header->rootLength, 1, fileSize)
+            || !fitsInFile(header->dirsOffset, header->dirCount, sizeof(Dir), fileSize)
+            || !fitsInFile(header->nameOffsetsOffset, header->entryCount, sizeof(quint32), fileSize)
+            || !fitsInFile(header->nameLengthsOffset, header->entryCount, sizeof(quint16), fileSize)
+            || !fitsInFile(header->entryDirsOffset, header->entryCount, sizeof(quint32), fileSize)
+            || !fitsInFile(header->typesOffset, header->entryCount, 1, fileSize)
+            || !fitsInFile(header->namesOffset, header->namesSize, 1, fileSize)) {
+        return QSharedPointer<FileIndex>();
+    }
+
+    index->header = header;
+    index->dirs = reinterpret_cast<const Dir *>(data + header->dirsOffset);
+    index->nameOffsets = reinterpret_cast<const quint32 *>(data + header->nameOffsetsOffset);
+    index->nameLengths = reinterpret_cast<const quint16 *>(data + header->nameLengthsOffset);
+    index->entryDirs = reinterpret_cast<const quint32 *>(data + header->entryDirsOffset);
+    index->types = data + header->typesOffset;
+    index->names = reinterpret_cast<const char *>(data + header->namesOffset);
+
+    if (!index->hasValidNames() || !index->hasValidDirs()) {
+        return QSharedPointer<FileIndex>();
+    }
+
+    return index;
+}
+
+/*!
+ * \brief Checks that the names of a mapped index lie within its name arena.
+ * \return A boolean value that is true if every name ends within the arena
+ * \note Every name is checked, since a damaged file may hold them in any order.
+ */
+bool FileIndex::hasValidNames() const
+{
+    for (quint32 entry(0); entry < header->entryCount; ++entry) {
+        if (nameOffsets[entry] > header->namesSize || nameLengths[entry] > header->namesSize - nameOffsets[entry]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Checks that the directory records of a mapped index refer to each other and to the entries consistently.
+ * \return A boolean value that is true if the entries of every directory lie within the entries, the root has no parent
+ * and every other directory comes after its parent and is one of the entries of its parent
+ * \note A parent always has a lower number than its children, so walking up from a directory ends at the root.
+ */
+bool FileIndex::hasValidDirs() const
+{
+    if (dirs[0].parent != NoIndex || dirs[0].entry != NoIndex) {
+        return false;
+    }
+
+    for (quint32 dir(0); dir < header->dirCount; ++dir) {
+        const Dir &current(dirs[dir]);
+
+        if (static_cast<quint64>(current.firstEntry) + current.entryCount > header->entryCount) {
+            return false;
+        }
+
+        if (dir == 0) {
+            continue;
+        }
+
+        if (current.parent >= dir) {
+            return false;
+        }
+
+        const Dir &parent(dirs[current.parent]);
+
+        if (current.entry < parent.firstEntry || current.entry - parent.firstEntry >= parent.entryCount) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Builds the index of a directory and writes it to a file.
+ * \param promise = The promise to which the success of the build is reported
+ * \param rootPath = The clean path of the directory
+ * \param indexPath = The path of the index file, which is replaced atomically
+ * \param previous = The previous index of the directory, which may be null
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * The tree is walked breadth first and only the directories of the same file system are indexed. A directory whose
+ * modification time matches the previous index has not gained, lost or renamed any entries, so its entries are copied
+ * from the previous index instead of being read again. Only its subdirectories are stat'ed.
+ */
+void FileIndex::build(QPromise<bool> &promise, const QString &rootPath, const QString &indexPath, const QSharedPointer<FileIndex> &previous)
+{
+    QVector<Dir> newDirs;
+    QVector<QByteArray> newDirPaths;
+    QByteArray newNames;
+    QVector<quint32> newNameOffsets;
+    QVector<quint16> newNameLengths;
+    QVector<quint32> newEntryDirs;
+    QVector<quint8> newTypes;
+    const QByteArray encodedRoot(QFile::encodeName(rootPath));
+
+#if defined (Q_OS_LINUX)
+    struct statx rootStat;
+
+    if (statx(AT_FDCWD, encodedRoot.constData(), AT_NO_AUTOMOUNT, STATX_TYPE | STATX_MTIME, &rootStat) != 0 || !S_ISDIR(rootStat.stx_mode)) {
+        promise.addResult(false);
+        return;
+    }
+
+    newDirs.append(Dir{NoIndex, NoIndex, 0, 0, statxMtime(rootStat)});
+    QByteArray buffer(256 * 1024, Qt::Uninitialized);
+#else
+    const QFileInfo rootInfo(rootPath);
+
+    if (!rootInfo.isDir()) {
+        promise.addResult(false);
+        return;
+    }
+
+    newDirs.append(Dir{NoIndex, NoIndex, 0, 0, rootInfo.lastModified().toMSecsSinceEpoch() * 1000000});
+#endif
+    newDirPaths.append(encodedRoot);
+
+    for (int dir(0); dir < newDirs.count(); ++dir) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const QByteArray dirPath(newDirPaths.at(dir));
+        const QByteArray pathPrefix(dirPath.endsWith('/') ? dirPath : dirPath + '/');
+        const int previousDir(previous.isNull() ? -1 : previous->findDir(QFile::decodeName(dirPath)));
+        QVector<BuildEntry> found;
+
+#if defined (Q_OS_LINUX)
+        const int dirFd(::open(dirPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW));
+
+        if (dirFd < 0) {
+            continue;
+        }
+
+        if (previousDir >= 0 && previous->dirs[previousDir].mtime == newDirs.at(dir).mtime) {
+            const Dir &oldDir(previous->dirs[previousDir]);
+
+            for (quint32 entry(oldDir.firstEntry); entry < oldDir.firstEntry + oldDir.entryCount; ++entry) {
+                BuildEntry buildEntry{previous->entryName(entry), previous->types[entry], false, 0};
+
+                if (buildEntry.type == DirectoryEntries::DirEntry) {
+                    buildEntry.descend = canDescend(dirFd, buildEntry.name.constData(), rootStat, buildEntry.mtime);
+                }
+
+                found.append(buildEntry);
+            }
+        } else {
+            forever {
+                const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+                if (bytesRead <= 0) {
+                    break;
+                }
+
+                for (long pos(0); pos < bytesRead;) {
+                    const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+                    pos += dirEntry->d_reclen;
+
+                    const char *name(dirEntry->d_name);
+
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                        continue;
+                    }
+
+                    BuildEntry buildEntry{QByteArray(name), DirectoryEntries::OtherEntry, false, 0};
+
+                    if (dirEntry->d_type == DT_REG) {
+                        buildEntry.type = DirectoryEntries::FileEntry;
+                    } else {
+                        if (dirEntry->d_type == DT_DIR || dirEntry->d_type == DT_UNKNOWN) {
+                            buildEntry.descend = canDescend(dirFd, name, rootStat, buildEntry.mtime);
+
+                            if (dirEntry->d_type == DT_DIR || buildEntry.mtime != 0) {
+                                buildEntry.type = DirectoryEntries::DirEntry;
+                            }
+                        }
+                    }
+
+                    found.append(buildEntry);
+                }
+            }
+        }
+
+        ::close(dirFd);
+#else
+        const QFileInfoList infos(QDir(QFile::decodeName(dirPath)).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System));
+
+        for (const QFileInfo &info : infos) {
+            BuildEntry buildEntry{QFile::encodeName(info.fileName()), DirectoryEntries::OtherEntry, false, 0};
+
+            if (info.isDir()) {
+                buildEntry.type = DirectoryEntries::DirEntry;
+                buildEntry.descend = !info.isSymLink();
+                buildEntry.mtime = info.lastModified().toMSecsSinceEpoch() * 1000000;
+            } else {
+                if (info.isFile()) {
+                    buildEntry.type = DirectoryEntries::FileEntry;
+                }
+            }
+
+            found.append(buildEntry);
+        }
+#endif
+
+        // The entries of a directory are sorted, so a name can be found with a binary search.
+        std::sort(found.begin(), found.end(), [](const BuildEntry &left, const BuildEntry &right) {
+            return left.name < right.name;
+        });
+
+        newDirs[dir].firstEntry = static_cast<quint32>(newNameOffsets.count());
+        newDirs[dir].entryCount = static_cast<quint32>(found.count());
+
+        for (const BuildEntry &buildEntry : qAsConst(found)) {
+            const quint32 entry(static_cast<quint32>(newNameOffsets.count()));
+
+            newNameOffsets.append(static_cast<quint32>(newNames.size()));
+            newNameLengths.append(static_cast<quint16>(buildEntry.name.size()));
+            newEntryDirs.append(static_cast<quint32>(dir));
+            newTypes.append(buildEntry.type);
+            newNames.append(buildEntry.name);
+
+            if (buildEntry.descend) {
+                newDirs.append(Dir{static_cast<quint32>(dir), entry, 0, 0, buildEntry.mtime});
+                newDirPaths.append(pathPrefix + buildEntry.name);
+            }
+        }
+    }
+
+    // Every section starts at a multiple of 8 bytes.
+    const auto align([](quint64 offset) {
+        return (offset + 7) & ~static_cast<quint64>(7);
+    });
+
+    Header newHeader;
+    memcpy(newHeader.magic, IndexMagic, sizeof(IndexMagic));
+    newHeader.version = Version;
+    newHeader.dirCount = static_cast<quint32>(newDirs.count());
+    newHeader.entryCount = static_cast<quint32>(newNameOffsets.count());
+    newHeader.rootLength = static_cast<quint32>(encodedRoot.size());
+    newHeader.buildTime = QDateTime::currentMSecsSinceEpoch();
+    newHeader.rootOffset = sizeof(Header);
+    newHeader.dirsOffset = align(newHeader.rootOffset + newHeader.rootLength);
+    newHeader.nameOffsetsOffset = align(newHeader.dirsOffset + newDirs.count() * sizeof(Dir));
+    newHeader.nameLengthsOffset = align(newHeader.nameOffsetsOffset + newNameOffsets.count() * sizeof(quint32));
+    newHeader.entryDirsOffset = align(newHeader.nameLengthsOffset + newNameLengths.count() * sizeof(quint16));
+    newHeader.typesOffset = align(newHeader.entryDirsOffset + newEntryDirs.count() * sizeof(quint32));
+    newHeader.namesOffset = align(newHeader.typesOffset + newTypes.count());
+    newHeader.namesSize = static_cast<quint64>(newNames.size());
+
+    QDir().mkpath(QFileInfo(indexPath).path());
+    QSaveFile indexFile(indexPath);
+
+    if (!indexFile.open(QIODevice::WriteOnly)) {
+        promise.addResult(false);
+        return;
+    }
+
+    const auto writeSection([&indexFile](quint64 offset, const void *data, quint64 size) {
+        indexFile.write(QByteArray(static_cast<int>(offset - static_cast<quint64>(indexFile.pos())), '\0'));
+        indexFile.write(static_cast<const char *>(data), static_cast<qint64>(size));
+    });
+
+    indexFile.write(reinterpret_cast<const char *>(&newHeader), sizeof(Header));
+    writeSection(newHeader.rootOffset, encodedRoot.constData(), newHeader.rootLength);
+    writeSection(newHeader.dirsOffset, newDirs.constData(), newDirs.count() * sizeof(Dir));
+    writeSection(newHeader.nameOffsetsOffset, newNameOffsets.constData(), newNameOffsets.count() * sizeof(quint32));
+    writeSection(newHeader.nameLengthsOffset, newNameLengths.constData(), newNameLengths.count() * sizeof(quint16));
+    writeSection(newHeader.entryDirsOffset, newEntryDirs.constData(), newEntryDirs.count() * sizeof(quint32));
+    writeSection(newHeader.typesOffset, newTypes.constData(), newTypes.count());
+    writeSection(newHeader.namesOffset, newNames.constData(), newHeader.namesSize);
+
+    promise.addResult(!promise.isCanceled() && indexFile.commit());
+}
+
+/*!
+ * \brief Provides the directory that has been indexed.
+ * \return A QString with the clean path
+ */
+QString FileIndex::rootPath() const
+{
+    return QFile::decodeName(QByteArray(reinterpret_cast<const char *>(header) + header->rootOffset, static_cast<int>(header->rootLength)));
+}
+
+/*!
+ * \brief Provides when the index was built.
+ * \return The time in milliseconds since the epoch
+ */
+qint64 FileIndex::buildTime() const
+{
+    return header->buildTime;
+}
+
+/*!
+ * \brief Provides the amount of entries in the index.
+ * \return An integer
+ */
+int FileIndex::entryCount() const
+{
+    return static_cast<int>(header->entryCount);
+}
+
+/*!
+ * \brief Looks up a directory by its path.
+ * \param dirPath = The clean path of the directory
+ * \return The number of the directory, or -1 if it is not in the index
+ */
+int FileIndex::findDir(const QString &dirPath) const
+{
+    const QString root(rootPath());
+
+    if (dirPath == root) {
+        return 0;
+    }
+
+    const QString rootPrefix(root.endsWith('/') ? root : root + '/');
+
+    if (!dirPath.startsWith(rootPrefix)) {
+        return -1;
+    }
+
+    const QStringList components(dirPath.mid(rootPrefix.length()).split('/', Qt::SkipEmptyParts));
+    int dir(0);
+
+    for (const QString &component : components) {
+        dir = childDir(static_cast<quint32>(dir), QFile::encodeName(component));
+
+        if (dir < 0) {
+            return -1;
+        }
+    }
+
+    return dir;
+}
+
+/*!
+ * \brief Finds the entries whose name matches a query.
+ * \param matcher = The NameMatcher of the query
+ * \param limit = The maximum amount of paths that are returned
+ * \param skippedDirs = The directories whose entries are skipped, because they have changed since the index was built
+ * \return A QStringList with the paths of the matching entries, in the order of the index
+ */
+QStringList FileIndex::locate(const NameMatcher &matcher, int limit, const QSet<int> &skippedDirs) const
+{
+    QStringList paths;
+
+    if (matcher.isEmpty() || header->entryCount == 0) {
+        return paths;
+    }
+
+    QVector<bool> matches(static_cast<int>(header->entryCount), false);
+    matcher.matchArena(names, nameOffsets, nameLengths, static_cast<int>(header->entryCount), matches.data());
+
+    for (quint32 entry(0); entry < header->entryCount && paths.count() < limit; ++entry) {
+        // The directories of the entries are not checked when the index is opened, so they are checked here.
+        if (!matches.at(static_cast<int>(entry)) || entryDirs[entry] >= header->dirCount || skippedDirs.contains(static_cast<int>(entryDirs[entry]))) {
+            continue;
+        }
+
+        const QByteArray parentPath(dirPath(entryDirs[entry]));
+        paths.append(QFile::decodeName((parentPath.endsWith('/') ? parentPath : parentPath + '/') + entryName(entry)));
+    }
+
+    return paths;
+}
+
+/*!
+ * \brief Provides the name of an entry.
+ * \param entry = The number of the entry
+ * \return A QByteArray with the encoded name
+ */
+QByteArray FileIndex::entryName(quint32 entry) const
+{
+    return QByteArray(names + nameOffsets[entry], nameLengths[entry]);
+}
+
+/*!
+ * \brief Provides the path of a directory.
+ * \param dir = The number of the directory
+ * \return A QByteArray with the encoded path
+ */
+QByteArray FileIndex::dirPath(quint32 dir) const
+{
+    QList<QByteArray> components;
+
+    while (dirs[dir].parent != NoIndex) {
+        components.prepend(entryName(dirs[dir].entry));
+        dir = dirs[dir].parent;
+    }
+
+    QByteArray path(reinterpret_cast<const char *>(header) + header->rootOffset, static_cast<int>(header->rootLength));
+
+    for (const QByteArray &component : qAsConst(components)) {
+        if (!path.endsWith('/')) {
+            path += '/';
+        }
+        path += component;
+    }
+
+    return path;
+}
+
+/*!
+ * \brief Looks up a subdirectory.
+ * \param dir = The number of the parent directory
+ * \param name = The encoded name of the subdirectory
+ * \return The number of the subdirectory, or -1 if it is not in the index
+ *
+ * The entries of every directory are sorted by name, and the directories are numbered in the order of their entries,
+ * so both lookups are binary searches.
+ */
+int FileIndex::childDir(quint32 dir, const QByteArray &name) const
+{
+    quint32 low(dirs[dir].firstEntry), high(dirs[dir].firstEntry + dirs[dir].entryCount);
+
+    while (low < high) {
+        const quint32 middle(low + (high - low) / 2);
+
+        if (entryName(middle) < name) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == dirs[dir].firstEntry + dirs[dir].entryCount || types[low] != DirectoryEntries::DirEntry || entryName(low) != name) {
+        return -1;
+    }
+
+    const Dir *firstDir(dirs + 1), *lastDir(dirs + header->dirCount);
+    const Dir *childDir(std::lower_bound(firstDir, lastDir, low, [](const Dir &candidate, quint32 entry) {
+        return candidate.entry < entry;
+    }));
+
+    if (childDir == lastDir || childDir->entry != low) {
+        return -1;
+    }
+
+    return static_cast<int>(childDir - dirs);
+}
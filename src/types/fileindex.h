@@ -0,0 +1,94 @@
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include "namematcher.h"
+
+#include <QFile>
+#include <QPromise>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief A read-only index of all the names below a directory, stored in a file that is memory-mapped as it is.
+ *
+ * The index is a tree of directories in which every directory refers to its parent, so a path is stored once per
+ * directory instead of once per entry. The entries are stored as a struct of arrays. Their names follow each other in
+ * a single arena in the same layout as DirectoryEntries, so the NameMatcher scans the mapped arena directly. Directories
+ * are numbered breadth first, so the directories are ordered like their entries and a path is looked up with one
+ * binary search per component.
+ *
+ * Opening an index maps the file and checks the bounds of its sections, names and directory records, so a damaged file
+ * can not make a lookup read out of bounds or loop forever. Nothing is parsed or copied, and the name arena is only
+ * loaded by the kernel as the first queries touch it.
+ * \note An index is immutable once built and may be queried from several threads at once.
+ */
+class FileIndex
+{
+public:
+    static QSharedPointer<FileIndex> open(const QString &indexPath);
+    static void build(QPromise<bool> &promise, const QString &rootPath, const QString &indexPath, const QSharedPointer<FileIndex> &previous);
+
+    ~FileIndex();
+    QString rootPath() const;
+    qint64 buildTime() const;
+    int entryCount() const;
+    int findDir(const QString &dirPath) const;
+    QStringList locate(const NameMatcher &matcher, int limit, const QSet<int> &skippedDirs) const;
+
+private:
+    static const quint32 Version = 1;               ///< The version of the file format.
+    static const quint32 NoIndex = 0xFFFFFFFF;      ///< Marks the missing parent or entry of the root directory.
+
+    /*!
+     * \brief The header at the start of an index file.
+     */
+    struct Header
+    {
+        char magic[8];              ///< Always "XPLRIDX" followed by a null byte.
+        quint32 version;            ///< The version of the file format.
+        quint32 dirCount;           ///< The amount of directories.
+        quint32 entryCount;         ///< The amount of entries.
+        quint32 rootLength;         ///< The length of the encoded root path.
+        qint64 buildTime;           ///< When the index was built, in milliseconds since the epoch.
+        quint64 rootOffset;         ///< The offset of the encoded root path.
+        quint64 dirsOffset;         ///< The offset of the Dir records.
+        quint64 nameOffsetsOffset;  ///< The offset of the name offsets of the entries.
+        quint64 nameLengthsOffset;  ///< The offset of the name lengths of the entries.
+        quint64 entryDirsOffset;    ///< The offset of the directory of every entry.
+        quint64 typesOffset;        ///< The offset of the DirectoryEntries::EntryType of every entry.
+        quint64 namesOffset;        ///< The offset of the name arena.
+        quint64 namesSize;          ///< The size of the name arena.
+    };
+
+    /*!
+     * \brief A directory in the index.
+     */
+    struct Dir
+    {
+        quint32 parent;         ///< The parent directory, or NoIndex for the root.
+        quint32 entry;          ///< The entry of the directory in its parent, or NoIndex for the root.
+        quint32 firstEntry;     ///< The first entry of the directory.
+        quint32 entryCount;     ///< The amount of entries in the directory.
+        qint64 mtime;           ///< The modification time of the directory in nanoseconds since the epoch.
+    };
+
+    QFile file;                         ///< The index file, which stays open while it is mapped.
+    const Header *header;               ///< The mapped header.
+    const Dir *dirs;                    ///< The mapped directories.
+    const quint32 *nameOffsets;         ///< The mapped name offsets.
+    const quint16 *nameLengths;         ///< The mapped name lengths.
+    const quint32 *entryDirs;           ///< The mapped directory of every entry.
+    const quint8 *types;                ///< The mapped entry types.
+    const char *names;                  ///< The mapped name arena.
+
+    explicit FileIndex(const QString &indexPath);
+    bool hasValidNames() const;
+    bool hasValidDirs() const;
+    QByteArray entryName(quint32 entry) const;
+    QByteArray dirPath(quint32 dir) const;
+    int childDir(quint32 dir, const QByteArray &name) const;
+};
+
+#endif // FILEINDEX_H
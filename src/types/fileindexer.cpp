@@ -0,0 +1,342 @@
+#include "fileindexer.h"
+#include "directoryreader.h"
+#include "directorywatcher.h"
+#include "namematcher.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ *
+ * The indexes of the drives that were indexed before are opened right away, and the ones that are missing or older
+ * than RebuildInterval are rebuilt.
+ */
+FileIndexer::FileIndexer(QObject *parent) :
+    QObject(parent)
+{
+    rebuildTimer.setInterval(RebuildInterval);
+
+    connect(&rebuildTimer, &QTimer::timeout, this, &FileIndexer::rebuildStale);
+    connect(DirectoryWatcher::instance(), &DirectoryWatcher::directoryChanged, this, [this](const QString &path) {
+        refreshDirectory(path);
+    });
+    connect(DirectoryWatcher::instance(), &DirectoryWatcher::rescanNeeded, this, &FileIndexer::refreshDirectory);
+
+    QSettings settings("Fverco", "Xplorer");
+    const QStringList savedRoots(settings.value("IndexedRoots").toStringList());
+
+    for (const QString &rootPath : savedRoots) {
+        IndexedRoot &root(roots[rootPath]);
+        root.index = FileIndex::open(indexPath(rootPath));
+        root.buildWatcher = nullptr;
+        root.buildStarted = 0;
+    }
+
+    rebuildStale();
+    rebuildTimer.start();
+}
+
+/*!
+ * \brief The destructor
+ * \note The running rebuilds are canceled, and their index files are left as they were.
+ */
+FileIndexer::~FileIndexer()
+{
+    for (IndexedRoot &root : roots) {
+        if (root.buildWatcher != nullptr) {
+            root.buildWatcher->cancel();
+            root.buildWatcher->waitForFinished();
+        }
+    }
+}
+
+/*!
+ * \brief Provides the indexer shared by the whole application.
+ * \return A pointer to the FileIndexer
+ * \note The indexer is bound to the application object and deleted with it.
+ */
+FileIndexer *FileIndexer::instance()
+{
+    static FileIndexer *indexer(new FileIndexer(QCoreApplication::instance()));
+    return indexer;
+}
+
+/*!
+ * \brief Provides the drives that are indexed.
+ * \return A QStringList with the clean paths
+ */
+QStringList FileIndexer::indexedRoots() const
+{
+    return roots.keys();
+}
+
+/*!
+ * \brief Checks if a drive is indexed.
+ * \param rootPath = The clean path of the drive
+ * \return A Boolean value
+ */
+bool FileIndexer::isIndexed(const QString &rootPath) const
+{
+    return roots.contains(rootPath);
+}
+
+/*!
+ * \brief Starts indexing a drive.
+ * \param rootPath = The clean path of the drive
+ * \note The drive is indexed again on every start until it is removed.
+ */
+void FileIndexer::addRoot(const QString &rootPath)
+{
+    if (roots.contains(rootPath)) {
+        return;
+    }
+
+    IndexedRoot &root(roots[rootPath]);
+    root.buildWatcher = nullptr;
+    root.buildStarted = 0;
+
+    saveRoots();
+    rebuild(rootPath);
+}
+
+/*!
+ * \brief Stops indexing a drive and deletes its index.
+ * \param rootPath = The clean path of the drive
+ */
+void FileIndexer::removeRoot(const QString &rootPath)
+{
+    if (!roots.contains(rootPath)) {
+        return;
+    }
+
+    IndexedRoot root(roots.take(rootPath));
+
+    if (root.buildWatcher != nullptr) {
+        root.buildWatcher->disconnect(this);
+        root.buildWatcher->cancel();
+        root.buildWatcher->waitForFinished();
+        root.buildWatcher->deleteLater();
+    }
+
+    root.index.clear();
+    QFile::remove(indexPath(rootPath));
+    saveRoots();
+}
+
+/*!
+ * \brief Finds the entries of all the indexed drives whose name matches a query.
+ * \param query = The query, in the syntax of the NameMatcher
+ * \param limit = The maximum amount of paths that are returned
+ * \return A QStringList with the paths of the matching entries
+ *
+ * The directories in the overlay are matched from their current entries, and their entries in the index are skipped.
+ */
+QStringList FileIndexer::locate(const QString &query, int limit) const
+{
+    const NameMatcher matcher(query);
+    QStringList paths;
+
+    if (matcher.isEmpty()) {
+        return paths;
+    }
+
+    for (auto root(roots.cbegin()); root != roots.cend() && paths.count() < limit; ++root) {
+        QSet<int> skippedDirs;
+
+        for (auto overlayDir(root->overlay.cbegin()); overlayDir != root->overlay.cend() && paths.count() < limit; ++overlayDir) {
+            const DirectoryEntries &entries(overlayDir->entries);
+            const QString pathPrefix(overlayDir.key().endsWith('/') ? overlayDir.key() : overlayDir.key() + '/');
+            QVector<bool> matches;
+            matcher.matchAll(entries, matches);
+
+            for (int entry(0); entry < entries.count() && paths.count() < limit; ++entry) {
+                if (matches.at(entry) && !entries.isDotOrDotDot(entry)) {
+                    paths.append(pathPrefix + entries.name(entry));
+                }
+            }
+
+            if (!root->index.isNull()) {
+                const int dir(root->index->findDir(overlayDir.key()));
+
+                if (dir >= 0) {
+                    skippedDirs.insert(dir);
+                }
+            }
+        }
+
+        if (!root->index.isNull() && paths.count() < limit) {
+            paths += root->index->locate(matcher, limit - paths.count(), skippedDirs);
+        }
+    }
+
+    return paths;
+}
+
+/*!
+ * \brief Stores the indexed drives in the settings.
+ */
+void FileIndexer::saveRoots() const
+{
+    QSettings settings("Fverco", "Xplorer");
+    settings.setValue("IndexedRoots", indexedRoots());
+}
+
+/*!
+ * \brief Starts rebuilding the index of a drive on a worker thread.
+ * \param rootPath = The clean path of the drive
+ * \note Nothing is done while the index of the drive is already being rebuilt.
+ */
+void FileIndexer::rebuild(const QString &rootPath)
+{
+    IndexedRoot &root(roots[rootPath]);
+
+    if (root.buildWatcher != nullptr) {
+        return;
+    }
+
+    root.buildStarted = QDateTime::currentMSecsSinceEpoch();
+    root.buildWatcher = new QFutureWatcher<bool>(this);
+
+    connect(root.buildWatcher, &QFutureWatcher<bool>::finished, this, [this, rootPath]() {
+        buildFinished(rootPath);
+    });
+
+    root.buildWatcher->setFuture(QtConcurrent::run(&FileIndex::build, rootPath, indexPath(rootPath), root.index));
+}
+
+/*!
+ * \brief Rebuilds the indexes that are missing or older than RebuildInterval.
+ */
+void FileIndexer::rebuildStale()
+{
+    const qint64 now(QDateTime::currentMSecsSinceEpoch());
+
+    for (auto root(roots.cbegin()); root != roots.cend(); ++root) {
+        if (root->index.isNull() || now - root->index->buildTime() >= RebuildInterval) {
+            rebuild(root.key());
+        }
+    }
+}
+
+/*!
+ * \brief Opens the new index of a drive once it has been rebuilt.
+ * \param rootPath = The clean path of the drive
+ * \note The directories in the overlay that were read before the rebuild started are dropped, since the new index
+ * holds the same or newer entries.
+ */
+void FileIndexer::buildFinished(const QString &rootPath)
+{
+    if (!roots.contains(rootPath)) {
+        return;
+    }
+
+    IndexedRoot &root(roots[rootPath]);
+    const QFuture<bool> future(root.buildWatcher->future());
+
+    root.buildWatcher->deleteLater();
+    root.buildWatcher = nullptr;
+
+    if (future.resultCount() == 0 || !future.result()) {
+        return;
+    }
+
+    const QSharedPointer<FileIndex> index(FileIndex::open(indexPath(rootPath)));
+
+    if (index.isNull()) {
+        return;
+    }
+
+    root.index = index;
+    root.overlay.removeIf([&root](const QHash<QString, OverlayDir>::iterator overlayDir) {
+        return overlayDir->readTime < root.buildStarted;
+    });
+
+    emit indexUpdated(rootPath);
+}
+
+/*!
+ * \brief Reads a changed directory again and puts it in the overlay of its drive.
+ * \param dirPath = The clean path of the directory
+ * \note The index of the drive is rebuilt once the overlay grows past MaxOverlayDirs directories.
+ */
+void FileIndexer::refreshDirectory(const QString &dirPath)
+{
+    const QString rootPath(rootOf(dirPath));
+
+    if (rootPath.isEmpty()) {
+        return;
+    }
+
+    const qint64 readTime(QDateTime::currentMSecsSinceEpoch());
+    QFutureWatcher<DirectoryEntries> *readWatcher(new QFutureWatcher<DirectoryEntries>(this));
+
+    connect(readWatcher, &QFutureWatcher<DirectoryEntries>::finished, this, [this, readWatcher, rootPath, dirPath, readTime]() {
+        readWatcher->deleteLater();
+
+        if (!roots.contains(rootPath)) {
+            return;
+        }
+
+        IndexedRoot &root(roots[rootPath]);
+        const QList<DirectoryEntries> batches(readWatcher->future().results());
+        OverlayDir &overlayDir(root.overlay[dirPath]);
+
+        // An older read that finishes last does not replace a newer one.
+        if (overlayDir.readTime > readTime) {
+            return;
+        }
+
+        overlayDir.entries.clear();
+        overlayDir.readTime = readTime;
+
+        for (const DirectoryEntries &batch : batches) {
+            overlayDir.entries.append(batch);
+        }
+
+        if (root.overlay.count() > MaxOverlayDirs) {
+            rebuild(rootPath);
+        }
+    });
+
+    readWatcher->setFuture(QtConcurrent::run(&DirectoryReader::readDirectory, dirPath));
+}
+
+/*!
+ * \brief Finds the indexed drive that holds a path.
+ * \param path = The clean path
+ * \return A QString with the path of the drive, which is empty if the path is not indexed
+ * \note The deepest drive wins, so a drive mounted below another one is matched on its own.
+ */
+QString FileIndexer::rootOf(const QString &path) const
+{
+    QString rootPath;
+
+    for (auto root(roots.cbegin()); root != roots.cend(); ++root) {
+        const QString rootPrefix(root.key().endsWith('/') ? root.key() : root.key() + '/');
+
+        if ((path == root.key() || path.startsWith(rootPrefix)) && root.key().length() > rootPath.length()) {
+            rootPath = root.key();
+        }
+    }
+
+    return rootPath;
+}
+
+/*!
+ * \brief Provides the path of the index file of a drive.
+ * \param rootPath = The clean path of the drive
+ * \return A QString with the path in the cache directory
+ */
+QString FileIndexer::indexPath(const QString &rootPath)
+{
+    static const QString dirPath(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Xplorer/index");
+    return dirPath + "/" + QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Md5).toHex() + ".idx";
+}
@@ -0,0 +1,80 @@
+#ifndef FILEINDEXER_H
+#define FILEINDEXER_H
+
+#include "directoryentries.h"
+#include "fileindex.h"
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+/*!
+ * \brief The service that keeps a FileIndex of every indexed drive and answers locate queries across all of them.
+ *
+ * The indexes are built on a worker thread and stored in the cache directory, so they are available instantly on the
+ * next start. Directories that change while Xplorer is running are read again and kept in an overlay, which replaces
+ * their entries in the index until the next rebuild. The indexes are rebuilt incrementally every RebuildInterval
+ * milliseconds, or as soon as the overlay grows past MaxOverlayDirs directories. A rebuild only reads the directories
+ * whose modification time has changed.
+ * \note The service may only be used from the GUI thread.
+ */
+class FileIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FileIndexer *instance();
+    QStringList indexedRoots() const;
+    bool isIndexed(const QString &rootPath) const;
+    void addRoot(const QString &rootPath);
+    void removeRoot(const QString &rootPath);
+    QStringList locate(const QString &query, int limit) const;
+
+signals:
+    void indexUpdated(const QString &rootPath);     ///< Emitted when a new index of a drive has been opened.
+
+private:
+    static const int RebuildInterval = 30 * 60 * 1000;  ///< The time in milliseconds between two rebuilds of an index.
+    static const int MaxOverlayDirs = 256;              ///< The amount of changed directories that triggers a rebuild.
+
+    /*!
+     * \brief A directory that has been read again since its index was built.
+     */
+    struct OverlayDir
+    {
+        DirectoryEntries entries;   ///< The current entries of the directory.
+        qint64 readTime = 0;        ///< When the directory was read, in milliseconds since the epoch.
+    };
+
+    /*!
+     * \brief The state of an indexed drive.
+     */
+    struct IndexedRoot
+    {
+        QSharedPointer<FileIndex> index;            ///< The last index that was built, which may be null.
+        QFutureWatcher<bool> *buildWatcher;         ///< Watches the running rebuild, or is null.
+        qint64 buildStarted;                        ///< When the running rebuild was started, in milliseconds since the epoch.
+        QHash<QString, OverlayDir> overlay;         ///< The directories that have changed, keyed by path.
+    };
+
+    QHash<QString, IndexedRoot> roots;              ///< The indexed drives, keyed by their clean path.
+    QTimer rebuildTimer;                            ///< Rebuilds the indexes periodically.
+
+    explicit FileIndexer(QObject *parent = nullptr);
+    ~FileIndexer();
+    void saveRoots() const;
+    void rebuild(const QString &rootPath);
+    void rebuildStale();
+    void buildFinished(const QString &rootPath);
+    void refreshDirectory(const QString &dirPath);
+    QString rootOf(const QString &path) const;
+
+    static QString indexPath(const QString &rootPath);
+};
+
+#endif // FILEINDEXER_H
@@ -0,0 +1,988 @@
+#include "fileoperation.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \brief Records an error.
+ * \param source = The position of the source path the error belongs to, or -1
+ * \param error = The message
+ * \note This may be called from any thread.
+ */
+void FileOperation::Progress::addError(int source, const QString &error)
+{
+    QMutexLocker locker(&errorMutex);
+    errors.append(error);
+
+    if (source >= 0) {
+        failedSources.insert(source);
+    }
+}
+
+/*!
+ * \brief The constructor
+ * \param mode = Whether the sources are copied, moved, deleted or synchronized
+ * \param sourcePaths = The files and folders to copy, move, delete or synchronize
+ * \param targetDir = The directory into which they are copied or moved, which is ignored by deletions
+ * \param parent = The QObject to which this object is bound
+ * \note The operation does not start until start() is called.
+ */
+FileOperation::FileOperation(Mode mode, const QStringList &sourcePaths, const QString &targetDir, QObject *parent) :
+    QObject(parent),
+    operationMode(mode),
+    sources(sourcePaths),
+    target(QDir::cleanPath(targetDir)),
+    progress(new Progress()),
+    sampledBytes(0),
+    bytesPerSecond(0)
+{
+    progressTimer.setInterval(ProgressInterval);
+
+    connect(&progressTimer, &QTimer::timeout, this, &FileOperation::sampleProgress);
+    connect(&watcher, &QFutureWatcher<void>::finished, this, [this]() {
+        progressTimer.stop();
+        sampleProgress();
+        emit finished();
+    });
+}
+
+/*!
+ * \brief The destructor
+ * \note A running operation is canceled and waited for, so no file is left half written.
+ */
+FileOperation::~FileOperation()
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+/*!
+ * \brief Sets the target path of every source of a synchronization.
+ * \param targetPaths = The paths, in the order of the sources
+ * \note This has to be called before start(), and only applies to SyncMode.
+ */
+void FileOperation::setTargetPaths(const QStringList &targetPaths)
+{
+    targets = targetPaths;
+}
+
+/*!
+ * \brief Starts the operation on a worker thread.
+ */
+void FileOperation::start()
+{
+    if (watcher.isRunning()) {
+        return;
+    }
+
+    sampleTimer.start();
+    progressTimer.start();
+    watcher.setFuture(QtConcurrent::run(&FileOperation::run, operationMode, sources, target, targets, progress));
+}
+
+/*!
+ * \brief Cancels the operation.
+ * \note The files that are being copied are removed again, and the files that have been copied are kept.
+ */
+void FileOperation::cancel()
+{
+    watcher.cancel();
+}
+
+/*!
+ * \brief Checks if the operation is running.
+ * \return A Boolean value
+ */
+bool FileOperation::isRunning() const
+{
+    return watcher.isRunning();
+}
+
+/*!
+ * \brief Checks if the operation has been canceled.
+ * \return A Boolean value
+ */
+bool FileOperation::isCanceled() const
+{
+    return watcher.isCanceled();
+}
+
+/*!
+ * \brief Checks if the trees of the sources are still being scanned.
+ * \return A Boolean value that is true while the total size is not known yet
+ */
+bool FileOperation::isScanning() const
+{
+    return progress->scanning.loadRelaxed() != 0;
+}
+
+/*!
+ * \brief Provides the mode of the operation.
+ * \return The Mode
+ */
+FileOperation::Mode FileOperation::mode() const
+{
+    return operationMode;
+}
+
+/*!
+ * \brief Provides the files and folders that are copied or moved.
+ * \return A QStringList with the paths
+ */
+QStringList FileOperation::sourcePaths() const
+{
+    return sources;
+}
+
+/*!
+ * \brief Provides the directory into which the sources are copied or moved.
+ * \return A QString with the clean path
+ */
+QString FileOperation::targetDir() const
+{
+    return target;
+}
+
+/*!
+ * \brief Provides the size of all the files to copy.
+ * \return The size in bytes, which grows while the sources are being scanned
+ */
+qint64 FileOperation::totalBytes() const
+{
+    return progress->totalBytes.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of bytes copied so far.
+ * \return The amount in bytes
+ */
+qint64 FileOperation::doneBytes() const
+{
+    return progress->doneBytes.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of files to copy or move.
+ * \return An integer, which grows while the sources are being scanned
+ */
+int FileOperation::totalFiles() const
+{
+    return progress->totalFiles.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of files copied or moved so far.
+ * \return An integer
+ */
+int FileOperation::doneFiles() const
+{
+    return progress->doneFiles.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the throughput of the operation.
+ * \return The smoothed amount of bytes copied per second
+ */
+qint64 FileOperation::throughput() const
+{
+    return bytesPerSecond;
+}
+
+/*!
+ * \brief Estimates the time until the operation has finished.
+ * \return The time in seconds, or -1 while it can not be estimated
+ */
+int FileOperation::remainingSeconds() const
+{
+    if (isScanning() || bytesPerSecond <= 0) {
+        return -1;
+    }
+
+    return static_cast<int>(qMax<qint64>(0, totalBytes() - doneBytes()) / bytesPerSecond);
+}
+
+/*!
+ * \brief Provides the errors that occurred.
+ * \return A QStringList with a message per error
+ */
+QStringList FileOperation::errors() const
+{
+    QMutexLocker locker(&progress->errorMutex);
+    return progress->errors;
+}
+
+/*!
+ * \brief Updates the throughput and reports the progress.
+ * \note The throughput is an exponential moving average, so the estimate does not jump with every sample.
+ */
+void FileOperation::sampleProgress()
+{
+    const qint64 elapsed(sampleTimer.restart());
+    const qint64 bytes(doneBytes());
+
+    if (elapsed > 0) {
+        const qint64 sampleRate((bytes - sampledBytes) * 1000 / elapsed);
+        bytesPerSecond = (bytesPerSecond == 0) ? sampleRate : (bytesPerSecond * 7 + sampleRate * 3) / 10;
+    }
+
+    sampledBytes = bytes;
+    emit progressChanged();
+}
+
+/*!
+ * \brief Performs the operation.
+ * \param promise = The promise through which the operation is canceled
+ * \param mode = Whether the sources are copied, moved, deleted or synchronized
+ * \param sourcePaths = The files and folders to copy, move, delete or synchronize
+ * \param targetDir = The clean path of the directory into which they are copied or moved
+ * \param targetPaths = The target path of every source of a synchronization
+ * \param progress = The progress shared with the GUI thread
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ */
+void FileOperation::run(QPromise<void> &promise, Mode mode, const QStringList &sourcePaths, const QString &targetDir, const QStringList &targetPaths, const QSharedPointer<Progress> &progress)
+{
+    if (mode == DeleteMode) {
+        deleteSources(promise, sourcePaths, *progress);
+        return;
+    }
+
+    const QString targetPrefix(targetDir.endsWith('/') ? targetDir : targetDir + '/');
+    QVector<QPair<int, QString>> copiedSources;
+
+    // Moves within a file system are renames, which are done before anything is scanned.
+    for (int source(0); source < sourcePaths.count() && !promise.isCanceled(); ++source) {
+        const QString sourcePath(QDir::cleanPath(sourcePaths.at(source)));
+        QString targetPath(targetPrefix + QFileInfo(sourcePath).fileName());
+
+        if (mode == SyncMode) {
+            if (source < targetPaths.count()) {
+                copiedSources.append(qMakePair(source, QDir::cleanPath(targetPaths.at(source))));
+            }
+            continue;
+        }
+
+        if (targetPath.startsWith(sourcePath + '/')) {
+            progress->addError(source, QString("%1 can not be put inside itself").arg(sourcePath));
+            continue;
+        }
+
+        if (targetPath == sourcePath) {
+            if (mode == MoveMode) {
+                continue;
+            }
+
+            // A copy into the same directory gets a new name.
+            const QFileInfo sourceInfo(sourcePath);
+            const QString baseName(sourceInfo.isDir() ? sourceInfo.fileName() : sourceInfo.completeBaseName());
+            const QString suffix((sourceInfo.isDir() || sourceInfo.suffix().isEmpty()) ? QString() : "." + sourceInfo.suffix());
+            int copyNumber(1);
+
+            do {
+                targetPath = targetPrefix + baseName + ((copyNumber == 1) ? QString(" (copy)") : QString(" (copy %1)").arg(copyNumber)) + suffix;
+                ++copyNumber;
+            } while (QFileInfo::exists(targetPath) || QFileInfo(targetPath).isSymLink());
+        }
+
+        if (mode == MoveMode) {
+            bool crossDevice(false);
+
+            if (renameEntry(sourcePath, targetPath, crossDevice)) {
+                progress->totalFiles.fetchAndAddRelaxed(1);
+                progress->doneFiles.fetchAndAddRelaxed(1);
+                continue;
+            }
+
+            if (!crossDevice) {
+                progress->addError(source, QString("Could not move %1 to %2").arg(sourcePath, targetDir));
+                continue;
+            }
+        }
+
+        copiedSources.append(qMakePair(source, targetPath));
+    }
+
+    // Scan the trees, so the total size is known before the first byte is copied.
+    QVector<QPair<QString, QString>> dirs;
+    QVector<CopyTask> tasks;
+    progress->scanning.storeRelaxed(1);
+
+    for (const QPair<int, QString> &copiedSource : qAsConst(copiedSources)) {
+        const int source(copiedSource.first);
+        const QString sourcePath(QDir::cleanPath(sourcePaths.at(source)));
+        QString targetPath(copiedSource.second);
+        const QFileInfo sourceInfo(sourcePath);
+
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const QFileInfo targetInfo(targetPath);
+        QString replacedPath;
+
+        if (targetInfo.exists() || targetInfo.isSymLink()) {
+            // A synchronization replaces files through a temporary copy next to them, whose name is chosen when it is created.
+            if (mode != SyncMode || (sourceInfo.isDir() && !sourceInfo.isSymLink()) || (targetInfo.isDir() && !targetInfo.isSymLink())) {
+                progress->addError(source, QString("%1 already exists").arg(targetPath));
+                continue;
+            }
+
+            replacedPath = targetPath;
+            targetPath.clear();
+        }
+
+        if (sourceInfo.isSymLink() || !sourceInfo.isDir()) {
+            tasks.append(CopyTask{source, sourcePath, targetPath, sourceInfo.isSymLink(), replacedPath});
+            progress->totalFiles.fetchAndAddRelaxed(1);
+            progress->totalBytes.fetchAndAddRelaxed(sourceInfo.isSymLink() ? 0 : sourceInfo.size());
+            continue;
+        }
+
+        dirs.append(qMakePair(sourcePath, targetPath));
+
+        QDirIterator dirIterator(sourcePath, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+
+        while (dirIterator.hasNext() && !promise.isCanceled()) {
+            const QString entryPath(dirIterator.next());
+            const QFileInfo entryInfo(dirIterator.fileInfo());
+            const QString entryTarget(targetPath + entryPath.mid(sourcePath.length()));
+
+            if (entryInfo.isDir() && !entryInfo.isSymLink()) {
+                dirs.append(qMakePair(entryPath, entryTarget));
+            } else {
+                tasks.append(CopyTask{source, entryPath, entryTarget, entryInfo.isSymLink(), QString()});
+                progress->totalFiles.fetchAndAddRelaxed(1);
+                progress->totalBytes.fetchAndAddRelaxed(entryInfo.isSymLink() ? 0 : entryInfo.size());
+            }
+        }
+    }
+
+    progress->scanning.storeRelaxed(0);
+
+    // The iterator lists every folder before its contents, so the parents are always created first.
+    for (const QPair<QString, QString> &dir : qAsConst(dirs)) {
+        if (!QDir().mkdir(dir.second)) {
+            progress->addError(-1, QString("Could not create %1").arg(dir.second));
+        }
+    }
+
+    QThreadPool copyPool;
+    copyPool.setMaxThreadCount(CopyThreads);
+
+    QtConcurrent::blockingMap(&copyPool, tasks, [&promise, &progress](CopyTask &task) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        if ((task.symlink ? copySymlink(task) : copyFile(promise, task, *progress)) && (task.replacedPath.isEmpty() || replaceFile(task))) {
+            progress->doneFiles.fetchAndAddRelaxed(1);
+        } else {
+            if (!promise.isCanceled()) {
+                progress->addError(task.source, QString("Could not copy %1").arg(task.sourcePath));
+            }
+        }
+    });
+
+    // The permissions of the folders are copied last, since a read-only folder could not be filled.
+    for (int i(dirs.count() - 1); i >= 0; --i) {
+        QFile::setPermissions(dirs.at(i).second, QFileInfo(dirs.at(i).first).permissions());
+    }
+
+    if (mode != MoveMode || promise.isCanceled()) {
+        return;
+    }
+
+    QSet<int> failedSources;
+    {
+        QMutexLocker locker(&progress->errorMutex);
+        failedSources = progress->failedSources;
+    }
+
+    for (const QPair<int, QString> &copiedSource : qAsConst(copiedSources)) {
+        if (failedSources.contains(copiedSource.first)) {
+            continue;
+        }
+
+        const QString sourcePath(QDir::cleanPath(sourcePaths.at(copiedSource.first)));
+        const QFileInfo sourceInfo(sourcePath);
+        const bool removed((sourceInfo.isDir() && !sourceInfo.isSymLink()) ? QDir(sourcePath).removeRecursively() : QFile::remove(sourcePath));
+
+        if (!removed) {
+            progress->addError(copiedSource.first, QString("Could not remove %1 after copying it").arg(sourcePath));
+        }
+    }
+}
+
+/*!
+ * \brief Moves a file or folder by renaming it, without ever replacing an existing target.
+ * \param sourcePath = The path of the file or folder
+ * \param targetPath = The new path
+ * \param crossDevice = Set to true if the target is on another file system, so the source has to be copied instead
+ * \return A Boolean value that is true if the source has been renamed
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+bool FileOperation::renameEntry(const QString &sourcePath, const QString &targetPath, bool &crossDevice)
+{
+#if defined (Q_OS_LINUX)
+    const QByteArray encodedSource(QFile::encodeName(sourcePath)), encodedTarget(QFile::encodeName(targetPath));
+
+    if (syscall(SYS_renameat2, AT_FDCWD, encodedSource.constData(), AT_FDCWD, encodedTarget.constData(), RENAME_NOREPLACE) == 0) {
+        return true;
+    }
+
+    // Some file systems do not support the flags of renameat2(), so the target is checked separately.
+    if (errno == EINVAL || errno == ENOSYS) {
+        struct stat targetStat;
+
+        if (lstat(encodedTarget.constData(), &targetStat) != 0 && ::rename(encodedSource.constData(), encodedTarget.constData()) == 0) {
+            return true;
+        }
+    }
+
+    crossDevice = (errno == EXDEV);
+    return false;
+#else
+    if (QFileInfo::exists(targetPath) || QFileInfo(targetPath).isSymLink()) {
+        return false;
+    }
+
+    // The reason of a failed rename is not known here, so the source is copied instead.
+    crossDevice = !QDir().rename(sourcePath, targetPath);
+    return !crossDevice;
+#endif
+}
+
+/*!
+ * \brief Copies a regular file together with its permissions and modification time.
+ * \param promise = The promise through which the operation is canceled
+ * \param task = The file, whose target path is set to the temporary copy if it replaces a file
+ * \param progress = The progress to which the copied bytes are added
+ * \return A Boolean value that is true if the file has been copied completely
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note A file that could not be copied completely is removed again.
+ */
+bool FileOperation::copyFile(QPromise<void> &promise, CopyTask &task, Progress &progress)
+{
+#if defined (Q_OS_LINUX)
+    const int sourceFd(::open(QFile::encodeName(task.sourcePath).constData(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+
+    if (sourceFd < 0) {
+        return false;
+    }
+
+    struct stat sourceStat;
+
+    if (fstat(sourceFd, &sourceStat) != 0) {
+        ::close(sourceFd);
+        return false;
+    }
+
+    int targetFd(-1);
+
+    // The copy of a replaced file gets a new name until one is free, so no existing file is ever overwritten.
+    for (int attempt(0); attempt < MaxTempAttempts; ++attempt) {
+        if (!task.replacedPath.isEmpty()) {
+            task.targetPath = tempPath(task.replacedPath);
+        }
+
+        targetFd = ::open(QFile::encodeName(task.targetPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, (sourceStat.st_mode & 07777) | S_IWUSR);
+
+        if (targetFd >= 0 || errno != EEXIST || task.replacedPath.isEmpty()) {
+            break;
+        }
+    }
+
+    if (targetFd < 0) {
+        ::close(sourceFd);
+        return false;
+    }
+
+    const QByteArray encodedTarget(QFile::encodeName(task.targetPath));
+
+    const qint64 size(sourceStat.st_size);
+    bool copied(true);
+
+    // A clone shares the data blocks of the source and takes no time, regardless of the size.
+    if (ioctl(targetFd, FICLONE, sourceFd) == 0) {
+        progress.doneBytes.fetchAndAddRelaxed(size);
+    } else {
+        const bool sparse(static_cast<qint64>(sourceStat.st_blocks) * 512 < size);
+        bool kernelCopy(true);
+        QByteArray buffer;
+
+        posix_fadvise(sourceFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        // Preallocating a sparse file would fill its holes.
+        if (!sparse && size > 0) {
+            fallocate(targetFd, 0, 0, size);
+        }
+
+        qint64 offset(0);
+
+        while (copied && offset < size) {
+            qint64 dataStart(offset), dataEnd(size);
+
+            if (sparse) {
+                dataStart = lseek(sourceFd, offset, SEEK_DATA);
+
+                // Only a hole is left.
+                if (dataStart < 0) {
+                    progress.doneBytes.fetchAndAddRelaxed(size - offset);
+                    break;
+                }
+
+                dataEnd = qMax(dataStart, static_cast<qint64>(lseek(sourceFd, dataStart, SEEK_HOLE)));
+            }
+
+            progress.doneBytes.fetchAndAddRelaxed(dataStart - offset);
+            copied = copyRange(promise, sourceFd, targetFd, dataStart, dataEnd - dataStart, kernelCopy, buffer, progress);
+            offset = dataEnd;
+        }
+
+        // The target gets the size of the source even if it ends with a hole.
+        copied = copied && ftruncate(targetFd, size) == 0;
+    }
+
+    if (copied) {
+        const struct timespec times[2] = {sourceStat.st_atim, sourceStat.st_mtim};
+        fchmod(targetFd, sourceStat.st_mode & 07777);
+        futimens(targetFd, times);
+    }
+
+    ::close(targetFd);
+    ::close(sourceFd);
+
+    if (!copied) {
+        unlink(encodedTarget.constData());
+    }
+
+    return copied;
+#else
+    Q_UNUSED(promise)
+
+    bool copied(false);
+
+    for (int attempt(0); !copied && attempt < MaxTempAttempts; ++attempt) {
+        if (!task.replacedPath.isEmpty()) {
+            task.targetPath = tempPath(task.replacedPath);
+        }
+
+        copied = QFile::copy(task.sourcePath, task.targetPath);
+
+        if (task.replacedPath.isEmpty()) {
+            break;
+        }
+    }
+
+    if (!copied) {
+        return false;
+    }
+
+    progress.doneBytes.fetchAndAddRelaxed(QFileInfo(task.sourcePath).size());
+    return true;
+#endif
+}
+
+/*!
+ * \brief Recreates a symbolic link with the same target.
+ * \param task = The link, whose target path is set to the temporary copy if it replaces a file
+ * \return A Boolean value that is true if the link has been created
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note On Linux relative targets are kept as they are.
+ * \note The copy of a replaced link gets a new name until one is free.
+ */
+bool FileOperation::copySymlink(CopyTask &task)
+{
+#if defined (Q_OS_LINUX)
+    QByteArray linkTarget(4096, Qt::Uninitialized);
+    const ssize_t length(readlink(QFile::encodeName(task.sourcePath).constData(), linkTarget.data(), linkTarget.size()));
+
+    if (length < 0 || length >= linkTarget.size()) {
+        return false;
+    }
+
+    linkTarget.truncate(static_cast<int>(length));
+
+    for (int attempt(0); attempt < MaxTempAttempts; ++attempt) {
+        if (!task.replacedPath.isEmpty()) {
+            task.targetPath = tempPath(task.replacedPath);
+        }
+
+        if (symlink(linkTarget.constData(), QFile::encodeName(task.targetPath).constData()) == 0) {
+            return true;
+        }
+
+        if (errno != EEXIST || task.replacedPath.isEmpty()) {
+            break;
+        }
+    }
+
+    return false;
+#else
+    for (int attempt(0); attempt < MaxTempAttempts; ++attempt) {
+        if (!task.replacedPath.isEmpty()) {
+            task.targetPath = tempPath(task.replacedPath);
+        }
+
+        if (QFile::link(QFileInfo(task.sourcePath).symLinkTarget(), task.targetPath)) {
+            return true;
+        }
+
+        if (task.replacedPath.isEmpty()) {
+            break;
+        }
+    }
+
+    return false;
+#endif
+}
+
+/*!
+ * \brief Provides a path for the temporary copy of a file that is replaced by a synchronization.
+ * \param replacedPath = The path of the replaced file
+ * \return A QString with a hidden path next to the replaced file, which ends in a random suffix
+ * \note The path is only a candidate. The copy is created exclusively, and another candidate is tried if it is taken.
+ */
+QString FileOperation::tempPath(const QString &replacedPath)
+{
+    static const char characters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    const QFileInfo replacedInfo(replacedPath);
+    QString suffix(TempSuffixLength, Qt::Uninitialized);
+
+    for (QChar &character : suffix) {
+        character = QLatin1Char(characters[QRandomGenerator::global()->bounded(static_cast<int>(sizeof(characters) - 1))]);
+    }
+
+    return replacedInfo.path() + "/." + replacedInfo.fileName() + ".xplorer-sync-" + suffix;
+}
+
+/*!
+ * \brief Replaces a file by its complete copy.
+ * \param task = The file, whose copy is at the target path
+ * \return A Boolean value that is true if the copy has taken the place of the replaced file
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note The copy is removed if it could not be moved into place.
+ */
+bool FileOperation::replaceFile(const CopyTask &task)
+{
+#if defined (Q_OS_LINUX)
+    const QByteArray encodedTarget(QFile::encodeName(task.targetPath)), encodedReplaced(QFile::encodeName(task.replacedPath));
+
+    // The rename replaces the file atomically, so there is no moment at which neither version exists.
+    if (syscall(SYS_renameat2, AT_FDCWD, encodedTarget.constData(), AT_FDCWD, encodedReplaced.constData(), 0) == 0) {
+        return true;
+    }
+
+    // Kernels older than 3.15 do not know renameat2.
+    if (errno == ENOSYS && ::rename(encodedTarget.constData(), encodedReplaced.constData()) == 0) {
+        return true;
+    }
+#else
+    if (QFile::remove(task.replacedPath) && QFile::rename(task.targetPath, task.replacedPath)) {
+        return true;
+    }
+#endif
+
+    QFile::remove(task.targetPath);
+    return false;
+}
+
+/*!
+ * \brief Deletes files and folders.
+ * \param promise = The promise through which the operation is canceled
+ * \param sourcePaths = The files and folders
+ * \param progress = The progress to which the removed entries are added
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+void FileOperation::deleteSources(QPromise<void> &promise, const QStringList &sourcePaths, Progress &progress)
+{
+#if defined (Q_OS_LINUX)
+    QThreadPool deletePool;
+    deletePool.setMaxThreadCount(DeleteThreads);
+#endif
+
+    for (int source(0); source < sourcePaths.count() && !promise.isCanceled(); ++source) {
+        const QString sourcePath(QDir::cleanPath(sourcePaths.at(source)));
+        const QFileInfo sourceInfo(sourcePath);
+
+        if (!sourceInfo.isDir() || sourceInfo.isSymLink()) {
+            if (QFile::remove(sourcePath)) {
+                progress.doneFiles.fetchAndAddRelaxed(1);
+            } else {
+                progress.addError(source, QString("Could not remove %1").arg(sourcePath));
+            }
+            continue;
+        }
+
+#if defined (Q_OS_LINUX)
+        const int parentFd(::open(QFile::encodeName(sourceInfo.path()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+        if (parentFd < 0) {
+            progress.addError(source, QString("Could not remove %1").arg(sourcePath));
+            continue;
+        }
+
+        QSharedPointer<DeleteNode> root(new DeleteNode{source, parentFd, QFile::encodeName(sourceInfo.fileName()), QFile::encodeName(sourcePath), 0, QAtomicInt(1), nullptr});
+
+        deletePool.start([&promise, &deletePool, root, &progress]() {
+            deleteNode(promise, deletePool, root, progress);
+        });
+#else
+        if (QDir(sourcePath).removeRecursively()) {
+            progress.doneFiles.fetchAndAddRelaxed(1);
+        } else {
+            progress.addError(source, QString("Could not remove %1").arg(sourcePath));
+        }
+#endif
+    }
+
+#if defined (Q_OS_LINUX)
+    // The tasks of a tree queue the tasks of its subdirectories, which are waited for as well.
+    deletePool.waitForDone();
+#endif
+}
+
+#if defined (Q_OS_LINUX)
+/*!
+ * \brief Copies a range of a file.
+ * \param promise = The promise through which the operation is canceled
+ * \param sourceFd = The source file
+ * \param targetFd = The target file
+ * \param offset = The offset of the range in both files
+ * \param length = The length of the range
+ * \param kernelCopy = Whether copy_file_range() can be used, which is set to false once it turns out it can not
+ * \param buffer = The buffer used for streaming, which is allocated on first use
+ * \param progress = The progress to which the copied bytes are added
+ * \return A Boolean value that is false if the range could not be copied or the operation was canceled
+ *
+ * copy_file_range() copies inside the kernel, and lets file systems and network shares copy on the server side. File
+ * systems that do not support it, or that are on different devices on older kernels, are streamed through a buffer of
+ * StreamBufferSize bytes instead.
+ */
+bool FileOperation::copyRange(QPromise<void> &promise, int sourceFd, int targetFd, qint64 offset, qint64 length, bool &kernelCopy, QByteArray &buffer, Progress &progress)
+{
+    while (length > 0) {
+        if (promise.isCanceled()) {
+            return false;
+        }
+
+        ssize_t copied(-1);
+
+        if (kernelCopy) {
+            loff_t sourceOffset(offset), targetOffset(offset);
+            copied = copy_file_range(sourceFd, &sourceOffset, targetFd, &targetOffset, static_cast<size_t>(qMin(length, CopyChunkSize)), 0);
+
+            if (copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                kernelCopy = false;
+                continue;
+            }
+        } else {
+            if (buffer.isEmpty()) {
+                buffer.resize(StreamBufferSize);
+            }
+
+            copied = pread(sourceFd, buffer.data(), static_cast<size_t>(qMin<qint64>(length, buffer.size())), offset);
+
+            for (ssize_t written(0); copied > 0 && written < copied;) {
+                const ssize_t result(pwrite(targetFd, buffer.constData() + written, static_cast<size_t>(copied - written), offset + written));
+
+                if (result <= 0) {
+                    return false;
+                }
+
+                written += result;
+            }
+        }
+
+        // The source has shrunk while it was being copied.
+        if (copied == 0) {
+            return true;
+        }
+
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        offset += copied;
+        length -= copied;
+        progress.doneBytes.fetchAndAddRelaxed(copied);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Removes a directory and everything below it that is not handed to other threads.
+ * \param promise = The promise through which the operation is canceled
+ * \param pool = The pool to which the subdirectories near the top of the tree are handed
+ * \param node = The directory
+ * \param progress = The progress to which the removed entries are added
+ */
+void FileOperation::deleteNode(QPromise<void> &promise, QThreadPool &pool, const QSharedPointer<DeleteNode> &node, Progress &progress)
+{
+    const int dirFd(openat(node->parentFd, node->name.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW));
+
+    if (dirFd >= 0) {
+        QVector<QByteArray> nameStack;
+        int removed(0);
+
+        deleteContents(promise, pool, node, dirFd, nameStack, removed, progress);
+        progress.doneFiles.fetchAndAddRelaxed(removed);
+        ::close(dirFd);
+    }
+
+    // A directory that can not be opened may still be empty, so only a failure to remove it is reported.
+    finishDeleteNode(promise, node, progress);
+}
+
+/*!
+ * \brief Removes the contents of a directory depth first.
+ * \param promise = The promise through which the operation is canceled
+ * \param pool = The pool to which the subdirectories near the top of the tree are handed
+ * \param node = The directory whose thread is doing the removal
+ * \param dirFd = The directory whose contents are removed, which is the node itself or a directory below it
+ * \param nameStack = The names of the directories between the node and dirFd, which are only joined for error messages
+ * \param removed = The amount of removed entries that has not been published yet
+ * \param progress = The progress to which the removed entries are published
+ *
+ * A directory is read completely before anything in it is removed, since removing entries while reading could make
+ * some file systems skip others. Every entry is opened and removed relative to the descriptor of its directory, and
+ * a subdirectory handed to another thread gets a duplicate of that descriptor.
+ */
+void FileOperation::deleteContents(QPromise<void> &promise, QThreadPool &pool, const QSharedPointer<DeleteNode> &node, int dirFd, QVector<QByteArray> &nameStack, int &removed, Progress &progress)
+{
+    QVector<QPair<QByteArray, bool>> entries;
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+
+    forever {
+        const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (long pos(0); pos < bytesRead;) {
+            const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+            pos += dirEntry->d_reclen;
+
+            const char *name(dirEntry->d_name);
+            bool isDir(dirEntry->d_type == DT_DIR);
+
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            if (dirEntry->d_type == DT_UNKNOWN) {
+                struct stat entryStat;
+                isDir = fstatat(dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(entryStat.st_mode);
+            }
+
+            entries.append(qMakePair(QByteArray(name), isDir));
+        }
+    }
+
+    const auto entryPath = [&node, &nameStack](const QByteArray &name) {
+        QByteArray path(node->path);
+
+        for (const QByteArray &dirName : nameStack) {
+            path += '/' + dirName;
+        }
+
+        return QFile::decodeName(path + '/' + name);
+    };
+
+    for (const QPair<QByteArray, bool> &entry : qAsConst(entries)) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const QByteArray &name(entry.first);
+
+        if (!entry.second) {
+            if (unlinkat(dirFd, name.constData(), 0) == 0) {
+                ++removed;
+            } else {
+                progress.addError(node->source, QString("Could not remove %1").arg(entryPath(name)));
+            }
+        } else {
+            const int childParentFd((nameStack.isEmpty() && node->depth < ParallelDepth) ? fcntl(dirFd, F_DUPFD_CLOEXEC, 0) : -1);
+
+            if (childParentFd >= 0) {
+                QSharedPointer<DeleteNode> child(new DeleteNode{node->source, childParentFd, name, node->path + '/' + name, node->depth + 1, QAtomicInt(1), node});
+
+                node->pending.ref();
+                pool.start([&promise, &pool, child, &progress]() {
+                    deleteNode(promise, pool, child, progress);
+                });
+            } else {
+                const int childFd(openat(dirFd, name.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW));
+
+                if (childFd >= 0) {
+                    nameStack.append(name);
+                    deleteContents(promise, pool, node, childFd, nameStack, removed, progress);
+                    nameStack.removeLast();
+                    ::close(childFd);
+                }
+
+                if (unlinkat(dirFd, name.constData(), AT_REMOVEDIR) == 0) {
+                    ++removed;
+                } else {
+                    if (!promise.isCanceled()) {
+                        progress.addError(node->source, QString("Could not remove %1").arg(entryPath(name)));
+                    }
+                }
+            }
+        }
+
+        if (removed >= ProgressBatch) {
+            progress.doneFiles.fetchAndAddRelaxed(removed);
+            removed = 0;
+        }
+    }
+}
+
+/*!
+ * \brief Removes a directory once no thread removes its contents anymore, and then its parents that have become empty.
+ * \param promise = The promise through which the operation is canceled
+ * \param node = The directory whose thread has finished
+ * \param progress = The progress to which the removed directories are added
+ * \note The descriptor of the parent of every removed directory is closed.
+ */
+void FileOperation::finishDeleteNode(QPromise<void> &promise, QSharedPointer<DeleteNode> node, Progress &progress)
+{
+    while (node && !node->pending.deref()) {
+        const bool dirRemoved(unlinkat(node->parentFd, node->name.constData(), AT_REMOVEDIR) == 0);
+        ::close(node->parentFd);
+
+        if (dirRemoved) {
+            progress.doneFiles.fetchAndAddRelaxed(1);
+        } else {
+            if (!promise.isCanceled()) {
+                progress.addError(node->source, QString("Could not remove %1").arg(QFile::decodeName(node->path)));
+            }
+        }
+
+        node = node->parent;
+    }
+}
+#endif
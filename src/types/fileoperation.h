@@ -0,0 +1,160 @@
+#ifndef FILEOPERATION_H
+#define FILEOPERATION_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QPromise>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+/*!
+ * \brief A copy, move or deletion of files and folders, performed on worker threads.
+ *
+ * Moves within a file system are plain renames. Everything else is copied: the trees are scanned first, so the total
+ * size is known, then the folders are created and the files are copied by several threads at once, which keeps the
+ * disk busy when there are many small files. On Linux every file is first cloned with FICLONE, which shares the data
+ * blocks on file systems that support it. Otherwise the file is preallocated and copied with copy_file_range(),
+ * falling back to streaming through a large buffer, and only the data regions of sparse files are copied, so their
+ * holes are kept. A move that crosses file systems removes each source once it has been copied without errors.
+ *
+ * Deletions are not scanned, since that would double their cost. On Linux the trees are removed bottom up by several
+ * threads, relative to the file descriptors of their directories, so no path is built for the entries themselves.
+ * The directories near the top of each tree are handed to the other threads, and the rest is removed depth first by
+ * the thread that found it. The amount of removed entries is published in batches, so a canceled deletion reports
+ * exactly what has been removed.
+ *
+ * The progress is sampled every ProgressInterval milliseconds on the GUI thread, which also derives the throughput and
+ * the remaining time from it.
+ * A synchronization copies every source to its own target path, given with setTargetPaths(). Files that exist at their
+ * target are replaced, but only once their copy is complete, so an interrupted synchronization never leaves a half
+ * written file behind.
+ * \note Apart from synchronizations, existing targets are never overwritten; they are reported as errors and skipped.
+ */
+class FileOperation : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        CopyMode,   ///< 0
+        MoveMode,   ///< 1
+        DeleteMode, ///< 2
+        SyncMode    ///< 3
+    };
+
+    FileOperation(Mode mode, const QStringList &sourcePaths, const QString &targetDir, QObject *parent = nullptr);
+    ~FileOperation();
+    void setTargetPaths(const QStringList &targetPaths);
+    void start();
+    void cancel();
+    bool isRunning() const;
+    bool isCanceled() const;
+    bool isScanning() const;
+    Mode mode() const;
+    QStringList sourcePaths() const;
+    QString targetDir() const;
+    qint64 totalBytes() const;
+    qint64 doneBytes() const;
+    int totalFiles() const;
+    int doneFiles() const;
+    qint64 throughput() const;
+    int remainingSeconds() const;
+    QStringList errors() const;
+
+signals:
+    void progressChanged();     ///< Emitted every ProgressInterval milliseconds while the operation runs.
+    void finished();            ///< Emitted when the operation has finished or has been canceled.
+
+private:
+    static const int ProgressInterval = 250;            ///< The time in milliseconds between two progress samples.
+    static const int CopyThreads = 4;                   ///< The amount of files copied at once.
+    static const int StreamBufferSize = 1024 * 1024;    ///< The size of the buffer used when the kernel can not copy a file.
+    static const qint64 CopyChunkSize = 16 * 1024 * 1024;  ///< The maximum amount of bytes copied by one system call.
+    static const int DeleteThreads = 4;                 ///< The amount of threads removing a tree at once.
+    static const int ParallelDepth = 3;                 ///< The depth up to which directories are handed to other threads.
+    static const int ProgressBatch = 256;               ///< The amount of removed entries after which the progress is published.
+    static const int MaxTempAttempts = 16;              ///< The amount of names tried for the temporary copy of a replaced file.
+    static const int TempSuffixLength = 6;              ///< The length of the random suffix of a temporary copy.
+
+    /*!
+     * \brief The progress shared between the GUI thread and the workers.
+     */
+    struct Progress
+    {
+        QAtomicInteger<qint64> totalBytes;  ///< The size of all the files to copy.
+        QAtomicInteger<qint64> doneBytes;   ///< The amount of bytes copied so far.
+        QAtomicInt totalFiles;      ///< The amount of files and links to copy or move.
+        QAtomicInt doneFiles;       ///< The amount of files and links copied or moved, or of entries deleted, so far.
+        QAtomicInt scanning;        ///< Set to 1 while the trees are being scanned.
+        QMutex errorMutex;          ///< Guards the errors and the failed sources.
+        QStringList errors;         ///< The errors that occurred.
+        QSet<int> failedSources;    ///< The sources of which something could not be copied.
+
+        void addError(int source, const QString &error);
+    };
+
+    /*!
+     * \brief A file or symbolic link that is copied.
+     */
+    struct CopyTask
+    {
+        int source;             ///< The position of the source path the file belongs to.
+        QString sourcePath;     ///< The path of the file.
+        QString targetPath;     ///< The path of the copy, which is chosen when it is created if it replaces a file.
+        bool symlink;           ///< Whether the file is a symbolic link, which is recreated instead of copied.
+        QString replacedPath;   ///< The file that is replaced by the copy once it is complete, or empty.
+    };
+
+#if defined (Q_OS_LINUX)
+    /*!
+     * \brief A directory whose contents are removed by a thread of its own.
+     * \note The directory is only ever reached through the descriptor of its parent, so a directory that is swapped for a
+     * symbolic link while it is being removed can not redirect the removal elsewhere.
+     */
+    struct DeleteNode
+    {
+        int source;             ///< The position of the source path the directory belongs to.
+        int parentFd;           ///< A descriptor of the directory containing this one, owned by the node.
+        QByteArray name;        ///< The encoded name of the directory within its parent.
+        QByteArray path;        ///< The encoded path of the directory, which is only used for error messages.
+        int depth;              ///< The depth of the directory below the source.
+        QAtomicInt pending;     ///< The amount of threads still removing contents of the directory, its own included.
+        QSharedPointer<DeleteNode> parent;  ///< The directory containing this one, or null for the source.
+    };
+#endif
+
+    Mode operationMode;         ///< Whether the sources are copied or moved.
+    QStringList sources;        ///< The files and folders that are copied or moved.
+    QString target;             ///< The directory into which the sources are copied or moved.
+    QStringList targets;        ///< The target path of every source of a synchronization.
+    QSharedPointer<Progress> progress;  ///< The progress of the workers.
+    QFutureWatcher<void> watcher;       ///< Watches the worker performing the operation.
+    QTimer progressTimer;       ///< Samples the progress.
+    QElapsedTimer sampleTimer;  ///< Measures the time between two samples.
+    qint64 sampledBytes;        ///< The amount of bytes copied at the last sample.
+    qint64 bytesPerSecond;      ///< The smoothed throughput.
+
+    void sampleProgress();
+
+    static void run(QPromise<void> &promise, Mode mode, const QStringList &sourcePaths, const QString &targetDir, const QStringList &targetPaths, const QSharedPointer<Progress> &progress);
+    static bool renameEntry(const QString &sourcePath, const QString &targetPath, bool &crossDevice);
+    static bool copyFile(QPromise<void> &promise, CopyTask &task, Progress &progress);
+    static bool copySymlink(CopyTask &task);
+    static QString tempPath(const QString &replacedPath);
+    static bool replaceFile(const CopyTask &task);
+    static void deleteSources(QPromise<void> &promise, const QStringList &sourcePaths, Progress &progress);
+#if defined (Q_OS_LINUX)
+    static bool copyRange(QPromise<void> &promise, int sourceFd, int targetFd, qint64 offset, qint64 length, bool &kernelCopy, QByteArray &buffer, Progress &progress);
+    static void deleteNode(QPromise<void> &promise, QThreadPool &pool, const QSharedPointer<DeleteNode> &node, Progress &progress);
+    static void deleteContents(QPromise<void> &promise, QThreadPool &pool, const QSharedPointer<DeleteNode> &node, int dirFd, QVector<QByteArray> &nameStack, int &removed, Progress &progress);
+    static void finishDeleteNode(QPromise<void> &promise, QSharedPointer<DeleteNode> node, Progress &progress);
+#endif
+};
+
+#endif // FILEOPERATION_H
@@ -0,0 +1,585 @@
+#include "filesearch.h"
+#include "namematcher.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <QMutex>
+#include <QPair>
+#include <QScopedArrayPointer>
+#include <QSet>
+#include <QWaitCondition>
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const unsigned int SearchStatMask(STATX_TYPE | STATX_SIZE | STATX_MTIME);   ///< The fields requested from statx.
+
+/*!
+ * \brief The work-stealing walker of a search on Linux, shared by all of its workers.
+ */
+class SearchWalker
+{
+public:
+    /*!
+     * \brief The constructor
+     * \param searchPromise = The promise to which the results are reported
+     * \param searchCriteria = The criteria of the search
+     * \param stats = The counters of the search
+     * \param workers = The amount of workers that walk the tree
+     */
+    SearchWalker(QPromise<QVector<SearchResult>> &searchPromise, const SearchCriteria &searchCriteria, SearchStatistics &stats, int workers) :
+        promise(searchPromise),
+        criteria(searchCriteria),
+        nameMatcher(searchCriteria.namePattern),
+        statistics(stats),
+        workerCount(workers),
+        queues(new WorkQueue[workers]),
+        pendingTasks(0)
+    {
+    }
+
+    /*!
+     * \brief Walks the tree below a directory and returns once it has been walked or the search has been canceled.
+     * \param rootPath = The encoded absolute path of the directory
+     */
+    void walk(const QByteArray &rootPath)
+    {
+        pushTask(0, QSharedPointer<DirHandle>(), rootPath);
+
+        QThreadPool workerPool;
+        workerPool.setMaxThreadCount(workerCount - 1);
+
+        for (int worker(1); worker < workerCount; ++worker) {
+            workerPool.start([this, worker]() {
+                work(worker);
+            });
+        }
+
+        work(0);
+        workerPool.waitForDone();
+    }
+
+private:
+    /*!
+     * \brief An open directory, which is closed once the last of its subdirectories has been opened.
+     */
+    struct DirHandle
+    {
+        int fd;             ///< The file descriptor of the directory.
+        QByteArray path;    ///< The encoded path of the directory.
+
+        /*!
+         * \brief The constructor
+         * \param dirFd = The file descriptor of the directory
+         * \param dirPath = The encoded path of the directory
+         */
+        DirHandle(int dirFd, const QByteArray &dirPath) :
+            fd(dirFd),
+            path(dirPath)
+        {
+        }
+
+        /*!
+         * \brief The destructor
+         */
+        ~DirHandle()
+        {
+            ::close(fd);
+        }
+    };
+
+    /*!
+     * \brief A directory that is waiting to be read.
+     */
+    struct Task
+    {
+        QSharedPointer<DirHandle> parent;   ///< The parent directory, which is null for the root of the search.
+        QByteArray name;                    ///< The name of the directory in its parent, or the path of the root.
+    };
+
+    /*!
+     * \brief The tasks of one worker.
+     */
+    struct WorkQueue
+    {
+        QMutex mutex;       ///< Guards the tasks.
+        QList<Task> tasks;  ///< The tasks, oldest first.
+    };
+
+    /*!
+     * \brief A part of the set of directories that have been visited.
+     */
+    struct VisitedShard
+    {
+        QMutex mutex;                           ///< Guards the directories.
+        QSet<QPair<quint64, quint64>> dirs;     ///< The device and inode of every visited directory.
+    };
+
+    static const int VisitedShardCount = 16;        ///< The amount of parts the visited directories are split into.
+    static const int ReadBufferSize = 64 * 1024;    ///< The size of the buffer handed to each getdents64 call.
+    static const int ResultBatchSize = 256;         ///< The amount of results after which a worker reports them.
+    static const int ResultInterval = 100;          ///< The time in milliseconds after which a worker reports its results.
+    static const int IdleWaitTime = 5;              ///< The time in milliseconds an idle worker waits for new tasks.
+
+    QPromise<QVector<SearchResult>> &promise;       ///< The promise to which the results are reported.
+    const SearchCriteria &criteria;                 ///< The criteria of the search.
+    NameMatcher nameMatcher;                        ///< Matches the names against the pattern of the criteria.
+    SearchStatistics &statistics;                   ///< The counters of the search.
+    const int workerCount;                          ///< The amount of workers.
+    QScopedArrayPointer<WorkQueue> queues;          ///< The queue of every worker.
+    VisitedShard visitedShards[VisitedShardCount];  ///< The directories that have been visited.
+    QAtomicInt pendingTasks;                        ///< The amount of tasks that have been queued but not finished.
+    QMutex idleMutex;                               ///< Guards the waiting of idle workers.
+    QWaitCondition workAvailable;                   ///< Wakes idle workers when tasks have been queued.
+
+    /*!
+     * \brief Handles tasks until no tasks are left anywhere or the search has been canceled.
+     * \param worker = The index of the worker
+     */
+    void work(int worker)
+    {
+        QByteArray buffer(ReadBufferSize, Qt::Uninitialized);
+        QVector<SearchResult> results;
+        QElapsedTimer reportTimer;
+        reportTimer.start();
+
+        while (!promise.isCanceled()) {
+            Task task;
+
+            if (takeTask(worker, task)) {
+                readDirectory(worker, task, buffer, results);
+
+                if (results.count() >= ResultBatchSize || (!results.isEmpty() && reportTimer.hasExpired(ResultInterval))) {
+                    promise.addResult(results);
+                    results.clear();
+                    reportTimer.restart();
+                }
+
+                // The last task wakes everyone up to finish.
+                if (!pendingTasks.deref()) {
+                    workAvailable.wakeAll();
+                }
+                continue;
+            }
+
+            if (pendingTasks.loadAcquire() == 0) {
+                break;
+            }
+
+            // Another worker is still reading and may queue new tasks.
+            QMutexLocker locker(&idleMutex);
+            workAvailable.wait(&idleMutex, IdleWaitTime);
+        }
+
+        if (!results.isEmpty() && !promise.isCanceled()) {
+            promise.addResult(results);
+        }
+    }
+
+    /*!
+     * \brief Queues a directory on a worker.
+     * \param worker = The index of the worker
+     * \param parent = The parent directory
+     * \param name = The name of the directory
+     */
+    void pushTask(int worker, const QSharedPointer<DirHandle> &parent, const QByteArray &name)
+    {
+        pendingTasks.ref();
+
+        WorkQueue &queue(queues[worker]);
+        QMutexLocker locker(&queue.mutex);
+        queue.tasks.append(Task{parent, name});
+        locker.unlock();
+
+        workAvailable.wakeOne();
+    }
+
+    /*!
+     * \brief Takes the next task of a worker, or steals one from another worker.
+     * \param worker = The index of the worker
+     * \param task = Receives the task
+     * \return A Boolean value that is false if all the queues are empty
+     */
+    bool takeTask(int worker, Task &task)
+    {
+        for (int offset(0); offset < workerCount; ++offset) {
+            WorkQueue &queue(queues[(worker + offset) % workerCount]);
+            QMutexLocker locker(&queue.mutex);
+
+            if (!queue.tasks.isEmpty()) {
+                task = (offset == 0) ? queue.tasks.takeLast() : queue.tasks.takeFirst();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Reads a directory, queues its subdirectories and collects its matching entries.
+     * \param worker = The index of the worker
+     * \param task = The directory
+     * \param buffer = The buffer handed to getdents64
+     * \param results = The results to which the matching entries are appended
+     */
+    void readDirectory(int worker, const Task &task, QByteArray &buffer, QVector<SearchResult> &results)
+    {
+        const int openFlags(O_RDONLY | O_DIRECTORY | O_CLOEXEC | (criteria.followSymlinks ? 0 : O_NOFOLLOW));
+        const QByteArray dirPath(task.parent.isNull() ? task.name
+                                                      : (task.parent->path.endsWith('/') ? task.parent->path : task.parent->path + '/') + task.name);
+        int dirFd(::openat(task.parent.isNull() ? AT_FDCWD : task.parent->fd, task.name.constData(), openFlags));
+
+        // Too many directories are open, so the directory is opened by its path instead.
+        if (dirFd < 0 && (errno == EMFILE || errno == ENFILE) && !task.parent.isNull()) {
+            dirFd = ::open(dirPath.constData(), openFlags);
+        }
+
+        if (dirFd < 0) {
+            statistics.failedDirs.ref();
+            return;
+        }
+
+        const QSharedPointer<DirHandle> dir(new DirHandle(dirFd, dirPath));
+        struct stat dirStat;
+
+        if (fstat(dirFd, &dirStat) == 0 && !markVisited(dirStat.st_dev, dirStat.st_ino)) {
+            return;
+        }
+
+        const QByteArray pathPrefix(dirPath.endsWith('/') ? dirPath : dirPath + '/');
+
+        forever {
+            const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+            if (bytesRead < 0) {
+                statistics.failedDirs.ref();
+                break;
+            }
+
+            if (bytesRead == 0 || promise.isCanceled()) {
+                break;
+            }
+
+            for (long pos(0); pos < bytesRead;) {
+                const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+                pos += dirEntry->d_reclen;
+
+                const char *name(dirEntry->d_name);
+
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+
+                if (name[0] == '.' && !criteria.includeHidden) {
+                    continue;
+                }
+
+                const int length(static_cast<int>(strlen(name)));
+                DirectoryEntries::EntryType type(DirectoryEntries::OtherEntry);
+                bool isLink(dirEntry->d_type == DT_LNK);
+
+                switch (dirEntry->d_type) {
+                case DT_DIR:
+                    type = DirectoryEntries::DirEntry;
+                    break;
+
+                case DT_REG:
+                    type = DirectoryEntries::FileEntry;
+                    break;
+
+                case DT_UNKNOWN:
+                    type = statType(dirFd, name, AT_SYMLINK_NOFOLLOW, isLink);
+                    break;
+
+                default:
+                    break;
+                }
+
+                if (isLink && criteria.followSymlinks) {
+                    bool targetIsLink(false);
+                    type = statType(dirFd, name, 0, targetIsLink);
+                }
+
+                if (type == DirectoryEntries::DirEntry && (!isLink || criteria.followSymlinks)) {
+                    pushTask(worker, dir, QByteArray(name, length));
+                }
+
+                if ((criteria.types == SearchCriteria::FilesOnly && type == DirectoryEntries::DirEntry)
+                        || (criteria.types == SearchCriteria::DirsOnly && type != DirectoryEntries::DirEntry)
+                        || !nameMatcher.matchesName(name, length)) {
+                    continue;
+                }
+
+                SearchResult result;
+                result.type = type;
+                result.size = -1;
+                result.mtime = -1;
+
+                struct statx stx;
+
+                if (statx(dirFd, name, (criteria.followSymlinks ? 0 : AT_SYMLINK_NOFOLLOW) | AT_NO_AUTOMOUNT, SearchStatMask, &stx) == 0) {
+                    result.size = static_cast<qint64>(stx.stx_size);
+                    result.mtime = static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+                }
+
+                if (!matchesMetadata(result)) {
+                    continue;
+                }
+
+                result.path = QFile::decodeName(pathPrefix + QByteArray(name, length));
+                results.append(result);
+            }
+        }
+
+        statistics.scannedDirs.ref();
+    }
+
+    /*!
+     * \brief Checks if the size and modification time of a result meet the criteria.
+     * \param result = The result
+     * \return A Boolean value that is false if the metadata is needed but could not be fetched
+     * \note The size criteria only apply to files, so directories never match them.
+     */
+    bool matchesMetadata(const SearchResult &result) const
+    {
+        if (criteria.minSize >= 0 || criteria.maxSize >= 0) {
+            if (result.type != DirectoryEntries::FileEntry || result.size < 0
+                    || (criteria.minSize >= 0 && result.size < criteria.minSize)
+                    || (criteria.maxSize >= 0 && result.size > criteria.maxSize)) {
+                return false;
+            }
+        }
+
+        if (criteria.modifiedAfter >= 0 || criteria.modifiedBefore >= 0) {
+            if (result.mtime < 0
+                    || (criteria.modifiedAfter >= 0 && result.mtime < criteria.modifiedAfter)
+                    || (criteria.modifiedBefore >= 0 && result.mtime > criteria.modifiedBefore)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Records that a directory has been visited.
+     * \param device = The device of the directory
+     * \param inode = The inode of the directory
+     * \return A Boolean value that is false if the directory had already been visited
+     */
+    bool markVisited(quint64 device, quint64 inode)
+    {
+        VisitedShard &shard(visitedShards[inode % VisitedShardCount]);
+        QMutexLocker locker(&shard.mutex);
+
+        const QPair<quint64, quint64> dir(device, inode);
+
+        if (shard.dirs.contains(dir)) {
+            return false;
+        }
+
+        shard.dirs.insert(dir);
+        return true;
+    }
+
+    /*!
+     * \brief Provides the type of an entry whose type was not reported by getdents64.
+     * \param dirFd = The file descriptor of the directory
+     * \param name = The name of the entry
+     * \param flags = The statx flags
+     * \param isLink = Set to true if the entry is a symbolic link
+     * \return The DirectoryEntries::EntryType
+     */
+    static DirectoryEntries::EntryType statType(int dirFd, const char *name, int flags, bool &isLink)
+    {
+        struct statx stx;
+
+        if (statx(dirFd, name, flags | AT_NO_AUTOMOUNT, STATX_TYPE, &stx) != 0) {
+            return DirectoryEntries::OtherEntry;
+        }
+
+        isLink = S_ISLNK(stx.stx_mode);
+
+        if (S_ISDIR(stx.stx_mode)) {
+            return DirectoryEntries::DirEntry;
+        }
+
+        return S_ISREG(stx.stx_mode) ? DirectoryEntries::FileEntry : DirectoryEntries::OtherEntry;
+    }
+};
+#else
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+FileSearch::FileSearch(QObject *parent) :
+    QObject(parent),
+    statistics(new SearchStatistics())
+{
+    connect(&searchWatcher, &QFutureWatcher<QVector<SearchResult>>::resultsReadyAt, this, &FileSearch::resultsReadyAt);
+    connect(&searchWatcher, &QFutureWatcher<QVector<SearchResult>>::finished, this, &FileSearch::finished);
+}
+
+/*!
+ * \brief The destructor
+ * \note A running search is canceled and finishes in the background.
+ */
+FileSearch::~FileSearch()
+{
+    cancel();
+}
+
+/*!
+ * \brief Starts a search and cancels the previous one.
+ * \param rootPath = The directory whose tree is searched
+ * \param criteria = The criteria that the entries have to meet
+ */
+void FileSearch::start(const QString &rootPath, const SearchCriteria &criteria)
+{
+    cancel();
+
+    statistics = QSharedPointer<SearchStatistics>::create();
+    searchWatcher.setFuture(QtConcurrent::run(&FileSearch::search, QDir::cleanPath(QDir(rootPath).absolutePath()), criteria, statistics));
+}
+
+/*!
+ * \brief Cancels the search.
+ * \note The results that have not been reported yet are dropped.
+ */
+void FileSearch::cancel()
+{
+    if (searchWatcher.isRunning()) {
+        searchWatcher.cancel();
+    }
+}
+
+/*!
+ * \brief Checks if the search is running.
+ * \return A Boolean value
+ */
+bool FileSearch::isRunning() const
+{
+    return searchWatcher.isRunning();
+}
+
+/*!
+ * \brief Provides the amount of directories that have been searched.
+ * \return An integer
+ */
+int FileSearch::scannedDirCount() const
+{
+    return statistics->scannedDirs.loadRelaxed();
+}
+
+/*!
+ * \brief Provides the amount of directories that could not be searched, usually because of their permissions.
+ * \return An integer
+ */
+int FileSearch::failedDirCount() const
+{
+    return statistics->failedDirs.loadRelaxed();
+}
+
+/*!
+ * \brief Reports the batches of results found by the workers.
+ * \param first = The position of the first new batch
+ * \param last = The position after the last new batch
+ */
+void FileSearch::resultsReadyAt(int first, int last)
+{
+    if (searchWatcher.isCanceled()) {
+        return;
+    }
+
+    for (int i(first); i < last; ++i) {
+        emit resultsFound(searchWatcher.resultAt(i));
+    }
+}
+
+/*!
+ * \brief Searches the tree below a directory.
+ * \param promise = The promise to which the batches of results are reported
+ * \param rootPath = The clean absolute path of the directory
+ * \param criteria = The criteria that the entries have to meet
+ * \param stats = The counters of the search
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * On Linux the tree is walked by one worker per core. Other platforms fall back to a single QDirIterator.
+ */
+void FileSearch::search(QPromise<QVector<SearchResult>> &promise, const QString &rootPath, const SearchCriteria &criteria,
+                        const QSharedPointer<SearchStatistics> &stats)
+{
+#if defined (Q_OS_LINUX)
+    SearchWalker walker(promise, criteria, *stats, qMax(1, QThread::idealThreadCount()));
+    walker.walk(QFile::encodeName(rootPath));
+#else
+    const NameMatcher nameMatcher(criteria.namePattern);
+    QDir::Filters filters(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System);
+    QVector<SearchResult> results;
+
+    if (criteria.includeHidden) {
+        filters |= QDir::Hidden;
+    }
+
+    QDirIterator dirIterator(rootPath, filters, criteria.followSymlinks ? (QDirIterator::Subdirectories | QDirIterator::FollowSymlinks)
+                                                                      : QDirIterator::Subdirectories);
+
+    while (dirIterator.hasNext() && !promise.isCanceled()) {
+        dirIterator.next();
+
+        const QFileInfo info(dirIterator.fileInfo());
+        const QByteArray name(info.fileName().toUtf8());
+
+        if (info.isDir()) {
+            stats->scannedDirs.ref();
+        }
+
+        if ((criteria.types == SearchCriteria::FilesOnly && info.isDir()) || (criteria.types == SearchCriteria::DirsOnly && !info.isDir())
+                || !nameMatcher.matchesName(name.constData(), name.size())) {
+            continue;
+        }
+
+        const qint64 mtime(info.lastModified().toMSecsSinceEpoch());
+
+        if ((criteria.minSize >= 0 && (!info.isFile() || info.size() < criteria.minSize))
+                || (criteria.maxSize >= 0 && (!info.isFile() || info.size() > criteria.maxSize))
+                || (criteria.modifiedAfter >= 0 && mtime < criteria.modifiedAfter)
+                || (criteria.modifiedBefore >= 0 && mtime > criteria.modifiedBefore)) {
+            continue;
+        }
+
+        SearchResult result;
+        result.path = info.filePath();
+        result.type = info.isDir() ? DirectoryEntries::DirEntry : (info.isFile() ? DirectoryEntries::FileEntry : DirectoryEntries::OtherEntry);
+        result.size = info.size();
+        result.mtime = mtime;
+        results.append(result);
+
+        if (results.count() >= 256) {
+            promise.addResult(results);
+            results.clear();
+        }
+    }
+
+    if (!results.isEmpty() && !promise.isCanceled()) {
+        promise.addResult(results);
+    }
+#endif
+}
@@ -0,0 +1,100 @@
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+#include "directoryentries.h"
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief The conditions that the entries found by a FileSearch have to meet.
+ */
+struct SearchCriteria
+{
+    /*!
+     * \brief The types of entries that are found.
+     */
+    enum EntryTypes {
+        AnyType,    ///< 0
+        FilesOnly,  ///< 1
+        DirsOnly    ///< 2
+    };
+
+    QString namePattern;            ///< The NameMatcher query the names have to match, which is empty to match every name.
+    EntryTypes types = AnyType;     ///< The types of entries that are found.
+    qint64 minSize = -1;            ///< The minimum size of the files in bytes, or -1 if there is no minimum.
+    qint64 maxSize = -1;            ///< The maximum size of the files in bytes, or -1 if there is no maximum.
+    qint64 modifiedAfter = -1;      ///< The earliest modification time in milliseconds since the epoch, or -1.
+    qint64 modifiedBefore = -1;     ///< The latest modification time in milliseconds since the epoch, or -1.
+    bool includeHidden = true;      ///< Whether hidden entries and the contents of hidden directories are searched.
+    bool followSymlinks = false;    ///< Whether symbolic links to directories are searched.
+};
+
+/*!
+ * \brief An entry found by a FileSearch.
+ */
+struct SearchResult
+{
+    QString path;       ///< The full path of the entry.
+    quint8 type;        ///< The DirectoryEntries::EntryType of the entry.
+    qint64 size;        ///< The size in bytes, or -1 if it has not been fetched.
+    qint64 mtime;       ///< The last modification time in milliseconds since the epoch, or -1 if it has not been fetched.
+};
+
+/*!
+ * \brief The counters of a running FileSearch, which are updated by its workers.
+ */
+struct SearchStatistics
+{
+    QAtomicInt scannedDirs;     ///< The amount of directories that have been read.
+    QAtomicInt failedDirs;      ///< The amount of directories that could not be opened or read.
+};
+
+/*!
+ * \brief A recursive search through a directory tree.
+ *
+ * The tree is walked by a pool of workers that each keep their own queue of directories. A worker handles the
+ * directories it finds itself last in, first out, so it stays close to the directories it has just read, and steals the
+ * oldest directory of another worker once its own queue is empty, which is usually the root of a large subtree. On
+ * Linux every directory is opened relative to its parent with openat() and read with getdents64, and the metadata is
+ * only fetched for the names that match when the criteria need it. Directories are identified by their device and
+ * inode, so a loop of symbolic links or bind mounts is only searched once.
+ *
+ * The results are reported in batches while the search is running.
+ * \note The search may only be used from the GUI thread.
+ */
+class FileSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileSearch(QObject *parent = nullptr);
+    ~FileSearch();
+    void start(const QString &rootPath, const SearchCriteria &criteria);
+    void cancel();
+    bool isRunning() const;
+    int scannedDirCount() const;
+    int failedDirCount() const;
+
+signals:
+    void resultsFound(const QVector<SearchResult> &results);   ///< Emitted with every batch of results.
+    void finished();    ///< Emitted when the search has walked the whole tree or has been canceled.
+
+private:
+    QFutureWatcher<QVector<SearchResult>> searchWatcher;    ///< Watches the running search.
+    QSharedPointer<SearchStatistics> statistics;            ///< The counters of the current search.
+
+    void resultsReadyAt(int first, int last);
+
+    static void search(QPromise<QVector<SearchResult>> &promise, const QString &rootPath, const SearchCriteria &criteria,
+                       const QSharedPointer<SearchStatistics> &stats);
+};
+
+Q_DECLARE_METATYPE(SearchResult)
+
+#endif // FILESEARCH_H
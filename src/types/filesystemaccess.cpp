@@ -0,0 +1,230 @@
+#include "filesystemaccess.h"
+#include "mimesniffer.h"
+#include "mountmonitor.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSharedPointer>
+#include <QThread>
+#include <QTimer>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+FileSystemAccess::FileSystemAccess(QObject *parent) :
+    QObject(parent)
+{
+    clock.start();
+}
+
+/*!
+ * \brief The destructor
+ * \note A worker that hangs on a dead mount would block the exit forever, so the workers that are still busy are left
+ * behind. Their threads end with the process.
+ */
+FileSystemAccess::~FileSystemAccess()
+{
+    for (Mount &mount : mounts) {
+        for (QThreadPool *pool : {mount.pool, mount.readerPool, mount.backgroundPool}) {
+            pool->clear();
+
+            if (pool->activeThreadCount() == 0) {
+                delete pool;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the FileSystemAccess
+ * \note The service is bound to the application object and deleted with it.
+ */
+FileSystemAccess *FileSystemAccess::instance()
+{
+    static FileSystemAccess *access(new FileSystemAccess(QCoreApplication::instance()));
+    return access;
+}
+
+/*!
+ * \brief Looks at a set of paths on the worker of their mount.
+ * \param paths = The absolute paths, which are expected to be on the same mount as the first one
+ * \param detectMimeType = Whether the MIME types of the files are detected as well
+ * \return A QFuture with the AccessResult, which is finished on the GUI thread within Deadline
+ */
+QFuture<AccessResult> FileSystemAccess::stat(const QStringList &paths, bool detectMimeType)
+{
+    const QSharedPointer<Request> request(new Request());
+    const QString mountPath(MountMonitor::instance()->mountFor(paths.value(0)).path);
+    request->promise.start();
+
+    QFuture<AccessResult> recordedFuture(request->promise.future().then(this, [this](const AccessResult &result) {
+        recordResult(result);
+        return result;
+    }));
+
+    AccessResult result;
+    result.mountPath = mountPath;
+
+    if (!isAvailable(paths.value(0))) {
+        result.status = AccessResult::Unavailable;
+        finish(*request, result);
+        return recordedFuture;
+    }
+
+    Mount &mount(mountOf(paths.value(0)));
+
+    QTimer::singleShot(Deadline, this, [request, result]() {
+        AccessResult timedOut(result);
+        timedOut.status = AccessResult::TimedOut;
+        finish(*request, timedOut);
+    });
+
+    mount.pool->start([request, result, paths, detectMimeType]() {
+        AccessResult answer(result);
+        answer.infos = statPaths(paths, detectMimeType);
+        finish(*request, answer);
+    });
+
+    return recordedFuture;
+}
+
+/*!
+ * \brief Checks if the mount of a path may be asked.
+ * \param path = The absolute path
+ * \return A boolean value that is false if the mount is stale or its circuit is open
+ */
+bool FileSystemAccess::isAvailable(const QString &path) const
+{
+    const MountPoint mountPoint(MountMonitor::instance()->mountFor(path));
+
+    if (mountPoint.stale) {
+        return false;
+    }
+
+    const auto mount(mounts.constFind(mountPoint.path));
+
+    return mount == mounts.constEnd() || mount->openUntil <= clock.elapsed();
+}
+
+/*!
+ * \brief Provides the threads on which the directories and the metadata of a mount are read.
+ * \param path = The absolute path of a directory on the mount
+ * \return A pointer to the QThreadPool, which is owned by the service
+ */
+QThreadPool *FileSystemAccess::readerPool(const QString &path)
+{
+    return mountOf(path).readerPool;
+}
+
+/*!
+ * \brief Provides the threads on which the directories of a mount are read speculatively.
+ * \param path = The absolute path of a directory on the mount
+ * \return A pointer to the QThreadPool, which is owned by the service
+ * \note The threads run at idle CPU priority and never run anything but speculative reads.
+ */
+QThreadPool *FileSystemAccess::backgroundPool(const QString &path)
+{
+    return mountOf(path).backgroundPool;
+}
+
+/*!
+ * \brief Provides the mount that holds a path, together with its workers.
+ * \param path = The absolute path
+ * \return A reference to the Mount, whose workers are created the first time it is used
+ */
+FileSystemAccess::Mount &FileSystemAccess::mountOf(const QString &path)
+{
+    Mount &mount(mounts[MountMonitor::instance()->mountFor(path).path]);
+
+    if (mount.pool == nullptr) {
+        mount.pool = new QThreadPool();
+        mount.pool->setMaxThreadCount(1);
+        mount.readerPool = new QThreadPool();
+        mount.readerPool->setMaxThreadCount(ReaderThreads);
+        mount.backgroundPool = new QThreadPool();
+        mount.backgroundPool->setMaxThreadCount(BackgroundThreads);
+        mount.backgroundPool->setThreadPriority(QThread::IdlePriority);
+    }
+
+    return mount;
+}
+
+/*!
+ * \brief Updates the circuit breaker of a mount with the outcome of a request.
+ * \param result = The outcome
+ * \note An answer in time closes the circuit, and the MaxFailures-th timeout in a row opens it. A timeout after a
+ * cooldown opens it again at once, since the failures are only reset by an answer.
+ */
+void FileSystemAccess::recordResult(const AccessResult &result)
+{
+    if (result.status == AccessResult::Unavailable || !mounts.contains(result.mountPath)) {
+        return;
+    }
+
+    Mount &mount(mounts[result.mountPath]);
+
+    if (result.status == AccessResult::Done) {
+        mount.failures = 0;
+        mount.openUntil = 0;
+        return;
+    }
+
+    ++mount.failures;
+
+    if (mount.failures >= MaxFailures && mount.openUntil <= clock.elapsed()) {
+        mount.openUntil = clock.elapsed() + CooldownTime;
+        emit mountUnavailable(result.mountPath);
+    }
+}
+
+/*!
+ * \brief Reports the result of a request, unless its worker or its deadline has already reported one.
+ * \param request = The request
+ * \param result = The result
+ * \return A boolean value that is true if this result was reported
+ * \note This function may be called from any thread.
+ */
+bool FileSystemAccess::finish(Request &request, const AccessResult &result)
+{
+    if (!request.finished.testAndSetOrdered(0, 1)) {
+        return false;
+    }
+
+    request.promise.addResult(result);
+    request.promise.finish();
+
+    return true;
+}
+
+/*!
+ * \brief Looks at a set of paths.
+ * \param paths = The absolute paths
+ * \param detectMimeType = Whether the MIME types of the files are detected as well
+ * \return A QVector of PathInfo in the order of the paths
+ * \note This function is meant to be run on the worker of a mount and may hang for as long as the mount does.
+ */
+QVector<PathInfo> FileSystemAccess::statPaths(const QStringList &paths, bool detectMimeType)
+{
+    QVector<PathInfo> infos;
+    infos.reserve(paths.count());
+
+    for (const QString &path : paths) {
+        const QFileInfo fileInfo(path);
+
+        PathInfo info;
+        info.path = path;
+        info.exists = fileInfo.exists();
+        info.isDir = fileInfo.isDir();
+        info.isExecutable = fileInfo.isExecutable();
+
+        if (detectMimeType && info.exists && !info.isDir) {
+            info.mimeName = MimeSniffer::instance()->mimeTypeForFile(path);
+        }
+
+        infos.append(info);
+    }
+
+    return infos;
+}
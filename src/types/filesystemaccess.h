@@ -0,0 +1,113 @@
+#ifndef FILESYSTEMACCESS_H
+#define FILESYSTEMACCESS_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QPromise>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+/*!
+ * \brief What is known about a path.
+ */
+struct PathInfo
+{
+    QString path;               ///< The path.
+    bool exists = false;        ///< Whether the path exists.
+    bool isDir = false;         ///< Whether the path is a directory, after following symbolic links.
+    bool isExecutable = false;  ///< Whether the path may be executed by the user.
+    QString mimeName;           ///< The MIME type of a file, which is only detected on request.
+};
+
+/*!
+ * \brief The outcome of a request to the FileSystemAccess.
+ */
+struct AccessResult
+{
+    enum Status {
+        Done,           ///< 0
+        TimedOut,       ///< 1 (the file system did not answer before the deadline)
+        Unavailable     ///< 2 (the file system is known not to answer, so it was not asked)
+    };
+
+    Status status = Done;       ///< Whether the paths could be looked at.
+    QString mountPath;          ///< The mount on which the paths were looked at.
+    QVector<PathInfo> infos;    ///< What is known about every path, which is empty unless the status is Done.
+};
+
+/*!
+ * \brief The layer through which the GUI thread looks at the file system without ever waiting for it.
+ *
+ * Every request is run on the worker thread of the mount that holds its paths, so a mount that hangs only holds up its
+ * own requests. A request that is not answered within Deadline is reported as timed out, while the worker keeps
+ * waiting for the file system in the background. Every mount also has a few reader threads, on which the listings
+ * read directories and fetch metadata, and an idle priority thread for speculative reads. A hung mount therefore only
+ * ties up its own threads, never the global thread pool that the views sort on.
+ *
+ * Every mount has a circuit breaker. After MaxFailures timeouts in a row, the mount is not asked again for CooldownTime
+ * and its requests are reported as unavailable at once, so a dead network share can not pile up requests. After the
+ * cooldown the mount is asked again, and a single answer in time closes the circuit. Mounts that the MountMonitor
+ * reports as stale are unavailable as well.
+ * \note The service may only be used from the GUI thread. The returned futures are finished on the GUI thread as well,
+ * so their continuations may use the widgets.
+ */
+class FileSystemAccess : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FileSystemAccess *instance();
+    QFuture<AccessResult> stat(const QStringList &paths, bool detectMimeType = false);
+    bool isAvailable(const QString &path) const;
+    QThreadPool *readerPool(const QString &path);
+    QThreadPool *backgroundPool(const QString &path);
+
+signals:
+    void mountUnavailable(const QString &mountPath);    ///< Emitted when the circuit of a mount opens.
+
+private:
+    static const int Deadline = 1500;           ///< The time in milliseconds after which a request is reported as timed out.
+    static const int MaxFailures = 3;           ///< The amount of timeouts in a row after which the circuit of a mount opens.
+    static const int CooldownTime = 30000;      ///< The time in milliseconds for which a mount with an open circuit is not asked.
+    static const int ReaderThreads = 3;         ///< The amount of threads per mount that read directories and metadata.
+    static const int BackgroundThreads = 1;     ///< The amount of threads per mount that read directories speculatively.
+
+    /*!
+     * \brief The worker and the circuit breaker of a mount.
+     */
+    struct Mount
+    {
+        QThreadPool *pool = nullptr;    ///< The worker that looks at the paths on the mount.
+        QThreadPool *readerPool = nullptr;      ///< The workers that read directories and metadata on the mount.
+        QThreadPool *backgroundPool = nullptr;  ///< The workers that read directories on the mount speculatively, at idle priority.
+        int failures = 0;               ///< The amount of timeouts in a row.
+        qint64 openUntil = 0;           ///< Until when the circuit is open, on the clock of the service.
+    };
+
+    /*!
+     * \brief A request that is finished by its worker or by its deadline, whichever comes first.
+     */
+    struct Request
+    {
+        QPromise<AccessResult> promise;     ///< The promise of the result.
+        QAtomicInt finished;                ///< Whether the result has been reported.
+    };
+
+    QHash<QString, Mount> mounts;   ///< The mounts that have been asked, keyed by mount path.
+    QElapsedTimer clock;            ///< The clock on which the circuits are timed.
+
+    explicit FileSystemAccess(QObject *parent = nullptr);
+    ~FileSystemAccess();
+    Mount &mountOf(const QString &path);
+    void recordResult(const AccessResult &result);
+
+    static bool finish(Request &request, const AccessResult &result);
+    static QVector<PathInfo> statPaths(const QStringList &paths, bool detectMimeType);
+};
+
+#endif // FILESYSTEMACCESS_H
@@ -0,0 +1,337 @@
+#include "foldersizeservice.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined (Q_OS_LINUX)
+/*!
+ * \brief Provides the device of a statx result as a single number.
+ * \param stx = The statx result
+ * \return The major number in the upper and the minor number in the lower 32 bits
+ */
+static quint64 statxDevice(const struct statx &stx)
+{
+    return (static_cast<quint64>(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+}
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ * \note Half of the available cores are used for walking, but never more than four, since the walk is bound by I/O.
+ */
+FolderSizeService::FolderSizeService(QObject *parent) :
+    QObject(parent)
+{
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+}
+
+/*!
+ * \brief The destructor
+ * \note The running jobs are canceled and waited for, since they use the directory cache.
+ */
+FolderSizeService::~FolderSizeService()
+{
+    for (Job &job : jobs) {
+        job.watcher->cancel();
+    }
+
+    pool.waitForDone();
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the FolderSizeService
+ * \note The service is bound to the application object and deleted with it.
+ */
+FolderSizeService *FolderSizeService::instance()
+{
+    static FolderSizeService *service(new FolderSizeService(QCoreApplication::instance()));
+    return service;
+}
+
+/*!
+ * \brief Provides the last known size of a folder.
+ * \param dirPath = The clean path of the folder
+ * \return A FolderSize whose bytes are -1 if the folder has not been counted yet
+ */
+FolderSize FolderSizeService::folderSize(const QString &dirPath) const
+{
+    return sizes.value(dirPath);
+}
+
+/*!
+ * \brief Starts counting a folder unless its size is recent or it is already being counted.
+ * \param dirPath = The clean path of the folder
+ * \param requester = The object requesting the size, which can cancel the request later
+ * \note sizeChanged() is emitted with every partial total and with the final size.
+ */
+void FolderSizeService::requestSize(const QString &dirPath, const QObject *requester)
+{
+    if (jobs.contains(dirPath)) {
+        return;
+    }
+
+    const auto countTime(countTimes.constFind(dirPath));
+
+    if (countTime != countTimes.constEnd() && QDateTime::currentMSecsSinceEpoch() - countTime.value() < RefreshInterval) {
+        return;
+    }
+
+    Job &job(jobs[dirPath]);
+    job.watcher = new QFutureWatcher<FolderSize>(this);
+    job.requester = requester;
+
+    connect(job.watcher, &QFutureWatcher<FolderSize>::resultReadyAt, this, [this, dirPath](int resultIndex) {
+        const auto runningJob(jobs.constFind(dirPath));
+
+        if (runningJob == jobs.constEnd()) {
+            return;
+        }
+
+        const FolderSize size(runningJob->watcher->resultAt(resultIndex));
+
+        // A partial total never hides a complete size from an earlier count, which is usually closer to the truth.
+        if (size.complete || !sizes.value(dirPath).complete) {
+            sizes.insert(dirPath, size);
+            emit sizeChanged(dirPath);
+        }
+    });
+    connect(job.watcher, &QFutureWatcher<FolderSize>::finished, this, [this, dirPath]() {
+        jobFinished(dirPath);
+    });
+
+    job.watcher->setFuture(QtConcurrent::run(&pool, &FolderSizeService::countFolder, this, dirPath));
+}
+
+/*!
+ * \brief Cancels the jobs requested by an object.
+ * \param requester = The object that requested the sizes
+ * \note The partial totals of the canceled jobs are kept, and the folders are counted again on the next request.
+ */
+void FolderSizeService::cancelRequests(const QObject *requester)
+{
+    for (Job &job : jobs) {
+        if (job.requester == requester) {
+            job.watcher->cancel();
+        }
+    }
+}
+
+/*!
+ * \brief Counts the tree below a folder.
+ * \param promise = The promise to which the partial and final totals are reported
+ * \param dirPath = The clean path of the folder
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+void FolderSizeService::countFolder(QPromise<FolderSize> &promise, const QString &dirPath)
+{
+    const QByteArray encodedPath(QFile::encodeName(dirPath));
+    quint64 rootDevice(0);
+
+#if defined (Q_OS_LINUX)
+    struct statx rootStat;
+
+    if (statx(AT_FDCWD, encodedPath.constData(), AT_NO_AUTOMOUNT, STATX_TYPE, &rootStat) != 0 || !S_ISDIR(rootStat.stx_mode)) {
+        return;
+    }
+
+    rootDevice = statxDevice(rootStat);
+#endif
+
+    QVector<QByteArray> pendingDirs({encodedPath});
+    QSet<QPair<quint64, quint64>> countedLinks;
+    FolderSize size;
+    QElapsedTimer reportTimer;
+
+    size.bytes = 0;
+    reportTimer.start();
+
+    while (!pendingDirs.isEmpty()) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const QByteArray path(pendingDirs.takeLast());
+        CachedDir dir;
+
+        if (!readDirectory(path, rootDevice, dir)) {
+            continue;
+        }
+
+        size.bytes += dir.ownBytes;
+        size.fileCount += dir.fileCount;
+
+        for (const HardLink &hardLink : qAsConst(dir.hardLinks)) {
+            if (!countedLinks.contains(qMakePair(hardLink.device, hardLink.inode))) {
+                countedLinks.insert(qMakePair(hardLink.device, hardLink.inode));
+                size.bytes += hardLink.bytes;
+            }
+        }
+
+        for (const QByteArray &subdir : qAsConst(dir.subdirs)) {
+            pendingDirs.append(path.endsWith('/') ? path + subdir : path + '/' + subdir);
+        }
+
+        if (reportTimer.elapsed() >= ReportInterval) {
+            promise.addResult(size);
+            reportTimer.restart();
+        }
+    }
+
+    size.complete = true;
+    promise.addResult(size);
+}
+
+/*!
+ * \brief Provides what a directory holds itself, from the cache if the directory has not changed.
+ * \param dirPath = The encoded path of the directory
+ * \param rootDevice = The device of the folder that is being counted
+ * \param dir = Set to what the directory holds
+ * \return A Boolean value that is false if the directory could not be read or belongs to another file system
+ * \note A cached directory is only used if its modification time matches and it has been read within MaxCacheAge.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note Other platforms read every directory, since they do not expose the inode of a directory.
+ */
+bool FolderSizeService::readDirectory(const QByteArray &dirPath, quint64 rootDevice, CachedDir &dir)
+{
+#if defined (Q_OS_LINUX)
+    struct statx dirStat;
+
+    if (statx(AT_FDCWD, dirPath.constData(), AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_INO | STATX_MTIME | STATX_BLOCKS, &dirStat) != 0
+            || !S_ISDIR(dirStat.stx_mode) || statxDevice(dirStat) != rootDevice) {
+        return false;
+    }
+
+    const QPair<quint64, quint64> key(rootDevice, dirStat.stx_ino);
+    const qint64 mtime(static_cast<qint64>(dirStat.stx_mtime.tv_sec) * 1000000000 + dirStat.stx_mtime.tv_nsec);
+    const qint64 now(QDateTime::currentMSecsSinceEpoch());
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        const auto cachedDir(dirCache.constFind(key));
+
+        if (cachedDir != dirCache.constEnd() && cachedDir->mtime == mtime && now - cachedDir->readTime < MaxCacheAge) {
+            dir = cachedDir.value();
+            return true;
+        }
+    }
+
+    const int dirFd(::open(dirPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW));
+
+    if (dirFd < 0) {
+        return false;
+    }
+
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    dir.mtime = mtime;
+    dir.readTime = now;
+    dir.ownBytes = static_cast<qint64>(dirStat.stx_blocks) * 512;
+
+    forever {
+        const long bytesRead(syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size()));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        for (long pos(0); pos < bytesRead;) {
+            const struct dirent64 *dirEntry(reinterpret_cast<const struct dirent64 *>(buffer.constData() + pos));
+            pos += dirEntry->d_reclen;
+
+            const char *name(dirEntry->d_name);
+            struct statx entryStat;
+
+            if ((name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                    || statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_INO | STATX_NLINK | STATX_BLOCKS, &entryStat) != 0) {
+                continue;
+            }
+
+            if (S_ISDIR(entryStat.stx_mode)) {
+                if (statxDevice(entryStat) == rootDevice) {
+                    dir.subdirs.append(QByteArray(name));
+                }
+                continue;
+            }
+
+            const qint64 bytes(static_cast<qint64>(entryStat.stx_blocks) * 512);
+            ++dir.fileCount;
+
+            if (entryStat.stx_nlink > 1) {
+                dir.hardLinks.append(HardLink{rootDevice, entryStat.stx_ino, bytes});
+            } else {
+                dir.ownBytes += bytes;
+            }
+        }
+    }
+
+    ::close(dirFd);
+
+    QMutexLocker locker(&cacheMutex);
+
+    if (dirCache.count() >= MaxCachedDirs && !dirCache.contains(key)) {
+        dirCache.clear();
+    }
+
+    dirCache.insert(key, dir);
+    return true;
+#else
+    Q_UNUSED(rootDevice)
+
+    const QFileInfoList infos(QDir(QFile::decodeName(dirPath)).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System));
+
+    for (const QFileInfo &info : infos) {
+        if (info.isDir()) {
+            if (!info.isSymLink()) {
+                dir.subdirs.append(QFile::encodeName(info.fileName()));
+            }
+        } else {
+            ++dir.fileCount;
+            dir.ownBytes += info.size();
+        }
+    }
+
+    return true;
+#endif
+}
+
+/*!
+ * \brief Removes a job once it has finished or has been canceled.
+ * \param dirPath = The clean path of the folder of the job
+ */
+void FolderSizeService::jobFinished(const QString &dirPath)
+{
+    const Job job(jobs.take(dirPath));
+    const QFuture<FolderSize> future(job.watcher->future());
+
+    if (!future.isCanceled() && future.resultCount() > 0 && future.resultAt(future.resultCount() - 1).complete) {
+        const qint64 now(QDateTime::currentMSecsSinceEpoch());
+        countTimes.insert(dirPath, now);
+
+        // Folders counted longer than RefreshInterval ago are counted again anyway, so their times are only dropped.
+        if (countTimes.count() > MaxCountTimes) {
+            countTimes.removeIf([now](const QHash<QString, qint64>::iterator &countTime) {
+                return now - countTime.value() >= RefreshInterval;
+            });
+        }
+    }
+
+    job.watcher->deleteLater();
+}
@@ -0,0 +1,106 @@
+#ifndef FOLDERSIZESERVICE_H
+#define FOLDERSIZESERVICE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QPromise>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+/*!
+ * \brief The size of the tree below a folder.
+ */
+struct FolderSize
+{
+    qint64 bytes = -1;          ///< The disk usage in bytes, or -1 if it is not known yet.
+    qint64 fileCount = 0;       ///< The amount of files.
+    bool complete = false;      ///< Whether the whole tree has been counted, or the size is a partial total.
+};
+
+/*!
+ * \brief The service that computes the sizes of folders in the background.
+ *
+ * Every folder is counted by a job on a bounded thread pool, so the folders of a directory are counted in parallel.
+ * Jobs report their partial totals every ReportInterval milliseconds, so sizes grow in the views while the trees are
+ * being walked. Files with several hard links are counted once per job, and the walk does not leave the file system
+ * of the folder.
+ *
+ * What every directory holds itself is cached by device and inode and stays valid as long as the modification time
+ * of the directory does not change, for at most MaxCacheAge milliseconds. Counting a folder again soon after only reads
+ * the directories that have gained, lost or renamed entries, and merely stat's the others. Files that grow in place do
+ * not change the modification time of their directory, so every directory is read again once its entry has expired.
+ * The cache is dropped as a whole once it holds MaxCachedDirs directories.
+ * \note The service may only be used from the GUI thread. The jobs share the directory cache under a mutex.
+ */
+class FolderSizeService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FolderSizeService *instance();
+    FolderSize folderSize(const QString &dirPath) const;
+    void requestSize(const QString &dirPath, const QObject *requester);
+    void cancelRequests(const QObject *requester);
+
+signals:
+    void sizeChanged(const QString &dirPath);   ///< Emitted when a partial or final size of a folder is known.
+
+private:
+    static const int ReportInterval = 100;      ///< The minimum time in milliseconds between two partial totals of a job.
+    static const int RefreshInterval = 30000;   ///< The time in milliseconds after which a counted folder is counted again.
+    static const int MaxCacheAge = RefreshInterval; ///< The time in milliseconds after which a cached directory is read again.
+    static const int MaxCachedDirs = 100000;    ///< The maximum amount of directories in the cache.
+    static const int MaxCountTimes = 4096;      ///< The amount of count times above which the expired ones are dropped.
+
+    /*!
+     * \brief A file with several hard links.
+     */
+    struct HardLink
+    {
+        quint64 device;     ///< The device of the file.
+        quint64 inode;      ///< The inode of the file.
+        qint64 bytes;       ///< The disk usage of the file.
+    };
+
+    /*!
+     * \brief What a directory holds itself, without its subdirectories.
+     */
+    struct CachedDir
+    {
+        qint64 mtime = 0;               ///< The modification time of the directory when it was read.
+        qint64 readTime = 0;            ///< When the directory was read, in milliseconds since the epoch.
+        qint64 ownBytes = 0;            ///< The disk usage of the directory and of its files that have a single link.
+        qint64 fileCount = 0;           ///< The amount of files.
+        QVector<QByteArray> subdirs;    ///< The names of the subdirectories on the same file system.
+        QVector<HardLink> hardLinks;    ///< The files with several hard links.
+    };
+
+    /*!
+     * \brief A folder that is being counted.
+     */
+    struct Job
+    {
+        QFutureWatcher<FolderSize> *watcher;    ///< Watches the partial and final totals.
+        const QObject *requester;               ///< The object that requested the size.
+    };
+
+    QThreadPool pool;                               ///< The workers that walk the trees.
+    QMutex cacheMutex;                              ///< Guards the directory cache.
+    QHash<QPair<quint64, quint64>, CachedDir> dirCache;     ///< What every directory read so far holds, keyed by device and inode.
+    QHash<QString, FolderSize> sizes;               ///< The last known size of every folder, keyed by path.
+    QHash<QString, qint64> countTimes;              ///< When each folder was last counted completely, keyed by path.
+    QHash<QString, Job> jobs;                       ///< The running jobs, keyed by the path of their folder.
+
+    explicit FolderSizeService(QObject *parent = nullptr);
+    ~FolderSizeService();
+    void countFolder(QPromise<FolderSize> &promise, const QString &dirPath);
+    bool readDirectory(const QByteArray &dirPath, quint64 rootDevice, CachedDir &dir);
+    void jobFinished(const QString &dirPath);
+};
+
+#endif // FOLDERSIZESERVICE_H
@@ -0,0 +1,61 @@
+#include "historycache.h"
+
+/*!
+ * \brief The constructor
+ */
+HistoryCache::HistoryCache() :
+    snapshots(DefaultMaxMegabytes * 1024)
+{
+}
+
+/*!
+ * \brief Provides the cache shared by the whole application.
+ * \return A pointer to the HistoryCache
+ */
+HistoryCache *HistoryCache::instance()
+{
+    static HistoryCache cache;
+    return &cache;
+}
+
+/*!
+ * \brief Keeps a listing alive and marks it as the most recently used one.
+ * \param listing = The listing of a directory that is being left
+ * \note A listing that is larger than the whole cap is not retained.
+ */
+void HistoryCache::retain(const QSharedPointer<DirectoryListing> &listing)
+{
+    if (listing.isNull() || !listing->isLoaded()) {
+        return;
+    }
+
+    const qint64 cost(qMax<qint64>(1, listing->entries().memoryUsage() / 1024));
+    snapshots.insert(listing->path(), new QSharedPointer<DirectoryListing>(listing), cost);
+}
+
+/*!
+ * \brief Sets the memory cap of the retained listings.
+ * \param bytes = The cap in bytes
+ * \note The least recently used listings are dropped right away if the cache exceeds the new cap.
+ */
+void HistoryCache::setMaxBytes(qint64 bytes)
+{
+    snapshots.setMaxCost(qMax<qint64>(0, bytes / 1024));
+}
+
+/*!
+ * \brief Provides the memory cap of the retained listings.
+ * \return The cap in bytes
+ */
+qint64 HistoryCache::maxBytes() const
+{
+    return snapshots.maxCost() * 1024;
+}
+
+/*!
+ * \brief Drops all the retained listings.
+ */
+void HistoryCache::clear()
+{
+    snapshots.clear();
+}
@@ -0,0 +1,34 @@
+#ifndef HISTORYCACHE_H
+#define HISTORYCACHE_H
+
+#include "directorylisting.h"
+
+#include <QCache>
+#include <QSharedPointer>
+#include <QString>
+
+/*!
+ * \brief The cache that keeps the listings of the directories in the navigation history alive.
+ *
+ * A retained listing stays in the DirectoryCache, so going back or forward to its directory shows the entries right
+ * away instead of reading the directory again. The listings keep being updated by the DirectoryWatcher while they are
+ * retained. The least recently retained listings are dropped once their estimated memory exceeds the configured cap.
+ * \note The cache may only be used from the GUI thread.
+ */
+class HistoryCache
+{
+public:
+    static const int DefaultMaxMegabytes = 64;  ///< The default memory cap in MiB.
+
+    static HistoryCache *instance();
+    void retain(const QSharedPointer<DirectoryListing> &listing);
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    void clear();
+
+private:
+    HistoryCache();
+    QCache<QString, QSharedPointer<DirectoryListing>> snapshots;   ///< The retained listings keyed by path, with their memory in KiB as cost.
+};
+
+#endif // HISTORYCACHE_H
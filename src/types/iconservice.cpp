@@ -0,0 +1,338 @@
+#include "iconservice.h"
+#include "mimetypetable.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QIconEngine>
+#include <QMimeDatabase>
+#include <QPainter>
+#include <QtConcurrent/QtConcurrentRun>
+
+/*!
+ * \brief The icon engine of the shared icons, which renders through the pixmap cache of the IconService.
+ */
+class CachedIconEngine : public QIconEngine
+{
+public:
+    /*!
+     * \brief The constructor
+     * \param key = The key of the icon in the pixmap cache
+     * \param icon = The icon that is rendered
+     */
+    CachedIconEngine(const QString &key, const QIcon &icon) :
+        cacheKey(key),
+        baseIcon(icon)
+    {
+    }
+
+    /*!
+     * \brief Paints the icon.
+     * \param painter = The painter
+     * \param rect = The rectangle in which the icon is painted
+     * \param mode = The mode of the icon
+     * \param state = The state of the icon
+     */
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override
+    {
+        painter->drawPixmap(rect, pixmap(rect.size(), mode, state));
+    }
+
+    /*!
+     * \brief Provides the icon rendered at a size.
+     * \param size = The size
+     * \param mode = The mode of the icon
+     * \param state = The state of the icon
+     * \return A QPixmap that is taken from the cache when possible
+     */
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        return IconService::instance()->cachedPixmap(cacheKey, baseIcon, size, mode, state);
+    }
+
+    /*!
+     * \brief Provides the actual size of the icon at a requested size.
+     * \param size = The requested size
+     * \param mode = The mode of the icon
+     * \param state = The state of the icon
+     * \return A QSize
+     */
+    QSize actualSize(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        return baseIcon.actualSize(size, mode, state);
+    }
+
+    /*!
+     * \brief Provides the sizes in which the icon is available.
+     * \param mode = The mode of the icon
+     * \param state = The state of the icon
+     * \return A QList of QSize
+     */
+    QList<QSize> availableSizes(QIcon::Mode mode, QIcon::State state) override
+    {
+        return baseIcon.availableSizes(mode, state);
+    }
+
+    /*!
+     * \brief Provides the name of the icon.
+     * \return A QString
+     */
+    QString iconName() override
+    {
+        return baseIcon.name();
+    }
+
+    /*!
+     * \brief Provides a copy of the engine.
+     * \return A pointer to the new QIconEngine
+     */
+    QIconEngine *clone() const override
+    {
+        return new CachedIconEngine(cacheKey, baseIcon);
+    }
+
+private:
+    QString cacheKey;   ///< The key of the icon in the pixmap cache.
+    QIcon baseIcon;     ///< The icon that is rendered.
+};
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+IconService::IconService(QObject *parent) :
+    QObject(parent),
+    pixmaps(MaxPixmapBytes)
+{
+    requestTimer.setSingleShot(true);
+    requestTimer.setInterval(0);
+
+    connect(&requestTimer, &QTimer::timeout, this, &IconService::startResolving);
+    connect(&resolveWatcher, &QFutureWatcher<QVector<SuffixType>>::finished, this, &IconService::resolvingFinished);
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the IconService
+ * \note The service is bound to the application object and deleted with it.
+ */
+IconService *IconService::instance()
+{
+    static IconService *service(new IconService(QCoreApplication::instance()));
+    return service;
+}
+
+/*!
+ * \brief Sets the provider of the folder, drive and placeholder icons.
+ * \param provider = The icon provider
+ * \note The file icons that have already been created are dropped.
+ */
+void IconService::setIconProvider(const QSharedPointer<QAbstractFileIconProvider> &provider)
+{
+    icons = provider;
+    typeIcons.clear();
+    pixmaps.clear();
+    emit iconsResolved();
+}
+
+/*!
+ * \brief Provides the icon of a folder.
+ * \return A QIcon that is empty if there is no icon provider
+ */
+QIcon IconService::folderIcon() const
+{
+    return icons.isNull() ? QIcon() : icons->icon(QAbstractFileIconProvider::Folder);
+}
+
+/*!
+ * \brief Provides the icon of a drive.
+ * \return A QIcon that is empty if there is no icon provider
+ */
+QIcon IconService::driveIcon() const
+{
+    return icons.isNull() ? QIcon() : icons->icon(QAbstractFileIconProvider::Drive);
+}
+
+/*!
+ * \brief Provides the icon shown for files whose icon is not known yet.
+ * \return A QIcon that is empty if there is no icon provider
+ */
+QIcon IconService::placeholderIcon() const
+{
+    return icons.isNull() ? QIcon() : icons->icon(QAbstractFileIconProvider::File);
+}
+
+/*!
+ * \brief Provides the icon of a file.
+ * \param filePath = The path of the file
+ * \param mimeType = The ID of the file's MIME type in the MimeTypeTable, or 0 if it is not known yet
+ * \return A QIcon that is the placeholder icon until the icon has been resolved
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * If the MIME type is not known, the file is matched by its suffix. A suffix that has not been seen before is resolved
+ * on a worker thread and iconsResolved() is emitted once it is done. Other platforms than Linux ask the icon provider
+ * for one file of every suffix instead.
+ */
+QIcon IconService::fileIcon(const QString &filePath, quint16 mimeType)
+{
+    if (icons.isNull()) {
+        return QIcon();
+    }
+
+    const QString suffix(QFileInfo(filePath).suffix().toLower());
+
+#if defined (Q_OS_LINUX)
+    if (mimeType != 0) {
+        return mimeTypeIcon(MimeTypeTable::instance()->name(mimeType));
+    }
+
+    if (suffix.isEmpty()) {
+        return placeholderIcon();
+    }
+
+    const auto suffixType(suffixTypes.constFind(suffix));
+
+    if (suffixType == suffixTypes.constEnd()) {
+        if (!requestedSuffixes.contains(suffix)) {
+            requestedSuffixes.insert(suffix);
+            pendingSuffixes.append(suffix);
+
+            if (!requestTimer.isActive()) {
+                requestTimer.start();
+            }
+        }
+
+        return placeholderIcon();
+    }
+
+    return suffixType.value().isEmpty() ? placeholderIcon() : mimeTypeIcon(suffixType.value());
+#else
+    Q_UNUSED(mimeType)
+
+    if (suffix.isEmpty()) {
+        return placeholderIcon();
+    }
+
+    const auto cachedIcon(typeIcons.constFind(suffix));
+
+    if (cachedIcon != typeIcons.constEnd()) {
+        return cachedIcon.value();
+    }
+
+    return typeIcon(suffix, icons->icon(QFileInfo(filePath)));
+#endif
+}
+
+/*!
+ * \brief Provides a rendered icon from the pixmap cache and renders it if it is not cached.
+ * \param key = The key of the icon
+ * \param icon = The icon
+ * \param size = The size at which the icon is rendered
+ * \param mode = The mode of the icon
+ * \param state = The state of the icon
+ * \return A QPixmap
+ */
+QPixmap IconService::cachedPixmap(const QString &key, const QIcon &icon, const QSize &size, QIcon::Mode mode, QIcon::State state)
+{
+    const QString pixmapKey(QString("%1@%2x%3:%4:%5").arg(key).arg(size.width()).arg(size.height()).arg(mode).arg(state));
+    const QPixmap *storedPixmap(pixmaps.object(pixmapKey));
+
+    if (storedPixmap != nullptr) {
+        return *storedPixmap;
+    }
+
+    const QPixmap pixmap(icon.pixmap(size, mode, state));
+    const int cost(qMax(1, pixmap.width() * pixmap.height() * 4));
+    pixmaps.insert(pixmapKey, new QPixmap(pixmap), cost);
+
+    return pixmap;
+}
+
+/*!
+ * \brief Stores a new file icon under a key and wraps it so it renders through the pixmap cache.
+ * \param key = The MIME type name or suffix
+ * \param icon = The icon
+ * \return The shared QIcon
+ */
+QIcon IconService::typeIcon(const QString &key, const QIcon &icon)
+{
+    return typeIcons.insert(key, QIcon(new CachedIconEngine(key, icon))).value();
+}
+
+/*!
+ * \brief Provides the icon of a MIME type and creates it if needed.
+ * \param mimeName = The name of the MIME type
+ * \return A QIcon that falls back to the generic icon of the type and then to the placeholder icon
+ */
+QIcon IconService::mimeTypeIcon(const QString &mimeName)
+{
+    const auto cachedIcon(typeIcons.constFind(mimeName));
+
+    if (cachedIcon != typeIcons.constEnd()) {
+        return cachedIcon.value();
+    }
+
+    MimeTypeTable *mimeTypes(MimeTypeTable::instance());
+    const quint16 mimeType(mimeTypes->intern(mimeName));
+    const QIcon genericIcon(QIcon::fromTheme(mimeTypes->genericIconName(mimeType), placeholderIcon()));
+
+    return typeIcon(mimeName, QIcon::fromTheme(mimeTypes->iconName(mimeType), genericIcon));
+}
+
+/*!
+ * \brief Starts a worker for the pending suffixes, unless one is already running.
+ */
+void IconService::startResolving()
+{
+    if (resolveWatcher.isRunning() || pendingSuffixes.isEmpty()) {
+        return;
+    }
+
+    resolveWatcher.setFuture(QtConcurrent::run(&IconService::resolveSuffixes, pendingSuffixes));
+    pendingSuffixes.clear();
+}
+
+/*!
+ * \brief Stores the MIME types resolved by the worker and resolves the suffixes requested in the meantime.
+ */
+void IconService::resolvingFinished()
+{
+    if (resolveWatcher.future().resultCount() == 0) {
+        return;
+    }
+
+    const QVector<SuffixType> results(resolveWatcher.result());
+    resolveWatcher.setFuture(QFuture<QVector<SuffixType>>());
+
+    for (const SuffixType &suffixType : results) {
+        suffixTypes.insert(suffixType.suffix, suffixType.mimeName);
+        requestedSuffixes.remove(suffixType.suffix);
+    }
+
+    startResolving();
+    emit iconsResolved();
+}
+
+/*!
+ * \brief Resolves the MIME types of a list of file suffixes.
+ * \param suffixes = The lowercase suffixes
+ * \return A QVector of SuffixType
+ * \note This function is meant to be run with QtConcurrent::run(). Suffixes that only match the default type are
+ * reported with an empty MIME type name.
+ */
+QVector<IconService::SuffixType> IconService::resolveSuffixes(const QStringList &suffixes)
+{
+    QMimeDatabase mimeDatabase;
+    QVector<SuffixType> results;
+    results.reserve(suffixes.count());
+
+    for (const QString &suffix : suffixes) {
+        const QMimeType mimeType(mimeDatabase.mimeTypeForFile("file." + suffix, QMimeDatabase::MatchExtension));
+
+        SuffixType suffixType;
+        suffixType.suffix = suffix;
+        suffixType.mimeName = mimeType.isDefault() ? QString() : mimeType.name();
+        results.append(suffixType);
+    }
+
+    return results;
+}
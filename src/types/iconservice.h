@@ -0,0 +1,70 @@
+#ifndef ICONSERVICE_H
+#define ICONSERVICE_H
+
+#include <QObject>
+#include <QAbstractFileIconProvider>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QIcon>
+#include <QPixmap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+
+/*!
+ * \brief The icon service shared by the explorers and the tree view.
+ *
+ * File icons are resolved once per MIME type and shared by every file of that type, so a hundred thousand log files
+ * hold a single QIcon. Files whose MIME type is not known yet are matched by their suffix: the suffixes are resolved to
+ * MIME types on a worker thread and a placeholder icon is shown until they are in. The rendered pixmaps of all the
+ * icons are kept in one bounded cache, of which the least recently used pixmaps are dropped first.
+ * \note The service may only be used from the GUI thread.
+ */
+class IconService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static IconService *instance();
+    void setIconProvider(const QSharedPointer<QAbstractFileIconProvider> &provider);
+    QIcon folderIcon() const;
+    QIcon driveIcon() const;
+    QIcon placeholderIcon() const;
+    QIcon fileIcon(const QString &filePath, quint16 mimeType = 0);
+    QPixmap cachedPixmap(const QString &key, const QIcon &icon, const QSize &size, QIcon::Mode mode, QIcon::State state);
+
+signals:
+    void iconsResolved();   ///< Emitted when icons that were shown as placeholders have been resolved.
+
+private:
+    /*!
+     * \brief The MIME type of a file suffix, as resolved by the worker.
+     */
+    struct SuffixType
+    {
+        QString suffix;     ///< The lowercase suffix.
+        QString mimeName;   ///< The name of the MIME type, which is empty if it is not known.
+    };
+
+    static const int MaxPixmapBytes = 16 * 1024 * 1024;    ///< The maximum size of all the cached pixmaps together.
+
+    QSharedPointer<QAbstractFileIconProvider> icons;    ///< The provider of the folder, drive and placeholder icons.
+    QHash<QString, QString> suffixTypes;    ///< The MIME type names of the suffixes that have been resolved.
+    QHash<QString, QIcon> typeIcons;        ///< The icons that have been created, keyed by MIME type or suffix.
+    QStringList pendingSuffixes;            ///< The suffixes waiting to be resolved.
+    QSet<QString> requestedSuffixes;        ///< The suffixes that are waiting or being resolved.
+    QTimer requestTimer;                    ///< Resolves the suffixes requested during a turn of the event loop together.
+    QFutureWatcher<QVector<SuffixType>> resolveWatcher; ///< Watches the worker resolving suffixes.
+    QCache<QString, QPixmap> pixmaps;       ///< The rendered pixmaps, keyed by icon, size and mode.
+
+    explicit IconService(QObject *parent = nullptr);
+    QIcon typeIcon(const QString &key, const QIcon &icon);
+    QIcon mimeTypeIcon(const QString &mimeName);
+    void startResolving();
+    void resolvingFinished();
+
+    static QVector<SuffixType> resolveSuffixes(const QStringList &suffixes);
+};
+
+#endif // ICONSERVICE_H
@@ -0,0 +1,473 @@
+#include "mimesniffer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined (Q_OS_LINUX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <QDateTime>
+#endif
+
+/*!
+ * \brief The constructor
+ * \note The magic table is compiled here, once for the whole application.
+ */
+MimeSniffer::MimeSniffer() :
+    firstByteRules(256),
+    cache(MaxCachedTypes)
+{
+    pool.setMaxThreadCount(SniffThreads);
+    compileRules();
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the MimeSniffer
+ */
+MimeSniffer *MimeSniffer::instance()
+{
+    static MimeSniffer sniffer;
+    return &sniffer;
+}
+
+/*!
+ * \brief Detects the MIME type of a single file.
+ * \param filePath = The path of the file
+ * \return A QString with the name of the MIME type, which is empty if the file does not exist
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note The header is read on the calling thread, so this is meant for files that are about to be opened.
+ */
+QString MimeSniffer::mimeTypeForFile(const QString &filePath)
+{
+    Probe probe;
+    probe.path = filePath;
+    quint32 mode(0);
+
+#if defined (Q_OS_LINUX)
+    struct statx stx;
+
+    if (statx(AT_FDCWD, QFile::encodeName(filePath).constData(), AT_NO_AUTOMOUNT,
+              STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO, &stx) != 0) {
+        return QString();
+    }
+
+    if (S_ISDIR(stx.stx_mode)) {
+        return QStringLiteral("inode/directory");
+    }
+
+    probe.device = (static_cast<quint64>(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+    probe.inode = stx.stx_ino;
+    probe.mtime = static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+    probe.size = static_cast<qint64>(stx.stx_size);
+    mode = stx.stx_mode;
+#else
+    const QFileInfo info(filePath);
+
+    if (!info.exists()) {
+        return QString();
+    }
+
+    if (info.isDir()) {
+        return QStringLiteral("inode/directory");
+    }
+
+    probe.mtime = info.lastModified().toMSecsSinceEpoch();
+    probe.size = info.size();
+    mode = static_cast<quint32>(info.permissions());
+#endif
+
+    const QMimeType nameType(QMimeDatabase().mimeTypeForFile(QFileInfo(filePath).fileName(), QMimeDatabase::MatchExtension));
+    probe.nameType = nameType.isDefault() ? QString() : nameType.name();
+
+    if (!needsSniffing(probe.nameType, mode)) {
+        return probe.nameType;
+    }
+
+    sniff(probe);
+
+    return probe.mimeName;
+}
+
+/*!
+ * \brief Detects the MIME types of a batch of files in parallel.
+ * \param probes = The files, whose mimeName is set
+ * \note This blocks until every header has been read, so it is meant to be called from a worker thread.
+ */
+void MimeSniffer::detect(QVector<Probe> &probes)
+{
+    if (probes.count() == 1) {
+        sniff(probes[0]);
+        return;
+    }
+
+    QtConcurrent::blockingMap(&pool, probes, [this](Probe &probe) {
+        sniff(probe);
+    });
+}
+
+/*!
+ * \brief Checks if the contents of a file have to be read to know its MIME type.
+ * \param nameType = The MIME type matched by the name, which is empty if the name tells nothing
+ * \param mode = The mode bits of the file
+ * \return A boolean value that is true if the name tells nothing or the file is executable
+ * \note This contains preprocessor directives for detecting the OS at compile time. Other platforms than Linux report
+ * the mode as QFileDevice::Permissions.
+ */
+bool MimeSniffer::needsSniffing(const QString &nameType, quint32 mode)
+{
+#if defined (Q_OS_LINUX)
+    const quint32 executableBits(S_IXUSR | S_IXGRP | S_IXOTH);
+#else
+    const quint32 executableBits(QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+#endif
+
+    return nameType.isEmpty() || (mode & executableBits) != 0;
+}
+
+/*!
+ * \brief Checks if a MIME type is a program that is started instead of opened.
+ * \param mimeName = The name of the MIME type
+ * \return A boolean value that is true for binaries and scripts
+ */
+bool MimeSniffer::isProgram(const QString &mimeName)
+{
+    static const QStringList programTypes({"application/x-executable", "application/x-pie-executable", "application/x-sharedlib",
+                                           "application/vnd.appimage", "application/x-shellscript", "application/x-perl",
+                                           "text/x-python", "text/x-python3", "application/x-ruby"});
+
+    return programTypes.contains(mimeName);
+}
+
+/*!
+ * \brief Adds a signature to the magic table.
+ * \param mimeName = The MIME type of the files with the signature
+ * \param matches = The byte sequences of the signature, of which the first is the most distinctive
+ */
+void MimeSniffer::addRule(const QString &mimeName, const QVector<MagicMatch> &matches)
+{
+    MagicRule rule;
+    rule.matches = matches;
+    rule.mimeName = mimeName;
+
+    if (matches.first().offset == 0) {
+        firstByteRules[static_cast<uchar>(matches.first().bytes.at(0))].append(rule);
+    } else {
+        offsetRules.append(rule);
+    }
+}
+
+/*!
+ * \brief Compiles the magic table.
+ *
+ * The rules of every bucket are sorted by the amount of bytes they compare, so the most specific signature wins, like
+ * a Debian package over a plain ar archive.
+ */
+void MimeSniffer::compileRules()
+{
+    addRule("image/png", {{0, QByteArray::fromHex("89504e470d0a1a0a")}});
+    addRule("image/jpeg", {{0, QByteArray::fromHex("ffd8ff")}});
+    addRule("image/gif", {{0, "GIF87a"}});
+    addRule("image/gif", {{0, "GIF89a"}});
+    addRule("image/bmp", {{0, "BM"}, {14, QByteArray::fromHex("28000000")}});
+    addRule("image/bmp", {{0, "BM"}, {14, QByteArray::fromHex("7c000000")}});
+    addRule("image/tiff", {{0, QByteArray::fromHex("49492a00")}});
+    addRule("image/tiff", {{0, QByteArray::fromHex("4d4d002a")}});
+    addRule("image/webp", {{0, "RIFF"}, {8, "WEBP"}});
+    addRule("audio/x-wav", {{0, "RIFF"}, {8, "WAVE"}});
+    addRule("video/x-msvideo", {{0, "RIFF"}, {8, "AVI "}});
+    addRule("audio/ogg", {{0, "OggS"}});
+    addRule("audio/flac", {{0, "fLaC"}});
+    addRule("audio/mpeg", {{0, "ID3"}});
+    addRule("audio/midi", {{0, "MThd"}});
+    addRule("video/x-matroska", {{0, QByteArray::fromHex("1a45dfa3")}});
+    addRule("audio/mp4", {{4, "ftypM4A"}});
+    addRule("video/quicktime", {{4, "ftypqt"}});
+    addRule("video/mp4", {{4, "ftyp"}});
+    addRule("application/pdf", {{0, "%PDF-"}});
+    addRule("application/postscript", {{0, "%!PS"}});
+    addRule("text/rtf", {{0, "{\\rtf"}});
+    addRule("application/zip", {{0, QByteArray::fromHex("504b0304")}});
+    addRule("application/zip", {{0, QByteArray::fromHex("504b0506")}});
+    addRule("application/gzip", {{0, QByteArray::fromHex("1f8b")}});
+    addRule("application/x-bzip2", {{0, "BZh"}});
+    addRule("application/x-xz", {{0, QByteArray::fromHex("fd377a585a00")}});
+    addRule("application/zstd", {{0, QByteArray::fromHex("28b52ffd")}});
+    addRule("application/x-7z-compressed", {{0, QByteArray::fromHex("377abcaf271c")}});
+    addRule("application/vnd.rar", {{0, QByteArray::fromHex("526172211a07")}});
+    addRule("application/x-tar", {{257, "ustar"}});
+    addRule("application/vnd.debian.binary-package", {{0, "!<arch>\ndebian"}});
+    addRule("application/x-archive", {{0, "!<arch>\n"}});
+    addRule("application/x-rpm", {{0, QByteArray::fromHex("edabeedb")}});
+    addRule("application/vnd.sqlite3", {{0, QByteArray("SQLite format 3", 16)}});
+    addRule("application/x-hdf5", {{0, QByteArray::fromHex("894844460d0a1a0a")}});
+    addRule("application/x-ole-storage", {{0, QByteArray::fromHex("d0cf11e0a1b11ae1")}});
+    addRule("application/x-ms-dos-executable", {{0, "MZ"}});
+    addRule("application/x-java", {{0, QByteArray::fromHex("cafebabe")}});
+    addRule("application/wasm", {{0, QByteArray::fromHex("0061736d")}});
+    addRule("application/x-mach-binary", {{0, QByteArray::fromHex("feedface")}});
+    addRule("application/x-mach-binary", {{0, QByteArray::fromHex("feedfacf")}});
+    addRule("application/x-mach-binary", {{0, QByteArray::fromHex("cefaedfe")}});
+    addRule("application/x-mach-binary", {{0, QByteArray::fromHex("cffaedfe")}});
+    addRule("font/otf", {{0, "OTTO"}});
+    addRule("font/woff", {{0, "wOFF"}});
+    addRule("font/woff2", {{0, "wOF2"}});
+
+    // An AppImage is an ELF executable as well, so its rule has to come before the ELF rules of the same length.
+    addRule("application/vnd.appimage", {{0, "\x7f" "ELF"}, {8, "AI\x02"}});
+
+    // The type of an ELF file is a 16-bit value at offset 16, in the byte order given at offset 5.
+    const QStringList elfTypes({"application/x-object", "application/x-executable", "application/x-sharedlib", "application/x-core"});
+
+    for (int elfType(0); elfType < elfTypes.count(); ++elfType) {
+        const char typeByte(static_cast<char>(elfType + 1));
+        addRule(elfTypes.at(elfType), {{0, "\x7f" "ELF"}, {5, QByteArray(1, '\x01')}, {16, QByteArray(1, typeByte) + '\0'}});
+        addRule(elfTypes.at(elfType), {{0, "\x7f" "ELF"}, {5, QByteArray(1, '\x02')}, {16, QByteArray(1, '\0') + typeByte}});
+    }
+
+    const auto ruleBytes([](const MagicRule &rule) {
+        int bytes(0);
+
+        for (const MagicMatch &match : rule.matches) {
+            bytes += match.bytes.size();
+        }
+
+        return bytes;
+    });
+    const auto moreSpecific([&ruleBytes](const MagicRule &rule, const MagicRule &other) {
+        return ruleBytes(rule) > ruleBytes(other);
+    });
+
+    for (QVector<MagicRule> &rules : firstByteRules) {
+        std::stable_sort(rules.begin(), rules.end(), moreSpecific);
+    }
+
+    std::stable_sort(offsetRules.begin(), offsetRules.end(), moreSpecific);
+}
+
+/*!
+ * \brief Detects the MIME type of a file from the cache or from its header.
+ * \param probe = The file, whose mimeName is set
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note Files that can not be read keep the type matched by their name and are not cached, since they may become
+ * readable without being modified.
+ */
+void MimeSniffer::sniff(Probe &probe)
+{
+    const FileKey key({probe.device, probe.inode, probe.mtime});
+
+    if (probe.inode != 0) {
+        QMutexLocker locker(&cacheMutex);
+        const QString *cachedType(cache.object(key));
+
+        if (cachedType != nullptr) {
+            probe.mimeName = resolve(probe.nameType, *cachedType);
+            return;
+        }
+    }
+
+    QByteArray header;
+    bool readable(true);
+
+    if (probe.size > 0) {
+#if defined (Q_OS_LINUX)
+        const int fd(::open(QFile::encodeName(probe.path).constData(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK));
+
+        if (fd >= 0) {
+            header.resize(static_cast<int>(qMin<qint64>(probe.size, HeaderSize)));
+            const ssize_t bytesRead(::pread(fd, header.data(), static_cast<size_t>(header.size()), 0));
+            header.resize(bytesRead > 0 ? static_cast<int>(bytesRead) : 0);
+            readable = bytesRead >= 0;
+            ::close(fd);
+        } else {
+            readable = false;
+        }
+#else
+        QFile file(probe.path);
+        readable = file.open(QIODevice::ReadOnly);
+
+        if (readable) {
+            header = file.read(HeaderSize);
+        }
+#endif
+    }
+
+    if (!readable) {
+        probe.mimeName = probe.nameType.isEmpty() ? QStringLiteral("application/octet-stream") : probe.nameType;
+        return;
+    }
+
+    QString contentType(matchHeader(header));
+
+    if (contentType.isEmpty()) {
+        contentType = textType(header);
+    }
+
+    if (probe.inode != 0) {
+        QMutexLocker locker(&cacheMutex);
+        cache.insert(key, new QString(contentType));
+    }
+
+    probe.mimeName = resolve(probe.nameType, contentType);
+}
+
+/*!
+ * \brief Matches a header against the magic table.
+ * \param header = The first bytes of a file
+ * \return A QString with the MIME type of the first matching signature, which is empty if none matches
+ */
+QString MimeSniffer::matchHeader(const QByteArray &header) const
+{
+    if (header.isEmpty()) {
+        return QString();
+    }
+
+    if (header.startsWith("#!")) {
+        return scriptType(header);
+    }
+
+    for (const MagicRule &rule : firstByteRules.at(static_cast<uchar>(header.at(0)))) {
+        if (matches(rule, header)) {
+            return rule.mimeName;
+        }
+    }
+
+    for (const MagicRule &rule : offsetRules) {
+        if (matches(rule, header)) {
+            return rule.mimeName;
+        }
+    }
+
+    return QString();
+}
+
+/*!
+ * \brief Checks if a header contains all the byte sequences of a signature.
+ * \param rule = The signature
+ * \param header = The first bytes of a file
+ * \return A boolean value that is true if the signature matches
+ */
+bool MimeSniffer::matches(const MagicRule &rule, const QByteArray &header)
+{
+    for (const MagicMatch &match : rule.matches) {
+        if (match.offset + match.bytes.size() > header.size()
+                || std::memcmp(header.constData() + match.offset, match.bytes.constData(), static_cast<size_t>(match.bytes.size())) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Provides the MIME type of a script from the interpreter in its #! line.
+ * \param header = The first bytes of the script
+ * \return A QString that falls back to application/x-executable for interpreters that are not known
+ * \note An interpreter started through env is looked up by the first argument of env that is not an option.
+ */
+QString MimeSniffer::scriptType(const QByteArray &header)
+{
+    const int lineEnd(header.indexOf('\n'));
+    const QList<QByteArray> arguments(header.mid(2, lineEnd < 0 ? -1 : lineEnd - 2).simplified().split(' '));
+    QByteArray interpreter;
+    bool afterEnv(false);
+
+    for (const QByteArray &argument : arguments) {
+        const QByteArray program(argument.mid(argument.lastIndexOf('/') + 1));
+
+        if (!afterEnv && program == "env") {
+            afterEnv = true;
+            continue;
+        }
+
+        if (afterEnv && (program.startsWith('-') || program.contains('='))) {
+            continue;
+        }
+
+        interpreter = program;
+        break;
+    }
+
+    static const QList<QByteArray> shells({"sh", "bash", "dash", "zsh", "ksh", "csh", "tcsh"});
+
+    if (shells.contains(interpreter)) {
+        return QStringLiteral("application/x-shellscript");
+    }
+
+    if (interpreter.startsWith("python")) {
+        return interpreter.startsWith("python2") ? QStringLiteral("text/x-python") : QStringLiteral("text/x-python3");
+    }
+
+    if (interpreter.startsWith("perl")) {
+        return QStringLiteral("application/x-perl");
+    }
+
+    if (interpreter.startsWith("ruby")) {
+        return QStringLiteral("application/x-ruby");
+    }
+
+    return QStringLiteral("application/x-executable");
+}
+
+/*!
+ * \brief Provides the MIME type of a header that matches no signature.
+ * \param header = The first bytes of a file
+ * \return A QString with a text type if the header holds no control characters other than whitespace, and
+ * application/octet-stream otherwise
+ * \note Markup is recognized by its first tag, ignoring leading whitespace and a UTF-8 byte order mark.
+ */
+QString MimeSniffer::textType(const QByteArray &header)
+{
+    if (header.isEmpty()) {
+        return QStringLiteral("application/x-zerosize");
+    }
+
+    for (const char byte : header) {
+        const uchar value(static_cast<uchar>(byte));
+
+        if (value < 0x20 && value != '\t' && value != '\n' && value != '\r' && value != '\f' && value != '\b' && value != 0x1b) {
+            return QStringLiteral("application/octet-stream");
+        }
+    }
+
+    QByteArray start(header.startsWith("\xef\xbb\xbf") ? header.mid(3) : header);
+    start = start.trimmed().left(64).toLower();
+
+    if (start.startsWith("<?xml")) {
+        return header.contains("<svg") ? QStringLiteral("image/svg+xml") : QStringLiteral("application/xml");
+    }
+
+    if (start.startsWith("<svg")) {
+        return QStringLiteral("image/svg+xml");
+    }
+
+    if (start.startsWith("<!doctype html") || start.startsWith("<html")) {
+        return QStringLiteral("text/html");
+    }
+
+    return QStringLiteral("text/plain");
+}
+
+/*!
+ * \brief Combines the MIME type matched by the name of a file with the type found in its contents.
+ * \param nameType = The MIME type matched by the name, which is empty if the name tells nothing
+ * \param contentType = The MIME type found in the contents
+ * \return A QString with the type matched by the name, unless the name tells nothing or the contents are a program
+ * that the name does not reveal
+ */
+QString MimeSniffer::resolve(const QString &nameType, const QString &contentType)
+{
+    if (nameType.isEmpty() || (isProgram(contentType) && !isProgram(nameType))) {
+        return contentType;
+    }
+
+    return nameType;
+}
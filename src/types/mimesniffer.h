@@ -0,0 +1,111 @@
+#ifndef MIMESNIFFER_H
+#define MIMESNIFFER_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+/*!
+ * \brief The service that detects the MIME types of files by their contents.
+ *
+ * Files are matched by their name first. The files whose name tells nothing, such as extensionless build artifacts,
+ * and the files that are marked executable have the first HeaderSize bytes read and matched against a magic table.
+ * The table is compiled once into buckets keyed by the first byte of the signature, so a header is only compared with
+ * the few signatures that can match it. A header that matches no signature is reported as text if it holds no control
+ * characters other than whitespace. The type found in the contents only replaces the type matched by the name if it is
+ * a program, such as an ELF binary or a script, and the name does not already tell so.
+ *
+ * The types found in the contents are cached by device, inode and modification time, so a file is read only once for
+ * as long as it does not change, whatever its name. Batches of files are sniffed in parallel on a small thread pool.
+ * \note The service may be used from any thread. It does not use QMimeDatabase for the headers, since its lookups are
+ * serialized by a global lock.
+ */
+class MimeSniffer
+{
+public:
+    /*!
+     * \brief A file whose MIME type is detected.
+     */
+    struct Probe
+    {
+        QString path;           ///< The full path of the file.
+        quint64 device = 0;     ///< The device of the file.
+        quint64 inode = 0;      ///< The inode of the file, which is 0 if it is not known.
+        qint64 mtime = 0;       ///< The last modification time in milliseconds since the epoch.
+        qint64 size = 0;        ///< The size in bytes.
+        QString nameType;       ///< The MIME type matched by the name, which is empty if the name tells nothing.
+        QString mimeName;       ///< The detected MIME type.
+    };
+
+    static MimeSniffer *instance();
+    QString mimeTypeForFile(const QString &filePath);
+    void detect(QVector<Probe> &probes);
+
+    static bool needsSniffing(const QString &nameType, quint32 mode);
+    static bool isProgram(const QString &mimeName);
+
+private:
+    static const int HeaderSize = 512;          ///< The amount of bytes read from the start of a file.
+    static const int SniffThreads = 4;          ///< The amount of headers read at once.
+    static const int MaxCachedTypes = 65536;    ///< The maximum amount of files whose type is cached.
+
+    /*!
+     * \brief The identity of a file at one point in time.
+     */
+    struct FileKey
+    {
+        quint64 device;     ///< The device of the file.
+        quint64 inode;      ///< The inode of the file.
+        qint64 mtime;       ///< The last modification time in milliseconds since the epoch.
+
+        friend bool operator==(const FileKey &key, const FileKey &other)
+        {
+            return key.device == other.device && key.inode == other.inode && key.mtime == other.mtime;
+        }
+
+        friend size_t qHash(const FileKey &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.device, key.inode, key.mtime);
+        }
+    };
+
+    /*!
+     * \brief A sequence of bytes that a header contains at an offset.
+     */
+    struct MagicMatch
+    {
+        int offset;         ///< The offset of the bytes in the header.
+        QByteArray bytes;   ///< The bytes.
+    };
+
+    /*!
+     * \brief A signature, which matches when all of its byte sequences are found.
+     */
+    struct MagicRule
+    {
+        QVector<MagicMatch> matches;    ///< The byte sequences, of which the first is the most distinctive.
+        QString mimeName;               ///< The MIME type of the files with the signature.
+    };
+
+    QVector<QVector<MagicRule>> firstByteRules; ///< The rules whose first sequence starts the header, keyed by its first byte.
+    QVector<MagicRule> offsetRules;             ///< The rules whose first sequence is further in the header.
+    QThreadPool pool;                           ///< The workers that read the headers.
+    QMutex cacheMutex;                          ///< Guards the cache.
+    QCache<FileKey, QString> cache;             ///< The types found in the contents, keyed by the identity of the file.
+
+    MimeSniffer();
+    void addRule(const QString &mimeName, const QVector<MagicMatch> &matches);
+    void compileRules();
+    void sniff(Probe &probe);
+    QString matchHeader(const QByteArray &header) const;
+
+    static bool matches(const MagicRule &rule, const QByteArray &header);
+    static QString scriptType(const QByteArray &header);
+    static QString textType(const QByteArray &header);
+    static QString resolve(const QString &nameType, const QString &contentType);
+};
+
+#endif // MIMESNIFFER_H
@@ -0,0 +1,98 @@
+#include "mimetypetable.h"
+
+#include <QMimeDatabase>
+
+/*!
+ * \brief The constructor
+ * \note This reserves the ID 0 for the unknown type.
+ */
+MimeTypeTable::MimeTypeTable()
+{
+    names.append(QString());
+    comments.append(QString());
+    iconNames.append(QString());
+    genericIconNames.append(QString());
+}
+
+/*!
+ * \brief Provides the table shared by the whole application.
+ * \return A pointer to the MimeTypeTable
+ */
+MimeTypeTable *MimeTypeTable::instance()
+{
+    static MimeTypeTable table;
+    return &table;
+}
+
+/*!
+ * \brief Provides the ID of a MIME type and adds it to the table if needed.
+ * \param mimeName = The name of the MIME type
+ * \return The ID, which is 0 for an empty or invalid name
+ */
+quint16 MimeTypeTable::intern(const QString &mimeName)
+{
+    if (mimeName.isEmpty()) {
+        return 0;
+    }
+
+    const auto existingId(ids.constFind(mimeName));
+
+    if (existingId != ids.constEnd()) {
+        return existingId.value();
+    }
+
+    const QMimeType mimeType(QMimeDatabase().mimeTypeForName(mimeName));
+
+    if (!mimeType.isValid() || names.count() > 0xFFFF) {
+        return 0;
+    }
+
+    const quint16 id(static_cast<quint16>(names.count()));
+    names.append(mimeType.name());
+    comments.append(mimeType.comment());
+    iconNames.append(mimeType.iconName());
+    genericIconNames.append(mimeType.genericIconName());
+    ids.insert(mimeName, id);
+
+    return id;
+}
+
+/*!
+ * \brief Provides the name of a MIME type.
+ * \param id = The ID
+ * \return A QString like "text/plain"
+ */
+QString MimeTypeTable::name(quint16 id) const
+{
+    return names.value(id);
+}
+
+/*!
+ * \brief Provides the description of a MIME type.
+ * \param id = The ID
+ * \return A QString like "plain text document"
+ */
+QString MimeTypeTable::comment(quint16 id) const
+{
+    return comments.value(id);
+}
+
+/*!
+ * \brief Provides the icon name of a MIME type.
+ * \param id = The ID
+ * \return A QString like "text-plain"
+ */
+QString MimeTypeTable::iconName(quint16 id) const
+{
+    return iconNames.value(id);
+}
+
+/*!
+ * \brief Provides the generic icon name of a MIME type.
+ * \param id = The ID
+ * \return A QString like "text-x-generic"
+ */
+QString MimeTypeTable::genericIconName(quint16 id) const
+{
+    return genericIconNames.value(id);
+}
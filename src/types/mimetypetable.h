@@ -0,0 +1,34 @@
+#ifndef MIMETYPETABLE_H
+#define MIMETYPETABLE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief The table that maps MIME type names to compact IDs.
+ *
+ * Entries only store the 16-bit ID of their MIME type, and the name, description and icon names are looked up once
+ * per MIME type. The ID 0 stands for an unknown type.
+ * \note The table may only be used from the GUI thread.
+ */
+class MimeTypeTable
+{
+public:
+    static MimeTypeTable *instance();
+    quint16 intern(const QString &mimeName);
+    QString name(quint16 id) const;
+    QString comment(quint16 id) const;
+    QString iconName(quint16 id) const;
+    QString genericIconName(quint16 id) const;
+
+private:
+    MimeTypeTable();
+    QStringList names;              ///< The names of the MIME types, indexed by ID.
+    QStringList comments;           ///< The descriptions of the MIME types, indexed by ID.
+    QStringList iconNames;          ///< The icon names of the MIME types, indexed by ID.
+    QStringList genericIconNames;   ///< The generic icon names of the MIME types, indexed by ID.
+    QHash<QString, quint16> ids;    ///< The IDs of the MIME types, keyed by name.
+};
+
+#endif // MIMETYPETABLE_H
@@ -0,0 +1,423 @@
+#include "mountmonitor.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#else
+#include <QStorageInfo>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note On Linux the mount table is read right away, since reading it from /proc never waits for a file system.
+ */
+MountMonitor::MountMonitor(QObject *parent) :
+    QObject(parent),
+    tableChanged(false),
+    statPool(new QThreadPool()),
+    tableNotifier(nullptr),
+    tableFd(-1)
+{
+    statPool->setMaxThreadCount(MaxStatThreads);
+    refreshTimer.setInterval(RefreshInterval);
+
+    connect(&tableWatcher, &QFutureWatcher<QVector<MountPoint>>::finished, this, &MountMonitor::tableRead);
+    connect(&refreshTimer, &QTimer::timeout, this, &MountMonitor::refreshSpace);
+
+#if defined (Q_OS_LINUX)
+    tableFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+
+    if (tableFd >= 0) {
+        tableNotifier = new QSocketNotifier(tableFd, QSocketNotifier::Exception, this);
+        connect(tableNotifier, &QSocketNotifier::activated, this, &MountMonitor::readTable);
+    }
+
+    applyTable(readMountTable());
+#else
+    connect(&refreshTimer, &QTimer::timeout, this, &MountMonitor::readTable);
+    readTable();
+#endif
+
+    refreshTimer.start();
+}
+
+/*!
+ * \brief The destructor
+ * \note A request for space that hangs on a dead mount would block the exit forever, so the pool of workers is left
+ * behind if any request is still pending. Its threads end with the process.
+ */
+MountMonitor::~MountMonitor()
+{
+    tableWatcher.waitForFinished();
+
+    if (pendingStats.isEmpty()) {
+        delete statPool;
+    }
+
+#if defined (Q_OS_LINUX)
+    if (tableFd >= 0) {
+        ::close(tableFd);
+    }
+#endif
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the MountMonitor
+ * \note The service is bound to the application object and deleted with it.
+ */
+MountMonitor *MountMonitor::instance()
+{
+    static MountMonitor *monitor(new MountMonitor(QCoreApplication::instance()));
+    return monitor;
+}
+
+/*!
+ * \brief Provides the known mounts.
+ * \return A QVector of MountPoint in the order of the mount table
+ */
+QVector<MountPoint> MountMonitor::mounts() const
+{
+    return mountPoints;
+}
+
+/*!
+ * \brief Provides the mount that holds a path.
+ * \param path = The clean absolute path
+ * \return The MountPoint with the longest path that contains the path, which has an empty path if there is none
+ */
+MountPoint MountMonitor::mountFor(const QString &path) const
+{
+    MountPoint bestMount;
+
+    for (const MountPoint &mountPoint : mountPoints) {
+        const QString prefix(mountPoint.path.endsWith('/') ? mountPoint.path : mountPoint.path + '/');
+        const bool contains(path == mountPoint.path || path.startsWith(prefix));
+
+        if (contains && mountPoint.path.length() >= bestMount.path.length()) {
+            bestMount = mountPoint;
+        }
+    }
+
+    return bestMount;
+}
+
+/*!
+ * \brief Starts reading the mount table on a worker thread, or reads it again later if a read is already running.
+ */
+void MountMonitor::readTable()
+{
+    if (tableWatcher.isRunning()) {
+        tableChanged = true;
+        return;
+    }
+
+    tableChanged = false;
+    tableWatcher.setFuture(QtConcurrent::run(&MountMonitor::readMountTable));
+}
+
+/*!
+ * \brief Applies the mount table read by the worker and reads it again if it has changed in the meantime.
+ */
+void MountMonitor::tableRead()
+{
+    if (tableWatcher.future().resultCount() == 0) {
+        return;
+    }
+
+    const QVector<MountPoint> table(tableWatcher.result());
+    tableWatcher.setFuture(QFuture<QVector<MountPoint>>());
+    applyTable(table);
+
+    if (tableChanged) {
+        readTable();
+    }
+}
+
+/*!
+ * \brief Compares a mount table with the known mounts and reports the differences.
+ * \param table = The mounts read from the mount table
+ * \note The known space of the mounts that are still there is kept, and the space of the new mounts is requested.
+ */
+void MountMonitor::applyTable(const QVector<MountPoint> &table)
+{
+    const QVector<MountPoint> oldMounts(mountPoints);
+    QStringList addedPaths;
+    mountPoints.clear();
+
+    for (const MountPoint &newMount : table) {
+        MountPoint mountPoint(newMount);
+        bool known(false);
+
+        for (const MountPoint &oldMount : oldMounts) {
+            if (oldMount.path == newMount.path && oldMount.device == newMount.device) {
+                mountPoint = oldMount;
+                mountPoint.readOnly = newMount.readOnly;
+                known = true;
+                break;
+            }
+        }
+
+        mountPoints.append(mountPoint);
+
+        if (!known) {
+            addedPaths.append(mountPoint.path);
+        }
+    }
+
+    for (const MountPoint &oldMount : oldMounts) {
+        const int index(indexOf(oldMount.path));
+
+        if (index == -1 || mountPoints.at(index).device != oldMount.device) {
+            emit mountRemoved(oldMount.path);
+        }
+    }
+
+    for (const QString &mountPath : qAsConst(addedPaths)) {
+        emit mountAdded(mountPath);
+        requestSpace(mountPath);
+    }
+}
+
+/*!
+ * \brief Requests the space of every known mount.
+ */
+void MountMonitor::refreshSpace()
+{
+    for (const MountPoint &mountPoint : qAsConst(mountPoints)) {
+        requestSpace(mountPoint.path);
+    }
+}
+
+/*!
+ * \brief Requests the space of a mount on a worker thread, unless a request for it is still pending.
+ * \param mountPath = The path of the mount
+ */
+void MountMonitor::requestSpace(const QString &mountPath)
+{
+    if (pendingStats.contains(mountPath)) {
+        return;
+    }
+
+    // The callbacks only hold weak references, since the watcher would otherwise keep itself alive.
+    const QSharedPointer<QFutureWatcher<MountSpace>> watcher(new QFutureWatcher<MountSpace>(), &QObject::deleteLater);
+    const QWeakPointer<QFutureWatcher<MountSpace>> weakWatcher(watcher);
+    pendingStats.insert(mountPath, watcher);
+
+    connect(watcher.data(), &QFutureWatcher<MountSpace>::finished, this, [this, mountPath, weakWatcher](){
+        spaceRead(mountPath, weakWatcher.toStrongRef());
+    });
+    QTimer::singleShot(StatTimeout, this, [this, mountPath, weakWatcher](){
+        markStale(mountPath, weakWatcher.toStrongRef());
+    });
+
+    watcher->setFuture(QtConcurrent::run(statPool, &MountMonitor::readSpace, mountPath));
+}
+
+/*!
+ * \brief Stores the space of a mount read by a worker and reports it.
+ * \param mountPath = The path of the mount
+ * \param watcher = The watcher of the request, which is null if it has been dropped
+ * \note A mount that was stale is no longer stale once its request returns.
+ */
+void MountMonitor::spaceRead(const QString &mountPath, const QSharedPointer<QFutureWatcher<MountSpace>> &watcher)
+{
+    if (watcher.isNull() || pendingStats.value(mountPath) != watcher) {
+        return;
+    }
+
+    pendingStats.remove(mountPath);
+
+    const MountSpace space(watcher->result());
+    const int index(indexOf(mountPath));
+
+    if (index == -1) {
+        return;
+    }
+
+    MountPoint &mountPoint(mountPoints[index]);
+    const qint64 bytesTotal(space.valid ? space.bytesTotal : -1);
+    const qint64 bytesFree(space.valid ? space.bytesFree : -1);
+
+    if (mountPoint.bytesTotal != bytesTotal || mountPoint.bytesFree != bytesFree || mountPoint.stale) {
+        mountPoint.bytesTotal = bytesTotal;
+        mountPoint.bytesFree = bytesFree;
+        mountPoint.stale = false;
+        emit mountChanged(mountPath);
+    }
+}
+
+/*!
+ * \brief Marks a mount as stale if its request for space has not returned in time.
+ * \param mountPath = The path of the mount
+ * \param watcher = The watcher of the request, which is null if it has been dropped
+ */
+void MountMonitor::markStale(const QString &mountPath, const QSharedPointer<QFutureWatcher<MountSpace>> &watcher)
+{
+    const int index(indexOf(mountPath));
+
+    if (watcher.isNull() || pendingStats.value(mountPath) != watcher || index == -1 || mountPoints.at(index).stale) {
+        return;
+    }
+
+    mountPoints[index].stale = true;
+    emit mountChanged(mountPath);
+}
+
+/*!
+ * \brief Provides the position of a mount in the known mounts.
+ * \param mountPath = The path of the mount
+ * \return The index, which is -1 if the mount is not known
+ */
+int MountMonitor::indexOf(const QString &mountPath) const
+{
+    for (int i(0); i < mountPoints.count(); ++i) {
+        if (mountPoints.at(i).path == mountPath) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*!
+ * \brief Reads the mount table.
+ * \return A QVector of MountPoint without the pseudo file systems
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note When several file systems are mounted on the same path, only the one on top is kept.
+ *
+ * On Linux the lines of /proc/self/mountinfo hold the mount point in their fifth field and the type and source of the
+ * file system after a lone dash, with spaces and other special characters escaped as octal numbers.
+ */
+QVector<MountPoint> MountMonitor::readMountTable()
+{
+    QVector<MountPoint> table;
+
+#if defined (Q_OS_LINUX)
+    QFile mountInfo("/proc/self/mountinfo");
+
+    if (!mountInfo.open(QIODevice::ReadOnly)) {
+        return table;
+    }
+
+    const auto unescape([](const QByteArray &field) {
+        QByteArray unescaped;
+        unescaped.reserve(field.size());
+
+        for (int i(0); i < field.size(); ++i) {
+            if (field.at(i) == '\\' && i + 3 < field.size()) {
+                unescaped.append(static_cast<char>(field.mid(i + 1, 3).toInt(nullptr, 8)));
+                i += 3;
+            } else {
+                unescaped.append(field.at(i));
+            }
+        }
+
+        return QFile::decodeName(unescaped);
+    });
+
+    const QList<QByteArray> lines(mountInfo.readAll().split('\n'));
+
+    for (const QByteArray &line : lines) {
+        const QList<QByteArray> fields(line.split(' '));
+        const int separator(fields.indexOf("-"));
+
+        if (fields.count() < 6 || separator < 6 || separator + 2 >= fields.count()) {
+            continue;
+        }
+
+        MountPoint mountPoint;
+        mountPoint.path = unescape(fields.at(4));
+        mountPoint.device = unescape(fields.at(separator + 2));
+        mountPoint.fileSystemType = QString::fromUtf8(fields.at(separator + 1));
+        mountPoint.readOnly = fields.at(5).split(',').contains("ro");
+
+        if (isPseudoFileSystem(mountPoint.fileSystemType, mountPoint.path)) {
+            continue;
+        }
+
+        for (int i(0); i < table.count(); ++i) {
+            if (table.at(i).path == mountPoint.path) {
+                table.remove(i);
+                break;
+            }
+        }
+
+        table.append(mountPoint);
+    }
+#else
+    const QList<QStorageInfo> volumes(QStorageInfo::mountedVolumes());
+
+    for (const QStorageInfo &volume : volumes) {
+        MountPoint mountPoint;
+        mountPoint.path = volume.rootPath();
+        mountPoint.device = QString::fromUtf8(volume.device());
+        mountPoint.fileSystemType = QString::fromUtf8(volume.fileSystemType());
+        mountPoint.readOnly = volume.isReadOnly();
+
+        if (!isPseudoFileSystem(mountPoint.fileSystemType, mountPoint.path)) {
+            table.append(mountPoint);
+        }
+    }
+#endif
+
+    return table;
+}
+
+/*!
+ * \brief Reads the space of a file system.
+ * \param mountPath = The path on which the file system is mounted
+ * \return A MountSpace that is not valid if the space could not be read
+ * \note This function is meant to be run with QtConcurrent::run() and may hang for as long as the file system does.
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+MountMonitor::MountSpace MountMonitor::readSpace(const QString &mountPath)
+{
+    MountSpace space;
+
+#if defined (Q_OS_LINUX)
+    struct statvfs fileSystem;
+
+    if (statvfs(QFile::encodeName(mountPath).constData(), &fileSystem) == 0) {
+        space.valid = true;
+        space.bytesTotal = static_cast<qint64>(fileSystem.f_blocks) * static_cast<qint64>(fileSystem.f_frsize);
+        space.bytesFree = static_cast<qint64>(fileSystem.f_bavail) * static_cast<qint64>(fileSystem.f_frsize);
+    }
+#else
+    const QStorageInfo volume(mountPath);
+
+    if (volume.isValid() && volume.isReady()) {
+        space.valid = true;
+        space.bytesTotal = volume.bytesTotal();
+        space.bytesFree = volume.bytesAvailable();
+    }
+#endif
+
+    return space;
+}
+
+/*!
+ * \brief Checks if a file system is a pseudo file system that holds no files of the user.
+ * \param fileSystemType = The type of the file system
+ * \param mountPath = The path on which it is mounted
+ * \return A boolean value that is true for kernel, container and automount file systems
+ * \note Automount points are skipped since reading their space would mount them.
+ */
+bool MountMonitor::isPseudoFileSystem(const QString &fileSystemType, const QString &mountPath)
+{
+    static const QStringList pseudoTypes({"autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs", "debugfs",
+                                          "devpts", "devtmpfs", "efivarfs", "fusectl", "hugetlbfs", "mqueue", "nsfs",
+                                          "overlay", "proc", "pstore", "ramfs", "rpc_pipefs", "securityfs", "selinuxfs",
+                                          "squashfs", "sysfs", "tracefs", "fuse.gvfsd-fuse", "fuse.portal"});
+
+    return pseudoTypes.contains(fileSystemType) || mountPath.startsWith("/proc/") || mountPath.startsWith("/sys/")
+            || mountPath.startsWith("/dev/");
+}
@@ -0,0 +1,98 @@
+#ifndef MOUNTMONITOR_H
+#define MOUNTMONITOR_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+class QSocketNotifier;
+
+/*!
+ * \brief A mounted file system.
+ */
+struct MountPoint
+{
+    QString path;               ///< The directory on which the file system is mounted.
+    QString device;             ///< The device or remote share that is mounted.
+    QString fileSystemType;     ///< The type of the file system, such as ext4 or nfs4.
+    bool readOnly = false;      ///< Whether the file system is mounted read-only.
+    qint64 bytesTotal = -1;     ///< The size of the file system in bytes, or -1 if it is not known yet.
+    qint64 bytesFree = -1;      ///< The bytes available to the user, or -1 if it is not known yet.
+    bool stale = false;         ///< Whether the file system did not answer the last request for its space in time.
+};
+
+/*!
+ * \brief The service that keeps track of the mounted file systems without ever blocking the GUI thread.
+ *
+ * On Linux the kernel flags /proc/self/mountinfo with a priority event whenever a file system is mounted or unmounted,
+ * so the file is watched with a socket notifier for exceptions, which the event loop polls together with everything
+ * else. The table is then read again and compared with the known mounts, and only the mounts that have appeared or
+ * disappeared are reported.
+ *
+ * The space of every mount is requested on a worker thread when it appears and every RefreshInterval after that. A
+ * mount that does not answer within StatTimeout, like a hung network share, is marked stale and no new request is sent
+ * to it until the pending one returns.
+ * \note This contains preprocessor directives for detecting the OS at compile time. Other platforms read the mount
+ * table on a worker thread every RefreshInterval instead.
+ * \note The service may only be used from the GUI thread.
+ */
+class MountMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MountMonitor *instance();
+    QVector<MountPoint> mounts() const;
+    MountPoint mountFor(const QString &path) const;
+
+signals:
+    void mountAdded(const QString &mountPath);      ///< Emitted when a file system has been mounted.
+    void mountRemoved(const QString &mountPath);    ///< Emitted when a file system has been unmounted.
+    void mountChanged(const QString &mountPath);    ///< Emitted when the space or the stale state of a mount has changed.
+
+private:
+    static const int RefreshInterval = 10000;   ///< The interval in milliseconds at which the space of the mounts is requested.
+    static const int StatTimeout = 2000;        ///< The time in milliseconds after which a mount that does not answer is stale.
+    static const int MaxStatThreads = 8;        ///< The maximum amount of mounts whose space is requested at once.
+
+    /*!
+     * \brief The space of a file system, as read by a worker thread.
+     */
+    struct MountSpace
+    {
+        bool valid = false;     ///< Whether the space could be read.
+        qint64 bytesTotal = 0;  ///< The size of the file system in bytes.
+        qint64 bytesFree = 0;   ///< The bytes available to the user.
+    };
+
+    QVector<MountPoint> mountPoints;        ///< The known mounts, in the order of the mount table.
+    QHash<QString, QSharedPointer<QFutureWatcher<MountSpace>>> pendingStats;   ///< The requests for space that have not returned yet, keyed by mount path.
+    QFutureWatcher<QVector<MountPoint>> tableWatcher;   ///< Watches the worker reading the mount table.
+    bool tableChanged;                      ///< Whether the mount table has changed while it was being read.
+    QThreadPool *statPool;                  ///< The workers that request the space of the mounts.
+    QSocketNotifier *tableNotifier;         ///< Reports the changes of the mount table, which is null if they are polled.
+    int tableFd;                            ///< The file descriptor that is watched for changes of the mount table.
+    QTimer refreshTimer;                    ///< Requests the space of the mounts periodically.
+
+    explicit MountMonitor(QObject *parent = nullptr);
+    ~MountMonitor();
+    void readTable();
+    void tableRead();
+    void applyTable(const QVector<MountPoint> &table);
+    void refreshSpace();
+    void requestSpace(const QString &mountPath);
+    void spaceRead(const QString &mountPath, const QSharedPointer<QFutureWatcher<MountSpace>> &watcher);
+    void markStale(const QString &mountPath, const QSharedPointer<QFutureWatcher<MountSpace>> &watcher);
+    int indexOf(const QString &mountPath) const;
+
+    static QVector<MountPoint> readMountTable();
+    static MountSpace readSpace(const QString &mountPath);
+    static bool isPseudoFileSystem(const QString &fileSystemType, const QString &mountPath);
+};
+
+#endif // MOUNTMONITOR_H
@@ -0,0 +1,431 @@
+#include "namematcher.h"
+
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+
+/*!
+ * \brief The constructor
+ * \param query = The query, which is empty to match every name
+ */
+NameMatcher::NameMatcher(const QString &query) :
+    queryText(query),
+    mode(SubstringMode),
+    asciiQuery(true)
+{
+    QString text(query);
+
+    if (text.startsWith('~')) {
+        mode = FuzzyMode;
+        text.remove(0, 1);
+    } else {
+        if (text.contains('*') || text.contains('?')) {
+            mode = GlobMode;
+        }
+    }
+
+    for (const QChar character : qAsConst(text)) {
+        if (character.unicode() >= 0x80) {
+            asciiQuery = false;
+            break;
+        }
+    }
+
+    if (asciiQuery) {
+        pattern = text.toLatin1();
+        foldAscii(pattern.constData(), pattern.size(), pattern.data());
+    } else {
+        pattern = foldName(text);
+    }
+
+    if (mode == GlobMode) {
+        // Every name that matches the glob contains its longest run of plain characters.
+        int runStart(0);
+
+        for (int pos(0); pos <= pattern.size(); ++pos) {
+            if (pos == pattern.size() || pattern.at(pos) == '*' || pattern.at(pos) == '?') {
+                if (pos - runStart > literal.size()) {
+                    literal = pattern.mid(runStart, pos - runStart);
+                }
+                runStart = pos + 1;
+            }
+        }
+    } else {
+        if (mode == SubstringMode) {
+            literal = pattern;
+        }
+    }
+}
+
+/*!
+ * \brief Checks if the matcher matches every name.
+ * \return A Boolean value that is true if the query is empty
+ */
+bool NameMatcher::isEmpty() const
+{
+    return pattern.isEmpty();
+}
+
+/*!
+ * \brief Provides the query of the matcher.
+ * \return A QString with the query as it was typed
+ */
+QString NameMatcher::query() const
+{
+    return queryText;
+}
+
+/*!
+ * \brief Checks if every name matched by this matcher is also matched by another one.
+ * \param previous = The other matcher, usually the one of the query before it was extended
+ * \return A Boolean value that is true if only the names matched by the other matcher need to be matched again
+ */
+bool NameMatcher::refines(const NameMatcher &previous) const
+{
+    if (previous.isEmpty() || previous.mode != mode || previous.asciiQuery != asciiQuery) {
+        return false;
+    }
+
+    switch (mode) {
+    case SubstringMode:
+        return pattern.contains(previous.pattern);
+
+    case FuzzyMode:
+        return isSubsequence(previous.pattern, pattern.constData(), pattern.size());
+
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Matches all the entries.
+ * \param entries = The entries
+ * \param matches = Set to the result of every entry, indexed by position
+ * \note Removed entries never match.
+ */
+void NameMatcher::matchAll(const DirectoryEntries &entries, QVector<bool> &matches) const
+{
+    matches.fill(false, entries.count());
+    matchArena(entries.nameArena.constData(), entries.nameOffsets.constData(), entries.nameLengths.constData(), entries.count(),
+               matches.data());
+
+    for (int entry(0); entry < entries.count(); ++entry) {
+        if (matches.at(entry) && entries.isRemoved(entry)) {
+            matches[entry] = false;
+        }
+    }
+}
+
+/*!
+ * \brief Matches all the names of an arena in which the names are stored back to back.
+ * \param arena = The UTF-8 names
+ * \param offsets = The offset of every name in the arena, in increasing order
+ * \param lengths = The length in bytes of every name
+ * \param count = The amount of names
+ * \param matches = Receives the result of every name, and must be set to false beforehand
+ * \note This is used for the names of DirectoryEntries and of the FileIndex.
+ */
+void NameMatcher::matchArena(const char *arena, const quint32 *offsets, const quint16 *lengths, int count, bool *matches) const
+{
+    QVector<int> chunkStarts;
+
+    for (int start(0); start < count; start += ChunkEntries) {
+        chunkStarts.append(start);
+    }
+
+    QtConcurrent::blockingMap(chunkStarts, [this, arena, offsets, lengths, count, matches](int start) {
+        matchRange(arena, offsets, lengths, start, qMin(start + ChunkEntries, count), matches);
+    });
+}
+
+/*!
+ * \brief Matches some of the entries.
+ * \param entries = The entries
+ * \param ids = The positions of the entries that are matched
+ * \param matches = Receives the result of each matched entry, indexed by position, and must hold all the entries
+ * \note This is used to refine the entries that matched the previous query, and for entries that have been added.
+ */
+void NameMatcher::matchEntries(const DirectoryEntries &entries, const QVector<int> &ids, QVector<bool> &matches) const
+{
+    QVector<int> chunkStarts;
+
+    for (int start(0); start < ids.count(); start += ChunkEntries) {
+        chunkStarts.append(start);
+    }
+
+    bool *matchData(matches.data());
+    const int idCount(ids.count());
+
+    QtConcurrent::blockingMap(chunkStarts, [this, &entries, &ids, matchData, idCount](int start) {
+        for (int i(start); i < qMin(start + ChunkEntries, idCount); ++i) {
+            matchData[ids.at(i)] = matchesEntry(entries, ids.at(i));
+        }
+    });
+}
+
+/*!
+ * \brief Matches a range of consecutive names.
+ * \param arena = The UTF-8 names
+ * \param offsets = The offset of every name in the arena
+ * \param lengths = The length in bytes of every name
+ * \param first = The position of the first name
+ * \param last = The position after the last name
+ * \param matches = Receives the result of each name, indexed by position
+ *
+ * The names of consecutive entries are stored back to back, so they are folded into one buffer and the buffer is
+ * searched for the literal part of the query. A hit that spans two names is skipped, and the rest of a name is skipped
+ * once it has matched.
+ */
+void NameMatcher::matchRange(const char *arena, const quint32 *offsets, const quint16 *lengths, int first, int last, bool *matches) const
+{
+    if (!asciiQuery || literal.isEmpty()) {
+        for (int entry(first); entry < last; ++entry) {
+            matches[entry] = matchesName(arena + offsets[entry], lengths[entry]);
+        }
+        return;
+    }
+
+    QByteArray buffer(FoldBufferSize, Qt::Uninitialized);
+
+    for (int blockFirst(first); blockFirst < last;) {
+        const quint32 blockStart(offsets[blockFirst]);
+        int blockLast(blockFirst + 1);
+
+        while (blockLast < last && offsets[blockLast] + lengths[blockLast] - blockStart <= static_cast<quint32>(FoldBufferSize)) {
+            ++blockLast;
+        }
+
+        const int blockLength(static_cast<int>(offsets[blockLast - 1] + lengths[blockLast - 1] - blockStart));
+        foldAscii(arena + blockStart, blockLength, buffer.data());
+
+        const char *folded(buffer.constData());
+        int searchPos(0), entry(blockFirst);
+
+        forever {
+            const char *hit(findBytes(folded + searchPos, blockLength - searchPos, literal));
+
+            if (hit == nullptr) {
+                break;
+            }
+
+            const quint32 hitOffset(blockStart + static_cast<quint32>(hit - folded));
+
+            while (offsets[entry] + lengths[entry] <= hitOffset) {
+                ++entry;
+            }
+
+            const quint32 nameEnd(offsets[entry] + lengths[entry]);
+
+            if (hitOffset + literal.size() > nameEnd) {
+                searchPos = static_cast<int>(hit - folded) + 1;
+                continue;
+            }
+
+            matches[entry] = (mode == SubstringMode) || matchesFolded(folded + (offsets[entry] - blockStart), lengths[entry]);
+
+            searchPos = static_cast<int>(nameEnd - blockStart);
+            ++entry;
+
+            if (entry >= blockLast) {
+                break;
+            }
+        }
+
+        blockFirst = blockLast;
+    }
+}
+
+/*!
+ * \brief Matches a single name.
+ * \param name = The UTF-8 name (does not need to be null terminated)
+ * \param length = The length of the name in bytes
+ * \return A Boolean value that is always true if the query is empty
+ */
+bool NameMatcher::matchesName(const char *name, int length) const
+{
+    if (isEmpty()) {
+        return true;
+    }
+
+    if (!asciiQuery) {
+        const QByteArray folded(foldName(QString::fromUtf8(name, length)));
+        return matchesFolded(folded.constData(), folded.size());
+    }
+
+    QVarLengthArray<char, 256> folded(length);
+    foldAscii(name, length, folded.data());
+
+    return matchesFolded(folded.constData(), folded.size());
+}
+
+/*!
+ * \brief Matches a single entry.
+ * \param entries = The entries
+ * \param entry = The position of the entry
+ * \return A Boolean value that is false for removed entries
+ */
+bool NameMatcher::matchesEntry(const DirectoryEntries &entries, int entry) const
+{
+    if (entries.isRemoved(entry)) {
+        return false;
+    }
+
+    const QByteArrayView name(entries.nameView(entry));
+    return matchesName(name.data(), static_cast<int>(name.size()));
+}
+
+/*!
+ * \brief Matches a folded name against the pattern.
+ * \param name = The folded name
+ * \param length = The length of the name in bytes
+ * \return A Boolean value
+ */
+bool NameMatcher::matchesFolded(const char *name, int length) const
+{
+    switch (mode) {
+    case GlobMode:
+        return globMatches(pattern, name, length);
+
+    case FuzzyMode:
+        return isSubsequence(pattern, name, length);
+
+    default:
+        return findBytes(name, length, pattern) != nullptr;
+    }
+}
+
+/*!
+ * \brief Folds the case of a name so it can be compared with a folded query.
+ * \param name = The name
+ * \return A QByteArray with the case folded name in UTF-8
+ */
+QByteArray NameMatcher::foldName(const QString &name)
+{
+    return name.normalized(QString::NormalizationForm_C).toCaseFolded().toUtf8();
+}
+
+/*!
+ * \brief Converts the uppercase ASCII letters of a buffer to lowercase.
+ * \param source = The bytes
+ * \param length = The amount of bytes
+ * \param target = Receives the folded bytes, which may be the source itself
+ * \note Other bytes are copied as they are, so the loop can be vectorized by the compiler.
+ */
+void NameMatcher::foldAscii(const char *source, int length, char *target)
+{
+    for (int i(0); i < length; ++i) {
+        const unsigned char byte(static_cast<unsigned char>(source[i]));
+        target[i] = static_cast<char>((byte - 'A' < 26u) ? (byte | 0x20) : byte);
+    }
+}
+
+/*!
+ * \brief Finds the first occurrence of a byte sequence.
+ * \param haystack = The bytes that are searched
+ * \param length = The amount of bytes that are searched
+ * \param needle = The bytes that are looked for
+ * \return A pointer to the occurrence, or nullptr if there is none
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+const char *NameMatcher::findBytes(const char *haystack, int length, const QByteArray &needle)
+{
+    if (length < needle.size()) {
+        return nullptr;
+    }
+
+#if defined (Q_OS_LINUX)
+    return static_cast<const char *>(memmem(haystack, static_cast<size_t>(length), needle.constData(), static_cast<size_t>(needle.size())));
+#else
+    const char *hit(std::search(haystack, haystack + length, needle.constBegin(), needle.constEnd()));
+    return (hit == haystack + length) ? nullptr : hit;
+#endif
+}
+
+/*!
+ * \brief Matches a whole name against a glob.
+ * \param glob = The folded glob, in which "*" matches any amount of characters and "?" matches a single character
+ * \param name = The folded name
+ * \param length = The length of the name in bytes
+ * \return A Boolean value
+ */
+bool NameMatcher::globMatches(const QByteArray &glob, const char *name, int length)
+{
+    int globPos(0), namePos(0), starGlobPos(-1), starNamePos(0);
+
+    while (namePos < length) {
+        if (globPos < glob.size() && glob.at(globPos) == '*') {
+            starGlobPos = ++globPos;
+            starNamePos = namePos;
+        } else {
+            if (globPos < glob.size() && glob.at(globPos) == '?') {
+                ++globPos;
+                namePos = nextCharacter(name, length, namePos);
+            } else {
+                if (globPos < glob.size() && glob.at(globPos) == name[namePos]) {
+                    ++globPos;
+                    ++namePos;
+                } else {
+                    if (starGlobPos < 0) {
+                        return false;
+                    }
+
+                    // Let the last star swallow one more character and try again.
+                    globPos = starGlobPos;
+                    starNamePos = nextCharacter(name, length, starNamePos);
+                    namePos = starNamePos;
+                }
+            }
+        }
+    }
+
+    while (globPos < glob.size() && glob.at(globPos) == '*') {
+        ++globPos;
+    }
+
+    return globPos == glob.size();
+}
+
+/*!
+ * \brief Checks if a name contains some characters in the same order.
+ * \param characters = The folded characters
+ * \param name = The folded name
+ * \param length = The length of the name in bytes
+ * \return A Boolean value
+ */
+bool NameMatcher::isSubsequence(const QByteArray &characters, const char *name, int length)
+{
+    int namePos(0);
+
+    for (const char character : characters) {
+        const void *hit(memchr(name + namePos, character, static_cast<size_t>(length - namePos)));
+
+        if (hit == nullptr) {
+            return false;
+        }
+
+        namePos = static_cast<int>(static_cast<const char *>(hit) - name) + 1;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Provides the position of the next UTF-8 character in a name.
+ * \param name = The name
+ * \param length = The length of the name in bytes
+ * \param pos = The position of the current character
+ * \return The position after the current character
+ */
+int NameMatcher::nextCharacter(const char *name, int length, int pos)
+{
+    ++pos;
+
+    while (pos < length && (static_cast<unsigned char>(name[pos]) & 0xC0) == 0x80) {
+        ++pos;
+    }
+
+    return pos;
+}
@@ -0,0 +1,65 @@
+#ifndef NAMEMATCHER_H
+#define NAMEMATCHER_H
+
+#include "directoryentries.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief Matches the names of DirectoryEntries against the query typed in a filter box.
+ *
+ * A query without wildcards matches every name that contains it, a query with "*" or "?" is a glob that has to match
+ * the whole name and a query starting with "~" matches every name that contains its characters in the same order. All
+ * the matching is case-insensitive.
+ *
+ * ASCII queries are matched on the name arena itself. Consecutive names are folded to lowercase into a buffer that
+ * stays in the CPU cache and the whole buffer is searched for the query at once, so only the names around a hit are
+ * looked at individually. Large directories are split into chunks that are matched in parallel. Queries with other
+ * characters are matched against the case folded names one by one.
+ */
+class NameMatcher
+{
+public:
+    /*!
+     * \brief The ways in which a query is matched.
+     */
+    enum Mode {
+        SubstringMode,  ///< 0
+        GlobMode,       ///< 1
+        FuzzyMode       ///< 2
+    };
+
+    explicit NameMatcher(const QString &query = QString());
+    bool isEmpty() const;
+    QString query() const;
+    bool refines(const NameMatcher &previous) const;
+    bool matchesName(const char *name, int length) const;
+    void matchAll(const DirectoryEntries &entries, QVector<bool> &matches) const;
+    void matchArena(const char *arena, const quint32 *offsets, const quint16 *lengths, int count, bool *matches) const;
+    void matchEntries(const DirectoryEntries &entries, const QVector<int> &ids, QVector<bool> &matches) const;
+
+private:
+    static const int ChunkEntries = 32768;          ///< The amount of entries that are matched by one worker at a time.
+    static const int FoldBufferSize = 64 * 1024;    ///< The size of the buffer in which the names are folded.
+
+    QString queryText;  ///< The query as it was typed.
+    Mode mode;          ///< How the query is matched.
+    bool asciiQuery;    ///< Whether the query only contains ASCII characters, so the names can be folded byte by byte.
+    QByteArray pattern; ///< The folded query without its mode prefix.
+    QByteArray literal; ///< The longest part of the pattern without wildcards, which every matching name contains.
+
+    void matchRange(const char *arena, const quint32 *offsets, const quint16 *lengths, int first, int last, bool *matches) const;
+    bool matchesEntry(const DirectoryEntries &entries, int entry) const;
+    bool matchesFolded(const char *name, int length) const;
+
+    static QByteArray foldName(const QString &name);
+    static void foldAscii(const char *source, int length, char *target);
+    static const char *findBytes(const char *haystack, int length, const QByteArray &needle);
+    static bool globMatches(const QByteArray &glob, const char *name, int length);
+    static bool isSubsequence(const QByteArray &characters, const char *name, int length);
+    static int nextCharacter(const char *name, int length, int pos);
+};
+
+#endif // NAMEMATCHER_H
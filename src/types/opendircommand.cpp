@@ -1,20 +1,28 @@
 #include "opendircommand.h"
+#include "directorycache.h"
+#include "historycache.h"
+
+#include <QItemSelection>
+#include <QTimer>
 
 /*!
  * \brief The constructor
  * \param nDir = The new directory path
  * \param oDir = The previous directory path
  * \param fileSystemModel = The file system model to which the changes will be applied
+ * \param view = The view showing the file system model, whose state is saved and restored
  * \param parent = The QUndoCommand to which this command is bound
  */
 OpenDirCommand::OpenDirCommand(const QString &nDir,
                                const QString &oDir,
-                               QSharedPointer<QFileSystemModel> fileSystemModel,
+                               QSharedPointer<DirectoryModel> fileSystemModel,
+                               QAbstractItemView *view,
                                QUndoCommand *parent) :
     QUndoCommand(parent),
     newDir(nDir),
     oldDir(oDir),
-    fileModel(fileSystemModel)
+    fileModel(fileSystemModel),
+    fileView(view)
 {
 }
 
@@ -30,7 +38,7 @@ OpenDirCommand::~OpenDirCommand()
  */
 void OpenDirCommand::undo()
 {
-    fileModel->setRootPath(oldDir);
+    openDir(oldDir, newState, oldState);
 }
 
 /*!
@@ -38,7 +46,7 @@ void OpenDirCommand::undo()
  */
 void OpenDirCommand::redo()
 {
-    fileModel->setRootPath(newDir);
+    openDir(newDir, oldState, newState);
 }
 
 /*!
@@ -49,3 +57,113 @@ int OpenDirCommand::id() const
 {
     return Id;
 }
+
+/*!
+ * \brief Shows a directory in the model and restores the state its view had there.
+ * \param dirPath = The directory to show
+ * \param leftState = Set to the state of the view in the directory that is left
+ * \param enteredState = The state of the view in the directory to show, which is empty the first time it is shown
+ *
+ * The listing that is left is retained by the HistoryCache. A retained listing of the new directory is shown right
+ * away and checked against the modification time of the directory, so it is only read again if it has changed.
+ */
+void OpenDirCommand::openDir(const QString &dirPath, ViewState &leftState, const ViewState &enteredState)
+{
+    leftState = saveViewState();
+    HistoryCache::instance()->retain(DirectoryCache::instance()->find(fileModel->rootPath()));
+
+    fileModel->setRootPath(dirPath);
+
+    const QSharedPointer<DirectoryListing> listing(DirectoryCache::instance()->find(fileModel->rootPath()));
+
+    if (!listing.isNull()) {
+        listing->revalidate();
+    }
+
+    if (fileView.isNull() || enteredState.dirPath.isEmpty()) {
+        return;
+    }
+
+    QAbstractItemView *view(fileView.data());
+    DirectoryModel *model(fileModel.data());
+
+    // The view lays its items out on the next turn of the event loop, and a directory that is read again only has
+    // its entries once it has been loaded.
+    if (fileModel->isLoading()) {
+        QObject::connect(model, &DirectoryModel::directoryLoaded, view, [view, model, enteredState]() {
+            restoreViewState(view, model, enteredState);
+        }, Qt::SingleShotConnection);
+    } else {
+        QTimer::singleShot(0, view, [view, model, enteredState]() {
+            restoreViewState(view, model, enteredState);
+        });
+    }
+}
+
+/*!
+ * \brief Saves the state of the view in the directory it shows.
+ * \return The ViewState, which is empty if there is no view
+ * \note Only the first MaxSavedSelection selected entries are remembered.
+ */
+OpenDirCommand::ViewState OpenDirCommand::saveViewState() const
+{
+    ViewState state;
+
+    if (fileView.isNull() || fileModel->rootPath().isEmpty()) {
+        return state;
+    }
+
+    state.dirPath = fileModel->rootPath();
+    state.topName = fileModel->fileName(fileView->indexAt(QPoint(1, 1)));
+    state.currentName = fileModel->fileName(fileView->currentIndex());
+
+    if (fileView->selectionModel() != nullptr) {
+        const QModelIndexList selectedIndexes(fileView->selectionModel()->selectedIndexes());
+
+        for (int i(0); i < selectedIndexes.count() && i < MaxSavedSelection; ++i) {
+            state.selectedNames.append(fileModel->fileName(selectedIndexes.at(i)));
+        }
+    }
+
+    return state;
+}
+
+/*!
+ * \brief Scrolls a view back to the entries it showed and selects them again.
+ * \param view = The view
+ * \param model = The model shown by the view
+ * \param state = The saved state of the view
+ * \note Nothing is restored if the model has moved on to another directory in the meantime, and entries that no
+ * longer exist are skipped.
+ */
+void OpenDirCommand::restoreViewState(QAbstractItemView *view, DirectoryModel *model, const ViewState &state)
+{
+    if (model->rootPath() != state.dirPath || view->selectionModel() == nullptr) {
+        return;
+    }
+
+    const QString pathPrefix(state.dirPath.endsWith('/') ? state.dirPath : state.dirPath + '/');
+    QItemSelection selection;
+
+    for (const QString &name : state.selectedNames) {
+        const QModelIndex selectedIndex(model->index(pathPrefix + name));
+
+        if (selectedIndex.isValid()) {
+            selection.select(selectedIndex, selectedIndex);
+        }
+    }
+
+    view->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+
+    const QModelIndex currentIndex(model->index(pathPrefix + state.currentName));
+
+    if (currentIndex.isValid()) {
+        view->selectionModel()->setCurrentIndex(currentIndex, QItemSelectionModel::NoUpdate);
+    }
+
+    const QModelIndex topIndex(model->index(pathPrefix + state.topName));
+
+    if (topIndex.isValid()) {
+        view->scrollTo(topIndex, QAbstractItemView::PositionAtTop);
+    }
+}
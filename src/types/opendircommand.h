@@ -1,19 +1,27 @@
 #ifndef OPENDIRCOMMAND_H
 #define OPENDIRCOMMAND_H
 
-#include <QUndoCommand>
-#include <QFileSystemModel>
+#include "directorymodel.h"
+
+#include <QAbstractItemView>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QStringList>
+#include <QUndoCommand>
 
 /*!
  * \brief The command class for opening a directory path.
+ *
+ * The command remembers how the view looked in both directories, so undoing or redoing it scrolls back to the same
+ * entries with the same selection. The listing of the directory that is left is retained by the HistoryCache, so it is
+ * shown again instantly and only read again if it has changed in the meantime.
  */
 class OpenDirCommand : public QUndoCommand
 {
 public:
     enum {Id = 1122};
 
-    OpenDirCommand(const QString &nDir, const QString &oDir, QSharedPointer<QFileSystemModel> fileSystemModel, QUndoCommand *parent = nullptr);
+    OpenDirCommand(const QString &nDir, const QString &oDir, QSharedPointer<DirectoryModel> fileSystemModel, QAbstractItemView *view = nullptr, QUndoCommand *parent = nullptr);
     ~OpenDirCommand();
 
     void undo() override;
@@ -21,9 +29,30 @@ public:
     int id() const override;
 
 private:
+    static const int MaxSavedSelection = 1000;  ///< The maximum amount of selected entries that are remembered.
+
+    /*!
+     * \brief The state of the view in one of the directories.
+     */
+    struct ViewState
+    {
+        QString dirPath;            ///< The directory that was shown, which is empty if no state was saved.
+        QString topName;            ///< The name of the entry at the top of the viewport.
+        QString currentName;        ///< The name of the current entry.
+        QStringList selectedNames;  ///< The names of the selected entries.
+    };
+
     QString newDir; ///< The new directory path to be opened.
     QString oldDir; ///< The old directory path before opening the new one.
-    QSharedPointer<QFileSystemModel> fileModel; ///< The file system model on which the command should be performed.
+    QSharedPointer<DirectoryModel> fileModel; ///< The file system model on which the command should be performed.
+    QPointer<QAbstractItemView> fileView;   ///< The view showing the file system model, which may be null.
+    ViewState newState;     ///< The state of the view in the new directory, saved when the command is undone.
+    ViewState oldState;     ///< The state of the view in the old directory, saved when the command is performed.
+
+    void openDir(const QString &dirPath, ViewState &leftState, const ViewState &enteredState);
+    ViewState saveViewState() const;
+
+    static void restoreViewState(QAbstractItemView *view, DirectoryModel *model, const ViewState &state);
 };
 
 #endif // OPENDIRCOMMAND_H
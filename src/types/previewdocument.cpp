@@ -0,0 +1,425 @@
+#include "previewdocument.h"
+
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined (Q_OS_LINUX)
+#include <fcntl.h>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ */
+PreviewDocument::PreviewDocument(QObject *parent) :
+    QObject(parent),
+    fileSize(0),
+    indexed(0),
+    lineCount(0),
+    inLine(false)
+{
+    followTimer.setInterval(FollowInterval);
+
+    connect(&indexWatcher, &QFutureWatcher<IndexBatch>::resultsReadyAt, this, &PreviewDocument::indexBatchesReadyAt);
+    connect(&indexWatcher, &QFutureWatcher<IndexBatch>::finished, this, &PreviewDocument::startIndexing);
+    connect(&followTimer, &QTimer::timeout, this, &PreviewDocument::checkSize);
+}
+
+/*!
+ * \brief The destructor
+ * \note The worker that indexes the lines is canceled and waited for.
+ */
+PreviewDocument::~PreviewDocument()
+{
+    indexWatcher.cancel();
+    indexWatcher.waitForFinished();
+}
+
+/*!
+ * \brief Opens a file and starts indexing its lines.
+ * \param path = The path of the file
+ * \return A Boolean value that is true if the file could be opened
+ * \note The file that was open before is closed, even if the new file can not be opened.
+ */
+bool PreviewDocument::open(const QString &path)
+{
+    indexWatcher.cancel();
+    file.close();
+    file.setFileName(path);
+    fileSize = 0;
+    lineOffsets = {0};
+    indexed = 0;
+    lineCount = 0;
+    inLine = false;
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        emit sizeChanged();
+        return false;
+    }
+
+    fileSize = file.size();
+    startIndexing();
+    emit sizeChanged();
+
+    return true;
+}
+
+/*!
+ * \brief Closes the file.
+ */
+void PreviewDocument::close()
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    indexWatcher.cancel();
+    file.close();
+    fileSize = 0;
+    lineOffsets = {0};
+    indexed = 0;
+    lineCount = 0;
+    inLine = false;
+    emit sizeChanged();
+}
+
+/*!
+ * \brief Provides the path of the file.
+ * \return A QString that is empty if no file has been opened
+ */
+QString PreviewDocument::path() const
+{
+    return file.fileName();
+}
+
+/*!
+ * \brief Checks if a file is open.
+ * \return A Boolean value
+ */
+bool PreviewDocument::isOpen() const
+{
+    return file.isOpen();
+}
+
+/*!
+ * \brief Provides the size of the file.
+ * \return A qint64 with the size in bytes when it was last checked
+ */
+qint64 PreviewDocument::size() const
+{
+    return fileSize;
+}
+
+/*!
+ * \brief Checks if the lines are still being indexed.
+ * \return A Boolean value
+ */
+bool PreviewDocument::isIndexing() const
+{
+    return indexed < fileSize;
+}
+
+/*!
+ * \brief Provides the amount of bytes whose lines have been indexed.
+ * \return A qint64
+ */
+qint64 PreviewDocument::indexedBytes() const
+{
+    return indexed;
+}
+
+/*!
+ * \brief Provides the amount of lines that have been indexed.
+ * \return A qint64 with the amount of line ends found so far, plus one for a last line without a line end
+ */
+qint64 PreviewDocument::indexedLineCount() const
+{
+    return inLine ? lineCount + 1 : lineCount;
+}
+
+/*!
+ * \brief Reads a window of the file.
+ * \param offset = The offset of the window
+ * \param length = The maximum length of the window
+ * \return A QByteArray that is shorter than the length at the end of the file
+ */
+QByteArray PreviewDocument::read(qint64 offset, qint64 length)
+{
+    if (!file.isOpen() || offset < 0 || offset >= fileSize || !file.seek(offset)) {
+        return QByteArray();
+    }
+
+    return file.read(qMin(length, fileSize - offset));
+}
+
+/*!
+ * \brief Finds the start of the line that contains an offset.
+ * \param offset = The offset
+ * \return A qint64 with the offset of the line, which is at most MaxLineScan bytes before the offset
+ */
+qint64 PreviewDocument::lineStart(qint64 offset)
+{
+    const qint64 limit(qMax<qint64>(0, offset - MaxLineScan));
+
+    for (qint64 pos(qMin(offset, fileSize)); pos > limit;) {
+        const qint64 chunkStart(qMax<qint64>(limit, pos - ScanBufferSize));
+        const qint64 lineEnd(read(chunkStart, pos - chunkStart).lastIndexOf('\n'));
+
+        if (lineEnd >= 0) {
+            return chunkStart + lineEnd + 1;
+        }
+
+        pos = chunkStart;
+    }
+
+    return limit;
+}
+
+/*!
+ * \brief Finds the start of the line after the line that contains an offset.
+ * \param offset = The offset
+ * \return A qint64 with the offset of the next line, which is at most MaxLineScan bytes after the offset, or the size
+ * of the file if the offset is in the last line
+ */
+qint64 PreviewDocument::nextLineStart(qint64 offset)
+{
+    const qint64 limit(qMin(fileSize, offset + MaxLineScan));
+
+    for (qint64 pos(offset); pos < limit;) {
+        const QByteArray chunk(read(pos, qMin<qint64>(ScanBufferSize, limit - pos)));
+        const qint64 lineEnd(chunk.indexOf('\n'));
+
+        if (chunk.isEmpty()) {
+            break;
+        }
+
+        if (lineEnd >= 0) {
+            return pos + lineEnd + 1;
+        }
+
+        pos += chunk.size();
+    }
+
+    return limit;
+}
+
+/*!
+ * \brief Provides the offset of a line.
+ * \param line = The number of the line, starting at 0
+ * \return A qint64 with the offset, or -1 if the line has not been indexed yet
+ */
+qint64 PreviewDocument::lineOffset(qint64 line)
+{
+    if (line < 0 || line > lineCount) {
+        return -1;
+    }
+
+    return skipLines(lineOffsets.at(line / LineStride), line % LineStride);
+}
+
+/*!
+ * \brief Provides the number of the line that starts at an offset.
+ * \param offset = The offset
+ * \return A qint64 with the number, starting at 0, or -1 if the offset has not been indexed yet or lies more than
+ * MaxCountScan bytes after the nearest offset in the index
+ */
+qint64 PreviewDocument::lineNumber(qint64 offset)
+{
+    if (offset < 0 || offset > indexed) {
+        return -1;
+    }
+
+    const int stride(static_cast<int>(std::upper_bound(lineOffsets.constBegin(), lineOffsets.constEnd(), offset) - lineOffsets.constBegin()) - 1);
+    qint64 number(static_cast<qint64>(stride) * LineStride);
+
+    if (offset - lineOffsets.at(stride) > MaxCountScan) {
+        return -1;
+    }
+
+    for (qint64 pos(lineOffsets.at(stride)); pos < offset;) {
+        const QByteArray chunk(read(pos, qMin<qint64>(ScanBufferSize, offset - pos)));
+
+        if (chunk.isEmpty()) {
+            break;
+        }
+
+        number += chunk.count('\n');
+        pos += chunk.size();
+    }
+
+    return number;
+}
+
+/*!
+ * \brief Checks if the file is followed.
+ * \return A Boolean value
+ */
+bool PreviewDocument::isFollowing() const
+{
+    return followTimer.isActive();
+}
+
+/*!
+ * \brief Starts or stops following the file.
+ * \param following = Whether the size of the file is checked for appended data
+ */
+void PreviewDocument::setFollowing(bool following)
+{
+    if (following) {
+        followTimer.start();
+        checkSize();
+    } else {
+        followTimer.stop();
+    }
+}
+
+/*!
+ * \brief Starts indexing the part of the file that has not been indexed yet, unless it is already being indexed.
+ */
+void PreviewDocument::startIndexing()
+{
+    if (!file.isOpen() || indexWatcher.isRunning() || indexed >= fileSize) {
+        return;
+    }
+
+    indexWatcher.setFuture(QtConcurrent::run(&PreviewDocument::indexLines, file.fileName(), indexed, fileSize, lineCount, inLine));
+}
+
+/*!
+ * \brief Adds the parts of the index that the worker has reported.
+ * \param first = The index of the first part
+ * \param last = The index after the last part
+ */
+void PreviewDocument::indexBatchesReadyAt(int first, int last)
+{
+    if (indexWatcher.isCanceled()) {
+        return;
+    }
+
+    for (int i(first); i < last; ++i) {
+        const IndexBatch batch(indexWatcher.resultAt(i));
+
+        lineOffsets += batch.lineOffsets;
+        indexed = batch.indexedBytes;
+        lineCount = batch.lineCount;
+        inLine = batch.inLine;
+    }
+
+    emit indexChanged();
+}
+
+/*!
+ * \brief Checks if data has been appended to the followed file, or if it has been truncated or replaced.
+ * \note A file that is smaller at its path than it was is opened again, which also follows a log to the new file that
+ * replaces it when it is rotated.
+ */
+void PreviewDocument::checkSize()
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (QFileInfo(file.fileName()).size() < fileSize) {
+        open(file.fileName());
+        return;
+    }
+
+    const qint64 newSize(file.size());
+
+    if (newSize > fileSize) {
+        fileSize = newSize;
+        startIndexing();
+        emit sizeChanged();
+    }
+}
+
+/*!
+ * \brief Skips a number of lines.
+ * \param offset = The offset of the first line
+ * \param count = The amount of lines to skip
+ * \return A qint64 with the offset of the line after the skipped lines, or the size of the file if it ends before it
+ */
+qint64 PreviewDocument::skipLines(qint64 offset, qint64 count)
+{
+    while (count > 0) {
+        const QByteArray chunk(read(offset, ScanBufferSize));
+        const char *begin(chunk.constData()), *end(begin + chunk.size()), *pos(begin);
+
+        if (chunk.isEmpty()) {
+            return fileSize;
+        }
+
+        for (const char *lineEnd(static_cast<const char *>(memchr(pos, '\n', end - pos))); lineEnd != nullptr && count > 0;
+             lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos))) {
+            pos = lineEnd + 1;
+            --count;
+        }
+
+        offset += (count > 0) ? chunk.size() : (pos - begin);
+    }
+
+    return offset;
+}
+
+/*!
+ * \brief Indexes the lines of a part of a file.
+ * \param promise = The promise to which the parts of the index are reported
+ * \param path = The path of the file
+ * \param startOffset = The offset at which indexing starts
+ * \param endOffset = The offset at which indexing stops
+ * \param startLines = The amount of line ends before the start offset
+ * \param startInLine = Whether the start offset lies in the middle of a line
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note This function is meant to be run with QtConcurrent::run() and stops as soon as the promise is canceled.
+ */
+void PreviewDocument::indexLines(QPromise<IndexBatch> &promise, const QString &path, qint64 startOffset, qint64 endOffset, qint64 startLines,
+                                 bool startInLine)
+{
+    QFile indexedFile(path);
+
+    if (!indexedFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !indexedFile.seek(startOffset)) {
+        return;
+    }
+
+#if defined (Q_OS_LINUX)
+    posix_fadvise(indexedFile.handle(), startOffset, endOffset - startOffset, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    QByteArray buffer(IndexBufferSize, Qt::Uninitialized);
+    IndexBatch batch{QVector<qint64>(), startOffset, startLines, startInLine};
+    qint64 reportedOffset(startOffset);
+
+    for (qint64 offset(startOffset); offset < endOffset && !promise.isCanceled();) {
+        const qint64 bytesRead(indexedFile.read(buffer.data(), qMin<qint64>(buffer.size(), endOffset - offset)));
+
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        const char *begin(buffer.constData()), *end(begin + bytesRead);
+
+        for (const char *lineEnd(static_cast<const char *>(memchr(begin, '\n', bytesRead))); lineEnd != nullptr;
+             lineEnd = static_cast<const char *>(memchr(lineEnd + 1, '\n', end - lineEnd - 1))) {
+            if (++batch.lineCount % LineStride == 0) {
+                batch.lineOffsets.append(offset + (lineEnd - begin) + 1);
+            }
+        }
+
+        offset += bytesRead;
+        batch.indexedBytes = offset;
+        batch.inLine = (*(end - 1) != '\n');
+
+        if (offset - reportedOffset >= IndexBatchBytes) {
+            promise.addResult(batch);
+            batch.lineOffsets.clear();
+            reportedOffset = offset;
+        }
+    }
+
+    if (batch.indexedBytes > reportedOffset) {
+        promise.addResult(batch);
+    }
+}
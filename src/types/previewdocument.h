@@ -0,0 +1,91 @@
+#ifndef PREVIEWDOCUMENT_H
+#define PREVIEWDOCUMENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+/*!
+ * \brief A file shown in the preview pane, which is read in small windows around the visible part.
+ *
+ * Opening a file only opens it, so even files of many gigabytes are shown at once. The offsets of the lines are indexed
+ * on a worker thread in the background, which keeps only the offset of every LineStride-th line, so the index of a file
+ * with hundreds of millions of lines stays small. The offset of any indexed line is found from the nearest kept offset
+ * by counting at most LineStride lines.
+ *
+ * While following, the size of the file is checked every FollowInterval, and appended data is indexed from where the
+ * index stopped. A file that has been truncated is opened again.
+ * \note The windows are read with positional reads instead of mapping the file into memory, since a mapped file that is
+ * truncated by another process, as rotated logs are, would crash the application.
+ */
+class PreviewDocument : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewDocument(QObject *parent = nullptr);
+    ~PreviewDocument();
+    bool open(const QString &path);
+    void close();
+    QString path() const;
+    bool isOpen() const;
+    qint64 size() const;
+    bool isIndexing() const;
+    qint64 indexedBytes() const;
+    qint64 indexedLineCount() const;
+    QByteArray read(qint64 offset, qint64 length);
+    qint64 lineStart(qint64 offset);
+    qint64 nextLineStart(qint64 offset);
+    qint64 lineOffset(qint64 line);
+    qint64 lineNumber(qint64 offset);
+    bool isFollowing() const;
+    void setFollowing(bool following);
+
+signals:
+    void indexChanged();    ///< Emitted when more lines have been indexed.
+    void sizeChanged();     ///< Emitted when the file has been opened or closed, and when data has been appended to it.
+
+private:
+    static const int LineStride = 256;              ///< The amount of lines between the offsets kept in the index.
+    static const qint64 MaxLineScan = 1024 * 1024;  ///< The amount of bytes searched for the end of a line, beyond which a line is split.
+    static const qint64 MaxCountScan = 16 * 1024 * 1024;    ///< The amount of bytes in which line ends are counted to number a line.
+    static const int ScanBufferSize = 64 * 1024;    ///< The size of the reads with which lines are searched.
+    static const int IndexBufferSize = 1024 * 1024; ///< The size of the reads with which lines are indexed.
+    static const qint64 IndexBatchBytes = 64 * 1024 * 1024; ///< The amount of bytes indexed between two reports.
+    static const int FollowInterval = 500;          ///< The interval in milliseconds at which a followed file is checked.
+
+    /*!
+     * \brief A part of the index, reported by the worker thread.
+     */
+    struct IndexBatch
+    {
+        QVector<qint64> lineOffsets;    ///< The offsets of every LineStride-th line found in the part.
+        qint64 indexedBytes;            ///< The amount of bytes indexed once the part has been added.
+        qint64 lineCount;               ///< The amount of line ends found once the part has been added.
+        bool inLine;                    ///< Whether the indexed bytes end in the middle of a line.
+    };
+
+    QFile file;                             ///< The open file.
+    qint64 fileSize;                        ///< The size of the file when it was last checked.
+    QVector<qint64> lineOffsets;            ///< The offset of every LineStride-th line, starting with the first.
+    qint64 indexed;                         ///< The amount of bytes that have been indexed.
+    qint64 lineCount;                       ///< The amount of line ends in the indexed bytes.
+    bool inLine;                            ///< Whether the indexed bytes end in the middle of a line.
+    QFutureWatcher<IndexBatch> indexWatcher;    ///< Watches the worker that indexes the lines.
+    QTimer followTimer;                     ///< Checks the size of the file while it is followed.
+
+    void startIndexing();
+    void indexBatchesReadyAt(int first, int last);
+    void checkSize();
+    qint64 skipLines(qint64 offset, qint64 count);
+
+    static void indexLines(QPromise<IndexBatch> &promise, const QString &path, qint64 startOffset, qint64 endOffset, qint64 startLines,
+                           bool startInLine);
+};
+
+#endif // PREVIEWDOCUMENT_H
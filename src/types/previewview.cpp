@@ -0,0 +1,411 @@
+#include "previewview.h"
+
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+/*!
+ * \brief The constructor.
+ * \param parent = The widget to which the view is bound
+ */
+PreviewView::PreviewView(QWidget *parent) :
+    QAbstractScrollArea(parent),
+    viewMode(TextMode),
+    topOffset(0),
+    pendingLine(-1)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    setFocusPolicy(Qt::StrongFocus);
+
+    connect(verticalScrollBar(), &QScrollBar::actionTriggered, this, &PreviewView::scrollBarAction);
+}
+
+/*!
+ * \brief Sets the document that is shown.
+ * \param previewDocument = The document
+ */
+void PreviewView::setDocument(PreviewDocument *previewDocument)
+{
+    if (document) {
+        disconnect(document, nullptr, this, nullptr);
+    }
+
+    document = previewDocument;
+    connect(document, &PreviewDocument::sizeChanged, this, &PreviewView::documentSizeChanged);
+    connect(document, &PreviewDocument::indexChanged, this, &PreviewView::documentIndexChanged);
+    documentSizeChanged();
+}
+
+/*!
+ * \brief Provides whether the file is shown as text or as a hex dump.
+ * \return The Mode
+ */
+PreviewView::Mode PreviewView::mode() const
+{
+    return viewMode;
+}
+
+/*!
+ * \brief Shows the file as text or as a hex dump.
+ * \param newMode = The mode
+ * \note The top row stays at about the same offset.
+ */
+void PreviewView::setMode(Mode newMode)
+{
+    viewMode = newMode;
+    setTopOffset(topOffset);
+}
+
+/*!
+ * \brief Scrolls to a line, or to the line once it has been indexed.
+ * \param line = The number of the line, starting at 0
+ */
+void PreviewView::goToLine(qint64 line)
+{
+    if (!document) {
+        return;
+    }
+
+    const qint64 offset(document->lineOffset(line));
+
+    if (offset < 0) {
+        pendingLine = line;
+        return;
+    }
+
+    pendingLine = -1;
+    setTopOffset(offset);
+}
+
+/*!
+ * \brief Scrolls to the end of the file, so its last row is at the bottom.
+ */
+void PreviewView::scrollToEnd()
+{
+    if (!document) {
+        return;
+    }
+
+    const qint64 size(document->size());
+
+    if (viewMode == HexMode) {
+        const qint64 rowCount((size + HexRowBytes - 1) / HexRowBytes);
+        setTopOffset(qMax<qint64>(0, rowCount - fullRows()) * HexRowBytes);
+    } else {
+        qint64 offset(document->lineStart(size));
+
+        for (int row(1); row < fullRows() && offset > 0; ++row) {
+            offset = document->lineStart(offset - 1);
+        }
+
+        setTopOffset(offset);
+    }
+}
+
+/*!
+ * \brief Draws the rows in the viewport.
+ * \param event = The paint event
+ */
+void PreviewView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(viewport());
+    const QFontMetrics metrics(font());
+    const int rows(viewport()->height() / metrics.height() + 1);
+    const QColor dimColor(palette().color(QPalette::Disabled, QPalette::Text));
+
+    painter.setFont(font());
+
+    if (!document || !document->isOpen()) {
+        return;
+    }
+
+    if (viewMode == HexMode) {
+        const QByteArray data(document->read(topOffset, static_cast<qint64>(rows) * HexRowBytes));
+
+        for (int row(0); row * HexRowBytes < data.size(); ++row) {
+            const QByteArray rowData(data.mid(row * HexRowBytes, HexRowBytes));
+            QString hexText, charText;
+
+            for (int i(0); i < HexRowBytes; ++i) {
+                if (i < rowData.size()) {
+                    const uchar byte(static_cast<uchar>(rowData.at(i)));
+
+                    hexText += QString("%1 ").arg(static_cast<uint>(byte), 2, 16, QChar('0'));
+                    charText += (byte >= 0x20 && byte < 0x7f) ? QChar::fromLatin1(static_cast<char>(byte)) : QChar('.');
+                } else {
+                    hexText += "   ";
+                }
+
+                if (i == HexRowBytes / 2 - 1) {
+                    hexText += ' ';
+                }
+            }
+
+            const int baseline(row * metrics.height() + metrics.ascent());
+            const QString offsetText(QString("%1  ").arg(topOffset + row * HexRowBytes, 10, 16, QChar('0')));
+
+            painter.setPen(dimColor);
+            painter.drawText(0, baseline, offsetText);
+            painter.setPen(palette().color(QPalette::Text));
+            painter.drawText(metrics.horizontalAdvance(offsetText), baseline, hexText + ' ' + charText);
+        }
+
+        return;
+    }
+
+    // Every row is read on its own, so a long line never makes the rows below it wait for its end.
+    const qint64 firstLine(document->lineNumber(topOffset));
+    const int gutterWidth((firstLine < 0) ? 0 : metrics.horizontalAdvance(QString::number(firstLine + rows) + "  "));
+    qint64 offset(topOffset);
+
+    for (int row(0); row < rows && offset < document->size(); ++row) {
+        const QByteArray lineData(document->read(offset, MaxShownLength + 1));
+        const int lineEnd(lineData.indexOf('\n'));
+        QString lineText(QString::fromUtf8(lineData.left((lineEnd >= 0) ? lineEnd : MaxShownLength)));
+        const int baseline(row * metrics.height() + metrics.ascent());
+
+        lineText.replace('\t', "    ");
+        lineText.remove('\r');
+
+        if (firstLine >= 0) {
+            painter.setPen(dimColor);
+            painter.drawText(0, baseline, QString::number(firstLine + row + 1));
+        }
+
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(gutterWidth, baseline, lineText);
+
+        offset = (lineEnd >= 0) ? offset + lineEnd + 1 : document->nextLineStart(offset);
+    }
+}
+
+/*!
+ * \brief Keeps the end of a followed file in view when the view is resized.
+ * \param event = The resize event
+ */
+void PreviewView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    refreshScrollBar();
+
+    if (document && document->isFollowing()) {
+        scrollToEnd();
+    }
+}
+
+/*!
+ * \brief Scrolls to the start or the end of the file with the Home and End keys.
+ * \param event = The key event
+ * \note The other keys are handled by the scroll area, which triggers the actions of the scroll bar.
+ */
+void PreviewView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Home) {
+        setTopOffset(0);
+        return;
+    }
+
+    if (event->key() == Qt::Key_End) {
+        scrollToEnd();
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+/*!
+ * \brief Scrolls by rows with the mouse wheel.
+ * \param event = The wheel event
+ */
+void PreviewView::wheelEvent(QWheelEvent *event)
+{
+    const int delta(event->angleDelta().y());
+    qint64 rows(-delta * WheelRows / 120);
+
+    if (rows == 0 && delta != 0) {
+        rows = (delta > 0) ? -1 : 1;
+    }
+
+    scrollRows(rows);
+    event->accept();
+}
+
+/*!
+ * \brief Redraws the viewport after the scroll bar has moved.
+ * \param dx = The horizontal distance
+ * \param dy = The vertical distance
+ */
+void PreviewView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx)
+    Q_UNUSED(dy)
+
+    viewport()->update();
+}
+
+/*!
+ * \brief Provides the amount of rows that fit completely in the viewport.
+ * \return An integer that is at least 1
+ */
+int PreviewView::fullRows() const
+{
+    return qMax(1, viewport()->height() / QFontMetrics(font()).height());
+}
+
+/*!
+ * \brief Provides the start of the row that contains an offset.
+ * \param offset = The offset
+ * \return A qint64 with the start of the line in text mode, or of the row of bytes in hex mode
+ */
+qint64 PreviewView::rowStart(qint64 offset)
+{
+    if (viewMode == HexMode) {
+        return offset - offset % HexRowBytes;
+    }
+
+    return document->lineStart(offset);
+}
+
+/*!
+ * \brief Scrolls by a number of rows.
+ * \param rows = The amount of rows, which is negative to scroll up
+ * \note The top row never moves past the last row of the file.
+ */
+void PreviewView::scrollRows(qint64 rows)
+{
+    if (!document) {
+        return;
+    }
+
+    qint64 offset(topOffset);
+
+    if (viewMode == HexMode) {
+        const qint64 lastRow(qMax<qint64>(0, (document->size() - 1) / HexRowBytes));
+        offset = qBound<qint64>(0, offset / HexRowBytes + rows, lastRow) * HexRowBytes;
+    } else {
+        for (; rows > 0; --rows) {
+            const qint64 nextOffset(document->nextLineStart(offset));
+
+            if (nextOffset >= document->size()) {
+                break;
+            }
+
+            offset = nextOffset;
+        }
+
+        for (; rows < 0 && offset > 0; ++rows) {
+            offset = document->lineStart(offset - 1);
+        }
+    }
+
+    setTopOffset(offset);
+}
+
+/*!
+ * \brief Sets the offset of the top row and redraws the viewport.
+ * \param offset = The offset, which is moved to the start of its row
+ */
+void PreviewView::setTopOffset(qint64 offset)
+{
+    if (!document) {
+        return;
+    }
+
+    topOffset = rowStart(qBound<qint64>(0, offset, document->size()));
+    refreshScrollBar();
+    viewport()->update();
+}
+
+/*!
+ * \brief Sets the range and the position of the scroll bar to the size of the file and the offset of the top row.
+ */
+void PreviewView::refreshScrollBar()
+{
+    const qint64 size(document ? document->size() : 0);
+    const int maximum(static_cast<int>(qMin<qint64>(size, ScrollMaximum)));
+    QScrollBar *scrollBar(verticalScrollBar());
+    const QSignalBlocker blocker(scrollBar);
+
+    scrollBar->setRange(0, maximum);
+    scrollBar->setPageStep(qMax(1, maximum / 100));
+    scrollBar->setValue((size > 0) ? static_cast<int>(static_cast<double>(topOffset) / size * maximum) : 0);
+}
+
+/*!
+ * \brief Scrolls by rows or to the offset of the slider when the scroll bar is used.
+ * \param action = The QAbstractSlider::SliderAction
+ */
+void PreviewView::scrollBarAction(int action)
+{
+    QScrollBar *scrollBar(verticalScrollBar());
+
+    switch (action) {
+    case QAbstractSlider::SliderSingleStepAdd:
+        scrollRows(1);
+        break;
+
+    case QAbstractSlider::SliderSingleStepSub:
+        scrollRows(-1);
+        break;
+
+    case QAbstractSlider::SliderPageStepAdd:
+        scrollRows(fullRows() - 1);
+        break;
+
+    case QAbstractSlider::SliderPageStepSub:
+        scrollRows(1 - fullRows());
+        break;
+
+    case QAbstractSlider::SliderToMaximum:
+        scrollToEnd();
+        break;
+
+    default:
+        if (document && scrollBar->maximum() > 0) {
+            setTopOffset(static_cast<qint64>(static_cast<double>(scrollBar->sliderPosition()) / scrollBar->maximum() * document->size()));
+        }
+        break;
+    }
+
+    // The scroll bar applies the position of its slider after this action, so the position is taken from the top row.
+    if (document && document->size() > 0) {
+        scrollBar->setSliderPosition(static_cast<int>(static_cast<double>(topOffset) / document->size() * scrollBar->maximum()));
+    }
+}
+
+/*!
+ * \brief Shows a file that has been opened from its start, and follows the end of a file that has grown.
+ */
+void PreviewView::documentSizeChanged()
+{
+    if (document->path() != shownPath || topOffset > document->size()) {
+        shownPath = document->path();
+        topOffset = 0;
+        pendingLine = -1;
+    }
+
+    if (document->isFollowing()) {
+        scrollToEnd();
+    } else {
+        refreshScrollBar();
+        viewport()->update();
+    }
+}
+
+/*!
+ * \brief Goes to the line that was requested before it was indexed, and numbers the rows once they are indexed.
+ */
+void PreviewView::documentIndexChanged()
+{
+    if (pendingLine >= 0) {
+        goToLine(pendingLine);
+    }
+
+    viewport()->update();
+}
@@ -0,0 +1,62 @@
+#ifndef PREVIEWVIEW_H
+#define PREVIEWVIEW_H
+
+#include "previewdocument.h"
+
+#include <QAbstractScrollArea>
+#include <QPointer>
+
+/*!
+ * \brief The view of the preview pane, which shows a PreviewDocument as text or as a hex dump.
+ *
+ * Only the rows in the viewport are read and drawn, starting at the offset of the top row. The scroll bar maps to the
+ * offsets of the whole file rather than to its lines, so the view can be scrolled anywhere, including to the end,
+ * before the lines have been indexed. Lines are numbered once the index has reached them.
+ */
+class PreviewView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        TextMode,   ///< 0
+        HexMode     ///< 1
+    };
+
+    explicit PreviewView(QWidget *parent = nullptr);
+    void setDocument(PreviewDocument *previewDocument);
+    Mode mode() const;
+    void setMode(Mode newMode);
+    void goToLine(qint64 line);
+    void scrollToEnd();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    static const int HexRowBytes = 16;          ///< The amount of bytes in a row of the hex dump.
+    static const int MaxShownLength = 1024;     ///< The amount of bytes of a line that are shown.
+    static const int ScrollMaximum = 1 << 30;   ///< The maximum of the scroll bar for large files.
+    static const int WheelRows = 3;             ///< The amount of rows scrolled by a step of the mouse wheel.
+
+    QPointer<PreviewDocument> document; ///< The document that is shown.
+    QString shownPath;                  ///< The path of the file that is shown.
+    Mode viewMode;                      ///< Whether the file is shown as text or as a hex dump.
+    qint64 topOffset;                   ///< The offset of the top row.
+    qint64 pendingLine;                 ///< The line to go to once it has been indexed, or -1.
+
+    int fullRows() const;
+    qint64 rowStart(qint64 offset);
+    void scrollRows(qint64 rows);
+    void setTopOffset(qint64 offset);
+    void refreshScrollBar();
+    void scrollBarAction(int action);
+    void documentSizeChanged();
+    void documentIndexChanged();
+};
+
+#endif // PREVIEWVIEW_H
@@ -0,0 +1,176 @@
+#include "searchresultsmodel.h"
+#include "iconservice.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QLocale>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this model is bound
+ */
+SearchResultsModel::SearchResultsModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    connect(IconService::instance(), &IconService::iconsResolved, this, &SearchResultsModel::iconsResolved);
+}
+
+/*!
+ * \brief Provides the amount of rows under the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int SearchResultsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : results.count();
+}
+
+/*!
+ * \brief Provides the amount of columns under the given parent.
+ * \param parent = The parent index
+ * \return An integer
+ */
+int SearchResultsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+/*!
+ * \brief Provides the data of an index.
+ * \param index = The index
+ * \param role = The role of the data
+ * \return A QVariant that is invalid if there is no data for the role
+ */
+QVariant SearchResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= results.count()) {
+        return QVariant();
+    }
+
+    const SearchResult &result(results.at(index.row()));
+    const bool isDir(result.type == DirectoryEntries::DirEntry);
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case NameColumn:
+            return QFileInfo(result.path).fileName();
+
+        case FolderColumn:
+            return QFileInfo(result.path).path();
+
+        case SizeColumn:
+            if (isDir || result.size < 0) {
+                return QVariant();
+            }
+            return QLocale::system().formattedDataSize(result.size);
+
+        case DateColumn:
+            if (result.mtime < 0) {
+                return QVariant();
+            }
+            return QLocale::system().toString(QDateTime::fromMSecsSinceEpoch(result.mtime), QLocale::ShortFormat);
+
+        default:
+            return QVariant();
+        }
+
+    case Qt::DecorationRole:
+        if (index.column() == NameColumn) {
+            return isDir ? IconService::instance()->folderIcon() : IconService::instance()->fileIcon(result.path, 0);
+        }
+        return QVariant();
+
+    case Qt::TextAlignmentRole:
+        if (index.column() == SizeColumn) {
+            return QVariant(Qt::AlignTrailing | Qt::AlignVCenter);
+        }
+        return QVariant();
+
+    case Qt::ToolTipRole:
+        return result.path;
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Provides the column titles.
+ * \param section = The column
+ * \param orientation = The orientation of the header
+ * \param role = The role of the data
+ * \return A QVariant containing the title of the column
+ */
+QVariant SearchResultsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case NameColumn:
+        return QString("Name");
+
+    case FolderColumn:
+        return QString("Folder");
+
+    case SizeColumn:
+        return QString("Size");
+
+    case DateColumn:
+        return QString("Date Modified");
+
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Appends a batch of results.
+ * \param newResults = The results
+ */
+void SearchResultsModel::appendResults(const QVector<SearchResult> &newResults)
+{
+    if (newResults.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), results.count(), results.count() + newResults.count() - 1);
+    results.append(newResults);
+    endInsertRows();
+}
+
+/*!
+ * \brief Removes all the results.
+ */
+void SearchResultsModel::clear()
+{
+    beginResetModel();
+    results.clear();
+    endResetModel();
+}
+
+/*!
+ * \brief Provides the result at an index.
+ * \param index = The index
+ * \return A SearchResult with an empty path for the invalid index
+ */
+SearchResult SearchResultsModel::result(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= results.count()) {
+        return SearchResult{QString(), DirectoryEntries::UnknownEntry, -1, -1};
+    }
+
+    return results.at(index.row());
+}
+
+/*!
+ * \brief Refreshes the icons of all the rows once the IconService has resolved new icons.
+ */
+void SearchResultsModel::iconsResolved()
+{
+    if (!results.isEmpty()) {
+        emit dataChanged(index(0, NameColumn), index(results.count() - 1, NameColumn), {Qt::DecorationRole});
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SEARCHRESULTSMODEL_H
+#define SEARCHRESULTSMODEL_H
+
+#include "filesearch.h"
+
+#include <QAbstractTableModel>
+
+/*!
+ * \brief The item model of the entries found by a FileSearch.
+ *
+ * The results are appended in the order in which the workers find them.
+ */
+class SearchResultsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Columns {
+        NameColumn,     ///< 0
+        FolderColumn,   ///< 1
+        SizeColumn,     ///< 2
+        DateColumn,     ///< 3
+        ColumnCount     ///< 4
+    };
+
+    explicit SearchResultsModel(QObject *parent = nullptr);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void appendResults(const QVector<SearchResult> &newResults);
+    void clear();
+    SearchResult result(const QModelIndex &index) const;
+
+private:
+    QVector<SearchResult> results;  ///< The results, in the order in which they were found.
+
+    void iconsResolved();
+};
+
+#endif // SEARCHRESULTSMODEL_H
@@ -0,0 +1,268 @@
+#include "sessionsnapshot.h"
+#include "directorycache.h"
+#include "historycache.h"
+#include "mimetypetable.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+/*!
+ * \brief Writes the snapshot of the current session to the cache directory.
+ * \param views = The states of the views, in a fixed order that restore() reports them in again
+ * \param dirPaths = The directories whose listings are saved besides the ones shown by the views
+ * \note Only listings that have been read completely are saved, and listings with more than MaxSnapshotEntries entries
+ * are skipped. The file is replaced atomically, so a crash never leaves a truncated snapshot behind.
+ */
+void SessionSnapshot::save(const QVector<ViewState> &views, const QStringList &dirPaths)
+{
+    QStringList listingPaths;
+    QVector<QSharedPointer<DirectoryListing>> listings;
+
+    for (const ViewState &view : views) {
+        listingPaths.append(view.dirPath);
+    }
+    listingPaths.append(dirPaths);
+
+    for (const QString &dirPath : qAsConst(listingPaths)) {
+        const QSharedPointer<DirectoryListing> listing(DirectoryCache::instance()->find(dirPath));
+
+        if (!listing.isNull() && listing->isLoaded() && listing->entries().count() <= MaxSnapshotEntries && !listings.contains(listing)) {
+            listings.append(listing);
+        }
+    }
+
+    // The MIME types are numbered from 1 in the order they are found, so 0 still stands for an unknown type.
+    QStringList mimeNames;
+    QHash<quint16, quint16> mimeIndexes;
+
+    for (const QSharedPointer<DirectoryListing> &listing : qAsConst(listings)) {
+        const DirectoryEntries &entries(listing->entries());
+
+        for (int id(0); id < entries.count(); ++id) {
+            if (entries.hasMimeType(id) && entries.mimeType(id) != 0 && !mimeIndexes.contains(entries.mimeType(id))) {
+                mimeNames.append(MimeTypeTable::instance()->name(entries.mimeType(id)));
+                mimeIndexes.insert(entries.mimeType(id), static_cast<quint16>(mimeNames.count()));
+            }
+        }
+    }
+
+    QDir().mkpath(QFileInfo(snapshotPath()).path());
+    QSaveFile snapshotFile(snapshotPath());
+
+    if (!snapshotFile.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&snapshotFile);
+    stream << SnapshotMagic << SnapshotVersion << static_cast<quint32>(views.count());
+
+    for (const ViewState &view : views) {
+        stream << view.dirPath << view.topName << view.currentName;
+    }
+
+    stream << mimeNames << static_cast<quint32>(listings.count());
+
+    for (const QSharedPointer<DirectoryListing> &listing : qAsConst(listings)) {
+        stream << listing->path() << listing->modificationTime();
+        writeEntries(stream, listing->entries(), mimeIndexes);
+    }
+
+    snapshotFile.commit();
+}
+
+/*!
+ * \brief Reads the snapshot of the last session and puts its listings into the DirectoryCache.
+ * \return A QVector with the states of the views, in the order they were saved in
+ * \note The restored listings are kept alive by the HistoryCache until a view takes them, and each of them reads its
+ * directory again in the background if it has been modified since it was saved. A missing, outdated or damaged snapshot is ignored, and only the
+ * listings before a damaged one are restored.
+ * \note This should be called before the views are pointed at their directories, so they find the listings in the
+ * cache instead of reading the directories from scratch.
+ */
+QVector<SessionSnapshot::ViewState> SessionSnapshot::restore()
+{
+    QVector<ViewState> views;
+    QFile snapshotFile(snapshotPath());
+
+    if (!snapshotFile.open(QIODevice::ReadOnly)) {
+        return views;
+    }
+
+    const uchar *snapshotData(snapshotFile.map(0, snapshotFile.size()));
+
+    if (snapshotData == nullptr) {
+        return views;
+    }
+
+    // The stream reads straight from the mapped file, which stays mapped until the file is closed.
+    const QByteArray snapshotBytes(QByteArray::fromRawData(reinterpret_cast<const char *>(snapshotData), snapshotFile.size()));
+    QDataStream stream(snapshotBytes);
+    quint32 magic(0), version(0), viewCount(0), listingCount(0);
+    QStringList mimeNames;
+
+    stream >> magic >> version >> viewCount;
+
+    if (magic != SnapshotMagic || version != SnapshotVersion) {
+        return views;
+    }
+
+    for (quint32 i(0); i < viewCount && stream.status() == QDataStream::Ok; ++i) {
+        ViewState view;
+        stream >> view.dirPath >> view.topName >> view.currentName;
+        views.append(view);
+    }
+
+    stream >> mimeNames >> listingCount;
+
+    if (stream.status() != QDataStream::Ok) {
+        return QVector<ViewState>();
+    }
+
+    QVector<quint16> mimeIds;
+    mimeIds.reserve(mimeNames.count() + 1);
+    mimeIds.append(0);
+
+    for (const QString &mimeName : qAsConst(mimeNames)) {
+        mimeIds.append(MimeTypeTable::instance()->intern(mimeName));
+    }
+
+    for (quint32 i(0); i < listingCount; ++i) {
+        QString dirPath;
+        qint64 dirMtime(0);
+        DirectoryEntries entries;
+
+        stream >> dirPath >> dirMtime;
+
+        if (!readEntries(stream, entries, mimeIds)) {
+            break;
+        }
+
+        entries.dirMtime = dirMtime;
+
+        HistoryCache::instance()->retain(DirectoryCache::instance()->restore(dirPath, entries));
+    }
+
+    return views;
+}
+
+/*!
+ * \brief Provides the path of the snapshot file.
+ * \return A QString with the path inside the cache directory
+ */
+QString SessionSnapshot::snapshotPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Xplorer/session.snapshot";
+}
+
+/*!
+ * \brief Writes the columns, the arenas and the metadata pages of a block of entries.
+ * \param stream = The stream of the snapshot file
+ * \param entries = The entries
+ * \param mimeIndexes = The position of every MIME type ID in the saved list of MIME type names, counted from 1
+ * \note Pages that have not been allocated are only written as a flag.
+ */
+void SessionSnapshot::writeEntries(QDataStream &stream, const DirectoryEntries &entries, const QHash<quint16, quint16> &mimeIndexes)
+{
+    stream << entries.nameArena << entries.nameOffsets << entries.nameLengths
+           << entries.keyArena << entries.keyOffsets << entries.keyLengths
+           << entries.types << entries.flags << static_cast<quint32>(entries.metadataPages.count());
+
+    for (const DirectoryEntries::MetadataPage &page : entries.metadataPages) {
+        if (page.sizes.isEmpty()) {
+            stream << false;
+            continue;
+        }
+
+        QVector<quint16> mimeTypes;
+        mimeTypes.reserve(page.mimeTypes.count());
+
+        for (quint16 mimeType : page.mimeTypes) {
+            mimeTypes.append(mimeIndexes.value(mimeType, 0));
+        }
+
+        stream << true << page.sizes << page.mtimes << page.modes << mimeTypes;
+    }
+}
+
+/*!
+ * \brief Reads a block of entries written by writeEntries().
+ * \param stream = The stream of the snapshot file
+ * \param entries = Set to the entries that were read
+ * \param mimeIds = The MIME type ID of every position in the saved list of MIME type names
+ * \return A boolean value that is false if the entries could not be read or are not consistent
+ */
+bool SessionSnapshot::readEntries(QDataStream &stream, DirectoryEntries &entries, const QVector<quint16> &mimeIds)
+{
+    quint32 pageCount(0);
+
+    stream >> entries.nameArena >> entries.nameOffsets >> entries.nameLengths
+           >> entries.keyArena >> entries.keyOffsets >> entries.keyLengths
+           >> entries.types >> entries.flags >> pageCount;
+
+    if (stream.status() != QDataStream::Ok || pageCount > static_cast<quint32>(entries.count() / DirectoryEntries::PageSize + 1)) {
+        return false;
+    }
+
+    entries.metadataPages.resize(pageCount);
+
+    for (DirectoryEntries::MetadataPage &page : entries.metadataPages) {
+        bool allocated(false);
+        stream >> allocated;
+
+        if (!allocated) {
+            continue;
+        }
+
+        stream >> page.sizes >> page.mtimes >> page.modes >> page.mimeTypes;
+
+        for (quint16 &mimeType : page.mimeTypes) {
+            mimeType = mimeIds.value(mimeType, 0);
+        }
+    }
+
+    return stream.status() == QDataStream::Ok && isConsistent(entries);
+}
+
+/*!
+ * \brief Checks that the columns of a block of entries fit together, so a damaged snapshot can not be read out of bounds.
+ * \param entries = The entries
+ * \return A boolean value that is true if every column has an element per entry, every name and sort key lies within
+ * its arena and every entry with metadata has an allocated page
+ */
+bool SessionSnapshot::isConsistent(const DirectoryEntries &entries)
+{
+    const int entryCount(entries.count());
+
+    if (entries.nameOffsets.count() != entryCount || entries.nameLengths.count() != entryCount
+            || entries.keyOffsets.count() != entryCount || entries.keyLengths.count() != entryCount
+            || entries.flags.count() != entryCount) {
+        return false;
+    }
+
+    for (const DirectoryEntries::MetadataPage &page : entries.metadataPages) {
+        if (!page.sizes.isEmpty() && (page.sizes.count() != DirectoryEntries::PageSize || page.mtimes.count() != DirectoryEntries::PageSize
+                || page.modes.count() != DirectoryEntries::PageSize || page.mimeTypes.count() != DirectoryEntries::PageSize)) {
+            return false;
+        }
+    }
+
+    for (int id(0); id < entryCount; ++id) {
+        if (static_cast<qint64>(entries.nameOffsets.at(id)) + entries.nameLengths.at(id) > entries.nameArena.size()
+                || static_cast<qint64>(entries.keyOffsets.at(id)) + entries.keyLengths.at(id) > entries.keyArena.size()) {
+            return false;
+        }
+
+        if (entries.flags.at(id) & (DirectoryEntries::StatFlag | DirectoryEntries::MimeFlag)) {
+            const int pageIndex(id >> DirectoryEntries::PageShift);
+
+            if (pageIndex >= entries.metadataPages.count() || entries.metadataPages.at(pageIndex).sizes.isEmpty()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
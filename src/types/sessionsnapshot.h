@@ -0,0 +1,50 @@
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include "directoryentries.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief The snapshot of the listings and the views that were shown when the application was last closed.
+ *
+ * The entries of the listings are written as they are held in memory, columns and arenas included, so the sort keys do
+ * not have to be computed again. On the next start the file is mapped and the listings are put into the DirectoryCache
+ * before any view asks for them, so the last directories are painted without waiting for the file system. Every
+ * restored listing then reads its directory again in the background if its modification time has changed, and only
+ * applies the differences. The saved metadata is fetched again for the rows that are painted.
+ * \note The MIME types are stored by name, since their IDs are only valid within a single run of the application.
+ * \note The snapshot may only be used from the GUI thread.
+ */
+class SessionSnapshot
+{
+public:
+    /*!
+     * \brief The state of a view in the directory it showed.
+     */
+    struct ViewState
+    {
+        QString dirPath;        ///< The directory that was shown, which is empty if no state was saved.
+        QString topName;        ///< The name of the entry at the top of the viewport.
+        QString currentName;    ///< The name of the current entry.
+    };
+
+    static void save(const QVector<ViewState> &views, const QStringList &dirPaths);
+    static QVector<ViewState> restore();
+
+private:
+    static const quint32 SnapshotMagic = 0x58534e50;    ///< "XSNP", which identifies the snapshot file.
+    static const quint32 SnapshotVersion = 2;           ///< The version of the snapshot file format.
+    static const int MaxSnapshotEntries = 262144;       ///< The maximum amount of entries of a listing that is saved.
+
+    static QString snapshotPath();
+    static void writeEntries(QDataStream &stream, const DirectoryEntries &entries, const QHash<quint16, quint16> &mimeIndexes);
+    static bool readEntries(QDataStream &stream, DirectoryEntries &entries, const QVector<quint16> &mimeIds);
+    static bool isConsistent(const DirectoryEntries &entries);
+};
+
+#endif // SESSIONSNAPSHOT_H
@@ -0,0 +1,257 @@
+#include "thumbnailservice.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QPixmap>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ * \note Half of the available cores are used for decoding, but never more than four.
+ */
+ThumbnailService::ThumbnailService(QObject *parent) :
+    QObject(parent),
+    failedFiles(MaxFailedFiles),
+    thumbnails(MaxCachedBytes)
+{
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+
+    const QList<QByteArray> formats(QImageReader::supportedImageFormats());
+
+    for (const QByteArray &format : formats) {
+        imageSuffixes.insert(QString::fromLatin1(format).toLower());
+    }
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the ThumbnailService
+ * \note The service is bound to the application object and deleted with it.
+ */
+ThumbnailService *ThumbnailService::instance()
+{
+    static ThumbnailService *service(new ThumbnailService(QCoreApplication::instance()));
+    return service;
+}
+
+/*!
+ * \brief Checks if a thumbnail can be created for a file.
+ * \param fileName = The name of the file
+ * \return A Boolean value that is true if the suffix of the file belongs to a readable image format
+ */
+bool ThumbnailService::canThumbnail(const QString &fileName) const
+{
+    return imageSuffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+/*!
+ * \brief Provides the thumbnail of a file and requests it if it is not available yet.
+ * \param filePath = The path of the image file
+ * \param mtime = The modification time of the file in milliseconds since the epoch
+ * \param requester = The object requesting the thumbnail, which can cancel the request later
+ * \return A QIcon that is null until the thumbnail is available
+ * \note thumbnailReady() is emitted once a requested thumbnail is available.
+ */
+QIcon ThumbnailService::thumbnail(const QString &filePath, qint64 mtime, const QObject *requester)
+{
+    const QString key(cacheKey(filePath, mtime));
+    const QIcon *cachedThumbnail(thumbnails.object(key));
+
+    if (cachedThumbnail != nullptr) {
+        return *cachedThumbnail;
+    }
+
+    // Never create thumbnails of thumbnails.
+    if (failedFiles.contains(key) || runningRequests.contains(filePath) || filePath.startsWith(thumbnailDirPath())) {
+        return QIcon();
+    }
+
+    for (int i(0); i < pendingRequests.count(); ++i) {
+        if (pendingRequests.at(i).filePath == filePath) {
+            pendingRequests.move(i, 0);
+            return QIcon();
+        }
+    }
+
+    Request request;
+    request.filePath = filePath;
+    request.mtime = mtime;
+    request.requester = requester;
+    request.canceled = QSharedPointer<QAtomicInt>::create(0);
+    pendingRequests.prepend(request);
+
+    while (pendingRequests.count() > MaxPendingRequests) {
+        pendingRequests.removeLast();
+    }
+
+    startRequests();
+    return QIcon();
+}
+
+/*!
+ * \brief Cancels the requests of an object.
+ * \param requester = The object that requested the thumbnails
+ * \param keptPaths = The paths of the files whose requests are kept, for example because they are still on screen
+ * \note Thumbnails that are already being decoded are finished, but not stored or reported.
+ */
+void ThumbnailService::cancelRequests(const QObject *requester, const QSet<QString> &keptPaths)
+{
+    pendingRequests.removeIf([requester, &keptPaths](const Request &request) {
+        return request.requester == requester && !keptPaths.contains(request.filePath);
+    });
+
+    for (const Request &request : qAsConst(runningRequests)) {
+        if (request.requester == requester && !keptPaths.contains(request.filePath)) {
+            request.canceled->storeRelaxed(1);
+        }
+    }
+}
+
+/*!
+ * \brief Hands pending requests to the workers until all of them are busy.
+ */
+void ThumbnailService::startRequests()
+{
+    while (runningRequests.count() < pool.maxThreadCount() && !pendingRequests.isEmpty()) {
+        const Request request(pendingRequests.takeFirst());
+        runningRequests.insert(request.filePath, request);
+
+        QFutureWatcher<QImage> *watcher(new QFutureWatcher<QImage>(this));
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, request]() {
+            requestFinished(request.filePath, request.mtime, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run(&pool, &ThumbnailService::createThumbnail, request.filePath, request.mtime, request.canceled));
+    }
+}
+
+/*!
+ * \brief Stores a thumbnail created by a worker and starts the next request.
+ * \param filePath = The path of the image file
+ * \param mtime = The modification time of the file
+ * \param image = The thumbnail, which is null if it could not be created or the request was canceled
+ */
+void ThumbnailService::requestFinished(const QString &filePath, qint64 mtime, const QImage &image)
+{
+    const Request request(runningRequests.take(filePath));
+    const QString key(cacheKey(filePath, mtime));
+
+    if (request.canceled.isNull() || request.canceled->loadRelaxed() != 0) {
+        startRequests();
+        return;
+    }
+
+    if (image.isNull()) {
+        failedFiles.insert(key, new bool(true));
+    } else {
+        thumbnails.insert(key, new QIcon(QPixmap::fromImage(image)), qMax(1, image.width() * image.height() * 4));
+        emit thumbnailReady(filePath);
+    }
+
+    startRequests();
+}
+
+/*!
+ * \brief Provides the key of a thumbnail in the memory cache.
+ * \param filePath = The path of the image file
+ * \param mtime = The modification time of the file
+ * \return A QString
+ */
+QString ThumbnailService::cacheKey(const QString &filePath, qint64 mtime)
+{
+    return filePath + QChar('\n') + QString::number(mtime);
+}
+
+/*!
+ * \brief Provides the path of the shared thumbnail directory.
+ * \return A QString with the path, which is "$XDG_CACHE_HOME/thumbnails" on Linux
+ */
+QString ThumbnailService::thumbnailDirPath()
+{
+    static const QString dirPath(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails");
+    return dirPath;
+}
+
+/*!
+ * \brief Loads the thumbnail of an image file from the thumbnail cache, or creates and stores it.
+ * \param filePath = The path of the image file
+ * \param mtime = The modification time of the file in milliseconds since the epoch
+ * \param canceled = Set to 1 when the request is canceled
+ * \return A QImage that is null if no thumbnail could be created or the request was canceled
+ * \note This function is meant to be run on the thread pool of the service.
+ *
+ * Cached thumbnails are only used if their Thumb::URI and Thumb::MTime match the file. New thumbnails are decoded at
+ * their final size through QImageReader::setScaledSize() and saved atomically, readable by the user only, as the
+ * thumbnail specification requires.
+ */
+QImage ThumbnailService::createThumbnail(const QString &filePath, qint64 mtime, const QSharedPointer<QAtomicInt> &canceled)
+{
+    if (canceled->loadRelaxed() != 0) {
+        return QImage();
+    }
+
+    const QString uri(QUrl::fromLocalFile(filePath).toString(QUrl::FullyEncoded));
+    const QString mtimeText(QString::number(mtime / 1000));
+    const QString dirPath(thumbnailDirPath() + "/normal");
+    const QString thumbnailPath(dirPath + "/" + QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex() + ".png");
+
+    // The text chunks are read without decoding the cached image.
+    QImageReader cachedReader(thumbnailPath, "png");
+
+    if (cachedReader.canRead() && cachedReader.text("Thumb::URI") == uri && cachedReader.text("Thumb::MTime") == mtimeText) {
+        const QImage cachedImage(cachedReader.read());
+
+        if (!cachedImage.isNull()) {
+            return cachedImage;
+        }
+    }
+
+    if (canceled->loadRelaxed() != 0) {
+        return QImage();
+    }
+
+    QImageReader reader(filePath);
+    reader.setAutoTransform(true);
+
+    const QSize imageSize(reader.size());
+
+    if (imageSize.isValid() && (imageSize.width() > ThumbnailSize || imageSize.height() > ThumbnailSize)) {
+        reader.setScaledSize(imageSize.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio));
+    }
+
+    QImage image(reader.read());
+
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    // Some formats ignore the scaled size.
+    if (image.width() > ThumbnailSize || image.height() > ThumbnailSize) {
+        image = image.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    image.setText("Thumb::URI", uri);
+    image.setText("Thumb::MTime", mtimeText);
+    image.setText("Software", "Xplorer");
+
+    if (QDir().mkpath(dirPath)) {
+        QFile::setPermissions(dirPath, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+
+        QSaveFile thumbnailFile(thumbnailPath);
+
+        if (thumbnailFile.open(QIODevice::WriteOnly) && image.save(&thumbnailFile, "png") && thumbnailFile.commit()) {
+            QFile::setPermissions(thumbnailPath, QFile::ReadOwner | QFile::WriteOwner);
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,72 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QCache>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+/*!
+ * \brief The service that creates the thumbnails of image files in the background.
+ *
+ * Thumbnails are decoded by a bounded thread pool at a reduced scale, so the full resolution image is never decoded,
+ * and are stored in the freedesktop.org thumbnail cache under the URI and modification time of the file. They are
+ * shared with every other application that follows the thumbnail specification.
+ *
+ * Requests are served newest first, since the rows that were painted last are the ones on screen, and only a few jobs
+ * run at a time. A view can cancel its requests once they are scrolled out of sight.
+ * \note The service may only be used from the GUI thread.
+ */
+class ThumbnailService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int ThumbnailSize = 128;   ///< The size of the "normal" thumbnails of the specification.
+
+    static ThumbnailService *instance();
+    bool canThumbnail(const QString &fileName) const;
+    QIcon thumbnail(const QString &filePath, qint64 mtime, const QObject *requester);
+    void cancelRequests(const QObject *requester, const QSet<QString> &keptPaths = QSet<QString>());
+
+signals:
+    void thumbnailReady(const QString &filePath);   ///< Emitted when the thumbnail of a file has been created.
+
+private:
+    /*!
+     * \brief A thumbnail that is waiting for or being created by a worker.
+     */
+    struct Request
+    {
+        QString filePath;           ///< The path of the image file.
+        qint64 mtime;               ///< The modification time of the file in milliseconds since the epoch.
+        const QObject *requester;   ///< The object that requested the thumbnail.
+        QSharedPointer<QAtomicInt> canceled;    ///< Set to 1 when the request has been canceled.
+    };
+
+    static const int MaxPendingRequests = 512;          ///< The maximum amount of requests waiting for a worker.
+    static const int MaxCachedBytes = 32 * 1024 * 1024; ///< The maximum size of the thumbnails kept in memory.
+    static const int MaxFailedFiles = 4096;             ///< The maximum amount of failed files that are remembered.
+
+    QThreadPool pool;               ///< The workers that create the thumbnails.
+    QSet<QString> imageSuffixes;    ///< The suffixes of the image formats that can be read.
+    QList<Request> pendingRequests; ///< The requests waiting for a worker, newest first.
+    QHash<QString, Request> runningRequests;    ///< The requests being handled by a worker, keyed by path.
+    QCache<QString, bool> failedFiles;  ///< The files for which no thumbnail could be created, keyed by path and mtime, of which the most recent MaxFailedFiles are kept.
+    QCache<QString, QIcon> thumbnails;  ///< The thumbnails that are kept in memory, keyed by path and mtime.
+
+    explicit ThumbnailService(QObject *parent = nullptr);
+    void startRequests();
+    void requestFinished(const QString &filePath, qint64 mtime, const QImage &image);
+
+    static QString cacheKey(const QString &filePath, qint64 mtime);
+    static QString thumbnailDirPath();
+    static QImage createThumbnail(const QString &filePath, qint64 mtime, const QSharedPointer<QAtomicInt> &canceled);
+};
+
+#endif // THUMBNAILSERVICE_H
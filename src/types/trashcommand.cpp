@@ -0,0 +1,64 @@
+#include "trashcommand.h"
+
+/*!
+ * \brief The constructor
+ * \param paths = The paths of the files and folders to trash
+ * \param parent = The QUndoCommand to which this command is bound
+ */
+TrashCommand::TrashCommand(const QStringList &paths, QUndoCommand *parent) :
+    QUndoCommand(parent),
+    progress(new Progress())
+{
+    progress->trashedPaths = paths;
+    setText((paths.count() == 1) ? QString("Move to Trash") : QString("Move %1 Items to Trash").arg(paths.count()));
+}
+
+/*!
+ * \brief The destructor
+ */
+TrashCommand::~TrashCommand()
+{
+}
+
+/*!
+ * \brief Restores the items that were trashed by this command.
+ * \note Only the items that have actually been restored are trashed again by redo(). An item whose original path has
+ * been taken by another file stays in the trash, so that file is never trashed in its place.
+ */
+void TrashCommand::undo()
+{
+    const QSharedPointer<Progress> commandProgress(progress);
+    const QVector<TrashedItem> trashedItems(progress->trashedItems);
+
+    progress->trashedPaths.clear();
+    progress->trashedItems.clear();
+
+    if (trashedItems.isEmpty()) {
+        setObsolete(true);
+        return;
+    }
+
+    TrashService::instance()->restore(trashedItems).then(TrashService::instance(), [commandProgress](const QVector<TrashedItem> &restoredItems) {
+        for (const TrashedItem &item : restoredItems) {
+            commandProgress->trashedPaths.append(item.originalPath);
+        }
+    });
+}
+
+/*!
+ * \brief Moves the files and folders to the trash.
+ * \note Paths that no longer exist are skipped by the TrashService.
+ */
+void TrashCommand::redo()
+{
+    const QSharedPointer<Progress> commandProgress(progress);
+
+    if (progress->trashedPaths.isEmpty()) {
+        setObsolete(true);
+        return;
+    }
+
+    TrashService::instance()->trash(progress->trashedPaths).then(TrashService::instance(), [commandProgress](const QVector<TrashedItem> &trashedItems) {
+        commandProgress->trashedItems = trashedItems;
+    });
+}
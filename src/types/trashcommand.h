@@ -0,0 +1,41 @@
+#ifndef TRASHCOMMAND_H
+#define TRASHCOMMAND_H
+
+#include "trashservice.h"
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QUndoCommand>
+
+/*!
+ * \brief The command class for moving files and folders to the trash.
+ *
+ * The command lives on the undo stack of the file operations behind the Edit menu, apart from the directory history
+ * of the explorers, so undoing it restores the items it trashed and redoing it trashes them once more.
+ * The items are moved by the TrashService on its worker thread, so the command only knows what it has done once the
+ * batch has finished. The stack must therefore not be undone or redone while the service is busy.
+ * \note A command that has nothing to trash or restore makes itself obsolete, so it is dropped from the undo stack.
+ */
+class TrashCommand : public QUndoCommand
+{
+public:
+    explicit TrashCommand(const QStringList &paths, QUndoCommand *parent = nullptr);
+    ~TrashCommand();
+
+    void undo() override;
+    void redo() override;
+
+private:
+    /*!
+     * \brief What the command has done, which is shared with the batches that are still running.
+     */
+    struct Progress
+    {
+        QStringList trashedPaths;           ///< The paths that are trashed by the next redo(), which are only the restored ones after an undo().
+        QVector<TrashedItem> trashedItems;  ///< The items in the trash after the command has been performed.
+    };
+
+    QSharedPointer<Progress> progress;  ///< What the command has done, which outlives the command while a batch is running.
+};
+
+#endif // TRASHCOMMAND_H
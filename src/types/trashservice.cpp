@@ -0,0 +1,738 @@
+#include "trashservice.h"
+#include "mountmonitor.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+
+#if defined (Q_OS_LINUX)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \brief The constructor
+ * \param parent = The QObject to which this object is bound
+ * \note The index is read on first use.
+ */
+TrashService::TrashService(QObject *parent) :
+    QObject(parent),
+    indexLoaded(false),
+    runningBatches(0)
+{
+    workerPool.setMaxThreadCount(1);
+}
+
+/*!
+ * \brief Provides the service shared by the whole application.
+ * \return A pointer to the TrashService
+ * \note The service is bound to the application object and deleted with it.
+ */
+TrashService *TrashService::instance()
+{
+    static TrashService *service(new TrashService(QCoreApplication::instance()));
+    return service;
+}
+
+/*!
+ * \brief Provides the items in all the trash directories that are currently mounted.
+ * \return A QVector of TrashedItem
+ * \note Only the trash directories whose info directory has changed since they were indexed are parsed.
+ */
+QVector<TrashedItem> TrashService::items()
+{
+    if (!indexLoaded) {
+        loadIndex();
+    }
+
+    const QStringList trashPaths(knownTrashPaths());
+    QVector<TrashedItem> allItems;
+    bool changed(false);
+
+    for (const QString &trashPath : trashPaths) {
+        allItems += indexedTrashDir(trashPath, changed).items;
+    }
+
+    if (changed) {
+        saveIndex();
+    }
+
+    return allItems;
+}
+
+/*!
+ * \brief Moves files and folders to the trash on a worker thread.
+ * \param paths = The paths of the files and folders
+ * \return A QFuture with the items that have been trashed, which is finished on the GUI thread once the index is updated
+ * \note operationFailed() is emitted with the paths that could not be trashed. Paths that no longer exist are skipped.
+ */
+QFuture<QVector<TrashedItem>> TrashService::trash(const QStringList &paths)
+{
+    if (!indexLoaded) {
+        loadIndex();
+    }
+
+    return startBatch(QtConcurrent::run(&workerPool, &TrashService::moveToTrash, paths), false);
+}
+
+/*!
+ * \brief Moves items out of the trash on a worker thread, back to where they were trashed from.
+ * \param restoredItems = The items
+ * \return A QFuture with the items that have actually been restored, which is finished on the GUI thread once the index
+ * is updated
+ * \note operationFailed() is emitted with the items that could not be restored, for instance because their original
+ * path has been taken in the meantime.
+ */
+QFuture<QVector<TrashedItem>> TrashService::restore(const QVector<TrashedItem> &restoredItems)
+{
+    if (!indexLoaded) {
+        loadIndex();
+    }
+
+    return startBatch(QtConcurrent::run(&workerPool, &TrashService::moveOutOfTrash, restoredItems), true);
+}
+
+/*!
+ * \brief Checks if items are being trashed or restored.
+ * \return A Boolean value
+ */
+bool TrashService::isBusy() const
+{
+    return runningBatches > 0;
+}
+
+/*!
+ * \brief Removes items from the trash index and their .trashinfo files.
+ * \param erasedItems = The items
+ * \return A QStringList with the paths of the items inside the trash, which the caller deletes
+ * \note The files themselves are left to the caller, so large trees can be deleted by a FileOperation.
+ */
+QStringList TrashService::erase(const QVector<TrashedItem> &erasedItems)
+{
+    QStringList filePaths;
+
+    if (!indexLoaded) {
+        loadIndex();
+    }
+
+    QStringList touchedTrashPaths;
+
+    for (const TrashedItem &item : erasedItems) {
+        if (!item.infoPath.isEmpty()) {
+            bool parsed(false);
+            indexedTrashDir(trashPathOf(item), parsed);
+            QFile::remove(item.infoPath);
+        }
+
+        if (!touchedTrashPaths.contains(trashPathOf(item))) {
+            touchedTrashPaths.append(trashPathOf(item));
+        }
+
+        removeFromIndex(item);
+        filePaths.append(item.filePath);
+    }
+
+    for (const QString &trashPath : qAsConst(touchedTrashPaths)) {
+        refreshTrashDir(trashPath);
+    }
+
+    if (!filePaths.isEmpty()) {
+        saveIndex();
+        emit itemsChanged();
+    }
+
+    return filePaths;
+}
+
+/*!
+ * \brief Provides the path of the index file.
+ * \return A QString with the path inside the cache directory
+ */
+QString TrashService::indexPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Xplorer/trash.idx";
+}
+
+/*!
+ * \brief Reads the index from the cache directory.
+ * \note A missing or outdated index is ignored, so every trash directory is parsed once.
+ */
+void TrashService::loadIndex()
+{
+    QFile indexFile(indexPath());
+    indexLoaded = true;
+
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&indexFile);
+    quint32 magic(0), version(0), dirCount(0);
+
+    stream >> magic >> version >> dirCount;
+
+    if (magic != IndexMagic || version != IndexVersion) {
+        return;
+    }
+
+    for (quint32 i(0); i < dirCount && stream.status() == QDataStream::Ok; ++i) {
+        QString trashPath;
+        TrashDir trashDir;
+        quint32 itemCount(0);
+
+        stream >> trashPath >> trashDir.infoMtime >> itemCount;
+
+        for (quint32 j(0); j < itemCount && stream.status() == QDataStream::Ok; ++j) {
+            TrashedItem item;
+            stream >> item.filePath >> item.infoPath >> item.originalPath >> item.deletionDate;
+            trashDir.items.append(item);
+        }
+
+        if (stream.status() == QDataStream::Ok) {
+            trashDirs.insert(trashPath, trashDir);
+        }
+    }
+}
+
+/*!
+ * \brief Writes the index to the cache directory.
+ * \note The file is replaced atomically, so a crash never leaves a truncated index behind.
+ */
+void TrashService::saveIndex() const
+{
+    QDir().mkpath(QFileInfo(indexPath()).path());
+    QSaveFile indexFile(indexPath());
+
+    if (!indexFile.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&indexFile);
+    stream << IndexMagic << IndexVersion << static_cast<quint32>(trashDirs.count());
+
+    for (auto trashDir(trashDirs.constBegin()); trashDir != trashDirs.constEnd(); ++trashDir) {
+        stream << trashDir.key() << trashDir->infoMtime << static_cast<quint32>(trashDir->items.count());
+
+        for (const TrashedItem &item : trashDir->items) {
+            stream << item.filePath << item.infoPath << item.originalPath << item.deletionDate;
+        }
+    }
+
+    indexFile.commit();
+}
+
+/*!
+ * \brief Provides the index of a trash directory, after parsing the directory again if it has changed.
+ * \param trashPath = The path of the trash directory
+ * \param parsed = Set to true if the directory has been parsed, and left unchanged otherwise
+ * \return A reference to the TrashDir in the index
+ */
+TrashService::TrashDir &TrashService::indexedTrashDir(const QString &trashPath, bool &parsed)
+{
+    TrashDir &trashDir(trashDirs[trashPath]);
+    const qint64 mtime(infoDirMtime(trashPath));
+
+    if (!trashPath.isEmpty() && trashDir.infoMtime != mtime) {
+        trashDir.items = parseTrashDir(trashPath);
+        trashDir.infoMtime = mtime;
+        parsed = true;
+    }
+
+    return trashDir;
+}
+
+/*!
+ * \brief Removes an item from the index.
+ * \param item = The item, which has been restored or erased
+ * \note The caller marks the index of the trash directory as current again.
+ */
+void TrashService::removeFromIndex(const TrashedItem &item)
+{
+    const auto trashDir(trashDirs.find(trashPathOf(item)));
+
+    if (trashDir == trashDirs.end()) {
+        return;
+    }
+
+    trashDir->items.removeIf([&item](const TrashedItem &indexedItem) {
+        return indexedItem.filePath == item.filePath;
+    });
+}
+
+/*!
+ * \brief Marks the index of a trash directory as current after the service has changed it itself.
+ * \param trashPath = The path of the trash directory
+ * \note Without this the next call to items() would parse the directory again.
+ */
+void TrashService::refreshTrashDir(const QString &trashPath)
+{
+    if (!trashPath.isEmpty()) {
+        trashDirs[trashPath].infoMtime = infoDirMtime(trashPath);
+    }
+}
+
+/*!
+ * \brief Keeps count of a batch that has been started and applies it to the index once it has finished.
+ * \param batch = The QFuture of the worker running the batch
+ * \param restoring = Whether the batch restores items instead of trashing them
+ * \return A QFuture with the items that have been trashed or restored
+ */
+QFuture<QVector<TrashedItem>> TrashService::startBatch(const QFuture<TrashBatch> &batch, bool restoring)
+{
+    if (runningBatches++ == 0) {
+        emit busyChanged(true);
+    }
+
+    return batch.then(this, [this, restoring](const TrashBatch &finishedBatch) {
+        applyBatch(finishedBatch, restoring);
+
+        if (--runningBatches == 0) {
+            emit busyChanged(false);
+        }
+
+        return finishedBatch.items;
+    });
+}
+
+/*!
+ * \brief Applies a finished batch to the index and reports it.
+ * \param batch = The batch
+ * \param restoring = Whether the batch has restored items instead of trashing them
+ *
+ * The index of a trash directory is only marked as current if it was current right before the batch changed the
+ * directory. Otherwise it has been parsed or changed by someone else in the meantime, and it is parsed again by the next
+ * call to items().
+ */
+void TrashService::applyBatch(const TrashBatch &batch, bool restoring)
+{
+    for (const TrashedItem &item : batch.items) {
+        if (restoring) {
+            removeFromIndex(item);
+        } else {
+            trashDirs[trashPathOf(item)].items.append(item);
+        }
+    }
+
+    for (auto infoMtime(batch.infoMtimes.constBegin()); infoMtime != batch.infoMtimes.constEnd(); ++infoMtime) {
+        TrashDir &trashDir(trashDirs[infoMtime.key()]);
+        trashDir.infoMtime = (trashDir.infoMtime == infoMtime.value()) ? batch.newInfoMtimes.value(infoMtime.key(), -1) : -1;
+    }
+
+    if (!batch.items.isEmpty()) {
+        saveIndex();
+        emit itemsChanged();
+    }
+
+    if (!batch.errors.isEmpty()) {
+        emit operationFailed(batch.errors);
+    }
+}
+
+/*!
+ * \brief Provides the path of the home trash.
+ * \return A QString with $XDG_DATA_HOME/Trash
+ */
+QString TrashService::homeTrashPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/Trash";
+}
+
+/*!
+ * \brief Provides the trash directories that currently exist.
+ * \return A QStringList with the home trash and the trash directories at the top of the mounted volumes
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note Volumes that the MountMonitor reports as stale are skipped, since looking into them would hang.
+ */
+QStringList TrashService::knownTrashPaths()
+{
+    QStringList trashPaths;
+
+#if defined (Q_OS_LINUX)
+    const QString uid(QString::number(getuid()));
+
+    if (QFileInfo(homeTrashPath()).isDir()) {
+        trashPaths.append(homeTrashPath());
+    }
+
+    const QVector<MountPoint> mounts(MountMonitor::instance()->mounts());
+
+    for (const MountPoint &mountPoint : mounts) {
+        if (mountPoint.stale) {
+            continue;
+        }
+
+        const QString topDir(mountPoint.path.endsWith('/') ? mountPoint.path : mountPoint.path + '/');
+
+        for (const QString &trashPath : {topDir + ".Trash/" + uid, topDir + ".Trash-" + uid}) {
+            if (QFileInfo(trashPath + "/info").isDir() && !trashPaths.contains(trashPath)) {
+                trashPaths.append(trashPath);
+            }
+        }
+    }
+#else
+    trashPaths.append(QString());
+#endif
+
+    return trashPaths;
+}
+
+/*!
+ * \brief Finds or creates the trash directory on the volume of a path.
+ * \param path = The clean absolute path of the file or folder that is trashed
+ * \param topDir = Set to the top directory of the volume, or cleared for the home trash
+ * \return A QString with the path of the trash directory, which is empty if the volume has no usable trash
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * The administrator can provide $topdir/.Trash with the sticky bit set, in which every user gets a directory named
+ * after their uid. Otherwise every user gets $topdir/.Trash-$uid.
+ */
+QString TrashService::trashPathFor(const QString &path, QString &topDir)
+{
+#if defined (Q_OS_LINUX)
+    struct stat pathStat, homeStat;
+    const QString homeTrash(homeTrashPath());
+
+    if (lstat(QFile::encodeName(path).constData(), &pathStat) != 0) {
+        return QString();
+    }
+
+    QDir().mkpath(homeTrash);
+
+    if (stat(QFile::encodeName(homeTrash).constData(), &homeStat) == 0 && homeStat.st_dev == pathStat.st_dev) {
+        topDir.clear();
+        QDir().mkpath(homeTrash + "/files");
+        QDir().mkpath(homeTrash + "/info");
+        return homeTrash;
+    }
+
+    // The top directory is the last parent that is still on the file system of the path.
+    topDir = QFileInfo(path).path();
+
+    while (topDir != "/") {
+        const QString parentDir(QFileInfo(topDir).path());
+        struct stat parentStat;
+
+        if (stat(QFile::encodeName(parentDir).constData(), &parentStat) != 0 || parentStat.st_dev != pathStat.st_dev) {
+            break;
+        }
+
+        topDir = parentDir;
+    }
+
+    const QString uid(QString::number(getuid()));
+    const QString adminTrash(topDir + "/.Trash");
+    struct stat trashStat;
+    QStringList candidates;
+
+    if (lstat(QFile::encodeName(adminTrash).constData(), &trashStat) == 0 && S_ISDIR(trashStat.st_mode) && (trashStat.st_mode & S_ISVTX)) {
+        candidates.append(adminTrash + "/" + uid);
+    }
+
+    candidates.append(topDir + "/.Trash-" + uid);
+
+    for (const QString &candidate : qAsConst(candidates)) {
+        const QByteArray encodedCandidate(QFile::encodeName(candidate));
+        mkdir(encodedCandidate.constData(), 0700);
+
+        // A trash directory that is a symbolic link or that belongs to someone else must not be used.
+        if (lstat(encodedCandidate.constData(), &trashStat) != 0 || !S_ISDIR(trashStat.st_mode) || trashStat.st_uid != getuid()
+                || trashStat.st_dev != pathStat.st_dev) {
+            continue;
+        }
+
+        mkdir(QFile::encodeName(candidate + "/files").constData(), 0700);
+        mkdir(QFile::encodeName(candidate + "/info").constData(), 0700);
+
+        if (QFileInfo(candidate + "/files").isDir() && QFileInfo(candidate + "/info").isDir()) {
+            return candidate;
+        }
+    }
+
+    return QString();
+#else
+    Q_UNUSED(path)
+    topDir.clear();
+    return QString();
+#endif
+}
+
+/*!
+ * \brief Provides the path of the trash directory that holds an item.
+ * \param item = The item
+ * \return A QString with the path of the trash directory, which is empty on platforms without .trashinfo files
+ */
+QString TrashService::trashPathOf(const TrashedItem &item)
+{
+    return item.infoPath.isEmpty() ? QString() : QFileInfo(QFileInfo(item.infoPath).path()).path();
+}
+
+/*!
+ * \brief Moves files and folders to the trash.
+ * \param paths = The paths of the files and folders
+ * \return The TrashBatch with the items that have been trashed
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note This function is meant to be run on the worker of the service, which runs one batch at a time.
+ */
+TrashService::TrashBatch TrashService::moveToTrash(const QStringList &paths)
+{
+    TrashBatch batch;
+
+#if defined (Q_OS_LINUX)
+    const QString deletionDate(QDateTime::currentDateTime().toString("yyyy-MM-ddThh:mm:ss"));
+    QVector<TrashedItem> reservedItems;
+
+    // Reserve a name and write the .trashinfo file of every item first, as the specification requires.
+    for (const QString &path : paths) {
+        const QString cleanPath(QDir::cleanPath(QFileInfo(path).absoluteFilePath()));
+        struct stat pathStat;
+
+        if (lstat(QFile::encodeName(cleanPath).constData(), &pathStat) != 0 && errno == ENOENT) {
+            continue;
+        }
+
+        QString topDir;
+        const QString trashPath(trashPathFor(cleanPath, topDir));
+
+        if (trashPath.isEmpty()) {
+            batch.errors.append(QString("There is no trash on the volume of %1").arg(cleanPath));
+            continue;
+        }
+
+        // The index only takes the batch in if it was current right before the trash directory was changed.
+        if (!batch.infoMtimes.contains(trashPath)) {
+            batch.infoMtimes.insert(trashPath, infoDirMtime(trashPath));
+        }
+
+        const QString fileName(QFileInfo(cleanPath).fileName());
+        const QByteArray infoContents("[Trash Info]\nPath="
+                                      + QUrl::toPercentEncoding(topDir.isEmpty() ? cleanPath : QDir(topDir).relativeFilePath(cleanPath), "/")
+                                      + "\nDeletionDate=" + deletionDate.toLatin1() + "\n");
+        TrashedItem item;
+        int infoFd(-1);
+
+        for (int number(1); infoFd < 0 && number < 10000; ++number) {
+            const QString trashedName((number == 1) ? fileName : QString("%1.%2").arg(fileName, QString::number(number)));
+            struct stat fileStat;
+
+            item.filePath = trashPath + "/files/" + trashedName;
+            item.infoPath = trashPath + "/info/" + trashedName + ".trashinfo";
+
+            if (lstat(QFile::encodeName(item.filePath).constData(), &fileStat) == 0) {
+                continue;
+            }
+
+            infoFd = ::open(QFile::encodeName(item.infoPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+            if (infoFd < 0 && errno != EEXIST) {
+                break;
+            }
+        }
+
+        if (infoFd < 0) {
+            batch.errors.append(QString("Could not write the trash information of %1").arg(cleanPath));
+            continue;
+        }
+
+        const bool written(::write(infoFd, infoContents.constData(), infoContents.size()) == infoContents.size());
+        ::close(infoFd);
+
+        if (!written) {
+            unlink(QFile::encodeName(item.infoPath).constData());
+            batch.errors.append(QString("Could not write the trash information of %1").arg(cleanPath));
+            continue;
+        }
+
+        item.originalPath = cleanPath;
+        item.deletionDate = QDateTime::fromString(deletionDate, Qt::ISODate);
+        reservedItems.append(item);
+    }
+
+    // Every trash directory is on the volume of its items, so moving them is a rename.
+    for (const TrashedItem &item : qAsConst(reservedItems)) {
+        if (::rename(QFile::encodeName(item.originalPath).constData(), QFile::encodeName(item.filePath).constData()) != 0) {
+            unlink(QFile::encodeName(item.infoPath).constData());
+            batch.errors.append(QString("Could not move %1 to the trash").arg(item.originalPath));
+        } else {
+            batch.items.append(item);
+        }
+    }
+
+    // The info directories are synced once per batch instead of once per item.
+    for (auto infoMtime(batch.infoMtimes.constBegin()); infoMtime != batch.infoMtimes.constEnd(); ++infoMtime) {
+        const int infoDirFd(::open(QFile::encodeName(infoMtime.key() + "/info").constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+        if (infoDirFd >= 0) {
+            fsync(infoDirFd);
+            ::close(infoDirFd);
+        }
+
+        batch.newInfoMtimes.insert(infoMtime.key(), infoDirMtime(infoMtime.key()));
+    }
+#else
+    for (const QString &path : paths) {
+        TrashedItem item;
+
+        if (!QFileInfo::exists(path) && !QFileInfo(path).isSymLink()) {
+            continue;
+        }
+
+        if (QFile::moveToTrash(path, &item.filePath)) {
+            item.originalPath = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+            item.deletionDate = QDateTime::currentDateTime();
+            batch.items.append(item);
+        } else {
+            batch.errors.append(QString("Could not move %1 to the trash").arg(path));
+        }
+    }
+#endif
+
+    return batch;
+}
+
+/*!
+ * \brief Moves items out of the trash, back to where they were trashed from.
+ * \param items = The items
+ * \return The TrashBatch with the items that have been restored
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ * \note This function is meant to be run on the worker of the service, which runs one batch at a time.
+ */
+TrashService::TrashBatch TrashService::moveOutOfTrash(const QVector<TrashedItem> &items)
+{
+    TrashBatch batch;
+
+    for (const TrashedItem &item : items) {
+        const QByteArray encodedFile(QFile::encodeName(item.filePath)), encodedOriginal(QFile::encodeName(item.originalPath));
+
+        if (QFileInfo::exists(item.originalPath) || QFileInfo(item.originalPath).isSymLink()) {
+            batch.errors.append(QString("Could not restore %1, since it already exists").arg(item.originalPath));
+            continue;
+        }
+
+        QDir().mkpath(QFileInfo(item.originalPath).path());
+
+        if (!item.infoPath.isEmpty() && !batch.infoMtimes.contains(trashPathOf(item))) {
+            batch.infoMtimes.insert(trashPathOf(item), infoDirMtime(trashPathOf(item)));
+        }
+
+#if defined (Q_OS_LINUX)
+        const bool renamed(syscall(SYS_renameat2, AT_FDCWD, encodedFile.constData(), AT_FDCWD, encodedOriginal.constData(), RENAME_NOREPLACE) == 0
+                           || ((errno == EINVAL || errno == ENOSYS) && ::rename(encodedFile.constData(), encodedOriginal.constData()) == 0));
+#else
+        const bool renamed(QDir().rename(item.filePath, item.originalPath));
+#endif
+
+        if (!renamed) {
+            batch.errors.append(QString("Could not restore %1").arg(item.originalPath));
+            continue;
+        }
+
+        if (!item.infoPath.isEmpty()) {
+            QFile::remove(item.infoPath);
+        }
+
+        batch.items.append(item);
+    }
+
+    for (auto infoMtime(batch.infoMtimes.constBegin()); infoMtime != batch.infoMtimes.constEnd(); ++infoMtime) {
+        batch.newInfoMtimes.insert(infoMtime.key(), infoDirMtime(infoMtime.key()));
+    }
+
+    return batch;
+}
+
+/*!
+ * \brief Provides the modification time of the info directory of a trash directory.
+ * \param trashPath = The path of the trash directory
+ * \return The time in nanoseconds since the epoch, or -1 if the info directory does not exist
+ * \note This contains preprocessor directives for detecting the OS at compile time.
+ */
+qint64 TrashService::infoDirMtime(const QString &trashPath)
+{
+#if defined (Q_OS_LINUX)
+    struct stat infoStat;
+
+    if (stat(QFile::encodeName(trashPath + "/info").constData(), &infoStat) != 0) {
+        return -1;
+    }
+
+    return static_cast<qint64>(infoStat.st_mtim.tv_sec) * 1000000000 + infoStat.st_mtim.tv_nsec;
+#else
+    Q_UNUSED(trashPath)
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Parses the .trashinfo files of a trash directory.
+ * \param trashPath = The path of the trash directory
+ * \return A QVector with the items whose file still exists
+ */
+QVector<TrashedItem> TrashService::parseTrashDir(const QString &trashPath)
+{
+    QVector<TrashedItem> trashItems;
+    QString topDir;
+
+    // The items of a volume trash are stored relative to the top of the volume.
+    if (QFileInfo(trashPath).fileName().startsWith(".Trash-")) {
+        topDir = QFileInfo(trashPath).path();
+    } else {
+        if (QFileInfo(QFileInfo(trashPath).path()).fileName() == ".Trash") {
+            topDir = QFileInfo(QFileInfo(trashPath).path()).path();
+        }
+    }
+
+    const QStringList infoNames(QDir(trashPath + "/info").entryList({"*.trashinfo"}, QDir::Files | QDir::Hidden));
+
+    for (const QString &infoName : infoNames) {
+        TrashedItem item;
+        item.infoPath = trashPath + "/info/" + infoName;
+        item.filePath = trashPath + "/files/" + infoName.chopped(10);
+
+        if (parseInfo(item.infoPath, topDir, item) && (QFileInfo::exists(item.filePath) || QFileInfo(item.filePath).isSymLink())) {
+            trashItems.append(item);
+        }
+    }
+
+    return trashItems;
+}
+
+/*!
+ * \brief Parses a .trashinfo file.
+ * \param infoPath = The path of the file
+ * \param topDir = The top directory of the volume, or empty for the home trash
+ * \param item = Receives the original path and the deletion date
+ * \return A Boolean value that is false if the file could not be read or has no path
+ */
+bool TrashService::parseInfo(const QString &infoPath, const QString &topDir, TrashedItem &item)
+{
+    QFile infoFile(infoPath);
+
+    if (!infoFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QList<QByteArray> lines(infoFile.readAll().split('\n'));
+
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("Path=")) {
+            const QString originalPath(QUrl::fromPercentEncoding(line.mid(5)));
+            item.originalPath = (originalPath.startsWith('/') || topDir.isEmpty()) ? originalPath : QDir::cleanPath(topDir + "/" + originalPath);
+        } else {
+            if (line.startsWith("DeletionDate=")) {
+                item.deletionDate = QDateTime::fromString(QString::fromLatin1(line.mid(13)).trimmed(), Qt::ISODate);
+            }
+        }
+    }
+
+    return !item.originalPath.isEmpty();
+}
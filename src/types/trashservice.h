@@ -0,0 +1,110 @@
+#ifndef TRASHSERVICE_H
+#define TRASHSERVICE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+/*!
+ * \brief A file or folder in the trash.
+ */
+struct TrashedItem
+{
+    QString filePath;           ///< The path of the item inside the trash.
+    QString infoPath;           ///< The path of its .trashinfo file, which is empty on platforms without one.
+    QString originalPath;       ///< The path from which the item was trashed.
+    QDateTime deletionDate;     ///< When the item was trashed.
+};
+
+/*!
+ * \brief The service that moves files and folders to the trash and restores them.
+ *
+ * On Linux this implements the freedesktop.org Trash specification. Every item is moved into the trash directory on
+ * its own file system: the home trash if the item lives on the same file system as the home directory, and otherwise
+ * the .Trash/$uid or .Trash-$uid directory at the top of its volume. Trashing is therefore always a single rename,
+ * however large the item is, and an item for which no trash exists on its volume is never copied but reported as an
+ * error instead.
+ *
+ * Trashing is done in batches. The .trashinfo files of a batch are reserved and written first, as the specification
+ * requires, then the items are renamed, and the info directories are synced and the index is saved only once per
+ * batch. The index holds the parsed contents of every known trash directory, and is kept in memory and in the cache
+ * directory. A trash directory is only parsed again if the modification time of its info directory has changed, so
+ * listing the trash does not read thousands of .trashinfo files.
+ * \note This contains preprocessor directives for detecting the OS at compile time. Other platforms use the trash of the
+ * system, and only know the items trashed since the application was started.
+ * \note The service may only be used from the GUI thread. The items are moved on a worker thread, one batch at a time,
+ * and the index is updated on the GUI thread once a batch has finished.
+ */
+class TrashService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TrashService *instance();
+    QVector<TrashedItem> items();
+    QFuture<QVector<TrashedItem>> trash(const QStringList &paths);
+    QFuture<QVector<TrashedItem>> restore(const QVector<TrashedItem> &restoredItems);
+    bool isBusy() const;
+    QStringList erase(const QVector<TrashedItem> &erasedItems);
+
+signals:
+    void itemsChanged();                            ///< Emitted when items have been trashed, restored or erased.
+    void operationFailed(const QStringList &errors);    ///< Emitted when items could not be trashed or restored.
+    void busyChanged(bool busy);                    ///< Emitted when the first batch is started or the last running batch has finished.
+
+private:
+    static const quint32 IndexMagic = 0x58545258;   ///< "XTRX", which identifies the index file.
+    static const quint32 IndexVersion = 1;          ///< The version of the index file format.
+
+    /*!
+     * \brief The parsed contents of a trash directory.
+     */
+    struct TrashDir
+    {
+        qint64 infoMtime = -1;          ///< The modification time of the info directory when it was parsed.
+        QVector<TrashedItem> items;     ///< The items in the trash directory.
+    };
+
+    /*!
+     * \brief The outcome of trashing or restoring a set of items on the worker.
+     */
+    struct TrashBatch
+    {
+        QVector<TrashedItem> items;         ///< The items that have been trashed or restored.
+        QStringList errors;                 ///< The items that could not be trashed or restored.
+        QHash<QString, qint64> infoMtimes;  ///< The modification time of the info directory of every changed trash directory, right before the batch changed it.
+        QHash<QString, qint64> newInfoMtimes;   ///< The modification time of the same info directories once the batch was done.
+    };
+
+    QHash<QString, TrashDir> trashDirs; ///< The index, keyed by the path of the trash directory.
+    bool indexLoaded;                   ///< Whether the index has been read from the cache directory.
+    QThreadPool workerPool;             ///< Runs one batch at a time, so a restore never overtakes the trashing it undoes.
+    int runningBatches;                 ///< The amount of batches that have been started and not applied yet.
+
+    explicit TrashService(QObject *parent = nullptr);
+    QString indexPath() const;
+    void loadIndex();
+    void saveIndex() const;
+    TrashDir &indexedTrashDir(const QString &trashPath, bool &parsed);
+    void removeFromIndex(const TrashedItem &item);
+    void refreshTrashDir(const QString &trashPath);
+    QFuture<QVector<TrashedItem>> startBatch(const QFuture<TrashBatch> &batch, bool restoring);
+    void applyBatch(const TrashBatch &batch, bool restoring);
+
+    static QString homeTrashPath();
+    static QStringList knownTrashPaths();
+    static QString trashPathFor(const QString &path, QString &topDir);
+    static QString trashPathOf(const TrashedItem &item);
+    static TrashBatch moveToTrash(const QStringList &paths);
+    static TrashBatch moveOutOfTrash(const QVector<TrashedItem> &items);
+    static qint64 infoDirMtime(const QString &trashPath);
+    static QVector<TrashedItem> parseTrashDir(const QString &trashPath);
+    static bool parseInfo(const QString &infoPath, const QString &topDir, TrashedItem &item);
+};
+
+#endif // TRASHSERVICE_H
@@ -2,10 +2,10 @@
 
 /*!
  * \brief The constructor
- * \note This will make the dirModel only display folders.
+ * \note This will make the dirModel only display folders. The folder listings are shared with the explorers through the DirectoryCache.
  */
 TreeViewManager::TreeViewManager() :
-    dirModel(new QFileSystemModel())
+    dirModel(new DirectoryTreeModel())
 {
     dirModel->setFilter(QDir::AllDirs | QDir::NoDotAndDotDot);
 }
@@ -22,9 +22,9 @@ TreeViewManager::~TreeViewManager()
 
 /*!
  * \brief Provides a QSharedPointer of the tree view's file model.
- * \return A QSharedPointer of a QFileSystemModel
+ * \return A QSharedPointer of a DirectoryTreeModel
  */
-QSharedPointer<QFileSystemModel> TreeViewManager::getFileSystemModel() const
+QSharedPointer<DirectoryTreeModel> TreeViewManager::getFileSystemModel() const
 {
     return dirModel;
 }
@@ -1,7 +1,8 @@
 #ifndef TREEVIEWMANAGER_H
 #define TREEVIEWMANAGER_H
 
-#include <QFileSystemModel>
+#include "directorytreemodel.h"
+
 #include <QSharedPointer>
 
 /*!
@@ -12,14 +13,14 @@ class TreeViewManager
 public:
     TreeViewManager();
     ~TreeViewManager();
-    QSharedPointer<QFileSystemModel> getFileSystemModel() const;
+    QSharedPointer<DirectoryTreeModel> getFileSystemModel() const;
     QString currentPath() const;
     QModelIndex currentPathIndex() const;
     void setCurrentPath(const QString &newPath);
     static QString getTreeDirPath(const QModelIndex &dirIndex);
 
 private:
-    QSharedPointer<QFileSystemModel> dirModel;  ///< The tree view's file model.
+    QSharedPointer<DirectoryTreeModel> dirModel;  ///< The tree view's file model.
 };
 
 #endif // TREEVIEWMANAGER_H
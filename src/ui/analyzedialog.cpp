@@ -0,0 +1,101 @@
+#include "analyzedialog.h"
+#include "ui_analyzedialog.h"
+#include "../types/foldersizeservice.h"
+
+#include <QDir>
+#include <QLocale>
+
+/*!
+ * \brief The constructor.
+ * \param rootPath = The directory that is analyzed first.
+ * \param parent = The QWidget to which this dialog is bound.
+ */
+AnalyzeDialog::AnalyzeDialog(const QString &rootPath, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::AnalyzeDialog)
+{
+    ui->setupUi(this);
+    ui->tvUsage->setModel(&usageModel);
+    ui->tvUsage->setColumnWidth(DirectoryModel::NameColumn, 320);
+    ui->tvUsage->setColumnWidth(DirectoryModel::SizeColumn, 120);
+    ui->tvUsage->sortByColumn(DirectoryModel::SizeColumn, Qt::DescendingOrder);
+
+    connect(FolderSizeService::instance(), &FolderSizeService::sizeChanged, this, [this](const QString &dirPath) {
+        if (dirPath == usageModel.rootPath()) {
+            refreshTotal();
+        }
+    });
+
+    setAnalyzedPath(rootPath);
+}
+
+/*!
+ * \brief The destructor.
+ * \note The folders that are still being counted for this dialog are canceled with its model.
+ */
+AnalyzeDialog::~AnalyzeDialog()
+{
+    FolderSizeService::instance()->cancelRequests(this);
+    delete ui;
+}
+
+/*!
+ * \brief Analyzes the parent of the analyzed directory.
+ */
+void AnalyzeDialog::on_btnUp_clicked()
+{
+    QDir parentDir(usageModel.rootPath());
+
+    if (parentDir.cdUp()) {
+        setAnalyzedPath(parentDir.absolutePath());
+    }
+}
+
+/*!
+ * \brief Shows the analyzed directory in the active explorer.
+ */
+void AnalyzeDialog::on_btnShowInExplorer_clicked()
+{
+    emit locationRequested(usageModel.rootPath());
+}
+
+/*!
+ * \brief Analyzes a folder of the analyzed directory.
+ * \param index = The index of the folder
+ */
+void AnalyzeDialog::on_tvUsage_doubleClicked(const QModelIndex &index)
+{
+    if (usageModel.isDir(index)) {
+        setAnalyzedPath(usageModel.filePath(index));
+    }
+}
+
+/*!
+ * \brief Lists the entries of a directory and starts counting its folders.
+ * \param dirPath = The directory
+ */
+void AnalyzeDialog::setAnalyzedPath(const QString &dirPath)
+{
+    FolderSizeService::instance()->cancelRequests(this);
+    usageModel.setRootPath(dirPath);
+    FolderSizeService::instance()->requestSize(usageModel.rootPath(), this);
+    refreshTotal();
+}
+
+/*!
+ * \brief Shows the total size of the analyzed directory, which grows while its tree is being counted.
+ */
+void AnalyzeDialog::refreshTotal()
+{
+    const FolderSize size(FolderSizeService::instance()->folderSize(usageModel.rootPath()));
+    const QLocale locale(QLocale::system());
+
+    if (size.bytes < 0) {
+        ui->lblAnalyzeRoot->setText(QString("%1 - Counting...").arg(usageModel.rootPath()));
+        return;
+    }
+
+    const QString total(QString("%1 - %2 in %3 files").arg(usageModel.rootPath(), locale.formattedDataSize(size.bytes),
+                                                        locale.toString(size.fileCount)));
+    ui->lblAnalyzeRoot->setText(size.complete ? total : total + " - Counting...");
+}
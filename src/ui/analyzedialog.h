@@ -0,0 +1,39 @@
+#ifndef ANALYZEDIALOG_H
+#define ANALYZEDIALOG_H
+
+#include "../types/directorymodel.h"
+
+#include <QDialog>
+
+namespace Ui {
+class AnalyzeDialog;
+}
+
+/*!
+ * \brief The dialog that lists the entries of a directory by the space they use, folders included.
+ */
+class AnalyzeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit AnalyzeDialog(const QString &rootPath, QWidget *parent = nullptr);
+    ~AnalyzeDialog();
+
+signals:
+    void locationRequested(const QString &dirPath);    ///< Emitted when the analyzed directory is opened in the explorer.
+
+private slots:
+    void on_btnUp_clicked();
+    void on_btnShowInExplorer_clicked();
+    void on_tvUsage_doubleClicked(const QModelIndex &index);
+
+private:
+    Ui::AnalyzeDialog *ui;          ///< The object containing all the UI elements.
+    DirectoryModel usageModel;      ///< The entries of the analyzed directory, sorted by size.
+
+    void setAnalyzedPath(const QString &dirPath);
+    void refreshTotal();
+};
+
+#endif // ANALYZEDIALOG_H
@@ -0,0 +1,232 @@
+#include "duplicatesdialog.h"
+#include "ui_duplicatesdialog.h"
+#include "../types/trashservice.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMessageBox>
+#include <QSet>
+
+/*!
+ * \brief The constructor.
+ * \param rootPath = The directory whose tree is searched.
+ * \param parent = The QWidget to which this dialog is bound.
+ */
+DuplicatesDialog::DuplicatesDialog(const QString &rootPath, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::DuplicatesDialog),
+    searchRoot(rootPath)
+{
+    ui->setupUi(this);
+    ui->lblDuplicatesRoot->setText(QString("Find duplicates in %1").arg(searchRoot));
+    ui->twDuplicates->setColumnWidth(0, 240);
+    ui->twDuplicates->setColumnWidth(1, 320);
+
+    statusTimer.setInterval(250);
+
+    connect(&finder, &DuplicateFinder::finished, this, &DuplicatesDialog::searchFinished);
+    connect(&statusTimer, &QTimer::timeout, this, &DuplicatesDialog::refreshStatus);
+    connect(ui->twDuplicates, &QTreeWidget::itemSelectionChanged, this, [this]() {
+        ui->btnKeepOne->setEnabled(!ui->twDuplicates->selectedItems().isEmpty());
+    });
+}
+
+/*!
+ * \brief The destructor.
+ */
+DuplicatesDialog::~DuplicatesDialog()
+{
+    finder.cancel();
+    delete ui;
+}
+
+/*!
+ * \brief Starts a new search for duplicates.
+ */
+void DuplicatesDialog::on_btnFind_clicked()
+{
+    ui->twDuplicates->clear();
+    finder.start(searchRoot, static_cast<qint64>(ui->sbMinSize->value()) * 1024);
+    statusTimer.start();
+
+    ui->btnStop->setEnabled(true);
+    refreshStatus();
+}
+
+/*!
+ * \brief Stops the running search.
+ */
+void DuplicatesDialog::on_btnStop_clicked()
+{
+    finder.cancel();
+}
+
+/*!
+ * \brief Keeps one file of every selected group and moves the other files of the group to the trash.
+ * \note The file that is kept is the first selected file of the group, or the first file if only the group itself is
+ * selected.
+ */
+void DuplicatesDialog::on_btnKeepOne_clicked()
+{
+    QStringList trashedPaths;
+
+    for (int i(0); i < ui->twDuplicates->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *groupItem(ui->twDuplicates->topLevelItem(i));
+        QTreeWidgetItem *keptItem(nullptr);
+
+        for (int j(0); j < groupItem->childCount() && keptItem == nullptr; ++j) {
+            if (groupItem->child(j)->isSelected()) {
+                keptItem = groupItem->child(j);
+            }
+        }
+
+        if (keptItem == nullptr) {
+            if (!groupItem->isSelected() || groupItem->childCount() == 0) {
+                continue;
+            }
+
+            keptItem = groupItem->child(0);
+        }
+
+        for (int j(0); j < groupItem->childCount(); ++j) {
+            if (groupItem->child(j) != keptItem) {
+                trashedPaths.append(groupItem->child(j)->data(0, Qt::UserRole).toString());
+            }
+        }
+    }
+
+    if (trashedPaths.isEmpty()) {
+        return;
+    }
+
+    if (QMessageBox::question(this, "Keep One", QString("Are you sure you want to move %1 duplicate files to the trash?").arg(trashedPaths.count())) != QMessageBox::Yes) {
+        return;
+    }
+
+    // Files that could not be trashed stay listed, and the errors are reported by the TrashService. The groups are looked
+    // up again once the files have been trashed, since the list may have been refilled in the meantime.
+    TrashService::instance()->trash(trashedPaths).then(this, [this](const QVector<TrashedItem> &trashedItems) {
+        QSet<QString> removedPaths;
+
+        for (const TrashedItem &item : trashedItems) {
+            removedPaths.insert(item.originalPath);
+        }
+
+        // Groups with less than two files left are deleted, so the list is walked from the bottom up.
+        for (int i(ui->twDuplicates->topLevelItemCount() - 1); i >= 0; --i) {
+            QTreeWidgetItem *groupItem(ui->twDuplicates->topLevelItem(i));
+            bool changed(false);
+
+            for (int j(groupItem->childCount() - 1); j >= 0; --j) {
+                if (removedPaths.contains(groupItem->child(j)->data(0, Qt::UserRole).toString())) {
+                    delete groupItem->takeChild(j);
+                    changed = true;
+                }
+            }
+
+            if (changed) {
+                refreshGroupItem(groupItem);
+            }
+        }
+
+        refreshStatus();
+    });
+}
+
+/*!
+ * \brief Shows the folder of a duplicate file in the active explorer.
+ * \param item = The item of the file, or of its group
+ * \param column = The column that was double clicked
+ */
+void DuplicatesDialog::on_twDuplicates_itemDoubleClicked(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column)
+
+    if (item->parent() != nullptr) {
+        emit locationRequested(QFileInfo(item->data(0, Qt::UserRole).toString()).path());
+    }
+}
+
+/*!
+ * \brief Lists the groups once the search has finished, or shows the final status once it has been stopped.
+ */
+void DuplicatesDialog::searchFinished()
+{
+    const QVector<DuplicateGroup> groups(finder.groups());
+    const QLocale locale(QLocale::system());
+
+    for (const DuplicateGroup &group : groups) {
+        QTreeWidgetItem *groupItem(new QTreeWidgetItem(ui->twDuplicates));
+
+        for (const QString &path : group.paths) {
+            QTreeWidgetItem *fileItem(new QTreeWidgetItem(groupItem));
+            const QFileInfo info(path);
+
+            fileItem->setText(0, info.fileName());
+            fileItem->setData(0, Qt::UserRole, path);
+            fileItem->setText(1, QDir::toNativeSeparators(info.path()));
+            fileItem->setText(2, locale.formattedDataSize(group.size));
+        }
+
+        groupItem->setData(0, Qt::UserRole, group.size);
+        refreshGroupItem(groupItem);
+        groupItem->setExpanded(true);
+    }
+
+    statusTimer.stop();
+    ui->btnStop->setEnabled(false);
+    refreshStatus();
+}
+
+/*!
+ * \brief Shows the stage and the progress of the search, or the amount of duplicates that were found.
+ */
+void DuplicatesDialog::refreshStatus()
+{
+    const QLocale locale(QLocale::system());
+
+    if (!finder.isRunning()) {
+        qint64 wastedBytes(0);
+        int fileCount(0);
+
+        for (int i(0); i < ui->twDuplicates->topLevelItemCount(); ++i) {
+            const QTreeWidgetItem *groupItem(ui->twDuplicates->topLevelItem(i));
+            wastedBytes += groupItem->data(0, Qt::UserRole).toLongLong() * (groupItem->childCount() - 1);
+            fileCount += groupItem->childCount();
+        }
+
+        ui->lblDuplicatesStatus->setText(QString("%1 groups with %2 files, %3 can be freed").arg(locale.toString(ui->twDuplicates->topLevelItemCount()),
+                                                                                              locale.toString(fileCount),
+                                                                                              locale.formattedDataSize(wastedBytes)));
+        return;
+    }
+
+    if (finder.stage() == DuplicateFinder::Scanning) {
+        ui->lblDuplicatesStatus->setText(QString("Scanning... %1 files").arg(locale.toString(finder.scannedFileCount())));
+    } else {
+        const QString stageText((finder.stage() == DuplicateFinder::HashingEdges) ? "Comparing the edges of files of the same size..."
+                                                                                  : "Comparing the contents of files...");
+
+        ui->lblDuplicatesStatus->setText(QString("%1 %2 of %3").arg(stageText, locale.formattedDataSize(finder.hashedBytes()),
+                                                                    locale.formattedDataSize(finder.totalHashBytes())));
+    }
+}
+
+/*!
+ * \brief Shows the amount of files and the space that can be freed in the item of a group.
+ * \param groupItem = The item of the group, which is deleted once it has less than two files left
+ */
+void DuplicatesDialog::refreshGroupItem(QTreeWidgetItem *groupItem)
+{
+    if (groupItem->childCount() < 2) {
+        delete groupItem;
+        return;
+    }
+
+    const qint64 size(groupItem->data(0, Qt::UserRole).toLongLong());
+    const QLocale locale(QLocale::system());
+
+    groupItem->setText(0, QString("%1 files of %2").arg(locale.toString(groupItem->childCount()), locale.formattedDataSize(size)));
+    groupItem->setText(1, QString("%1 can be freed").arg(locale.formattedDataSize(size * (groupItem->childCount() - 1))));
+}
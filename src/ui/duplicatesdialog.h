@@ -0,0 +1,46 @@
+#ifndef DUPLICATESDIALOG_H
+#define DUPLICATESDIALOG_H
+
+#include "../types/duplicatefinder.h"
+
+#include <QDialog>
+#include <QTimer>
+
+class QTreeWidgetItem;
+
+namespace Ui {
+class DuplicatesDialog;
+}
+
+/*!
+ * \brief The dialog that finds the duplicate files below a directory and trashes all but one file of a group.
+ */
+class DuplicatesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DuplicatesDialog(const QString &rootPath, QWidget *parent = nullptr);
+    ~DuplicatesDialog();
+
+signals:
+    void locationRequested(const QString &dirPath);    ///< Emitted when a file is opened, with the directory to show.
+
+private slots:
+    void on_btnFind_clicked();
+    void on_btnStop_clicked();
+    void on_btnKeepOne_clicked();
+    void on_twDuplicates_itemDoubleClicked(QTreeWidgetItem *item, int column);
+
+private:
+    Ui::DuplicatesDialog *ui;       ///< The object containing all the UI elements.
+    QString searchRoot;             ///< The directory whose tree is searched.
+    DuplicateFinder finder;         ///< The running search.
+    QTimer statusTimer;             ///< Refreshes the status while the search is running.
+
+    void searchFinished();
+    void refreshStatus();
+    void refreshGroupItem(QTreeWidgetItem *groupItem);
+};
+
+#endif // DUPLICATESDIALOG_H
@@ -1,7 +1,24 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "aboutdialog.h"
+#include "analyzedialog.h"
+#include "duplicatesdialog.h"
+#include "operationdialog.h"
+#include "searchdialog.h"
+#include "trashdialog.h"
+#include "../types/trashcommand.h"
 #include "../types/explorersplitter.h"
+#include "../types/directorycache.h"
+#include "../types/directoryprefetcher.h"
+#include "../types/fileindexer.h"
+#include "../types/filesystemaccess.h"
+#include "../types/historycache.h"
+#include "../types/previewdocument.h"
+#include "../types/previewview.h"
+#include "../types/iconservice.h"
+#include "../types/mountmonitor.h"
+#include "../types/thumbnailservice.h"
+#include "../types/trashservice.h"
 
 #include <QSplitter>
 #include <QtDebug>
@@ -10,14 +27,20 @@
 #include <QKeyEvent>
 #include <QGroupBox>
 #include <QSettings>
-
-#if defined(Q_OS_WINDOWS)
-#include <QFileInfoList>
-#endif
-
-#if defined(Q_OS_LINUX)
-#include <QStorageInfo>
-#endif
+#include <QLabel>
+#include <QProgressBar>
+#include <QLocale>
+#include <QScrollBar>
+#include <QLineEdit>
+#include <QCompleter>
+#include <QAbstractItemView>
+#include <QStringListModel>
+#include <QTimer>
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QMimeData>
+#include <QUrl>
+#include <QUndoStack>
 
 /*!
  * \brief The constructor of the main window.
@@ -32,7 +55,18 @@ MainWindow::MainWindow(QWidget *parent)
       actionMan(),
       viewSplitter(new ExplorerSplitter(Qt::Horizontal, this)),
       iconProvider(new QFileIconProvider()),
-      contextMenu(new QMenu())
+      contextMenu(new QMenu()),
+      clipboardCut(false),
+      entryCountLabel(new QLabel()),
+      loadingProgressBar(new QProgressBar()),
+      locateCompleter(new QCompleter(this)),
+      locateResults(new QStringListModel(this)),
+      locateTimer(new QTimer(this)),
+      explorerCompare(new DirectoryCompare(this)),
+      compareLabel(new QLabel()),
+      previewDocument(new PreviewDocument(this)),
+      previewView(new PreviewView()),
+      fileUndoStack(new QUndoStack(this))
 {
     ui->setupUi(this);
     initializeExplorerUi();
@@ -49,6 +83,11 @@ MainWindow::~MainWindow()
     viewSplitter.clear();
     iconProvider.clear();
     aboutDialog.clear();
+    searchDialog.clear();
+    analyzeDialog.clear();
+    duplicatesDialog.clear();
+    trashDialog.clear();
+    HistoryCache::instance()->clear();
     delete ui;
 }
 
@@ -119,6 +158,59 @@ void MainWindow::openAboutDialog()
     aboutDialog->show();
 }
 
+/*!
+ * \brief Opens an instance of the search dialog, which searches the current directory of the active explorer.
+ * \note This also destroys any existing instance of the search dialog and cancels its search.
+ */
+void MainWindow::openSearchDialog()
+{
+    const ExplorerManager &explMan((activeExplorer.first == Explorer::Explorer1) ? explorerMan1 : explorerMan2);
+
+    searchDialog.clear();
+    searchDialog = QSharedPointer<SearchDialog>::create(explMan.currentPath(), this);
+    connect(searchDialog.data(), &SearchDialog::locationRequested, this, &MainWindow::openDirectoryInExplorer);
+    searchDialog->show();
+}
+
+/*!
+ * \brief Opens an instance of the disk usage dialog, which analyzes the current directory of the active explorer.
+ * \note This also destroys any existing instance of the disk usage dialog and cancels its counting.
+ */
+void MainWindow::openAnalyzeDialog()
+{
+    const ExplorerManager &explMan((activeExplorer.first == Explorer::Explorer1) ? explorerMan1 : explorerMan2);
+
+    analyzeDialog.clear();
+    analyzeDialog = QSharedPointer<AnalyzeDialog>::create(explMan.currentPath(), this);
+    connect(analyzeDialog.data(), &AnalyzeDialog::locationRequested, this, &MainWindow::openDirectoryInExplorer);
+    analyzeDialog->show();
+}
+
+/*!
+ * \brief Opens an instance of the duplicate finder dialog, which searches the current directory of the active explorer.
+ * \note This also destroys any existing instance of the duplicate finder dialog and cancels its search.
+ */
+void MainWindow::openDuplicatesDialog()
+{
+    const ExplorerManager &explMan((activeExplorer.first == Explorer::Explorer1) ? explorerMan1 : explorerMan2);
+
+    duplicatesDialog.clear();
+    duplicatesDialog = QSharedPointer<DuplicatesDialog>::create(explMan.currentPath(), this);
+    connect(duplicatesDialog.data(), &DuplicatesDialog::locationRequested, this, &MainWindow::openDirectoryInExplorer);
+    duplicatesDialog->show();
+}
+
+/*!
+ * \brief Opens an instance of the trash dialog.
+ * \note This also destroys any existing instance of the trash dialog.
+ */
+void MainWindow::openTrashDialog()
+{
+    trashDialog.clear();
+    trashDialog = QSharedPointer<TrashDialog>::create(this);
+    trashDialog->show();
+}
+
 /*!
  * \brief Initializes the core UI components for the file explorers.
  */
@@ -129,6 +221,12 @@ void MainWindow::initializeExplorerUi()
     viewSplitter->addWidget(ui->gbTreeView);
     viewSplitter->addWidget(ui->gbExplorer1);
     viewSplitter->addWidget(ui->gbExplorer2);
+    viewSplitter->addWidget(ui->gbPreview);
+
+    // Show the current file of the explorers in the preview pane, which is hidden until it is enabled.
+    ui->vLayoutPreview->insertWidget(1, previewView);
+    ui->gbPreview->setVisible(false);
+    previewView->setDocument(previewDocument);
 
     // Add file models to the file views.
     ui->tvFileSys->setModel(treeViewMan.getFileSystemModel().data());
@@ -142,21 +240,102 @@ void MainWindow::initializeExplorerUi()
     ui->lvExplorer2->setModel(explorerMan2.getFileSystemModel().data());
     ui->lvExplorer2->setRootIndex(explorerMan2.currentPathIndex());
 
+    // Let the history of each explorer restore the scroll position and selection of its view.
+    explorerMan1.setView(ui->lvExplorer1);
+    explorerMan2.setView(ui->lvExplorer2);
+
+    // Read the folders under the keyboard focus or the cursor ahead of time, as well as the directories that are likely
+    // to be visited after the current one.
+    ui->lvExplorer1->setMouseTracking(true);
+    ui->lvExplorer2->setMouseTracking(true);
+
+    connect(ui->lvExplorer1->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex &current){
+        prefetchIndex(explorerMan1, current);
+        previewIndex(explorerMan1, current);
+    });
+    connect(ui->lvExplorer1, &QListView::entered, this, [this](const QModelIndex &index){
+        prefetchIndex(explorerMan1, index);
+    });
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, this, [](const QString &newPath){
+        DirectoryPrefetcher::instance()->recordVisit(newPath);
+    });
+
+    connect(ui->lvExplorer2->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex &current){
+        prefetchIndex(explorerMan2, current);
+        previewIndex(explorerMan2, current);
+    });
+    connect(ui->lvExplorer2, &QListView::entered, this, [this](const QModelIndex &index){
+        prefetchIndex(explorerMan2, index);
+    });
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, this, [](const QString &newPath){
+        DirectoryPrefetcher::instance()->recordVisit(newPath);
+    });
+
+    // All the rows have the same height, so the views never have to measure every row of a huge directory.
+    ui->lvExplorer1->setUniformItemSizes(true);
+    ui->lvExplorer1->setLayoutMode(QListView::Batched);
+    ui->lvExplorer2->setUniformItemSizes(true);
+    ui->lvExplorer2->setLayoutMode(QListView::Batched);
+
     // Assign current directory of each explorer to their combo boxes.
     ui->cbPathExplorer1->addItem(explorerMan1.currentPath());
-    connect(explorerMan1.getFileSystemModel().data(), &QFileSystemModel::rootPathChanged, ui->cbPathExplorer1, [this](){
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, ui->cbPathExplorer1, [this](){
         ui->cbPathExplorer1->setCurrentText(explorerMan1.currentPath());
     });
 
     ui->cbPathExplorer2->addItem(explorerMan2.currentPath());
-    connect(explorerMan2.getFileSystemModel().data(), &QFileSystemModel::rootPathChanged, ui->cbPathExplorer2, [this](){
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, ui->cbPathExplorer2, [this](){
         ui->cbPathExplorer2->setCurrentText(explorerMan2.currentPath());
     });
 
-    // Assign a file icon provider to each model.
-    treeViewMan.getFileSystemModel()->setIconProvider(iconProvider.data());
-    explorerMan1.getFileSystemModel()->setIconProvider(iconProvider.data());
-    explorerMan1.getFileSystemModel()->setIconProvider(iconProvider.data());
+    // Narrow the rows of each explorer down to the names matching its filter box, which is cleared on every new path.
+    connect(ui->leFilterExplorer1, &QLineEdit::textChanged, this, [this](const QString &text){
+        explorerMan1.getFileSystemModel()->setNameFilter(text);
+    });
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, ui->leFilterExplorer1, &QLineEdit::clear);
+
+    connect(ui->leFilterExplorer2, &QLineEdit::textChanged, this, [this](const QString &text){
+        explorerMan2.getFileSystemModel()->setNameFilter(text);
+    });
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::rootPathChanged, ui->leFilterExplorer2, &QLineEdit::clear);
+
+    // Share the file icon provider between the explorers and the tree view.
+    IconService::instance()->setIconProvider(iconProvider);
+
+    // Add the loading indicator and the entry count of the active explorer to the status bar.
+    loadingProgressBar->setRange(0, 0);
+    loadingProgressBar->setMaximumWidth(120);
+    loadingProgressBar->setVisible(false);
+    compareLabel->setVisible(false);
+    ui->statusbar->addPermanentWidget(compareLabel);
+    ui->statusbar->addPermanentWidget(entryCountLabel);
+    ui->statusbar->addPermanentWidget(loadingProgressBar);
+
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::loadProgress, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::directoryLoaded, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::loadProgress, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::directoryLoaded, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::rowsInserted, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::rowsRemoved, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::rowsInserted, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::rowsRemoved, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::modelReset, this, &MainWindow::refreshStatusBar);
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::modelReset, this, &MainWindow::refreshStatusBar);
+
+    // Fetch the metadata of the rows around the viewport of each explorer before they are scrolled into view, and drop
+    // the thumbnails of the rows that have been scrolled out of view.
+    connect(ui->lvExplorer1->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](){
+        refreshExplorerViewport(explorerMan1, ui->lvExplorer1);
+    });
+    connect(explorerMan1.getFileSystemModel().data(), &DirectoryModel::directoryLoaded, this, [this](){
+        refreshExplorerViewport(explorerMan1, ui->lvExplorer1);
+    });
+    connect(ui->lvExplorer2->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](){
+        refreshExplorerViewport(explorerMan2, ui->lvExplorer2);
+    });
+    connect(explorerMan2.getFileSystemModel().data(), &DirectoryModel::directoryLoaded, this, [this](){
+        refreshExplorerViewport(explorerMan2, ui->lvExplorer2);
+    });
 
     // Set fixed width of the back and forward buttons.
     ui->btnBackExplorer1->setFixedWidth(50);
@@ -168,7 +347,16 @@ void MainWindow::initializeExplorerUi()
     connect(ui->actionQuit, &QAction::triggered, this, &MainWindow::closeApp);
     connect(&explorerMan1, &ExplorerManager::pathChanged, this, &MainWindow::refreshExplorer1);
     connect(&explorerMan2, &ExplorerManager::pathChanged, this, &MainWindow::refreshExplorer2);
-    connect(ui->cbDrives, &QComboBox::currentTextChanged, this, &MainWindow::setTreeViewPath);
+    connect(ui->cbDrives, &QComboBox::currentIndexChanged, this, [this](){
+        const QString drive(ui->cbDrives->currentData().toString());
+
+        if (!drive.isEmpty() && drive != treeViewMan.currentPath()) {
+            setTreeViewPath(drive);
+        }
+    });
+    connect(MountMonitor::instance(), &MountMonitor::mountAdded, this, &MainWindow::refreshDriveList);
+    connect(MountMonitor::instance(), &MountMonitor::mountRemoved, this, &MainWindow::refreshDriveList);
+    connect(MountMonitor::instance(), &MountMonitor::mountChanged, this, &MainWindow::refreshDriveLabels);
     connect(&explorerMan1, &ExplorerManager::pathChanged, this, [this](){
         refreshBackAndForwardButtons(explorerMan1, ui->btnBackExplorer1, ui->btnForwardExplorer1);
     });
@@ -176,6 +364,54 @@ void MainWindow::initializeExplorerUi()
         refreshBackAndForwardButtons(explorerMan2, ui->btnBackExplorer2, ui->btnForwardExplorer2);
     });
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::openAboutDialog);
+    connect(ui->actionSearch, &QAction::triggered, this, &MainWindow::openSearchDialog);
+    connect(ui->actionAnalyze, &QAction::triggered, this, &MainWindow::openAnalyzeDialog);
+    connect(ui->actionDuplicates, &QAction::triggered, this, &MainWindow::openDuplicatesDialog);
+    connect(ui->actionTrash, &QAction::triggered, this, &MainWindow::openTrashDialog);
+    connect(ui->actionUndo, &QAction::triggered, fileUndoStack, &QUndoStack::undo);
+    connect(ui->actionRedo, &QAction::triggered, fileUndoStack, &QUndoStack::redo);
+    connect(fileUndoStack, &QUndoStack::indexChanged, this, &MainWindow::refreshUndoActions);
+    connect(TrashService::instance(), &TrashService::busyChanged, this, &MainWindow::refreshUndoActions);
+    connect(ui->actionCompare, &QAction::toggled, this, &MainWindow::setCompareMode);
+    connect(ui->actionSync, &QAction::triggered, this, &MainWindow::synchronizeExplorers);
+    connect(explorerCompare, &DirectoryCompare::finished, this, &MainWindow::comparisonFinished);
+    connect(TrashService::instance(), &TrashService::operationFailed, this, [this](const QStringList &errors) {
+        QMessageBox::warning(this, "Trash Error", errors.join('\n'));
+    });
+    connect(ui->actionThumbnails, &QAction::toggled, this, &MainWindow::setThumbnailMode);
+    connect(ui->actionPreview, &QAction::toggled, this, &MainWindow::setPreviewMode);
+    connect(ui->cbPreviewMode, &QComboBox::currentIndexChanged, this, [this](int index){
+        previewView->setMode(static_cast<PreviewView::Mode>(index));
+    });
+    connect(ui->leGoToLine, &QLineEdit::returnPressed, this, [this](){
+        bool isNumber(false);
+        const qint64 line(ui->leGoToLine->text().toLongLong(&isNumber));
+
+        if (isNumber && line > 0) {
+            previewView->goToLine(line - 1);
+            previewView->setFocus();
+        }
+    });
+    connect(ui->chkFollowPreview, &QCheckBox::toggled, previewDocument, &PreviewDocument::setFollowing);
+    connect(previewDocument, &PreviewDocument::sizeChanged, this, &MainWindow::refreshPreviewStatus);
+    connect(previewDocument, &PreviewDocument::indexChanged, this, &MainWindow::refreshPreviewStatus);
+    connect(ui->actionIndexDrive, &QAction::triggered, this, &MainWindow::setDriveIndexed);
+    connect(ui->cbDrives, &QComboBox::currentIndexChanged, this, [this](){
+        ui->actionIndexDrive->setChecked(FileIndexer::instance()->isIndexed(ui->cbDrives->currentData().toString()));
+    });
+
+    // Look the locate box up in the indexed drives once typing pauses, and open the folder of the chosen result.
+    locateCompleter->setModel(locateResults);
+    locateCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    locateCompleter->setWidget(ui->leLocate);
+    locateTimer->setSingleShot(true);
+    locateTimer->setInterval(100);
+
+    connect(ui->leLocate, &QLineEdit::textEdited, locateTimer, qOverload<>(&QTimer::start));
+    connect(locateTimer, &QTimer::timeout, this, &MainWindow::runLocateQuery);
+    connect(locateCompleter, qOverload<const QString &>(&QCompleter::activated), this, [this](const QString &path){
+        openDirectoryInExplorer(path, true);
+    });
 
     // Add event filter to the explorer group boxes and everything in it for handling key presses.
     ui->gbExplorer1->installEventFilter(this);
@@ -196,7 +432,6 @@ void MainWindow::initializeExplorerUi()
     refreshDriveList();
 
     // Add icons to buttons.
-    ui->btnRefreshDrives->setIcon(QIcon(":/images/refresh.png"));
     ui->btnBackExplorer1->setIcon(QIcon(":/images/left_arrow.png"));
     ui->btnBackExplorer2->setIcon(QIcon(":/images/left_arrow.png"));
     ui->btnForwardExplorer1->setIcon(QIcon(":/images/right_arrow.png"));
@@ -214,8 +449,17 @@ void MainWindow::initializeExplorerUi()
     });
 
     // Initialize the context menu items for the explorers.
-    QAction *openFile(new QAction("Open", contextMenu));
-    contextMenu->addAction(openFile);
+    openEntryAction = contextMenu->addAction("Open");
+    contextMenu->addSeparator();
+    copyEntriesAction = contextMenu->addAction("Copy");
+    cutEntriesAction = contextMenu->addAction("Cut");
+    pasteEntriesAction = contextMenu->addAction("Paste");
+    contextMenu->addSeparator();
+    copyToOtherAction = contextMenu->addAction("Copy to Other Explorer");
+    moveToOtherAction = contextMenu->addAction("Move to Other Explorer");
+    contextMenu->addSeparator();
+    trashEntriesAction = contextMenu->addAction("Move to Trash");
+    deleteEntriesAction = contextMenu->addAction("Delete Permanently");
 }
 
 /*!
@@ -247,6 +491,8 @@ void MainWindow::setActiveExplorer(const Explorer &explorer, QGroupBox *explorer
     // Assign the new active explorer.
     activeExplorer.first = explorer;
     activeExplorer.second = explorerGroupBox;
+
+    refreshStatusBar();
 }
 
 /*!
@@ -320,18 +566,29 @@ void MainWindow::refreshExplorer2()
 /*!
  * \brief Assigns a new path for the tree view.
  * \param newPath = The new path
+ * \note The path is checked through the FileSystemAccess, and only the last requested path is assigned.
  */
 void MainWindow::setTreeViewPath(const QString &newPath)
 {
-    QDir path(newPath);
+    requestedTreeViewPath = newPath;
 
-    if (path.exists()) {
-        treeViewMan.setCurrentPath(newPath);
-        ui->tvFileSys->setRootIndex(treeViewMan.currentPathIndex());
-    } else {
-        QMessageBox::warning(this, "Directory not found", "The selected directory no longer exists. Please ensure that the drive is still connected.");
-        refreshDriveList();
-    }
+    FileSystemAccess::instance()->stat({newPath}).then(this, [this, newPath](const AccessResult &result){
+        if (newPath != requestedTreeViewPath) {
+            return;
+        }
+
+        if (result.status != AccessResult::Done) {
+            QMessageBox::warning(this, "Drive not responding", "The selected drive does not respond. Please check its connection and try again later.");
+            return;
+        }
+
+        if (result.infos.first().isDir) {
+            treeViewMan.setCurrentPath(newPath);
+            ui->tvFileSys->setRootIndex(treeViewMan.currentPathIndex());
+        } else {
+            QMessageBox::warning(this, "Directory not found", "The selected directory no longer exists. Please ensure that the drive is still connected.");
+        }
+    });
 }
 
 /*!
@@ -363,42 +620,123 @@ void MainWindow::refreshBackAndForwardButtons(const ExplorerManager &explMan, QP
  * \brief Opens the file/folder currently selected by the given explorer.
  * \param explMan = The explorer
  * \param fileIndex = The index of the selected file/folder
+ * \note The entry is looked at through the FileSystemAccess, which also detects the MIME type of a file and whether it
+ * is executable, and its PathInfo is handed to the ActionManager, so the file is not looked at from the GUI thread.
+ * Nothing is opened if the explorer has changed its directory in the meantime.
  */
 void MainWindow::openFileIndex(ExplorerManager &explMan, const QModelIndex &fileIndex)
 {
-    QFileInfo newDir(explMan.currentPath() + "/" + fileIndex.data().toString());
+    const QString dirPath(explMan.currentPath());
+    const QString entryPath(dirPath + "/" + fileIndex.data().toString());
 
-    if (newDir.isDir()) {
-        explMan.setCurrentPath(newDir.path() + "/" + newDir.fileName());
-    } else {
-        if (!actionMan.openFile(newDir)) {
-            QMessageBox::critical(this, "File Error", "An unknown error occurred while trying to open the file.");
+    FileSystemAccess::instance()->stat({entryPath}, true).then(this, [this, &explMan, dirPath](const AccessResult &result){
+        if (explMan.currentPath() != dirPath || !checkAccess(result)) {
+            return;
         }
+
+        const PathInfo &entryInfo(result.infos.first());
+
+        if (entryInfo.isDir) {
+            const QFileInfo newDir(entryInfo.path);
+            explMan.setCurrentPath(newDir.path() + "/" + newDir.fileName());
+        } else {
+            if (!actionMan.openFile(entryInfo)) {
+                QMessageBox::critical(this, "File Error", "An unknown error occurred while trying to open the file.");
+            }
+        }
+    });
+}
+
+/*!
+ * \brief Opens the selected entries of an explorer, or only the given entry if it is not selected.
+ * \param explMan = The explorer
+ * \param explView = The view of the explorer
+ * \param index = The index of the entry that was activated
+ * \note A single entry is opened like a double click opens it. Of several entries only the files are opened, and the
+ * files that are opened by the same application are passed to it at once.
+ */
+void MainWindow::openEntries(ExplorerManager &explMan, QListView *explView, const QModelIndex &index)
+{
+    const QStringList paths(selectedEntryPaths(explMan, explView, index));
+
+    if (paths.count() <= 1) {
+        openFileIndex(explMan, index);
+        return;
     }
+
+    FileSystemAccess::instance()->stat(paths, true).then(this, [this](const AccessResult &result){
+        if (!checkAccess(result)) {
+            return;
+        }
+
+        QVector<PathInfo> files;
+
+        for (const PathInfo &info : result.infos) {
+            if (info.exists && !info.isDir) {
+                files.append(info);
+            }
+        }
+
+        if (!actionMan.openFiles(files)) {
+            QMessageBox::critical(this, "File Error", "An unknown error occurred while trying to open the files.");
+        }
+    });
 }
 
 /*!
  * \brief Opens the given path in the active explorer.
  * \param path = The directory path
+ * \param openParent = Whether the parent directory is opened if the path is a file
+ * \note The path is looked at through the FileSystemAccess, and opened in the explorer that is active once it answers.
  */
-void MainWindow::openDirectoryInExplorer(const QString &path)
+void MainWindow::openDirectoryInExplorer(const QString &path, bool openParent)
 {
-    QFileInfo newDir(path);
+    FileSystemAccess::instance()->stat({path}).then(this, [this, openParent](const AccessResult &result){
+        if (!checkAccess(result)) {
+            return;
+        }
+
+        const PathInfo &info(result.infos.first());
+        QString dirPath(info.path);
+
+        if (!info.isDir) {
+            if (!info.exists || !openParent) {
+                return;
+            }
+
+            dirPath = QFileInfo(info.path).path();
+        }
 
-    if (newDir.isDir()) {
         switch(activeExplorer.first) {
         case Explorer::Explorer1:
-            explorerMan1.setCurrentPath(path);
+            explorerMan1.setCurrentPath(dirPath);
             break;
 
         case Explorer::Explorer2:
-            explorerMan2.setCurrentPath(path);
+            explorerMan2.setCurrentPath(dirPath);
             break;
 
         default:
             break;
         }
+    });
+}
+
+/*!
+ * \brief Tells the user in the status bar that a drive did not answer.
+ * \param result = The outcome of a request to the FileSystemAccess
+ * \return A boolean value that is true if the request was answered
+ */
+bool MainWindow::checkAccess(const AccessResult &result)
+{
+    if (result.status == AccessResult::Done) {
+        return true;
     }
+
+    const QString drive(result.mountPath.isEmpty() ? QString("The drive") : QString("The drive at %1").arg(result.mountPath));
+    ui->statusbar->showMessage(drive + " does not respond.", StatusMessageTimeout);
+
+    return false;
 }
 
 /*!
@@ -410,72 +748,357 @@ void MainWindow::openDirectoryInExplorer(const QString &path)
 void MainWindow::catchExplorerKeyEvent(ExplorerManager &explMan, QListView *explView, QKeyEvent *keyEvent)
 {
     if (keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) {
-        openFileIndex(explMan, explView->currentIndex());
+        openEntries(explMan, explView, explView->currentIndex());
     } else {
         if (keyEvent->key() == Qt::Key_Backspace && explMan.canUndoPath()) {
             explMan.undoPath();
+        } else {
+            if (keyEvent->key() == Qt::Key_Delete && explView->currentIndex().isValid() && explView->currentIndex().data().toString() != "..") {
+                deleteEntries(selectedEntryPaths(explMan, explView, explView->currentIndex()), keyEvent->modifiers().testFlag(Qt::ShiftModifier));
+            }
         }
     }
 }
 
 /*!
- * \brief Refreshes the list of drives for the tree view.
+ * \brief Brings the list of drives for the tree view in line with the mounts known to the MountMonitor.
  * \note This contains preprocessor directives for detecting the OS at compile time.
+ *
+ * Only the drives that have appeared or disappeared are added or removed, so the selected drive stays selected. Every
+ * item shows the path of its drive as text and keeps it as data, since the text also shows the space of the drive.
+ * The mount table is kept up to date by the MountMonitor, so this never waits for a file system.
  */
 void MainWindow::refreshDriveList()
 {
-#if defined (Q_OS_WINDOWS)
-    // Get currently selected volume.
-    QString lastSelectedVolume(ui->cbDrives->currentText());
+    QStringList drivePaths;
+
+#if defined (Q_OS_LINUX)
+    // Add the common directories.
+    drivePaths.append({"/", "/home", QDir::homePath()});
+#endif
 
-    // Clean up the list.
-    ui->cbDrives->clear();
+    // Add the connected external storage devices and network shares.
+    const QVector<MountPoint> mounts(MountMonitor::instance()->mounts());
 
-    // Get drive list.
-    QFileInfoList driveList(QDir::drives());
+    for (const MountPoint &mountPoint : mounts) {
+#if defined (Q_OS_LINUX)
+        static const QStringList networkTypes({"nfs", "nfs4", "cifs", "smb3", "fuse.sshfs"});
+        const bool removable(!mountPoint.readOnly && (mountPoint.path.startsWith("/run/media") || mountPoint.path.startsWith("/run/mnt")));
+        const bool listed(removable || networkTypes.contains(mountPoint.fileSystemType));
+#else
+        const bool listed(true);
+#endif
 
-    // Add the drives to the combobox.
-    for (int i(0); i < driveList.length(); ++i) {
-        ui->cbDrives->addItem(driveList.at(i).absolutePath());
+        if (listed && !drivePaths.contains(mountPoint.path)) {
+            drivePaths.append(mountPoint.path);
+        }
     }
 
-    // Select the previously selected volume.
-    int driveIndex(ui->cbDrives->findText(lastSelectedVolume));
-    if (driveIndex != -1) {
-        ui->cbDrives->setCurrentIndex(driveIndex);
+    // Remove the drives that are gone, and insert the new ones at their place.
+    for (int i(ui->cbDrives->count() - 1); i >= 0; --i) {
+        if (!drivePaths.contains(ui->cbDrives->itemData(i).toString())) {
+            ui->cbDrives->removeItem(i);
+        }
     }
-#endif
 
-#if defined (Q_OS_LINUX)
-    // Get currently selected volume.
-    QString lastSelectedVolume(ui->cbDrives->currentText());
+    for (int i(0); i < drivePaths.count(); ++i) {
+        if (ui->cbDrives->findData(drivePaths.at(i)) == -1) {
+            ui->cbDrives->insertItem(i, drivePaths.at(i), drivePaths.at(i));
+        }
+    }
+
+    refreshDriveLabels();
+}
+
+/*!
+ * \brief Shows the free and total space of every drive in the list, or that it does not respond.
+ */
+void MainWindow::refreshDriveLabels()
+{
+    const QLocale locale(QLocale::system());
 
-    // Clean up the list.
-    ui->cbDrives->clear();
+    for (int i(0); i < ui->cbDrives->count(); ++i) {
+        const QString drivePath(ui->cbDrives->itemData(i).toString());
+        const MountPoint mountPoint(MountMonitor::instance()->mountFor(drivePath));
+        QString label(drivePath);
 
-    // Add the common directories.
-    ui->cbDrives->addItem("/");
-    ui->cbDrives->addItem("/home");
-    ui->cbDrives->addItem(QDir::homePath());
-
-    // Add the connected external storage devices.
-    QList<QStorageInfo> volumes(QStorageInfo::mountedVolumes());
-    for (int i(0); i < volumes.length(); ++i) {
-        if (volumes.at(i).isValid() && volumes.at(i).isReady()) {
-            QString path(volumes.at(i).rootPath());
-
-            if (!volumes.at(i).isReadOnly() && (path.startsWith("/run/media") || path.startsWith("/run/mnt"))) {
-                ui->cbDrives->addItem(path);
+        if (mountPoint.stale) {
+            label += "  (not responding)";
+        } else {
+            if (mountPoint.bytesTotal >= 0) {
+                label += QString("  (%1 free of %2)").arg(locale.formattedDataSize(mountPoint.bytesFree), locale.formattedDataSize(mountPoint.bytesTotal));
             }
         }
+
+        if (ui->cbDrives->itemText(i) != label) {
+            ui->cbDrives->setItemText(i, label);
+        }
     }
+}
 
-    // Select the previously selected volume.
-    int driveIndex(ui->cbDrives->findText(lastSelectedVolume));
-    if (driveIndex != -1) {
-        ui->cbDrives->setCurrentIndex(driveIndex);
+/*!
+ * \brief Shows the entry count of the active explorer in the status bar and whether it is still loading.
+ */
+void MainWindow::refreshStatusBar()
+{
+    const ExplorerManager &explMan((activeExplorer.first == Explorer::Explorer1) ? explorerMan1 : explorerMan2);
+    const bool loading(explMan.getFileSystemModel()->isLoading());
+    const QString entryCount(QLocale::system().toString(explMan.getFileSystemModel()->rowCount()));
+    const QString itemsText(explMan.getFileSystemModel()->nameFilter().isEmpty() ? QString("%1 items") : QString("%1 matching items"));
+
+    loadingProgressBar->setVisible(loading);
+    entryCountLabel->setText(loading ? ("Loading... " + itemsText.arg(entryCount)) : itemsText.arg(entryCount));
+}
+
+/*!
+ * \brief Fetches the metadata of the rows around the viewport of an explorer and cancels the thumbnails outside of it.
+ * \param explMan = The ExplorerManager of the explorer
+ * \param explView = The QListView of the explorer
+ * \note One page of rows above and below the viewport is fetched, with a lower priority than the rows that are painted.
+ */
+void MainWindow::refreshExplorerViewport(ExplorerManager &explMan, QListView *explView)
+{
+    const QRect viewRect(explView->viewport()->rect());
+    const QModelIndex firstIndex(explView->indexAt(viewRect.topLeft())),
+            lastIndex(explView->indexAt(viewRect.bottomLeft()));
+
+    if (!firstIndex.isValid()) {
+        return;
     }
-#endif
+
+    const int lastRow(lastIndex.isValid() ? lastIndex.row() : explMan.getFileSystemModel()->rowCount() - 1);
+    const int pageRows(lastRow - firstIndex.row() + 1);
+
+    explMan.getFileSystemModel()->prefetchMetadata(firstIndex.row() - pageRows, lastRow + pageRows);
+    explMan.getFileSystemModel()->retainThumbnails(firstIndex.row(), lastRow);
+}
+
+/*!
+ * \brief Switches both explorers between the list and the thumbnail mode.
+ * \param enabled = Whether the thumbnail mode is enabled
+ */
+void MainWindow::setThumbnailMode(bool enabled)
+{
+    const QList<QPair<ExplorerManager *, QListView *>> explorers({{&explorerMan1, ui->lvExplorer1}, {&explorerMan2, ui->lvExplorer2}});
+
+    for (const QPair<ExplorerManager *, QListView *> &explorer : explorers) {
+        QListView *explView(explorer.second);
+
+        explorer.first->getFileSystemModel()->setThumbnailsEnabled(enabled);
+
+        if (enabled) {
+            explView->setViewMode(QListView::IconMode);
+            explView->setIconSize(QSize(ThumbnailService::ThumbnailSize, ThumbnailService::ThumbnailSize));
+            explView->setGridSize(QSize(ThumbnailService::ThumbnailSize + 24, ThumbnailService::ThumbnailSize + 40));
+            explView->setResizeMode(QListView::Adjust);
+            explView->setWordWrap(true);
+        } else {
+            explView->setViewMode(QListView::ListMode);
+            explView->setIconSize(QSize());
+            explView->setGridSize(QSize());
+            explView->setWordWrap(false);
+        }
+
+        // The view mode resets the movement and the layout, so the uniform item sizes are set again.
+        explView->setMovement(QListView::Static);
+        explView->setUniformItemSizes(true);
+    }
+}
+
+/*!
+ * \brief Suggests a folder of an explorer to the prefetcher, so it is ready once it is opened.
+ * \param explMan = The explorer showing the folder
+ * \param index = The index of the folder, which is ignored if it is not a folder or is ".."
+ */
+void MainWindow::prefetchIndex(ExplorerManager &explMan, const QModelIndex &index)
+{
+    const QSharedPointer<DirectoryModel> model(explMan.getFileSystemModel());
+
+    if (index.isValid() && model->isDir(index) && model->fileName(index) != "..") {
+        DirectoryPrefetcher::instance()->suggest(model->filePath(index));
+    }
+}
+
+/*!
+ * \brief Shows a file of an explorer in the preview pane, if the pane is enabled.
+ * \param explMan = The manager of the explorer
+ * \param index = The index of the entry, which clears the pane if it is not a file
+ */
+void MainWindow::previewIndex(ExplorerManager &explMan, const QModelIndex &index)
+{
+    const QSharedPointer<DirectoryModel> model(explMan.getFileSystemModel());
+
+    if (!ui->actionPreview->isChecked()) {
+        return;
+    }
+
+    if (!index.isValid() || model->isDir(index)) {
+        previewDocument->close();
+        refreshPreviewStatus();
+        return;
+    }
+
+    if (model->filePath(index) != previewDocument->path() || !previewDocument->isOpen()) {
+        previewDocument->open(model->filePath(index));
+    }
+}
+
+/*!
+ * \brief Looks the text of the locate box up in the indexed drives and shows the results below it.
+ */
+void MainWindow::runLocateQuery()
+{
+    locateResults->setStringList(FileIndexer::instance()->locate(ui->leLocate->text(), MaxLocateResults));
+
+    if (locateResults->rowCount() > 0) {
+        locateCompleter->complete();
+    } else {
+        locateCompleter->popup()->hide();
+    }
+}
+
+/*!
+ * \brief Starts or stops indexing the drive selected in the tree view.
+ * \param indexed = Whether the drive is indexed
+ */
+void MainWindow::setDriveIndexed(bool indexed)
+{
+    const QString drive(ui->cbDrives->currentData().toString());
+
+    if (indexed) {
+        FileIndexer::instance()->addRoot(drive);
+    } else {
+        FileIndexer::instance()->removeRoot(drive);
+    }
+}
+
+/*!
+ * \brief Starts comparing the directory trees of both explorers, or stops highlighting their differences.
+ * \param enabled = Whether the explorers are compared
+ * \note Explorer 1 is the left tree and explorer 2 the right tree.
+ */
+void MainWindow::setCompareMode(bool enabled)
+{
+    const QString leftRoot(explorerMan1.currentPath()), rightRoot(explorerMan2.currentPath());
+
+    if (!enabled) {
+        explorerCompare->cancel();
+        explorerMan1.getFileSystemModel()->setComparison(nullptr);
+        explorerMan2.getFileSystemModel()->setComparison(nullptr);
+        compareLabel->setVisible(false);
+        ui->actionSync->setEnabled(false);
+        return;
+    }
+
+    // A tree that contains the other one would be compared with itself.
+    if (leftRoot == rightRoot || leftRoot.startsWith(rightRoot.endsWith('/') ? rightRoot : rightRoot + '/')
+            || rightRoot.startsWith(leftRoot.endsWith('/') ? leftRoot : leftRoot + '/')) {
+        QMessageBox::information(this, "Compare Explorers", "The explorers have to show two separate directory trees.");
+        ui->actionCompare->setChecked(false);
+        return;
+    }
+
+    explorerCompare->start(leftRoot, rightRoot);
+    explorerMan1.getFileSystemModel()->setComparison(explorerCompare);
+    explorerMan2.getFileSystemModel()->setComparison(explorerCompare);
+    compareLabel->setText("Comparing...");
+    compareLabel->setVisible(true);
+    ui->actionSync->setEnabled(false);
+}
+
+/*!
+ * \brief Shows the outcome of the comparison of both explorers.
+ */
+void MainWindow::comparisonFinished()
+{
+    if (!explorerCompare->hasResults()) {
+        return;
+    }
+
+    const QLocale locale(QLocale::system());
+
+    compareLabel->setText(QString("%1 only left, %2 only right, %3 newer left, %4 newer right, %5 same")
+                          .arg(locale.toString(explorerCompare->count(DirectoryCompare::OnlyLeft)),
+                               locale.toString(explorerCompare->count(DirectoryCompare::OnlyRight)),
+                               locale.toString(explorerCompare->count(DirectoryCompare::NewerLeft)),
+                               locale.toString(explorerCompare->count(DirectoryCompare::NewerRight)),
+                               locale.toString(explorerCompare->count(DirectoryCompare::Same))));
+    ui->actionSync->setEnabled(explorerCompare->count(DirectoryCompare::OnlyLeft) + explorerCompare->count(DirectoryCompare::NewerLeft) > 0);
+}
+
+/*!
+ * \brief Copies what is only or newer in the tree of explorer 1 to the tree of explorer 2.
+ * \note The trees are compared again once the synchronization has finished.
+ */
+void MainWindow::synchronizeExplorers()
+{
+    QStringList sourcePaths, targetPaths;
+    explorerCompare->syncPaths(sourcePaths, targetPaths);
+
+    if (sourcePaths.isEmpty()) {
+        return;
+    }
+
+    if (QMessageBox::question(this, "Synchronize", QString("Copy %1 changed items from %2 to %3?")
+                              .arg(sourcePaths.count())
+                              .arg(QDir::toNativeSeparators(explorerCompare->leftRoot()), QDir::toNativeSeparators(explorerCompare->rightRoot()))) != QMessageBox::Yes) {
+        return;
+    }
+
+    FileOperation *operation(new FileOperation(FileOperation::SyncMode, sourcePaths, explorerCompare->rightRoot()));
+    operation->setTargetPaths(targetPaths);
+
+    connect(operation, &FileOperation::finished, this, [this]() {
+        if (ui->actionCompare->isChecked()) {
+            setCompareMode(true);
+        }
+    });
+
+    OperationDialog *operationDialog(new OperationDialog(operation, this));
+    operationDialog->show();
+}
+
+/*!
+ * \brief Shows or hides the preview pane.
+ * \param enabled = Whether the preview pane is shown
+ * \note The pane starts with the current file of the active explorer, and the file is closed when the pane is hidden.
+ */
+void MainWindow::setPreviewMode(bool enabled)
+{
+    ui->gbPreview->setVisible(enabled);
+
+    if (enabled) {
+        if (activeExplorer.first == Explorer::Explorer1) {
+            previewIndex(explorerMan1, ui->lvExplorer1->currentIndex());
+        } else {
+            previewIndex(explorerMan2, ui->lvExplorer2->currentIndex());
+        }
+    } else {
+        previewDocument->close();
+    }
+}
+
+/*!
+ * \brief Shows the name, the size and the amount of lines of the previewed file, and how far its lines are indexed.
+ */
+void MainWindow::refreshPreviewStatus()
+{
+    const QLocale locale(QLocale::system());
+
+    if (!previewDocument->isOpen()) {
+        ui->lblPreviewStatus->setText(previewDocument->path().isEmpty() ? QString() : QString("Could not open %1").arg(QFileInfo(previewDocument->path()).fileName()));
+        return;
+    }
+
+    QString status(QString("%1 - %2 - %3 lines").arg(QFileInfo(previewDocument->path()).fileName(),
+                                                     locale.formattedDataSize(previewDocument->size()),
+                                                     locale.toString(previewDocument->indexedLineCount())));
+
+    if (previewDocument->isIndexing()) {
+        status += QString(" so far (%1%)").arg(previewDocument->indexedBytes() * 100 / qMax<qint64>(1, previewDocument->size()));
+    }
+
+    ui->lblPreviewStatus->setText(status);
 }
 
 /*!
@@ -483,6 +1106,7 @@ void MainWindow::refreshDriveList()
  * \note This function may only be called if all the UI elements (espesially the combo boxes containing the directories) are fully loaded.
  *
  * This will load information of the MainWindow size and the splitter positions and assign them accordingly.
+ * The listings of the last session are restored from the SessionSnapshot before the explorers are pointed at their directories.
  */
 void MainWindow::loadSettings()
 {
@@ -491,9 +1115,18 @@ void MainWindow::loadSettings()
             splitterSizes(settings.value("SplitterSizes")),
             treeViewDir(settings.value("TreeViewDir")),
             explorer1Dir(settings.value("Explorer1Dir")),
-            explorer2Dir(settings.value("Explorer2Dir"));
-    QDir dir;
+            explorer2Dir(settings.value("Explorer2Dir")),
+            thumbnails(settings.value("Thumbnails")),
+            preview(settings.value("Preview")),
+            historyCacheSize(settings.value("HistoryCacheMegabytes"));
+
+    if (historyCacheSize != QVariant()) {
+        HistoryCache::instance()->setMaxBytes(historyCacheSize.toLongLong() * 1024 * 1024);
+    }
 
+    // The listings of the last session are put into the cache first, so the views find them there instead of reading
+    // their directories from scratch. The history cache keeps them alive until then, so its size is applied before.
+    const QVector<SessionSnapshot::ViewState> viewStates(SessionSnapshot::restore());
 
     if (windowSize != QVariant()) {
         this->restoreGeometry(windowSize.toByteArray());
@@ -504,40 +1137,119 @@ void MainWindow::loadSettings()
     }
 
     if (treeViewDir != QVariant()) {
-        int comboBoxIndex(ui->cbDrives->findText(treeViewDir.toString()));
+        int comboBoxIndex(ui->cbDrives->findData(treeViewDir.toString()));
         if (comboBoxIndex != -1) {
             ui->cbDrives->setCurrentIndex(comboBoxIndex);
         }
     }
 
-    if (explorer1Dir != QVariant()) {
-        dir.setPath(explorer1Dir.toString());
-        if (dir.exists()) {
-            explorerMan1.setCurrentPath(dir.path());
+    // A directory whose listing has been restored is shown at once, scrolled to where it was left, and is checked by
+    // the rescan of its listing. The other directories are restored once their drives answer, unless the user has moved on.
+    const QList<QPair<ExplorerManager *, QListView *>> explorers({{&explorerMan1, ui->lvExplorer1}, {&explorerMan2, ui->lvExplorer2}});
+
+    for (int i(0); i < explorers.count(); ++i) {
+        ExplorerManager *explMan(explorers.at(i).first);
+        const QVariant explorerDir((i == 0) ? explorer1Dir : explorer2Dir);
+
+        if (explorerDir != QVariant()) {
+            const QString dirPath(QDir::cleanPath(explorerDir.toString()));
+            const QSharedPointer<DirectoryListing> listing(DirectoryCache::instance()->find(dirPath));
+
+            if (!listing.isNull() && listing->isLoaded()) {
+                explMan->setCurrentPath(dirPath);
+                restoreExplorerViewState(*explMan, explorers.at(i).second, viewStates.value(i));
+            } else {
+                const QString startPath(explMan->currentPath());
+
+                FileSystemAccess::instance()->stat({dirPath}).then(this, [explMan, startPath](const AccessResult &result){
+                    if (result.status == AccessResult::Done && result.infos.first().isDir && explMan->currentPath() == startPath) {
+                        explMan->setCurrentPath(result.infos.first().path);
+                    }
+                });
+            }
         }
     }
 
-    if (explorer2Dir != QVariant()) {
-        dir.setPath(explorer2Dir.toString());
-        if (dir.exists()) {
-            explorerMan2.setCurrentPath(dir.path());
-        }
+    if (thumbnails != QVariant()) {
+        ui->actionThumbnails->setChecked(thumbnails.toBool());
+    }
+
+    if (preview != QVariant()) {
+        ui->actionPreview->setChecked(preview.toBool());
     }
 }
 
 /*!
  * \brief Save QSettings for the window objects.
  *
- * This will save information of the MainWindow size and the splitter positions.
+ * This will save information of the MainWindow size and the splitter positions, as well as the SessionSnapshot of the
+ * listings that are shown.
  */
 void MainWindow::saveSettings()
 {
     QSettings settings("Fverco", "Xplorer");
     settings.setValue("WindowSize", this->saveGeometry());
     settings.setValue("SplitterSizes", viewSplitter->saveState());
-    settings.setValue("TreeViewDir", ui->cbDrives->currentText());
+    settings.setValue("TreeViewDir", ui->cbDrives->currentData());
     settings.setValue("Explorer1Dir", ui->cbPathExplorer1->currentText());
     settings.setValue("Explorer2Dir", ui->cbPathExplorer2->currentText());
+    settings.setValue("Thumbnails", ui->actionThumbnails->isChecked());
+    settings.setValue("Preview", ui->actionPreview->isChecked());
+    settings.setValue("HistoryCacheMegabytes", HistoryCache::instance()->maxBytes() / (1024 * 1024));
+
+    // The listings are saved along with the settings, so the next start can show them before reading anything.
+    SessionSnapshot::save({explorerViewState(explorerMan1, ui->lvExplorer1), explorerViewState(explorerMan2, ui->lvExplorer2)}, {treeViewMan.currentPath()});
+}
+
+/*!
+ * \brief Provides the state of an explorer's view, to be saved in the session snapshot.
+ * \param explMan = The explorer
+ * \param explView = The view showing the explorer
+ * \return The SessionSnapshot::ViewState with the directory, the entry at the top of the viewport and the current entry
+ */
+SessionSnapshot::ViewState MainWindow::explorerViewState(const ExplorerManager &explMan, QListView *explView) const
+{
+    const QSharedPointer<DirectoryModel> fileModel(explMan.getFileSystemModel());
+    SessionSnapshot::ViewState state;
+
+    state.dirPath = explMan.currentPath();
+    state.topName = fileModel->fileName(explView->indexAt(QPoint(1, 1)));
+    state.currentName = fileModel->fileName(explView->currentIndex());
+
+    return state;
+}
+
+/*!
+ * \brief Scrolls an explorer's view back to the entries it showed when the last session was closed.
+ * \param explMan = The explorer
+ * \param explView = The view showing the explorer
+ * \param state = The state saved in the session snapshot
+ * \note Nothing is restored if the explorer shows another directory by the time the view has laid its items out, and
+ * entries that no longer exist are skipped.
+ */
+void MainWindow::restoreExplorerViewState(ExplorerManager &explMan, QListView *explView, const SessionSnapshot::ViewState &state)
+{
+    const QSharedPointer<DirectoryModel> fileModel(explMan.getFileSystemModel());
+
+    // The view lays its items out on the next turn of the event loop.
+    QTimer::singleShot(0, explView, [explView, fileModel, state]() {
+        if (fileModel->rootPath() != state.dirPath || explView->selectionModel() == nullptr) {
+            return;
+        }
+
+        const QString pathPrefix(state.dirPath.endsWith('/') ? state.dirPath : state.dirPath + '/');
+        const QModelIndex currentIndex(fileModel->index(pathPrefix + state.currentName));
+
+        if (currentIndex.isValid()) {
+            explView->selectionModel()->setCurrentIndex(currentIndex, QItemSelectionModel::NoUpdate);
+        }
+
+        const QModelIndex topIndex(fileModel->index(pathPrefix + state.topName));
+
+        if (topIndex.isValid()) {
+            explView->scrollTo(topIndex, QAbstractItemView::PositionAtTop);
+        }
+    });
 }
 
 /*!
@@ -550,11 +1262,12 @@ void MainWindow::on_tvFileSys_doubleClicked(const QModelIndex &index)
 }
 
 /*!
- * \brief Refreshes the drive list.
+ * \brief When a folder of the file system tree view is collapsed, the tree gives back the listings below it.
+ * \param index = The index of the tree view
  */
-void MainWindow::on_btnRefreshDrives_clicked()
+void MainWindow::on_tvFileSys_collapsed(const QModelIndex &index)
 {
-    refreshDriveList();
+    treeViewMan.getFileSystemModel()->releaseNode(index);
 }
 
 /*!
@@ -564,16 +1277,191 @@ void MainWindow::on_btnRefreshDrives_clicked()
  */
 void MainWindow::contextMenuRequested(QListView* listView, const QPoint &pos)
 {
+    ExplorerManager &explMan((listView == ui->lvExplorer1) ? explorerMan1 : explorerMan2);
+    ExplorerManager &otherExplMan((listView == ui->lvExplorer1) ? explorerMan2 : explorerMan1);
     QModelIndex rightClickedItem(listView->indexAt(pos));
     QPoint cursorLocation(listView->mapToGlobal(pos));
+    const bool onEntry(rightClickedItem.isValid() && rightClickedItem.data().toString() != "..");
+    const QStringList selectedPaths(onEntry ? selectedEntryPaths(explMan, listView, rightClickedItem) : QStringList());
+    const QMimeData *clipboardData(QGuiApplication::clipboard()->mimeData());
+
+    // Right clicking empty space only allows pasting into the current directory.
+    openEntryAction->setEnabled(onEntry);
+    copyEntriesAction->setEnabled(onEntry);
+    cutEntriesAction->setEnabled(onEntry);
+    copyToOtherAction->setEnabled(onEntry && otherExplMan.currentPath() != explMan.currentPath());
+    moveToOtherAction->setEnabled(onEntry && otherExplMan.currentPath() != explMan.currentPath());
+    trashEntriesAction->setEnabled(onEntry);
+    deleteEntriesAction->setEnabled(onEntry);
+    pasteEntriesAction->setEnabled(clipboardData != nullptr && clipboardData->hasUrls());
+
+    QAction *selectedAction(contextMenu->exec(cursorLocation));
+    contextMenu->close();
+
+    if (selectedAction == openEntryAction) {
+        openEntries(explMan, listView, rightClickedItem);
+    }
+
+    if (selectedAction == copyEntriesAction || selectedAction == cutEntriesAction) {
+        setClipboardPaths(selectedPaths, selectedAction == cutEntriesAction);
+    }
+
+    if (selectedAction == pasteEntriesAction) {
+        pasteClipboardPaths(explMan.currentPath());
+    }
 
-    if (rightClickedItem.isValid() && rightClickedItem.data().toString() != "..") {
-       QAction *selectedAction(contextMenu->exec(cursorLocation));
-       contextMenu->close();
+    if (selectedAction == copyToOtherAction) {
+        startFileOperation(FileOperation::CopyMode, selectedPaths, otherExplMan.currentPath());
+    }
+
+    if (selectedAction == moveToOtherAction) {
+        startFileOperation(FileOperation::MoveMode, selectedPaths, otherExplMan.currentPath());
+    }
+
+    if (selectedAction == trashEntriesAction || selectedAction == deleteEntriesAction) {
+        deleteEntries(selectedPaths, selectedAction == deleteEntriesAction);
+    }
+}
+
+/*!
+ * \brief Provides the paths of the selected entries of an explorer.
+ * \param explMan = The manager of the explorer
+ * \param explView = The view of the explorer
+ * \param clickedIndex = The entry that was clicked
+ * \return A QStringList with the paths of the selection if it contains the clicked entry, or else with the path of the clicked entry
+ * \note The ".." entry is never part of the paths.
+ */
+QStringList MainWindow::selectedEntryPaths(ExplorerManager &explMan, QListView *explView, const QModelIndex &clickedIndex) const
+{
+    QStringList paths;
+
+    if (!explView->selectionModel()->isSelected(clickedIndex)) {
+        paths.append(explMan.getFileSystemModel()->filePath(clickedIndex));
+        return paths;
+    }
+
+    const QModelIndexList selectedIndexes(explView->selectionModel()->selectedIndexes());
+
+    for (const QModelIndex &index : selectedIndexes) {
+        if (index.column() == 0 && index.data().toString() != "..") {
+            paths.append(explMan.getFileSystemModel()->filePath(index));
+        }
+    }
+
+    return paths;
+}
+
+/*!
+ * \brief Puts paths on the clipboard, so other applications can paste them as well.
+ * \param paths = The paths of the files and folders
+ * \param cut = Whether the files and folders are moved when they are pasted in an explorer
+ */
+void MainWindow::setClipboardPaths(const QStringList &paths, bool cut)
+{
+    QMimeData *mimeData(new QMimeData());
+    QList<QUrl> urls;
 
-       if (selectedAction) {
-           qDebug() << "Right clicked at item: " << rightClickedItem.data().toString() << Qt::endl;
-       }
+    for (const QString &path : paths) {
+        urls.append(QUrl::fromLocalFile(path));
     }
+
+    mimeData->setUrls(urls);
+    clipboardPaths = paths;
+    clipboardCut = cut;
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+}
+
+/*!
+ * \brief Copies or moves the files and folders on the clipboard into a directory.
+ * \param targetDir = The directory
+ * \note Files copied by other applications are always copied. Cut paths are removed from the clipboard once pasted.
+ */
+void MainWindow::pasteClipboardPaths(const QString &targetDir)
+{
+    const QMimeData *mimeData(QGuiApplication::clipboard()->mimeData());
+    QStringList paths;
+
+    if (mimeData == nullptr) {
+        return;
+    }
+
+    const QList<QUrl> urls(mimeData->urls());
+
+    for (const QUrl &url : urls) {
+        if (url.isLocalFile()) {
+            paths.append(url.toLocalFile());
+        }
+    }
+
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    const bool cut(clipboardCut && paths == clipboardPaths);
+    startFileOperation(cut ? FileOperation::MoveMode : FileOperation::CopyMode, paths, targetDir);
+
+    if (cut) {
+        clipboardPaths.clear();
+        clipboardCut = false;
+        QGuiApplication::clipboard()->clear();
+    }
+}
+
+/*!
+ * \brief Copies or moves files and folders into a directory, and shows the progress in a dialog.
+ * \param mode = Whether the files and folders are copied or moved
+ * \param sourcePaths = The paths of the files and folders
+ * \param targetDir = The directory
+ * \note Several operations can run at once, each with its own dialog.
+ */
+void MainWindow::startFileOperation(FileOperation::Mode mode, const QStringList &sourcePaths, const QString &targetDir)
+{
+    if (sourcePaths.isEmpty()) {
+        return;
+    }
+
+    OperationDialog *operationDialog(new OperationDialog(new FileOperation(mode, sourcePaths, targetDir), this));
+    operationDialog->show();
+}
+
+/*!
+ * \brief Deletes files and folders, or moves them to the trash.
+ * \param paths = The paths of the files and folders
+ * \param permanently = Whether the files and folders are deleted permanently, which has to be confirmed first
+ */
+void MainWindow::deleteEntries(const QStringList &paths, bool permanently)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    if (permanently) {
+        const QString items((paths.count() == 1) ? QString("\"%1\"").arg(QFileInfo(paths.first()).fileName()) : QString("these %1 items").arg(paths.count()));
+
+        if (QMessageBox::question(this, "Delete Permanently", QString("Are you sure you want to permanently delete %1?").arg(items)) != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    if (permanently) {
+        startFileOperation(FileOperation::DeleteMode, paths, QString());
+    } else {
+        fileUndoStack->push(new TrashCommand(paths));
+    }
+}
+
+/*!
+ * \brief Enables the Undo and Redo actions of the Edit menu and names the file operations they would undo or redo.
+ * \note The actions are disabled while the TrashService is busy, since a trash command only knows which items it has
+ * to restore or trash again once its batch has finished.
+ */
+void MainWindow::refreshUndoActions()
+{
+    const bool idle(!TrashService::instance()->isBusy());
+
+    ui->actionUndo->setEnabled(idle && fileUndoStack->canUndo());
+    ui->actionUndo->setText(fileUndoStack->canUndo() ? "Undo " + fileUndoStack->undoText() : QString("Undo"));
+    ui->actionRedo->setEnabled(idle && fileUndoStack->canRedo());
+    ui->actionRedo->setText(fileUndoStack->canRedo() ? "Redo " + fileUndoStack->redoText() : QString("Redo"));
 }
 
@@ -2,19 +2,34 @@
 #define MAINWINDOW_H
 
 #include "../types/actionmanager.h"
+#include "../types/directorycompare.h"
 #include "../types/explorermanager.h"
 #include "../types/treeviewmanager.h"
 #include "../types/explorersplitter.h"
+#include "../types/fileoperation.h"
+#include "../types/filesystemaccess.h"
+#include "../types/sessionsnapshot.h"
 
 #include <QMainWindow>
 #include <QPair>
 
-class QFileSystemModel;
 class QPushButton;
 class QGroupBox;
 class QListView;
+class QLabel;
+class QProgressBar;
+class QCompleter;
+class QStringListModel;
+class QTimer;
+class QUndoStack;
 class QFileIconProvider;
+class PreviewDocument;
+class PreviewView;
 class AboutDialog;
+class SearchDialog;
+class AnalyzeDialog;
+class DuplicatesDialog;
+class TrashDialog;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -38,6 +53,10 @@ public:
     void closeApp();
     bool eventFilter(QObject *watched, QEvent *event) override;
     void openAboutDialog();
+    void openSearchDialog();
+    void openAnalyzeDialog();
+    void openDuplicatesDialog();
+    void openTrashDialog();
 
 private slots:
     void on_lvExplorer1_doubleClicked(const QModelIndex &index);
@@ -50,10 +69,13 @@ private slots:
     void refreshExplorer2();
     void setTreeViewPath(const QString &newPath);
     void on_tvFileSys_doubleClicked(const QModelIndex &index);
-    void on_btnRefreshDrives_clicked();
+    void on_tvFileSys_collapsed(const QModelIndex &index);
     void contextMenuRequested(QListView* listView, const QPoint &pos);
 
 private:
+    static const int MaxLocateResults = 200;    ///< The maximum amount of results shown by the locate box.
+    static const int StatusMessageTimeout = 5000;   ///< The time in milliseconds for which a message is shown in the status bar.
+
     Ui::MainWindow *ui;              ///< The object containing all the ui elements.
     TreeViewManager treeViewMan;     ///< The manager for the tree view.
     ExplorerManager explorerMan1;    ///< The object responsible for managing explorer 1.
@@ -63,15 +85,63 @@ private:
     QSharedPointer<ExplorerSplitter> viewSplitter;  ///< The line that splits the explorers and tree view.
     QSharedPointer<QFileIconProvider> iconProvider; ///< The object that provides icons to the explorers and tree view.
     QSharedPointer<AboutDialog> aboutDialog;    ///< The about dialog.
+    QSharedPointer<SearchDialog> searchDialog;  ///< The search dialog.
+    QSharedPointer<AnalyzeDialog> analyzeDialog;    ///< The disk usage dialog.
+    QSharedPointer<DuplicatesDialog> duplicatesDialog;  ///< The duplicate finder dialog.
+    QSharedPointer<TrashDialog> trashDialog;        ///< The trash dialog.
     QMenu *contextMenu;     ///< The context menu for the explorers.
+    QAction *openEntryAction;       ///< Opens the right clicked file or folder.
+    QAction *copyEntriesAction;     ///< Puts the selected entries on the clipboard to be copied.
+    QAction *cutEntriesAction;      ///< Puts the selected entries on the clipboard to be moved.
+    QAction *pasteEntriesAction;    ///< Copies or moves the entries on the clipboard into the current directory.
+    QAction *copyToOtherAction;     ///< Copies the selected entries into the directory of the other explorer.
+    QAction *moveToOtherAction;     ///< Moves the selected entries into the directory of the other explorer.
+    QAction *trashEntriesAction;    ///< Moves the selected entries to the trash.
+    QAction *deleteEntriesAction;   ///< Deletes the selected entries permanently.
+    QStringList clipboardPaths;     ///< The paths last put on the clipboard by the explorers.
+    bool clipboardCut;              ///< Whether the paths on the clipboard are moved when they are pasted.
+    QLabel *entryCountLabel;    ///< Shows the amount of entries in the active explorer.
+    QProgressBar *loadingProgressBar;   ///< Shows that the active explorer is still loading its directory.
+    QCompleter *locateCompleter;        ///< Shows the results of the locate box.
+    QStringListModel *locateResults;    ///< The paths found by the locate box.
+    QTimer *locateTimer;                ///< Runs the query of the locate box once typing pauses.
+    DirectoryCompare *explorerCompare;  ///< Compares the directory trees of both explorers.
+    QLabel *compareLabel;               ///< Shows the progress or the outcome of the comparison.
+    PreviewDocument *previewDocument;   ///< The file shown in the preview pane.
+    PreviewView *previewView;           ///< Shows the file of the preview pane.
+    QUndoStack *fileUndoStack;          ///< The file operations that can be undone from the Edit menu, apart from the directory history of the explorers.
+    QString requestedTreeViewPath;      ///< The path last requested for the tree view, which is assigned once its drive answers.
 
     void initializeExplorerUi();
     void setActiveExplorer(const Explorer &explorer, QGroupBox *explorerGroupBox);
     void refreshBackAndForwardButtons(const ExplorerManager &explMan, QPushButton *backButton, QPushButton *forwardButton);
     void openFileIndex(ExplorerManager &explMan, const QModelIndex &fileIndex);
-    void openDirectoryInExplorer(const QString &path);
+    void openEntries(ExplorerManager &explMan, QListView *explView, const QModelIndex &index);
+    void prefetchIndex(ExplorerManager &explMan, const QModelIndex &index);
+    void previewIndex(ExplorerManager &explMan, const QModelIndex &index);
+    void openDirectoryInExplorer(const QString &path, bool openParent = false);
+    bool checkAccess(const AccessResult &result);
+    QStringList selectedEntryPaths(ExplorerManager &explMan, QListView *explView, const QModelIndex &clickedIndex) const;
+    void setClipboardPaths(const QStringList &paths, bool cut);
+    void pasteClipboardPaths(const QString &targetDir);
+    void startFileOperation(FileOperation::Mode mode, const QStringList &sourcePaths, const QString &targetDir);
+    void deleteEntries(const QStringList &paths, bool permanently);
+    void refreshUndoActions();
     void catchExplorerKeyEvent(ExplorerManager &explMan, QListView *explView, QKeyEvent *keyEvent);
     void refreshDriveList();
+    void refreshDriveLabels();
+    void refreshStatusBar();
+    void refreshExplorerViewport(ExplorerManager &explMan, QListView *explView);
+    void setThumbnailMode(bool enabled);
+    void setPreviewMode(bool enabled);
+    void refreshPreviewStatus();
+    void runLocateQuery();
+    void setDriveIndexed(bool indexed);
+    void setCompareMode(bool enabled);
+    void comparisonFinished();
+    void synchronizeExplorers();
+    SessionSnapshot::ViewState explorerViewState(const ExplorerManager &explMan, QListView *explView) const;
+    void restoreExplorerViewState(ExplorerManager &explMan, QListView *explView, const SessionSnapshot::ViewState &state);
     void loadSettings();
     void saveSettings();
 };
@@ -0,0 +1,147 @@
+#include "operationdialog.h"
+#include "ui_operationdialog.h"
+
+#include <QDir>
+#include <QLocale>
+#include <QMessageBox>
+
+/*!
+ * \brief The constructor.
+ * \param fileOperation = The operation to perform, which is taken over by the dialog.
+ * \param parent = The QWidget to which this dialog is bound.
+ * \note The operation starts right away.
+ */
+OperationDialog::OperationDialog(FileOperation *fileOperation, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::OperationDialog),
+    operation(fileOperation)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+    operation->setParent(this);
+
+    const QStringList sourcePaths(operation->sourcePaths());
+    const QString targetDir(operation->targetDir());
+    const QString items((sourcePaths.count() == 1) ? QDir(sourcePaths.first()).dirName() : QString("%1 items").arg(sourcePaths.count()));
+
+    switch (operation->mode()) {
+    case FileOperation::CopyMode:
+        setWindowTitle("Copy");
+        ui->lblOperation->setText(QString("Copying %1 to %2").arg(items, QDir::toNativeSeparators(targetDir)));
+        break;
+
+    case FileOperation::MoveMode:
+        setWindowTitle("Move");
+        ui->lblOperation->setText(QString("Moving %1 to %2").arg(items, QDir::toNativeSeparators(targetDir)));
+        break;
+
+    case FileOperation::DeleteMode:
+        setWindowTitle("Delete");
+        ui->lblOperation->setText(QString("Deleting %1").arg(items));
+        break;
+
+    case FileOperation::SyncMode:
+        setWindowTitle("Synchronize");
+        ui->lblOperation->setText(QString("Synchronizing %1 to %2").arg(items, QDir::toNativeSeparators(targetDir)));
+        break;
+    }
+
+    connect(operation, &FileOperation::progressChanged, this, &OperationDialog::refreshProgress);
+    connect(operation, &FileOperation::finished, this, &OperationDialog::operationFinished);
+
+    operation->start();
+    refreshProgress();
+}
+
+/*!
+ * \brief The destructor.
+ * \note A running operation is canceled with its FileOperation.
+ */
+OperationDialog::~OperationDialog()
+{
+    delete ui;
+}
+
+/*!
+ * \brief Cancels the operation, or closes the dialog once it has finished.
+ */
+void OperationDialog::on_btnCancel_clicked()
+{
+    if (operation->isRunning()) {
+        operation->cancel();
+    } else {
+        close();
+    }
+}
+
+/*!
+ * \brief Shows the progress, the throughput and the remaining time of the operation.
+ */
+void OperationDialog::refreshProgress()
+{
+    const QLocale locale(QLocale::system());
+
+    // The size of a deletion is not known in advance, so only the removed entries are counted.
+    if (operation->mode() == FileOperation::DeleteMode) {
+        ui->pbOperation->setMaximum(operation->isRunning() ? 0 : 1000);
+        ui->pbOperation->setValue(operation->isRunning() ? 0 : 1000);
+        ui->lblOperationStatus->setText(QString("%1 items removed").arg(locale.toString(operation->doneFiles())));
+        return;
+    }
+
+    if (operation->isScanning()) {
+        ui->pbOperation->setMaximum(0);
+        ui->lblOperationStatus->setText(QString("Preparing %1 files (%2)...")
+                                        .arg(locale.toString(operation->totalFiles()), locale.formattedDataSize(operation->totalBytes())));
+        return;
+    }
+
+    const qint64 totalBytes(operation->totalBytes());
+    QString status(QString("%1 of %2 files").arg(locale.toString(operation->doneFiles()), locale.toString(operation->totalFiles())));
+
+    ui->pbOperation->setMaximum(1000);
+    ui->pbOperation->setValue((totalBytes > 0) ? static_cast<int>(operation->doneBytes() * 1000 / totalBytes) : 0);
+
+    if (totalBytes > 0) {
+        status += QString(" - %1 of %2").arg(locale.formattedDataSize(operation->doneBytes()), locale.formattedDataSize(totalBytes));
+    }
+
+    if (operation->isRunning() && operation->throughput() > 0) {
+        status += QString(" - %1/s").arg(locale.formattedDataSize(operation->throughput()));
+
+        if (operation->remainingSeconds() >= 0) {
+            status += QString(" - %1 s left").arg(locale.toString(operation->remainingSeconds()));
+        }
+    }
+
+    ui->lblOperationStatus->setText(status);
+}
+
+/*!
+ * \brief Shows the final progress and the errors of the operation.
+ */
+void OperationDialog::operationFinished()
+{
+    const QStringList errors(operation->errors());
+
+    refreshProgress();
+    ui->btnCancel->setText("Close");
+
+    // A canceled operation stays open, so it is clear what has been done before it stopped.
+    if (operation->isCanceled()) {
+        ui->lblOperationStatus->setText("Canceled - " + ui->lblOperationStatus->text());
+        return;
+    }
+
+    if (!errors.isEmpty()) {
+        QString message(errors.mid(0, MaxShownErrors).join('\n'));
+
+        if (errors.count() > MaxShownErrors) {
+            message += QString("\n... and %1 more errors").arg(errors.count() - MaxShownErrors);
+        }
+
+        QMessageBox::warning(this, "File Operation Error", message);
+    } else {
+        close();
+    }
+}
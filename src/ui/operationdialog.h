@@ -0,0 +1,37 @@
+#ifndef OPERATIONDIALOG_H
+#define OPERATIONDIALOG_H
+
+#include "../types/fileoperation.h"
+
+#include <QDialog>
+
+namespace Ui {
+class OperationDialog;
+}
+
+/*!
+ * \brief The dialog that performs a copy or move and shows its progress.
+ * \note The dialog deletes itself when it is closed, which cancels an operation that is still running.
+ */
+class OperationDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit OperationDialog(FileOperation *fileOperation, QWidget *parent = nullptr);
+    ~OperationDialog();
+
+private slots:
+    void on_btnCancel_clicked();
+
+private:
+    static const int MaxShownErrors = 20;   ///< The maximum amount of errors listed when the operation has finished.
+
+    Ui::OperationDialog *ui;        ///< The object containing all the UI elements.
+    FileOperation *operation;       ///< The copy or move performed by this dialog.
+
+    void refreshProgress();
+    void operationFinished();
+};
+
+#endif // OPERATIONDIALOG_H
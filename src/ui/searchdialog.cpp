@@ -0,0 +1,113 @@
+#include "searchdialog.h"
+#include "ui_searchdialog.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QLocale>
+
+/*!
+ * \brief The constructor.
+ * \param rootPath = The directory whose tree is searched.
+ * \param parent = The QWidget to which this dialog is bound.
+ */
+SearchDialog::SearchDialog(const QString &rootPath, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::SearchDialog),
+    searchRoot(rootPath)
+{
+    ui->setupUi(this);
+    ui->lblSearchRoot->setText(QString("Search in %1").arg(searchRoot));
+    ui->deModifiedAfter->setDate(QDate::currentDate().addDays(-7));
+    ui->tvResults->setModel(&resultsModel);
+    ui->tvResults->setColumnWidth(SearchResultsModel::NameColumn, 220);
+    ui->tvResults->setColumnWidth(SearchResultsModel::FolderColumn, 260);
+
+    statusTimer.setInterval(250);
+
+    connect(&search, &FileSearch::resultsFound, &resultsModel, &SearchResultsModel::appendResults);
+    connect(&search, &FileSearch::finished, this, &SearchDialog::searchFinished);
+    connect(&statusTimer, &QTimer::timeout, this, &SearchDialog::refreshStatus);
+    connect(ui->chkModifiedAfter, &QCheckBox::toggled, ui->deModifiedAfter, &QDateEdit::setEnabled);
+}
+
+/*!
+ * \brief The destructor.
+ */
+SearchDialog::~SearchDialog()
+{
+    search.cancel();
+    delete ui;
+}
+
+/*!
+ * \brief Starts a new search with the criteria of the dialog.
+ */
+void SearchDialog::on_btnSearch_clicked()
+{
+    SearchCriteria criteria;
+    criteria.namePattern = ui->leSearchPattern->text();
+    criteria.types = static_cast<SearchCriteria::EntryTypes>(ui->cbSearchType->currentIndex());
+    criteria.minSize = (ui->sbMinSize->value() > 0) ? static_cast<qint64>(ui->sbMinSize->value()) * 1024 : -1;
+    criteria.maxSize = (ui->sbMaxSize->value() > 0) ? static_cast<qint64>(ui->sbMaxSize->value()) * 1024 : -1;
+    criteria.modifiedAfter = ui->chkModifiedAfter->isChecked() ? ui->deModifiedAfter->date().startOfDay().toMSecsSinceEpoch() : -1;
+    criteria.includeHidden = ui->chkHidden->isChecked();
+    criteria.followSymlinks = ui->chkFollowSymlinks->isChecked();
+
+    resultsModel.clear();
+    search.start(searchRoot, criteria);
+    statusTimer.start();
+
+    ui->btnStop->setEnabled(true);
+    refreshStatus();
+}
+
+/*!
+ * \brief Stops the running search.
+ */
+void SearchDialog::on_btnStop_clicked()
+{
+    search.cancel();
+}
+
+/*!
+ * \brief Shows the folder of a result in the active explorer.
+ * \param index = The index of the result
+ * \note A folder that was found is shown itself instead of its parent.
+ */
+void SearchDialog::on_tvResults_doubleClicked(const QModelIndex &index)
+{
+    const SearchResult result(resultsModel.result(index));
+
+    if (result.path.isEmpty()) {
+        return;
+    }
+
+    emit locationRequested((result.type == DirectoryEntries::DirEntry) ? result.path : QFileInfo(result.path).path());
+}
+
+/*!
+ * \brief Shows the final status once the search has finished or has been stopped.
+ */
+void SearchDialog::searchFinished()
+{
+    statusTimer.stop();
+    ui->btnStop->setEnabled(false);
+    refreshStatus();
+}
+
+/*!
+ * \brief Shows the amount of results and of searched folders.
+ */
+void SearchDialog::refreshStatus()
+{
+    const QLocale locale(QLocale::system());
+    QString status(QString("%1 results in %2 folders").arg(locale.toString(resultsModel.rowCount()),
+                                                           locale.toString(search.scannedDirCount())));
+
+    if (search.failedDirCount() > 0) {
+        status += QString(", %1 folders could not be read").arg(locale.toString(search.failedDirCount()));
+    }
+
+    ui->lblSearchStatus->setText(search.isRunning() ? ("Searching... " + status) : status);
+}
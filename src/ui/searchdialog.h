@@ -0,0 +1,44 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include "../types/filesearch.h"
+#include "../types/searchresultsmodel.h"
+
+#include <QDialog>
+#include <QTimer>
+
+namespace Ui {
+class SearchDialog;
+}
+
+/*!
+ * \brief The dialog that searches the tree below a directory and lists the results as they are found.
+ */
+class SearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SearchDialog(const QString &rootPath, QWidget *parent = nullptr);
+    ~SearchDialog();
+
+signals:
+    void locationRequested(const QString &dirPath);    ///< Emitted when a result is opened, with the directory to show.
+
+private slots:
+    void on_btnSearch_clicked();
+    void on_btnStop_clicked();
+    void on_tvResults_doubleClicked(const QModelIndex &index);
+
+private:
+    Ui::SearchDialog *ui;           ///< The object containing all the UI elements.
+    QString searchRoot;             ///< The directory whose tree is searched.
+    FileSearch search;              ///< The running search.
+    SearchResultsModel resultsModel;    ///< The results of the search.
+    QTimer statusTimer;             ///< Refreshes the status while the search is running.
+
+    void searchFinished();
+    void refreshStatus();
+};
+
+#endif // SEARCHDIALOG_H
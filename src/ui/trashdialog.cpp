@@ -0,0 +1,116 @@
+#include "trashdialog.h"
+#include "ui_trashdialog.h"
+#include "operationdialog.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMessageBox>
+
+/*!
+ * \brief The constructor.
+ * \param parent = The QWidget to which this dialog is bound.
+ */
+TrashDialog::TrashDialog(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::TrashDialog)
+{
+    ui->setupUi(this);
+    ui->twTrash->setColumnWidth(0, 220);
+    ui->twTrash->setColumnWidth(1, 320);
+    ui->twTrash->sortByColumn(2, Qt::DescendingOrder);
+
+    connect(TrashService::instance(), &TrashService::itemsChanged, this, &TrashDialog::refreshItems);
+
+    refreshItems();
+}
+
+/*!
+ * \brief The destructor.
+ */
+TrashDialog::~TrashDialog()
+{
+    delete ui;
+}
+
+/*!
+ * \brief Restores the selected items to where they were trashed from.
+ */
+void TrashDialog::on_btnRestore_clicked()
+{
+    TrashService::instance()->restore(selectedItems());
+}
+
+/*!
+ * \brief Deletes the selected items permanently.
+ */
+void TrashDialog::on_btnDeleteItems_clicked()
+{
+    deleteItems(selectedItems());
+}
+
+/*!
+ * \brief Deletes all the items in the trash permanently.
+ */
+void TrashDialog::on_btnEmptyTrash_clicked()
+{
+    deleteItems(trashItems);
+}
+
+/*!
+ * \brief Lists the items in the trash.
+ */
+void TrashDialog::refreshItems()
+{
+    trashItems = TrashService::instance()->items();
+    ui->twTrash->setSortingEnabled(false);
+    ui->twTrash->clear();
+
+    for (int i(0); i < trashItems.count(); ++i) {
+        const TrashedItem &item(trashItems.at(i));
+        QTreeWidgetItem *row(new QTreeWidgetItem(ui->twTrash));
+
+        row->setText(0, QFileInfo(item.originalPath).fileName());
+        row->setData(0, Qt::UserRole, i);
+        row->setText(1, QDir::toNativeSeparators(QFileInfo(item.originalPath).path()));
+        row->setText(2, item.deletionDate.toString("yyyy-MM-dd hh:mm:ss"));   // Sorts chronologically as text.
+    }
+
+    ui->twTrash->setSortingEnabled(true);
+    ui->btnEmptyTrash->setEnabled(!trashItems.isEmpty());
+}
+
+/*!
+ * \brief Provides the selected items.
+ * \return A QVector of TrashedItem
+ */
+QVector<TrashedItem> TrashDialog::selectedItems() const
+{
+    const QList<QTreeWidgetItem *> rows(ui->twTrash->selectedItems());
+    QVector<TrashedItem> items;
+
+    for (const QTreeWidgetItem *row : rows) {
+        items.append(trashItems.at(row->data(0, Qt::UserRole).toInt()));
+    }
+
+    return items;
+}
+
+/*!
+ * \brief Deletes items permanently after asking for confirmation.
+ * \param deletedItems = The items
+ * \note The items leave the trash right away, and their files are deleted by a FileOperation in the background.
+ */
+void TrashDialog::deleteItems(const QVector<TrashedItem> &deletedItems)
+{
+    if (deletedItems.isEmpty()) {
+        return;
+    }
+
+    if (QMessageBox::question(this, "Delete Permanently", QString("Are you sure you want to permanently delete %1 items?").arg(deletedItems.count())) != QMessageBox::Yes) {
+        return;
+    }
+
+    const QStringList filePaths(TrashService::instance()->erase(deletedItems));
+    OperationDialog *operationDialog(new OperationDialog(new FileOperation(FileOperation::DeleteMode, filePaths, QString()), parentWidget()));
+    operationDialog->show();
+}
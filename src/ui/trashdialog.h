@@ -0,0 +1,38 @@
+#ifndef TRASHDIALOG_H
+#define TRASHDIALOG_H
+
+#include "../types/trashservice.h"
+
+#include <QDialog>
+
+namespace Ui {
+class TrashDialog;
+}
+
+/*!
+ * \brief The dialog that lists the items in the trash and restores or deletes them.
+ * \note The list comes from the index of the TrashService, so the dialog opens without reading the trash directories.
+ */
+class TrashDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TrashDialog(QWidget *parent = nullptr);
+    ~TrashDialog();
+
+private slots:
+    void on_btnRestore_clicked();
+    void on_btnDeleteItems_clicked();
+    void on_btnEmptyTrash_clicked();
+
+private:
+    Ui::TrashDialog *ui;                ///< The object containing all the UI elements.
+    QVector<TrashedItem> trashItems;    ///< The items listed in the dialog, in the order of its rows.
+
+    void refreshItems();
+    QVector<TrashedItem> selectedItems() const;
+    void deleteItems(const QVector<TrashedItem> &deletedItems);
+};
+
+#endif // TRASHDIALOG_H
@@ -0,0 +1,16 @@
+QT       += testlib gui concurrent
+
+CONFIG += c++17 testcase
+
+TARGET = tst_actionmanager
+
+INCLUDEPATH += ../../src/types
+
+SOURCES += \
+    tst_actionmanager.cpp \
+    ../../src/types/actionmanager.cpp \
+    ../../src/types/mimesniffer.cpp
+
+HEADERS += \
+    ../../src/types/actionmanager.h \
+    ../../src/types/mimesniffer.h
@@ -0,0 +1,58 @@
+#include "actionmanager.h"
+
+#include <QtTest>
+
+/*!
+ * \brief Tests how the ActionManager splits the Exec key of a .desktop file.
+ * \note The values are written as they appear in a .desktop file, so a backslash of the quoting rules is written twice.
+ */
+class TestActionManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void splitExec_data();
+    void splitExec();
+};
+
+/*!
+ * \brief Provides Exec values and the arguments they are split into.
+ */
+void TestActionManager::splitExec_data()
+{
+    QTest::addColumn<QString>("exec");
+    QTest::addColumn<QStringList>("arguments");
+
+    QTest::newRow("empty") << "" << QStringList();
+    QTest::newRow("field code") << "gedit %U" << QStringList({"gedit", "%U"});
+    QTest::newRow("extra spaces") << "  gimp   %F  " << QStringList({"gimp", "%F"});
+    QTest::newRow("tab") << "vlc\t%u" << QStringList({"vlc", "%u"});
+    QTest::newRow("several field codes") << "app --name %c %i %f" << QStringList({"app", "--name", "%c", "%i", "%f"});
+    QTest::newRow("field code in argument") << "app --file=%f" << QStringList({"app", "--file=%f"});
+    QTest::newRow("quoted program") << "\"/opt/My App/run\" --file %f" << QStringList({"/opt/My App/run", "--file", "%f"});
+    QTest::newRow("quoted field code") << "app \"%f\"" << QStringList({"app", "%f"});
+    QTest::newRow("empty quotes") << "app \"\" %u" << QStringList({"app", "", "%u"});
+    QTest::newRow("quotes inside argument") << "pre\"fix mid\"post" << QStringList({"prefix midpost"});
+    QTest::newRow("escaped quotes") << "sh -c \"echo \\\\\"hi\\\\\"\"" << QStringList({"sh", "-c", "echo \"hi\""});
+    QTest::newRow("escaped dollar") << "sh -c \"echo \\\\$HOME\"" << QStringList({"sh", "-c", "echo $HOME"});
+    QTest::newRow("escaped backslash") << "app \"a\\\\\\\\b\"" << QStringList({"app", "a\\b"});
+    QTest::newRow("key file space") << "my\\sapp %f" << QStringList({"my", "app", "%f"});
+    QTest::newRow("key file space quoted") << "\"my\\sapp\" %f" << QStringList({"my app", "%f"});
+    QTest::newRow("trailing backslash") << "app\\" << QStringList({"app\\"});
+    QTest::newRow("unterminated quote") << "app \"some file" << QStringList({"app", "some file"});
+}
+
+/*!
+ * \brief Checks that an Exec value is split into the expected arguments.
+ */
+void TestActionManager::splitExec()
+{
+    QFETCH(QString, exec);
+    QFETCH(QStringList, arguments);
+
+    QCOMPARE(ActionManager::splitExec(exec), arguments);
+}
+
+QTEST_GUILESS_MAIN(TestActionManager)
+
+#include "tst_actionmanager.moc"
@@ -0,0 +1,15 @@
+QT       += testlib
+QT       -= gui
+
+CONFIG += c++17 testcase
+
+TARGET = tst_directoryentries
+
+INCLUDEPATH += ../../src/types
+
+SOURCES += \
+    tst_directoryentries.cpp \
+    ../../src/types/directoryentries.cpp
+
+HEADERS += \
+    ../../src/types/directoryentries.h
@@ -0,0 +1,148 @@
+#include "directoryentries.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <numeric>
+
+/*!
+ * \brief Tests the natural sort keys of DirectoryEntries.
+ */
+class TestDirectoryEntries : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compareNames_data();
+    void compareNames();
+    void sameKey_data();
+    void sameKey();
+    void sortOrder();
+
+private:
+    static int compare(const QString &name, const QString &otherName);
+};
+
+/*!
+ * \brief Compares two names with the sort keys DirectoryEntries gives them.
+ * \param name = The first name
+ * \param otherName = The second name
+ * \return The result of DirectoryEntries::compareNames()
+ */
+int TestDirectoryEntries::compare(const QString &name, const QString &otherName)
+{
+    DirectoryEntries entries;
+    const QByteArray encodedName(name.toUtf8()), encodedOtherName(otherName.toUtf8());
+
+    entries.append(encodedName.constData(), encodedName.size(), DirectoryEntries::FileEntry, 0);
+    entries.append(encodedOtherName.constData(), encodedOtherName.size(), DirectoryEntries::FileEntry, 0);
+
+    return entries.compareNames(0, 1);
+}
+
+/*!
+ * \brief Provides pairs of names of which the first one comes first.
+ */
+void TestDirectoryEntries::compareNames_data()
+{
+    QTest::addColumn<QString>("first");
+    QTest::addColumn<QString>("last");
+
+    QTest::newRow("letters") << "apple" << "banana";
+    QTest::newRow("case") << "Apple" << "banana";
+    QTest::newRow("case reversed") << "apple" << "Banana";
+    QTest::newRow("prefix") << "file" << "file1";
+    QTest::newRow("number value") << "file2" << "file10";
+    QTest::newRow("several numbers") << "a1b2" << "a1b10";
+    QTest::newRow("number before letter") << "1" << "a";
+    QTest::newRow("digit run before letters") << "file9" << "filea";
+    QTest::newRow("long numbers") << "x99999999999999999999" << "x100000000000000000000";
+    QTest::newRow("leading zeros") << "v007" << "v8";
+    QTest::newRow("accent") << QString::fromUtf8("école") << "eglise";
+    QTest::newRow("accented uppercase") << QString::fromUtf8("École") << "eglise";
+    QTest::newRow("same key by bytes") << "A" << "a";
+    QTest::newRow("zeros by bytes") << "file02" << "file2";
+    QTest::newRow("accent by bytes") << "ecole" << QString::fromUtf8("école");
+}
+
+/*!
+ * \brief Checks that the names are ordered both ways round.
+ */
+void TestDirectoryEntries::compareNames()
+{
+    QFETCH(QString, first);
+    QFETCH(QString, last);
+
+    QVERIFY(compare(first, last) < 0);
+    QVERIFY(compare(last, first) > 0);
+    QCOMPARE(compare(first, first), 0);
+}
+
+/*!
+ * \brief Provides pairs of names that get the same sort key.
+ */
+void TestDirectoryEntries::sameKey_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("otherName");
+
+    QTest::newRow("case") << "Readme.TXT" << "readme.txt";
+    QTest::newRow("leading zeros") << "track007" << "track7";
+    QTest::newRow("only zeros") << "0" << "000";
+    QTest::newRow("accent") << QString::fromUtf8("café") << "cafe";
+    QTest::newRow("combining accent") << QString::fromUtf8("café") << "cafe";
+}
+
+/*!
+ * \brief Checks that names that only differ in case, accents or leading zeros get the same sort key.
+ */
+void TestDirectoryEntries::sameKey()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, otherName);
+
+    DirectoryEntries entries;
+    const QByteArray encodedName(name.toUtf8()), encodedOtherName(otherName.toUtf8());
+
+    entries.append(encodedName.constData(), encodedName.size(), DirectoryEntries::FileEntry, 0);
+    entries.append(encodedOtherName.constData(), encodedOtherName.size(), DirectoryEntries::FileEntry, 0);
+
+    QCOMPARE(QByteArray(entries.keyArena.constData() + entries.keyOffsets.at(0), entries.keyLengths.at(0)),
+             QByteArray(entries.keyArena.constData() + entries.keyOffsets.at(1), entries.keyLengths.at(1)));
+}
+
+/*!
+ * \brief Checks that sorting a directory with the sort keys gives the natural order.
+ */
+void TestDirectoryEntries::sortOrder()
+{
+    const QStringList expected({"1", "2", "10", "img1.png", "IMG2.png", "img10.png", "img10b.png", "Img11.png", "photo"});
+    QStringList shuffled(expected);
+    std::reverse(shuffled.begin(), shuffled.end());
+    std::swap(shuffled[1], shuffled[4]);
+
+    DirectoryEntries entries;
+
+    for (const QString &name : qAsConst(shuffled)) {
+        const QByteArray encodedName(name.toUtf8());
+        entries.append(encodedName.constData(), encodedName.size(), DirectoryEntries::FileEntry, 0);
+    }
+
+    QVector<int> order(entries.count());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&entries](int entry, int otherEntry) {
+        return entries.compareNames(entry, otherEntry) < 0;
+    });
+
+    QStringList sorted;
+
+    for (const int entry : qAsConst(order)) {
+        sorted.append(entries.name(entry));
+    }
+
+    QCOMPARE(sorted, expected);
+}
+
+QTEST_APPLESS_MAIN(TestDirectoryEntries)
+
+#include "tst_directoryentries.moc"
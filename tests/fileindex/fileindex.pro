@@ -0,0 +1,19 @@
+QT       += testlib concurrent
+QT       -= gui
+
+CONFIG += c++17 testcase
+
+TARGET = tst_fileindex
+
+INCLUDEPATH += ../../src/types
+
+SOURCES += \
+    tst_fileindex.cpp \
+    ../../src/types/directoryentries.cpp \
+    ../../src/types/fileindex.cpp \
+    ../../src/types/namematcher.cpp
+
+HEADERS += \
+    ../../src/types/directoryentries.h \
+    ../../src/types/fileindex.h \
+    ../../src/types/namematcher.h
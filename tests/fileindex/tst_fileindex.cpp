@@ -0,0 +1,227 @@
+#include "fileindex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cstring>
+#include <limits>
+
+/*!
+ * \brief Tests that the FileIndex reads a valid index and rejects truncated and corrupted ones.
+ *
+ * The index of a small tree is built once. Every test writes a damaged copy of it and opens that. The damaged fields
+ * are addressed by their offsets in the file, which follow the Header of the file format: the dirCount at 12, the
+ * entryCount at 16, the rootLength at 20, the section offsets from 32 to 80 and the namesSize at 88.
+ */
+class TestFileIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void validIndex();
+    void truncated_data();
+    void truncated();
+    void corrupted_data();
+    void corrupted();
+    void everyByteFlipped();
+
+private:
+    static const int HeaderSize = 96;   ///< The size of the header of an index file.
+    static const int DirSize = 24;      ///< The size of a directory record.
+
+    QTemporaryDir tempDir;  ///< Holds the indexed tree and the index files.
+    QString rootPath;       ///< The root of the indexed tree.
+    QByteArray indexData;   ///< The contents of the valid index.
+
+    QSharedPointer<FileIndex> openData(const QByteArray &data) const;
+    quint64 field(int offset, int size) const;
+};
+
+/*!
+ * \brief Builds the index of a small tree.
+ * \note The entries are numbered breadth first and sorted by name: "a" is 0, "readme.md" is 1, "a/b" is 2 and
+ * "a/b/note.txt" is 3, while the root, "a" and "a/b" are directories 0, 1 and 2.
+ */
+void TestFileIndex::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+
+    rootPath = tempDir.filePath("root");
+    QVERIFY(QDir().mkpath(rootPath + "/a/b"));
+
+    for (const QString &filePath : {rootPath + "/readme.md", rootPath + "/a/b/note.txt"}) {
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    const QString indexPath(tempDir.filePath("valid.idx"));
+    QPromise<bool> promise;
+    QFuture<bool> future(promise.future());
+
+    promise.start();
+    FileIndex::build(promise, rootPath, indexPath, QSharedPointer<FileIndex>());
+    promise.finish();
+    QVERIFY(future.result());
+
+    QFile indexFile(indexPath);
+    QVERIFY(indexFile.open(QIODevice::ReadOnly));
+    indexData = indexFile.readAll();
+    QVERIFY(indexData.size() > HeaderSize);
+}
+
+/*!
+ * \brief Writes the data of an index to a file and opens it.
+ * \param data = The data
+ * \return A QSharedPointer to the FileIndex, which is null if it was rejected
+ */
+QSharedPointer<FileIndex> TestFileIndex::openData(const QByteArray &data) const
+{
+    const QString indexPath(tempDir.filePath("damaged.idx"));
+    QFile indexFile(indexPath);
+
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || indexFile.write(data) != data.size()) {
+        return QSharedPointer<FileIndex>();
+    }
+
+    indexFile.close();
+    return FileIndex::open(indexPath);
+}
+
+/*!
+ * \brief Reads a field of the valid index.
+ * \param offset = The offset of the field
+ * \param size = The size of the field in bytes
+ * \return The value
+ */
+quint64 TestFileIndex::field(int offset, int size) const
+{
+    quint64 value(0);
+    memcpy(&value, indexData.constData() + offset, static_cast<size_t>(size));
+    return value;
+}
+
+/*!
+ * \brief Checks that the valid index is opened and can be queried.
+ */
+void TestFileIndex::validIndex()
+{
+    const QSharedPointer<FileIndex> index(openData(indexData));
+
+    QVERIFY(!index.isNull());
+    QCOMPARE(index->rootPath(), rootPath);
+    QCOMPARE(index->entryCount(), 4);
+    QCOMPARE(index->findDir(rootPath), 0);
+    QCOMPARE(index->findDir(rootPath + "/a/b"), 2);
+    QCOMPARE(index->findDir(rootPath + "/missing"), -1);
+    QCOMPARE(index->locate(NameMatcher("note"), 10, QSet<int>()), QStringList(rootPath + "/a/b/note.txt"));
+    QCOMPARE(index->locate(NameMatcher("*.md"), 10, QSet<int>()), QStringList(rootPath + "/readme.md"));
+}
+
+/*!
+ * \brief Provides the sizes to which the index is truncated.
+ */
+void TestFileIndex::truncated_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("empty") << 0;
+    QTest::newRow("magic only") << 8;
+    QTest::newRow("partial header") << HeaderSize - 1;
+    QTest::newRow("header only") << HeaderSize;
+    QTest::newRow("half") << static_cast<int>(indexData.size() / 2);
+    QTest::newRow("last byte missing") << static_cast<int>(indexData.size() - 1);
+}
+
+/*!
+ * \brief Checks that a truncated index is rejected.
+ */
+void TestFileIndex::truncated()
+{
+    QFETCH(int, size);
+
+    QVERIFY(openData(indexData.left(size)).isNull());
+}
+
+/*!
+ * \brief Provides the fields that are damaged and the values they are set to.
+ */
+void TestFileIndex::corrupted_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("size");
+    QTest::addColumn<quint64>("value");
+
+    const int dirsOffset(static_cast<int>(field(40, 8)));
+    const int nameOffsetsOffset(static_cast<int>(field(48, 8)));
+    const int nameLengthsOffset(static_cast<int>(field(56, 8)));
+    const quint64 namesSize(field(88, 8));
+    const quint64 maxOffset(std::numeric_limits<quint64>::max());
+
+    QTest::newRow("magic") << 0 << 1 << quint64('Y');
+    QTest::newRow("version") << 8 << 4 << quint64(2);
+    QTest::newRow("no directories") << 12 << 4 << quint64(0);
+    QTest::newRow("directory count") << 12 << 4 << quint64(0xFFFFFFFF);
+    QTest::newRow("entry count") << 16 << 4 << quint64(0xFFFFFFFF);
+    QTest::newRow("root length") << 20 << 4 << quint64(0xFFFFFFFF);
+    QTest::newRow("root offset") << 32 << 8 << maxOffset;
+    QTest::newRow("directories offset") << 40 << 8 << maxOffset - 15;
+    QTest::newRow("name offsets offset") << 48 << 8 << maxOffset - 3;
+    QTest::newRow("name lengths offset") << 56 << 8 << maxOffset - 1;
+    QTest::newRow("entry directories offset") << 64 << 8 << quint64(indexData.size());
+    QTest::newRow("types offset") << 72 << 8 << maxOffset;
+    QTest::newRow("names offset") << 80 << 8 << maxOffset;
+    QTest::newRow("names size") << 88 << 8 << maxOffset;
+    QTest::newRow("names size too small") << 88 << 8 << namesSize - 1;
+    QTest::newRow("first name offset") << nameOffsetsOffset << 4 << quint64(0xFFFFFFFF);
+    QTest::newRow("middle name offset") << nameOffsetsOffset + 4 << 4 << namesSize;
+    QTest::newRow("first name length") << nameLengthsOffset << 2 << quint64(0xFFFF);
+    QTest::newRow("root with parent") << dirsOffset << 4 << quint64(0);
+    QTest::newRow("root with entry") << dirsOffset + 4 << 4 << quint64(0);
+    QTest::newRow("directory is its own parent") << dirsOffset + DirSize << 4 << quint64(1);
+    QTest::newRow("directory after its child") << dirsOffset + DirSize << 4 << quint64(2);
+    QTest::newRow("directory entry outside parent") << dirsOffset + DirSize + 4 << 4 << quint64(3);
+    QTest::newRow("first entry") << dirsOffset + DirSize + 8 << 4 << quint64(0xFFFFFFFF);
+    QTest::newRow("entry count of directory") << dirsOffset + DirSize + 12 << 4 << quint64(0xFFFFFFFF);
+}
+
+/*!
+ * \brief Checks that an index with a damaged field is rejected.
+ */
+void TestFileIndex::corrupted()
+{
+    QFETCH(int, offset);
+    QFETCH(int, size);
+    QFETCH(quint64, value);
+
+    QByteArray data(indexData);
+    memcpy(data.data() + offset, &value, static_cast<size_t>(size));
+
+    QVERIFY(openData(data).isNull());
+}
+
+/*!
+ * \brief Checks that an index in which any single byte is damaged is either rejected or can be queried safely.
+ * \note Damaged names, types or times still make a usable index, so those are only queried.
+ */
+void TestFileIndex::everyByteFlipped()
+{
+    for (int pos(0); pos < indexData.size(); ++pos) {
+        QByteArray data(indexData);
+        data[pos] = static_cast<char>(data.at(pos) ^ 0xFF);
+
+        const QSharedPointer<FileIndex> index(openData(data));
+
+        if (!index.isNull()) {
+            index->findDir(rootPath + "/a/b");
+            index->locate(NameMatcher("e"), 10, QSet<int>());
+            index->locate(NameMatcher("*"), 10, QSet<int>());
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestFileIndex)
+
+#include "tst_fileindex.moc"
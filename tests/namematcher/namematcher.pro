@@ -0,0 +1,17 @@
+QT       += testlib concurrent
+QT       -= gui
+
+CONFIG += c++17 testcase
+
+TARGET = tst_namematcher
+
+INCLUDEPATH += ../../src/types
+
+SOURCES += \
+    tst_namematcher.cpp \
+    ../../src/types/directoryentries.cpp \
+    ../../src/types/namematcher.cpp
+
+HEADERS += \
+    ../../src/types/directoryentries.h \
+    ../../src/types/namematcher.h
@@ -0,0 +1,127 @@
+#include "namematcher.h"
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+/*!
+ * \brief Tests the glob matching of the NameMatcher.
+ */
+class TestNameMatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void globMatches_data();
+    void globMatches();
+    void globArena();
+    void globBacktracking();
+
+private:
+    static bool matches(const QString &query, const QString &name);
+};
+
+/*!
+ * \brief Matches a single name.
+ * \param query = The query
+ * \param name = The name
+ * \return A Boolean value
+ */
+bool TestNameMatcher::matches(const QString &query, const QString &name)
+{
+    const QByteArray encodedName(name.toUtf8());
+    return NameMatcher(query).matchesName(encodedName.constData(), encodedName.size());
+}
+
+/*!
+ * \brief Provides globs, names and whether they match.
+ */
+void TestNameMatcher::globMatches_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("star suffix") << "*.txt" << "notes.txt" << true;
+    QTest::newRow("star suffix case") << "*.txt" << "NOTES.TXT" << true;
+    QTest::newRow("star matches nothing") << "*.txt" << ".txt" << true;
+    QTest::newRow("star suffix whole name") << "*.txt" << "notes.txt.bak" << false;
+    QTest::newRow("star suffix missing dot") << "*.txt" << "notestxt" << false;
+    QTest::newRow("star prefix") << "read*" << "README.md" << true;
+    QTest::newRow("star prefix whole name") << "read*" << "unread" << false;
+    QTest::newRow("only star") << "*" << "anything" << true;
+    QTest::newRow("double star") << "**" << "a" << true;
+    QTest::newRow("question mark") << "a?c" << "abc" << true;
+    QTest::newRow("question mark needs a character") << "a?c" << "ac" << false;
+    QTest::newRow("question mark one character") << "a?c" << "abbc" << false;
+    QTest::newRow("question mark multibyte") << "a?c" << QString::fromUtf8("aéc") << true;
+    QTest::newRow("question marks") << "file??.log" << "file10.log" << true;
+    QTest::newRow("question marks too short") << "file??.log" << "file1.log" << false;
+    QTest::newRow("stars in order") << "*a*b*" << "xaxbx" << true;
+    QTest::newRow("stars out of order") << "*a*b*" << "ba" << false;
+    QTest::newRow("star then question mark") << "*.?" << "archive.z" << true;
+    QTest::newRow("star backtracks") << "*ab" << "aab" << true;
+    QTest::newRow("star backtracks twice") << "*aab" << "aaab" << true;
+    QTest::newRow("stars backtrack") << "a*b*c" << "abcbc" << true;
+    QTest::newRow("multibyte literal") << QString::fromUtf8("*É*") << QString::fromUtf8("café") << true;
+    QTest::newRow("multibyte literal missing") << QString::fromUtf8("*É*") << "cafe" << false;
+    QTest::newRow("multibyte literal case") << QString::fromUtf8("*É") << QString::fromUtf8("CAFÉ") << true;
+    QTest::newRow("multibyte name") << "caf*" << QString::fromUtf8("café") << true;
+}
+
+/*!
+ * \brief Checks a glob against a single name.
+ */
+void TestNameMatcher::globMatches()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, name);
+    QFETCH(bool, expected);
+
+    QCOMPARE(matches(query, name), expected);
+}
+
+/*!
+ * \brief Checks that matching a whole arena at once gives the same results as matching the names one by one.
+ * \note The arena is searched for the literal part of the glob, so hits that span two names must not match.
+ */
+void TestNameMatcher::globArena()
+{
+    const QStringList names({"notes.txt", "NOTES.TXT", "notes", ".txt", "txt", "a.tx", "t.txt.bak", "x.txt", "..txt"});
+    const QStringList queries({"*.txt", "*.tx?", "n*.t*", "*txt", "?.txt", "*.*.*"});
+    DirectoryEntries entries;
+
+    for (const QString &name : names) {
+        const QByteArray encodedName(name.toUtf8());
+        entries.append(encodedName.constData(), encodedName.size(), DirectoryEntries::FileEntry, 0);
+    }
+
+    for (const QString &query : queries) {
+        const NameMatcher matcher(query);
+        QVector<bool> arenaMatches;
+
+        matcher.matchAll(entries, arenaMatches);
+
+        for (int entry(0); entry < entries.count(); ++entry) {
+            const QByteArrayView name(entries.nameView(entry));
+            QVERIFY2(arenaMatches.at(entry) == matcher.matchesName(name.data(), static_cast<int>(name.size())),
+                     qPrintable(query + " " + entries.name(entry)));
+        }
+    }
+}
+
+/*!
+ * \brief Checks that a glob with many stars that does not match a long name fails without trying every split.
+ */
+void TestNameMatcher::globBacktracking()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(!matches("*a*a*a*a*a*a*a*a*b", QString(4000, 'a')));
+    QVERIFY(matches("*a*a*a*a*a*a*a*a*b", QString(4000, 'a') + 'b'));
+    QVERIFY(timer.elapsed() < 1000);
+}
+
+QTEST_GUILESS_MAIN(TestNameMatcher)
+
+#include "tst_namematcher.moc"
@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    directoryentries \
+    namematcher \
+    fileindex \
+    actionmanager